@@ -1,13 +1,16 @@
 // #include <Wire.h>
 #include "SSD1306.h"
 
+// no buffer, test() only sends a command
+SSD1306 oled(OLED_HOR_RES_MAX, OLED_VER_RES_MAX, OLED_COLOR_DEPTH_1, 19, 18);
+
 void setup() {
   Serial.begin(9600);
   Serial.println("Uart openned.");
 }
 void loop() {
   Serial.println("main loop");
-  ssd1306.test();
+  oled.test();
   Serial.println("after test");
   delay(500);
-}
\ No newline at end of file
+}
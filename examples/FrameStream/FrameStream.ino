@@ -0,0 +1,28 @@
+// Show frames streamed from a host, see extras/host/frame_stream_tx.h
+#include "st7789v.h"
+#include "frame_stream.h"
+
+ST7789V tft(5, 16, 23);
+disp_line_ops_t ops = ST7789V::line_ops();
+FrameStreamRx rx(&ops, 0, 0);
+
+void setup() {
+  Serial.begin(2000000);
+  tft.init(240, 135);
+  ST7789V::set_rotation(1);
+  ST7789V::clear_screen_directly(0x0000);
+
+  // the host has to encode frames of the rotated panel, 240 x 135 by default
+  rx.set_size(ST7789V::m_st7789v_handle.width, ST7789V::m_st7789v_handle.height);
+}
+
+void loop() {
+  frame_stream_event_t ev = rx.poll(Serial);
+
+  // K after every frame, E asks the host for a key frame
+  if (ev == FRAME_STREAM_DONE) {
+    Serial.write('K');
+  } else if (ev == FRAME_STREAM_ERROR) {
+    Serial.write('E');
+  }
+}
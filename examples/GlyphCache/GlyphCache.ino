@@ -0,0 +1,29 @@
+// An uptime clock redrawn ten times a second, its glyphs come from a
+// 2 KB cache instead of being expanded to RGB565 on every draw.
+#include "st7789v.h"
+#include "font5x7.h"
+#include "glyph_cache.h"
+
+ST7789V tft(5, 16, 23);
+GlyphCacheBuffered<2048> cache;
+
+void setup() {
+  tft.init(240, 135);
+  ST7789V::set_rotation(1);
+  ST7789V::clear_screen_directly(0x0000);
+  ST7789V::set_glyph_cache(&cache);
+}
+
+void loop() {
+  uint32_t s = millis() / 1000;
+  uint8_t part[3] = { (uint8_t)(s / 3600 % 24), (uint8_t)(s / 60 % 60), (uint8_t)(s % 60) };
+  char text[9] = "00:00:00";
+
+  for (uint8_t i = 0; i < 3; i++) {
+    text[i * 3] = '0' + part[i] / 10;
+    text[i * 3 + 1] = '0' + part[i] % 10;
+  }
+
+  ST7789V::draw_string(96, 60, text, &font5x7, 0xFFFF, 0x0000);
+  delay(100);
+}
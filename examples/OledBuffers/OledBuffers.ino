@@ -0,0 +1,34 @@
+// The three ways of owning the SSD1306 buffer, pick one with OLED_BUFFER_MODE.
+// extras/size_report.sh builds all three to show what each costs.
+#include <Wire.h>
+#include "SSD1306.h"
+
+// 0 no buffer, 1 inside the object, 2 owned by the sketch
+#ifndef OLED_BUFFER_MODE
+#define OLED_BUFFER_MODE 1
+#endif
+
+#if OLED_BUFFER_MODE == 0
+SSD1306 oled(OLED_HOR_RES_MAX, OLED_VER_RES_MAX, OLED_COLOR_DEPTH_1, 19, 18);
+#elif OLED_BUFFER_MODE == 1
+SSD1306Buffered<> oled(19, 18);
+#else
+oled_buffer_t frame[OLED_BUFFER_SIZE];
+SSD1306 oled(OLED_HOR_RES_MAX, OLED_VER_RES_MAX, OLED_COLOR_DEPTH_1, 19, 18, frame);
+#endif
+
+void setup() {
+  Wire.begin();
+  oled.clear();
+}
+
+void loop() {
+  static uint8_t x;
+
+  // without a buffer this still works, whole pages are streamed
+  oled.fill_rect(x, 16, 8, 16, 0);
+  x = (x + 1) % (OLED_HOR_RES_MAX - 8);
+  oled.fill_rect(x, 16, 8, 16, 1);
+  oled.flush();
+  delay(20);
+}
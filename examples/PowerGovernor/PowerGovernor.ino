@@ -0,0 +1,46 @@
+// A bar that moves once a second, flushed by DispGovernor. The panel dims
+// after 15 s and sleeps after a minute, pressing the button lights it up.
+#include <Wire.h>
+#include "SSD1306.h"
+#include "disp_governor.h"
+
+#define BUTTON_PIN 0
+
+SSD1306Buffered<> oled(19, 18);
+disp_power_ops_t ops;
+disp_governor_cfg_t cfg = DISP_GOVERNOR_DEFAULTS;
+DispGovernor gov(&ops, &cfg);  // ops are filled in by setup()
+
+void setup() {
+  Wire.begin();
+  pinMode(BUTTON_PIN, INPUT_PULLUP);
+  oled.clear();
+
+  ops = oled.power_ops();
+  gov.wake(millis());
+}
+
+void loop() {
+  static uint32_t tick;
+  static uint8_t x;
+  uint32_t now = millis();
+
+  if (digitalRead(BUTTON_PIN) == LOW) {
+    gov.wake(now);
+  }
+
+  if (now - tick >= 1000) {
+    disp_area_t area = { 0, 24, OLED_HOR_RES_MAX - 1, 39 };
+
+    tick = now;
+    oled.fill_rect(x, 24, 8, 16, 0);
+    x = (x + 8) % OLED_HOR_RES_MAX;
+    oled.fill_rect(x, 24, 8, 16, 1);
+    gov.changed(now, &area);
+  }
+
+  gov.poll(now);
+
+  // a real sketch would sleep the MCU for up to gov.next_poll(now) ms
+  delay(10);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file Arduino.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Just enough of the Arduino core to build the drivers on a Linux
+ * host. Bus traffic is routed to the controller models, see host_bus.h.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __HOST_ARDUINO_H
+#define __HOST_ARDUINO_H
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define BIN 2
+#define OCT 8
+#define DEC 10
+#define HEX 16
+
+#define PROGMEM
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define memcpy_P memcpy
+
+void pinMode( uint8_t pin, uint8_t mode );
+void digitalWrite( uint8_t pin, uint8_t val );
+int digitalRead( uint8_t pin );
+
+void delay( unsigned long ms );
+void delayMicroseconds( unsigned int us );
+unsigned long millis( void );
+unsigned long micros( void );
+void yield( void );
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write( uint8_t c ) = 0;
+
+    size_t write( const uint8_t *buf, size_t len );
+    size_t print( const char *s );
+    size_t print( char c );
+    size_t print( long n, int base = DEC );
+    size_t print( unsigned long n, int base = DEC );
+    size_t print( int n, int base = DEC );
+    size_t print( unsigned int n, int base = DEC );
+    size_t println();
+    size_t println( const char *s );
+    size_t println( long n, int base = DEC );
+    size_t println( unsigned long n, int base = DEC );
+    size_t println( int n, int base = DEC );
+    size_t println( unsigned int n, int base = DEC );
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+
+    size_t readBytes( uint8_t *buf, size_t len );
+};
+
+/* stdout when echo is on, see host_serial_echo() */
+class HardwareSerial : public Stream
+{
+public:
+    void begin( unsigned long baud );
+    size_t write( uint8_t c );
+    int available();
+    int read();
+
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif
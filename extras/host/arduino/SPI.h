@@ -0,0 +1,45 @@
+/**
+ * @file SPI.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Host SPI, every byte goes to the model whose CS pin is low.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __HOST_SPI_H
+#define __HOST_SPI_H
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x01
+#define SPI_MODE2 0x02
+#define SPI_MODE3 0x03
+
+class SPISettings
+{
+public:
+    uint32_t clock;
+    uint8_t bit_order;
+    uint8_t mode;
+
+    SPISettings() : clock( 4000000 ), bit_order( MSBFIRST ), mode( SPI_MODE0 ) {}
+    SPISettings( uint32_t c, uint8_t b, uint8_t m ) : clock( c ), bit_order( b ), mode( m ) {}
+};
+
+class SPIClass
+{
+public:
+    void begin();
+    void end();
+    void beginTransaction( SPISettings settings );
+    void endTransaction();
+
+    uint8_t transfer( uint8_t data );
+    uint16_t transfer16( uint16_t data );
+    void transfer( void *buf, size_t count );
+};
+
+extern SPIClass SPI;
+
+#endif
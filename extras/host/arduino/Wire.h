@@ -0,0 +1,43 @@
+/**
+ * @file Wire.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Host I2C, a transmission is handed to the model at its address
+ * on endTransmission().
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __HOST_WIRE_H
+#define __HOST_WIRE_H
+
+#include "Arduino.h"
+
+/* same as the AVR core, writes past it are dropped */
+#define BUFFER_LENGTH 32
+
+class TwoWire : public Stream
+{
+private:
+    uint8_t m_addr;
+    uint8_t m_buf[BUFFER_LENGTH];
+    uint8_t m_len;
+
+public:
+    TwoWire();
+
+    void begin();
+    void setClock( uint32_t hz );
+    void beginTransmission( uint8_t addr );
+    uint8_t endTransmission( bool stop = true );
+    uint8_t requestFrom( uint8_t addr, uint8_t len );
+
+    size_t write( uint8_t c );
+    int available();
+    int read();
+
+    using Print::write;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,205 @@
+/**
+ * @file bus_trace.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Text format for recorded SPI and I2C traffic.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <ctype.h>
+#include <string.h>
+
+#include "bus_trace.h"
+
+// Writer ///////////////////////////////////////////////////////////////////////
+BusTraceWriter::BusTraceWriter( FILE *fp )
+{
+    m_fp = fp;
+    m_line.kind = 0;
+    m_line.len = 0;
+}
+
+BusTraceWriter::~BusTraceWriter()
+{
+    flush();
+}
+
+void BusTraceWriter::spi( bool dc, uint8_t b )
+{
+    uint8_t kind = dc ? BUS_TRACE_DATA : BUS_TRACE_CMD;
+
+    if( m_line.kind != kind || m_line.len >= BUS_TRACE_LINE_MAX ) {
+        flush();
+        m_line.kind = kind;
+    }
+
+    m_line.bytes[m_line.len++] = b;
+}
+
+void BusTraceWriter::deselect()
+{
+    bus_trace_rec_t rec = { BUS_TRACE_DESELECT, 0, { 0 } };
+
+    flush();
+    put( &rec );
+}
+
+void BusTraceWriter::i2c( uint8_t addr, const uint8_t *buf, uint16_t len )
+{
+    bus_trace_rec_t rec = { BUS_TRACE_I2C, 0, { 0 } };
+
+    if( len > BUS_TRACE_LINE_MAX ) {
+        len = BUS_TRACE_LINE_MAX;
+    }
+
+    rec.bytes[rec.len++] = addr;
+    memcpy( &rec.bytes[rec.len], buf, len );
+    rec.len += len;
+
+    flush();
+    put( &rec );
+}
+
+void BusTraceWriter::frame()
+{
+    bus_trace_rec_t rec = { BUS_TRACE_FRAME, 0, { 0 } };
+
+    flush();
+    put( &rec );
+    fflush( m_fp );
+}
+
+/**
+ * @brief Write out the pending run of spi bytes.
+ */
+void BusTraceWriter::flush()
+{
+    if( m_line.len ) {
+        put( &m_line );
+    }
+
+    m_line.kind = 0;
+    m_line.len = 0;
+}
+
+void BusTraceWriter::put( const bus_trace_rec_t *rec )
+{
+    uint16_t i;
+
+    fputc( rec->kind, m_fp );
+
+    for( i = 0; i < rec->len; i++ ) {
+        fprintf( m_fp, " %02X", rec->bytes[i] );
+    }
+
+    fputc( '\n', m_fp );
+}
+
+// Reader ///////////////////////////////////////////////////////////////////////
+BusTraceReader::BusTraceReader( FILE *fp )
+{
+    m_fp = fp;
+    m_line_no = 1;
+    m_kind = 0;
+}
+
+static void bus_trace_skip_line( FILE *fp )
+{
+    int c;
+
+    while( ( c = getc( fp ) ) != EOF && c != '\n' );
+}
+
+static int bus_trace_hex( int c )
+{
+    if( c >= '0' && c <= '9' ) {
+        return c - '0';
+    }
+
+    c = toupper( c );
+
+    return ( c >= 'A' && c <= 'F' ) ? c - 'A' + 10 : -1;
+}
+
+/**
+ * @brief Next record, blank lines, comments and unknown kinds are skipped.
+ * Long C and D lines come back as several records, long I lines are cut
+ * at one Wire buffer.
+ *
+ * @return false at the end of the trace
+ */
+bool BusTraceReader::next( bus_trace_rec_t *rec )
+{
+    int c, h, l;
+
+    while( !m_kind )
+    {
+        c = getc( m_fp );
+
+        if( c == EOF ) {
+            return false;
+        }
+
+        if( c == '\n' ) {
+            m_line_no++;
+        }
+        else if( c && strchr( "CDSIF", c ) ) {
+            m_kind = c;
+        }
+        else if( !isspace( c ) ) {
+            bus_trace_skip_line( m_fp );
+            m_line_no++;
+        }
+    }
+
+    rec->kind = m_kind;
+    rec->len = 0;
+
+    for( ;; )
+    {
+        do {
+            c = getc( m_fp );
+        }
+        while( c == ' ' || c == '\t' || c == '\r' );
+
+        if( c == '#' ) {
+            bus_trace_skip_line( m_fp );
+            c = '\n';
+        }
+
+        if( c == '\n' || c == EOF || ( h = bus_trace_hex( c ) ) < 0 )
+        {
+            if( c != '\n' && c != EOF ) {
+                bus_trace_skip_line( m_fp );
+            }
+
+            m_line_no++;
+            m_kind = 0;
+            return true;
+        }
+
+        if( rec->len == sizeof( rec->bytes ) )
+        {
+            /* the rest of a C or D run comes with the next call */
+            ungetc( c, m_fp );
+
+            if( rec->kind == BUS_TRACE_I2C ) {
+                bus_trace_skip_line( m_fp );
+                m_line_no++;
+                m_kind = 0;
+            }
+
+            return true;
+        }
+
+        l = bus_trace_hex( c = getc( m_fp ) );
+
+        if( l < 0 ) {
+            ungetc( c, m_fp );
+            rec->bytes[rec->len++] = h;
+        }
+        else {
+            rec->bytes[rec->len++] = ( h << 4 ) | l;
+        }
+    }
+}
@@ -0,0 +1,84 @@
+/**
+ * @file bus_trace.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Text format for recorded SPI and I2C traffic.
+ *
+ * One record per line, bytes in hex, '#' starts a comment:
+ *
+ *   C 2A            spi bytes with DC low, commands
+ *   D 00 34 00 F0   spi bytes with DC high, parameters and pixels
+ *   S               spi CS went high
+ *   I 3C 00 AE      one i2c write, address first
+ *   F               end of a frame
+ *
+ * The host bus writes it when a writer is attached, see host_bus_trace(),
+ * and a logic analyzer export converts to it line by line. The replay
+ * tool feeds C/D/S records to the st7789v model and I records to the
+ * ssd1306 model.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __BUS_TRACE_H
+#define __BUS_TRACE_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+/* bytes per line, longer runs are split */
+#define BUS_TRACE_LINE_MAX (32)
+
+typedef enum
+{
+    BUS_TRACE_CMD      = 'C',
+    BUS_TRACE_DATA     = 'D',
+    BUS_TRACE_DESELECT = 'S',
+    BUS_TRACE_I2C      = 'I',
+    BUS_TRACE_FRAME    = 'F',
+} bus_trace_kind_t;
+
+typedef struct
+{
+    uint8_t kind;
+    uint16_t len;
+    uint8_t bytes[BUS_TRACE_LINE_MAX + 1];  /* i2c address plus a full buffer */
+} bus_trace_rec_t;
+
+class BusTraceWriter
+{
+private:
+    FILE *m_fp;
+    bus_trace_rec_t m_line;     /* pending C or D run */
+
+    void put( const bus_trace_rec_t *rec );
+
+public:
+    BusTraceWriter( FILE *fp );
+    ~BusTraceWriter();
+
+    void spi( bool dc, uint8_t b );
+    void deselect();
+    void i2c( uint8_t addr, const uint8_t *buf, uint16_t len );
+    void frame();
+    void flush();
+};
+
+class BusTraceReader
+{
+private:
+    FILE *m_fp;
+    uint32_t m_line_no;
+    int m_kind;                 /* of the line being read, 0 between lines */
+
+public:
+    BusTraceReader( FILE *fp );
+
+    bool next( bus_trace_rec_t *rec );
+
+    uint32_t line_no() const
+    {
+        return m_line_no;
+    }
+};
+
+#endif
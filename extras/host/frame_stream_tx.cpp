@@ -0,0 +1,398 @@
+/**
+ * @file frame_stream_tx.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Host encoder for the delta frame stream of frame_stream.h.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_stream_tx.h"
+
+/* bytes of a RECT op, what merging two rectangles may waste at most */
+#define FS_TX_RECT_BYTES 9
+
+typedef struct
+{
+    uint32_t count;
+    uint16_t color;
+} fs_tx_rank_t;
+
+static int fs_tx_rank_cmp( const void *a, const void *b )
+{
+    const fs_tx_rank_t *x = ( const fs_tx_rank_t * )a;
+    const fs_tx_rank_t *y = ( const fs_tx_rank_t * )b;
+
+    return x->count < y->count ? 1 : ( x->count > y->count ? -1 : 0 );
+}
+
+static uint32_t fs_tx_area( const disp_area_t *a )
+{
+    return ( uint32_t )( a->x2 - a->x1 + 1 ) * ( a->y2 - a->y1 + 1 );
+}
+
+// Constructors ////////////////////////////////////////////////////////////////
+FrameStreamTx::FrameStreamTx( uint16_t width, uint16_t height )
+{
+    uint32_t n = ( uint32_t )width * height;
+
+    m_width = width;
+    m_height = height;
+    m_prev = new uint16_t[n];
+    m_scratch = new uint16_t[n];
+    m_index = new int16_t[0x10000];
+    m_hist = new uint32_t[0x10000];
+    m_colors = new uint16_t[0x10000];
+    m_rects = new disp_area_t[( height + FRAME_STREAM_TX_BAND - 1 ) / FRAME_STREAM_TX_BAND];
+
+    m_cap = 4096;
+    m_out = ( uint8_t * )malloc( m_cap );
+    m_len = 0;
+
+    memset( m_hist, 0, 0x10000 * sizeof( uint32_t ) );
+    memset( &m_stats, 0, sizeof( m_stats ) );
+    m_seq = 0;
+    keyframe();
+}
+
+FrameStreamTx::~FrameStreamTx()
+{
+    delete[] m_prev;
+    delete[] m_scratch;
+    delete[] m_index;
+    delete[] m_hist;
+    delete[] m_colors;
+    delete[] m_rects;
+    free( m_out );
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+/**
+ * @brief Forget the previous frame and the palette, both are sent again.
+ */
+void FrameStreamTx::keyframe()
+{
+    uint16_t i;
+
+    m_key = true;
+
+    for( i = 0; i < FRAME_STREAM_PALETTE_SIZE; i++ ) {
+        m_pal_valid[i] = false;
+    }
+
+    memset( m_index, 0xFF, 0x10000 * sizeof( int16_t ) );
+}
+
+const uint8_t *FrameStreamTx::encode( const uint16_t *frame, size_t *len )
+{
+    uint16_t band, bands = ( m_height + FRAME_STREAM_TX_BAND - 1 ) / FRAME_STREAM_TX_BAND;
+    uint16_t i, n = 0;
+
+    m_len = 0;
+    *len = 0;
+
+    /* one rectangle around the changes of every band */
+    for( band = 0; band < bands; band++ )
+    {
+        disp_area_t r = { ( disp_coord_t )m_width, 0, -1, -1 };
+        uint16_t y, y_end = band * FRAME_STREAM_TX_BAND + FRAME_STREAM_TX_BAND;
+
+        if( y_end > m_height ) {
+            y_end = m_height;
+        }
+
+        for( y = band * FRAME_STREAM_TX_BAND; y < y_end; y++ )
+        {
+            const uint16_t *cur = frame + ( uint32_t )y * m_width;
+            const uint16_t *old = m_prev + ( uint32_t )y * m_width;
+            disp_coord_t x1 = 0, x2 = m_width - 1;
+
+            if( !m_key )
+            {
+                if( !memcmp( cur, old, m_width * sizeof( uint16_t ) ) ) {
+                    continue;
+                }
+
+                while( cur[x1] == old[x1] ) {
+                    x1++;
+                }
+
+                while( cur[x2] == old[x2] ) {
+                    x2--;
+                }
+            }
+
+            if( r.y2 < 0 ) {
+                r.y1 = y;
+            }
+
+            r.x1 = disp_min( r.x1, x1 );
+            r.x2 = disp_max( r.x2, x2 );
+            r.y2 = y;
+        }
+
+        if( r.y2 < 0 ) {
+            continue;
+        }
+
+        /* stacked rectangles of about the same columns become one */
+        if( n )
+        {
+            disp_area_t *last = &m_rects[n - 1], joined;
+
+            disp_area_join( &joined, last, &r );
+
+            if( last->y2 + 1 == r.y1 &&
+                ( fs_tx_area( &joined ) - fs_tx_area( last ) - fs_tx_area( &r ) ) * 2 <= FS_TX_RECT_BYTES ) {
+                *last = joined;
+                continue;
+            }
+        }
+
+        m_rects[n++] = r;
+    }
+
+    if( !n ) {
+        return m_out;
+    }
+
+    put( FRAME_STREAM_SYNC0 );
+    put( FRAME_STREAM_SYNC1 );
+    m_sum = 0;
+    put( m_seq++ );
+
+    update_palette( frame, m_rects, n );
+
+    for( i = 0; i < n; i++ ) {
+        encode_rect( frame, &m_rects[i] );
+    }
+
+    put( FRAME_STREAM_END );
+    put( m_sum );
+
+    memcpy( m_prev, frame, ( uint32_t )m_width * m_height * sizeof( uint16_t ) );
+    m_key = false;
+
+    m_stats.frames++;
+    m_stats.bytes += m_len;
+    m_stats.rects += n;
+    *len = m_len;
+
+    return m_out;
+}
+
+// Private Methods //////////////////////////////////////////////////////////////
+void FrameStreamTx::put( uint8_t b )
+{
+    if( m_len == m_cap ) {
+        m_cap *= 2;
+        m_out = ( uint8_t * )realloc( m_out, m_cap );
+    }
+
+    m_out[m_len++] = b;
+    m_sum += b;
+}
+
+void FrameStreamTx::put_color( uint16_t c )
+{
+    put( c >> 8 );
+    put( c & 0xFF );
+}
+
+/**
+ * @brief Give the most used colors of the changed rectangles a palette
+ * entry, taking those of colors that dropped out of the top, and send the
+ * entries that changed.
+ */
+void FrameStreamTx::update_palette( const uint16_t *frame, const disp_area_t *rects, uint16_t n )
+{
+    bool keep[FRAME_STREAM_PALETTE_SIZE], changed[FRAME_STREAM_PALETTE_SIZE];
+    uint32_t i, k, top, ncolors = 0;
+    fs_tx_rank_t *rank;
+    disp_coord_t x, y;
+
+    for( i = 0; i < n; i++ )
+    {
+        for( y = rects[i].y1; y <= rects[i].y2; y++ )
+        {
+            for( x = rects[i].x1; x <= rects[i].x2; x++ )
+            {
+                uint16_t c = frame[( uint32_t )y * m_width + x];
+
+                if( !m_hist[c]++ ) {
+                    m_colors[ncolors++] = c;
+                }
+            }
+        }
+    }
+
+    rank = new fs_tx_rank_t[ncolors];
+
+    for( i = 0; i < ncolors; i++ ) {
+        rank[i].color = m_colors[i];
+        rank[i].count = m_hist[m_colors[i]];
+        m_hist[m_colors[i]] = 0;
+    }
+
+    qsort( rank, ncolors, sizeof( *rank ), fs_tx_rank_cmp );
+
+    for( top = 0; top < ncolors && top < FRAME_STREAM_PALETTE_SIZE; top++ )
+    {
+        if( rank[top].count < FRAME_STREAM_TX_PAL_MIN ) {
+            break;
+        }
+    }
+
+    memset( keep, 0, sizeof( keep ) );
+    memset( changed, 0, sizeof( changed ) );
+
+    for( i = 0; i < top; i++ )
+    {
+        if( m_index[rank[i].color] >= 0 ) {
+            keep[m_index[rank[i].color]] = true;
+        }
+    }
+
+    for( i = 0; i < top; i++ )
+    {
+        uint16_t c = rank[i].color;
+
+        if( m_index[c] >= 0 ) {
+            continue;
+        }
+
+        /* a free entry first, else one no top color holds */
+        for( k = 0; k < FRAME_STREAM_PALETTE_SIZE && m_pal_valid[k]; k++ ) {
+        }
+
+        if( k == FRAME_STREAM_PALETTE_SIZE )
+        {
+            for( k = 0; k < FRAME_STREAM_PALETTE_SIZE && keep[k]; k++ ) {
+            }
+
+            m_index[m_palette[k]] = -1;
+        }
+
+        m_palette[k] = c;
+        m_pal_valid[k] = true;
+        m_index[c] = k;
+        keep[k] = true;
+        changed[k] = true;
+    }
+
+    delete[] rank;
+
+    for( i = 0; i < FRAME_STREAM_PALETTE_SIZE; )
+    {
+        if( !changed[i] ) {
+            i++;
+            continue;
+        }
+
+        for( k = i; k < FRAME_STREAM_PALETTE_SIZE && changed[k]; k++ ) {
+        }
+
+        put( FRAME_STREAM_PAL );
+        put( i );
+        put( k - i - 1 );
+
+        m_stats.palette_sets += k - i;
+
+        for( ; i < k; i++ ) {
+            put_color( m_palette[i] );
+        }
+    }
+}
+
+void FrameStreamTx::encode_rect( const uint16_t *frame, const disp_area_t *area )
+{
+    uint16_t w = area->x2 - area->x1 + 1, h = area->y2 - area->y1 + 1;
+    uint16_t row;
+
+    put( FRAME_STREAM_RECT );
+    put( area->x1 & 0xFF );
+    put( area->x1 >> 8 );
+    put( area->y1 & 0xFF );
+    put( area->y1 >> 8 );
+    put( w & 0xFF );
+    put( w >> 8 );
+    put( h & 0xFF );
+    put( h >> 8 );
+
+    for( row = 0; row < h; row++ ) {
+        memcpy( m_scratch + ( uint32_t )row * w,
+                frame + ( uint32_t )( area->y1 + row ) * m_width + area->x1,
+                w * sizeof( uint16_t ) );
+    }
+
+    encode_pixels( m_scratch, ( uint32_t )w * h );
+}
+
+/**
+ * @brief Runs of three or more become RUN or IRUN, which beats two raw
+ * pixels plus an op, everything between is one IDX or RAW literal.
+ */
+void FrameStreamTx::encode_pixels( const uint16_t *px, uint32_t n )
+{
+    uint32_t i = 0, j, run;
+
+    m_stats.pixels += n;
+
+    while( i < n )
+    {
+        bool indexed = true;
+
+        for( run = 1; i + run < n && run < FRAME_STREAM_OP_MAX && px[i + run] == px[i]; run++ ) {
+        }
+
+        if( run >= 3 )
+        {
+            if( m_index[px[i]] >= 0 ) {
+                put( FRAME_STREAM_IRUN );
+                put( run - 1 );
+                put( m_index[px[i]] );
+            }
+            else {
+                put( FRAME_STREAM_RUN );
+                put( run - 1 );
+                put_color( px[i] );
+            }
+
+            m_stats.run_pixels += run;
+            i += run;
+            continue;
+        }
+
+        for( j = i; j < n && j - i < FRAME_STREAM_OP_MAX; j++ )
+        {
+            if( j + 2 < n && px[j] == px[j + 1] && px[j] == px[j + 2] ) {
+                break;
+            }
+
+            indexed = indexed && m_index[px[j]] >= 0;
+        }
+
+        put( indexed ? FRAME_STREAM_IDX : FRAME_STREAM_RAW );
+        put( j - i - 1 );
+
+        if( indexed ) {
+            m_stats.index_pixels += j - i;
+        }
+        else {
+            m_stats.raw_pixels += j - i;
+        }
+
+        for( ; i < j; i++ )
+        {
+            if( indexed ) {
+                put( m_index[px[i]] );
+            }
+            else {
+                put_color( px[i] );
+            }
+        }
+    }
+}
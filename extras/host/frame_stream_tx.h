@@ -0,0 +1,93 @@
+/**
+ * @file frame_stream_tx.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Host encoder for the delta frame stream of frame_stream.h.
+ *
+ * Keeps the previous frame and sends what changed, split into bands of
+ * FRAME_STREAM_TX_BAND rows. Each band yields one rectangle around its
+ * changes, and bands whose rectangles line up are merged. Pixels are
+ * coded as runs where a color repeats, else as palette indexes if all of
+ * them are in the palette, else raw. The most used colors of each frame
+ * replace palette entries that were not used.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __FRAME_STREAM_TX_H
+#define __FRAME_STREAM_TX_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "frame_stream.h"
+
+#ifndef FRAME_STREAM_TX_BAND
+    #define FRAME_STREAM_TX_BAND (16)
+#endif
+
+/* uses a color needs before it earns a palette entry */
+#define FRAME_STREAM_TX_PAL_MIN (3)
+
+typedef struct
+{
+    uint32_t frames;
+    uint64_t bytes;
+    uint32_t rects;
+    uint64_t pixels;            /* sent inside rectangles */
+    uint64_t run_pixels;
+    uint64_t index_pixels;
+    uint64_t raw_pixels;
+    uint32_t palette_sets;
+} frame_stream_tx_stats_t;
+
+class FrameStreamTx
+{
+private:
+    uint16_t m_width, m_height;
+    uint16_t *m_prev;
+    bool m_key;
+    uint8_t m_seq;
+
+    uint16_t m_palette[FRAME_STREAM_PALETTE_SIZE];
+    bool m_pal_valid[FRAME_STREAM_PALETTE_SIZE];
+    int16_t *m_index;           /* color to palette entry, -1 if none */
+
+    uint16_t *m_scratch;        /* pixels of one rectangle */
+    uint32_t *m_hist;           /* uses per color in this frame */
+    uint16_t *m_colors;         /* colors with a nonzero m_hist */
+    disp_area_t *m_rects;
+
+    uint8_t *m_out;
+    size_t m_len, m_cap;
+    uint8_t m_sum;
+
+    frame_stream_tx_stats_t m_stats;
+
+    void put( uint8_t b );
+    void put_color( uint16_t c );
+    void update_palette( const uint16_t *frame, const disp_area_t *rects, uint16_t n );
+    void encode_rect( const uint16_t *frame, const disp_area_t *area );
+    void encode_pixels( const uint16_t *px, uint32_t n );
+
+public:
+    FrameStreamTx( uint16_t width, uint16_t height );
+    ~FrameStreamTx();
+
+    /* the next frame is sent whole, e.g. after the receiver reported an error */
+    void keyframe();
+
+    /**
+     * @brief Encode frame, width * height rgb565 in row order.
+     *
+     * @return the stream bytes, valid until the next call, *len is 0 when
+     * nothing changed
+     */
+    const uint8_t *encode( const uint16_t *frame, size_t *len );
+
+    const frame_stream_tx_stats_t *stats() const
+    {
+        return &m_stats;
+    }
+};
+
+#endif
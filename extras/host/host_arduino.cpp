@@ -0,0 +1,530 @@
+/**
+ * @file host_arduino.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Host Arduino core, pins, time, Serial, SPI and Wire.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "Wire.h"
+#include "host_bus.h"
+
+#define HOST_PINS 256
+
+static uint8_t host_pins[HOST_PINS];
+
+typedef struct
+{
+    SpiDeviceModel *model;
+    uint8_t cs;
+    uint8_t dc;
+    bool trace;
+} host_spi_slot_t;
+
+static host_spi_slot_t host_spi[HOST_SPI_DEVICES];
+static uint8_t host_spi_count;
+static uint32_t host_spi_clock;
+static uint64_t host_spi_time;
+static uint32_t host_spi_overhead;
+static host_spi_stats_t host_spi_stats;
+static bool host_spi_named;     /* last_cs holds the first device of it */
+
+static Ssd1306Model *host_i2c_model;
+static uint8_t host_i2c_addr;
+
+static BusTraceWriter *host_trace;
+static bool host_echo;
+
+HardwareSerial Serial;
+SPIClass SPI;
+TwoWire Wire;
+
+static void host_spi_attach( SpiDeviceModel *model, uint8_t cs, uint8_t dc, bool trace )
+{
+    host_spi_slot_t *slot = NULL;
+
+    for( uint8_t i = 0; i < host_spi_count; i++ ) {
+        if( host_spi[i].cs == cs ) {
+            slot = &host_spi[i];
+        }
+    }
+
+    if( !model )
+    {
+        if( slot ) {
+            *slot = host_spi[--host_spi_count];
+        }
+
+        return;
+    }
+
+    if( !slot )
+    {
+        if( host_spi_count >= HOST_SPI_DEVICES ) {
+            fprintf( stderr, "host_bus: more than %d SPI devices\n", HOST_SPI_DEVICES );
+            return;
+        }
+
+        slot = &host_spi[host_spi_count++];
+    }
+
+    slot->model = model;
+    slot->cs = cs;
+    slot->dc = dc;
+    slot->trace = trace;
+    host_pins[cs] = HIGH;
+
+    model->set_clock( host_spi_clock );
+}
+
+void host_bus_attach_spi( St7789vModel *model, uint8_t cs, uint8_t dc )
+{
+    host_spi_attach( model, cs, dc, true );
+}
+
+void host_bus_attach_spi_device( SpiDeviceModel *model, uint8_t cs, uint8_t dc )
+{
+    host_spi_attach( model, cs, dc, false );
+}
+
+void host_bus_attach_i2c( Ssd1306Model *model, uint8_t addr )
+{
+    host_i2c_model = model;
+    host_i2c_addr = addr;
+}
+
+void host_bus_trace( BusTraceWriter *writer )
+{
+    if( host_trace ) {
+        host_trace->flush();
+    }
+
+    host_trace = writer;
+}
+
+uint32_t host_bus_spi_clock()
+{
+    return host_spi_clock;
+}
+
+uint64_t host_bus_spi_time_ns()
+{
+    return host_spi_time;
+}
+
+void host_bus_spi_overhead( uint32_t ns )
+{
+    host_spi_overhead = ns;
+}
+
+const host_spi_stats_t *host_bus_spi_stats()
+{
+    return &host_spi_stats;
+}
+
+void host_bus_spi_reset_stats()
+{
+    bool open = host_spi_stats.open;
+
+    memset( &host_spi_stats, 0, sizeof( host_spi_stats ) );
+    host_spi_stats.open = open;
+    host_spi_stats.last_cs = 0xFF;
+}
+
+void host_bus_frame()
+{
+    if( host_trace ) {
+        host_trace->frame();
+    }
+}
+
+void host_serial_echo( bool on )
+{
+    host_echo = on;
+}
+
+// Pins and time ////////////////////////////////////////////////////////////////
+void pinMode( uint8_t pin, uint8_t mode )
+{
+    ( void )pin;
+    ( void )mode;
+}
+
+void digitalWrite( uint8_t pin, uint8_t val )
+{
+    uint8_t old = host_pins[pin];
+
+    host_pins[pin] = val ? HIGH : LOW;
+
+    if( old || !val ) {
+        return;
+    }
+
+    for( uint8_t i = 0; i < host_spi_count; i++ )
+    {
+        if( host_spi[i].cs != pin ) {
+            continue;
+        }
+
+        if( host_trace && host_spi[i].trace ) {
+            host_trace->deselect();
+        }
+
+        host_spi[i].model->deselect();
+    }
+}
+
+int digitalRead( uint8_t pin )
+{
+    return host_pins[pin];
+}
+
+static uint64_t host_now_us()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void host_sleep_us( uint64_t us )
+{
+    struct timespec ts = { ( time_t )( us / 1000000 ), ( long )( us % 1000000 ) * 1000 };
+
+    nanosleep( &ts, NULL );
+}
+
+void delay( unsigned long ms )
+{
+    host_sleep_us( ( uint64_t )ms * 1000 );
+}
+
+void delayMicroseconds( unsigned int us )
+{
+    host_sleep_us( us );
+}
+
+unsigned long millis( void )
+{
+    return ( unsigned long )( host_now_us() / 1000 );
+}
+
+unsigned long micros( void )
+{
+    return ( unsigned long )host_now_us();
+}
+
+void yield( void )
+{
+}
+
+// Print ////////////////////////////////////////////////////////////////////////
+size_t Print::write( const uint8_t *buf, size_t len )
+{
+    size_t n = 0;
+
+    while( len-- ) {
+        n += write( *buf++ );
+    }
+
+    return n;
+}
+
+size_t Print::print( const char *s )
+{
+    return write( ( const uint8_t * )s, strlen( s ) );
+}
+
+size_t Print::print( char c )
+{
+    return write( ( uint8_t )c );
+}
+
+size_t Print::print( unsigned long n, int base )
+{
+    char buf[8 * sizeof( long ) + 1];
+    char *p = &buf[sizeof( buf ) - 1];
+
+    if( base < 2 ) {
+        base = DEC;
+    }
+
+    *p = '\0';
+
+    do {
+        unsigned long d = n % base;
+
+        *--p = d < 10 ? '0' + d : 'A' + d - 10;
+        n /= base;
+    }
+    while( n );
+
+    return print( p );
+}
+
+size_t Print::print( long n, int base )
+{
+    if( n < 0 && base == DEC ) {
+        return print( '-' ) + print( ( unsigned long ) - n, base );
+    }
+
+    return print( ( unsigned long )n, base );
+}
+
+size_t Print::print( int n, int base )
+{
+    return print( ( long )n, base );
+}
+
+size_t Print::print( unsigned int n, int base )
+{
+    return print( ( unsigned long )n, base );
+}
+
+size_t Print::println()
+{
+    return write( '\r' ) + write( '\n' );
+}
+
+size_t Print::println( const char *s )
+{
+    return print( s ) + println();
+}
+
+size_t Print::println( long n, int base )
+{
+    return print( n, base ) + println();
+}
+
+size_t Print::println( unsigned long n, int base )
+{
+    return print( n, base ) + println();
+}
+
+size_t Print::println( int n, int base )
+{
+    return print( n, base ) + println();
+}
+
+size_t Print::println( unsigned int n, int base )
+{
+    return print( n, base ) + println();
+}
+
+size_t Stream::readBytes( uint8_t *buf, size_t len )
+{
+    size_t n = 0;
+
+    while( n < len && available() ) {
+        buf[n++] = read();
+    }
+
+    return n;
+}
+
+// Serial ///////////////////////////////////////////////////////////////////////
+void HardwareSerial::begin( unsigned long baud )
+{
+    ( void )baud;
+}
+
+size_t HardwareSerial::write( uint8_t c )
+{
+    if( host_echo && c != '\r' ) {
+        putchar( c );
+    }
+
+    return 1;
+}
+
+int HardwareSerial::available()
+{
+    return 0;
+}
+
+int HardwareSerial::read()
+{
+    return -1;
+}
+
+// SPI //////////////////////////////////////////////////////////////////////////
+void SPIClass::begin()
+{
+}
+
+void SPIClass::end()
+{
+}
+
+void SPIClass::beginTransaction( SPISettings settings )
+{
+    if( host_spi_stats.open ) {
+        host_spi_stats.nested++;
+    }
+
+    host_spi_stats.open = true;
+    host_spi_stats.transactions++;
+    host_spi_stats.last_bytes = 0;
+    host_spi_stats.last_cs = 0xFF;
+    host_spi_named = false;
+
+    host_spi_clock = settings.clock;
+    host_spi_time += host_spi_overhead;
+
+    for( uint8_t i = 0; i < host_spi_count; i++ ) {
+        host_spi[i].model->set_clock( settings.clock );
+    }
+}
+
+void SPIClass::endTransaction()
+{
+    host_spi_stats.open = false;
+}
+
+uint8_t SPIClass::transfer( uint8_t data )
+{
+    host_spi_slot_t *slot = NULL;
+    bool dc;
+
+    if( host_spi_clock ) {
+        host_spi_time += 8000000000ULL / host_spi_clock;
+    }
+
+    if( host_spi_stats.open ) {
+        host_spi_stats.last_bytes++;
+    }
+    else {
+        host_spi_stats.stray_bytes++;
+    }
+
+    for( uint8_t i = 0; i < host_spi_count; i++ )
+    {
+        if( host_pins[host_spi[i].cs] ) {
+            continue;
+        }
+
+        if( slot ) {
+            host_spi_stats.conflicts++;
+            return 0xFF;
+        }
+
+        slot = &host_spi[i];
+    }
+
+    if( !slot ) {
+        return 0xFF;
+    }
+
+    /* the first device of a transaction names it, a second one spoils it */
+    if( host_spi_stats.open && !host_spi_named ) {
+        host_spi_stats.last_cs = slot->cs;
+        host_spi_named = true;
+    }
+    else if( host_spi_stats.open && host_spi_stats.last_cs != slot->cs ) {
+        host_spi_stats.last_cs = 0xFF;
+    }
+
+    dc = host_pins[slot->dc];
+
+    if( host_trace && slot->trace ) {
+        host_trace->spi( dc, data );
+    }
+
+    return slot->model->transfer( dc, data );
+}
+
+uint16_t SPIClass::transfer16( uint16_t data )
+{
+    uint16_t hi = transfer( data >> 8 );
+
+    return ( hi << 8 ) | transfer( data & 0xFF );
+}
+
+void SPIClass::transfer( void *buf, size_t count )
+{
+    uint8_t *p = ( uint8_t * )buf;
+
+    while( count-- ) {
+        *p = transfer( *p );
+        p++;
+    }
+}
+
+// Wire /////////////////////////////////////////////////////////////////////////
+TwoWire::TwoWire()
+{
+    m_addr = 0;
+    m_len = 0;
+}
+
+void TwoWire::begin()
+{
+}
+
+void TwoWire::setClock( uint32_t hz )
+{
+    ( void )hz;
+}
+
+void TwoWire::beginTransmission( uint8_t addr )
+{
+    m_addr = addr;
+    m_len = 0;
+}
+
+/**
+ * @return 0 on success, 2 for an address nobody answers, like the AVR core
+ */
+uint8_t TwoWire::endTransmission( bool stop )
+{
+    ( void )stop;
+
+    if( host_trace ) {
+        host_trace->i2c( m_addr, m_buf, m_len );
+    }
+
+    if( !host_i2c_model || m_addr != host_i2c_addr ) {
+        return 2;
+    }
+
+    host_i2c_model->i2c_write( m_buf, m_len );
+    m_len = 0;
+
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom( uint8_t addr, uint8_t len )
+{
+    ( void )addr;
+    ( void )len;
+
+    return 0;
+}
+
+size_t TwoWire::write( uint8_t c )
+{
+    if( m_len >= BUFFER_LENGTH ) {
+        return 0;
+    }
+
+    m_buf[m_len++] = c;
+
+    return 1;
+}
+
+int TwoWire::available()
+{
+    return 0;
+}
+
+int TwoWire::read()
+{
+    return -1;
+}
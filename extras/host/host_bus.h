@@ -0,0 +1,80 @@
+/**
+ * @file host_bus.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Wiring of the host Arduino core to the controller models.
+ *
+ * Build the library and a sketch for the host with hardware SPI, e.g.
+ *
+ *   g++ -std=gnu++11 -O2 -DST7789V_USE_SOFTWARE_SPI=0 \
+ *       -Iextras/host/arduino -Iextras/host -Isrc \
+ *       $(find src extras/host -maxdepth 1 -name '*.cpp') app.cpp -lrt -o app
+ *
+ * then attach a model per device before init() is called.
+ * extras/host/tests/run.sh builds and runs the host tests this way.
+ *
+ * Up to HOST_SPI_DEVICES models share the SPI bus, keyed by their CS pin.
+ * The core keeps a bus clock of its own: every byte takes 8 bits at the
+ * clock of its transaction and every transaction a fixed overhead, so
+ * latency on the shared bus can be measured without real hardware.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __HOST_BUS_H
+#define __HOST_BUS_H
+
+#include <inttypes.h>
+
+#include "spi_device_model.h"
+#include "st7789v_model.h"
+#include "ssd1306_model.h"
+#include "bus_trace.h"
+
+#define HOST_SPI_DEVICES (4)
+
+typedef struct
+{
+    uint32_t transactions;
+    uint32_t nested;            /* beginTransaction() while one was open */
+    uint32_t stray_bytes;       /* clocked outside any transaction */
+    uint32_t conflicts;         /* clocked with more than one CS low */
+    uint32_t last_bytes;        /* of the latest transaction */
+    uint8_t last_cs;            /* whom it talked to, 0xFF for nobody or several */
+    bool open;
+} host_spi_stats_t;
+
+/*
+ * bytes clocked while cs is low go to model, dc selects command or data,
+ * NULL detaches whatever sits on cs. Its traffic is what host_bus_trace()
+ * records.
+ */
+void host_bus_attach_spi( St7789vModel *model, uint8_t cs, uint8_t dc );
+
+/* another model on the bus behind its own cs, not traced, dc 0xFF for none */
+void host_bus_attach_spi_device( SpiDeviceModel *model, uint8_t cs, uint8_t dc = 0xFF );
+
+/* clock of the latest SPI transaction, also handed to the attached models */
+uint32_t host_bus_spi_clock();
+
+/* bus time since start, in ns, see above */
+uint64_t host_bus_spi_time_ns();
+
+/* cost of a transaction on top of its bytes, CS and bus setup, 0 at start */
+void host_bus_spi_overhead( uint32_t ns );
+
+const host_spi_stats_t *host_bus_spi_stats();
+void host_bus_spi_reset_stats();
+
+/* write transactions to addr go to model */
+void host_bus_attach_i2c( Ssd1306Model *model, uint8_t addr );
+
+/* record all traffic, NULL stops, see bus_trace.h */
+void host_bus_trace( BusTraceWriter *writer );
+
+/* mark the end of a frame in the trace */
+void host_bus_frame();
+
+/* copy Serial output to stdout, off by default */
+void host_serial_echo( bool on );
+
+#endif
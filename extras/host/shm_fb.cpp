@@ -0,0 +1,222 @@
+/**
+ * @file shm_fb.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Frame memory in a POSIX shared memory object, for live viewers.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shm_fb.h"
+
+/* pixels start on a cache line of their own */
+#define SHM_FB_DATA_OFFSET ((sizeof(shm_fb_header_t) + 63) & ~(size_t)63)
+
+// Constructors ////////////////////////////////////////////////////////////////
+ShmFrameBuffer::ShmFrameBuffer()
+{
+    m_name[0] = '\0';
+    m_hdr = NULL;
+    m_size = 0;
+    m_owner = false;
+    m_seen = 1;
+}
+
+ShmFrameBuffer::~ShmFrameBuffer()
+{
+    close();
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+/**
+ * @brief Create the object and map it, the name looks like "/st7789v".
+ * An object left over from a crashed run is reused.
+ */
+bool ShmFrameBuffer::create( const char *name, uint16_t width, uint16_t height,
+                             shm_fb_format_t format )
+{
+    uint32_t stride = format == SHM_FB_RGB565 ? width * 2 : width;
+    uint32_t rows = format == SHM_FB_RGB565 ? height : height / 8;
+    int fd;
+    void *p;
+
+    close();
+
+    m_size = SHM_FB_DATA_OFFSET + ( size_t )stride * rows;
+    fd = shm_open( name, O_CREAT | O_RDWR, 0644 );
+
+    if( fd < 0 ) {
+        return false;
+    }
+
+    if( ftruncate( fd, m_size ) < 0 ) {
+        ::close( fd );
+        return false;
+    }
+
+    p = mmap( NULL, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    ::close( fd );
+
+    if( p == MAP_FAILED ) {
+        return false;
+    }
+
+    m_hdr = ( shm_fb_header_t * )p;
+    memset( m_hdr, 0, m_size );
+    m_hdr->version = SHM_FB_VERSION;
+    m_hdr->format = format;
+    m_hdr->width = width;
+    m_hdr->height = height;
+    m_hdr->stride = stride;
+    m_hdr->data_offset = SHM_FB_DATA_OFFSET;
+    m_hdr->view.x2 = width - 1;
+    m_hdr->view.y2 = height - 1;
+    m_hdr->dirty = m_hdr->view;
+
+    /* a reader checks the magic last */
+    __atomic_store_n( &m_hdr->magic, SHM_FB_MAGIC, __ATOMIC_RELEASE );
+
+    snprintf( m_name, sizeof( m_name ), "%s", name );
+    m_owner = true;
+
+    return true;
+}
+
+/**
+ * @brief Map an existing object read only, for a viewer.
+ */
+bool ShmFrameBuffer::open( const char *name )
+{
+    off_t size;
+    int fd;
+    void *p;
+
+    close();
+
+    fd = shm_open( name, O_RDONLY, 0 );
+
+    if( fd < 0 ) {
+        return false;
+    }
+
+    size = lseek( fd, 0, SEEK_END );
+
+    if( size < ( off_t )SHM_FB_DATA_OFFSET ) {
+        ::close( fd );
+        return false;
+    }
+
+    p = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+    ::close( fd );
+
+    if( p == MAP_FAILED ) {
+        return false;
+    }
+
+    m_hdr = ( shm_fb_header_t * )p;
+    m_size = size;
+
+    if( __atomic_load_n( &m_hdr->magic, __ATOMIC_ACQUIRE ) != SHM_FB_MAGIC ||
+        m_hdr->version != SHM_FB_VERSION ) {
+        close();
+        return false;
+    }
+
+    m_seen = 1;
+
+    return true;
+}
+
+void ShmFrameBuffer::close()
+{
+    if( !m_hdr ) {
+        return;
+    }
+
+    munmap( m_hdr, m_size );
+
+    /* mappings of running viewers stay valid */
+    if( m_owner ) {
+        shm_unlink( m_name );
+    }
+
+    m_hdr = NULL;
+    m_owner = false;
+}
+
+/**
+ * @brief Part of the pixel memory a viewer should show, e.g. the visible
+ * panel inside st7789v GRAM.
+ */
+void ShmFrameBuffer::set_view( const disp_area_t *view )
+{
+    m_hdr->view = *view;
+    publish( view );
+}
+
+/**
+ * @brief Mark a frame done, dirty is in pixel memory coordinates.
+ */
+void ShmFrameBuffer::publish( const disp_area_t *dirty )
+{
+    uint32_t seq = m_hdr->seq;
+
+    __atomic_store_n( &m_hdr->seq, seq + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+
+    m_hdr->dirty = *dirty;
+    m_hdr->publish_ns = now_ns();
+    m_hdr->frames++;
+
+    __atomic_store_n( &m_hdr->seq, seq + 2, __ATOMIC_RELEASE );
+}
+
+/**
+ * @brief Reader side, check for a new frame.
+ *
+ * @param dirty area to repaint, the whole view if frames were missed
+ * @return false if nothing new was published
+ */
+bool ShmFrameBuffer::poll( disp_area_t *dirty, uint64_t *publish_ns )
+{
+    uint32_t s1 = __atomic_load_n( &m_hdr->seq, __ATOMIC_ACQUIRE ), s2;
+    disp_area_t area;
+    uint64_t ns;
+
+    if( ( s1 & 1 ) || s1 == m_seen ) {
+        return false;
+    }
+
+    area = m_hdr->dirty;
+    ns = m_hdr->publish_ns;
+
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    s2 = __atomic_load_n( &m_hdr->seq, __ATOMIC_RELAXED );
+
+    /* torn, try again on the next poll */
+    if( s1 != s2 ) {
+        return false;
+    }
+
+    *dirty = ( s1 == m_seen + 2 ) ? area : m_hdr->view;
+    *publish_ns = ns;
+    m_seen = s1;
+
+    return true;
+}
+
+uint64_t ShmFrameBuffer::now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
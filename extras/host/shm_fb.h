@@ -0,0 +1,87 @@
+/**
+ * @file shm_fb.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Frame memory in a POSIX shared memory object, for live viewers.
+ *
+ * The controller models draw straight into pixels(), nothing is copied.
+ * publish() only updates the header: the dirty area of the frame and a
+ * sequence counter that is odd while the header is being written. A
+ * reader that sees the counter jump by more than one frame repaints
+ * everything. Pixels are not locked, a viewer may show a frame half drawn
+ * just like the real panel would.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __SHM_FB_H
+#define __SHM_FB_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "disp_clip.h"
+
+#define SHM_FB_MAGIC   (0x31424653UL)    /* "SFB1" */
+#define SHM_FB_VERSION (1)
+
+typedef enum
+{
+    SHM_FB_RGB565    = 0x00,    /* native endian, row after row */
+    SHM_FB_MONO_PAGE = 0x01,    /* ssd1306 pages, one byte per column */
+} shm_fb_format_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t format;
+    uint16_t width;             /* of the pixel memory */
+    uint16_t height;
+    uint32_t stride;            /* bytes per row, or per page */
+    uint32_t data_offset;       /* from the start of the object */
+
+    /* the part a viewer should show */
+    disp_area_t view;
+
+    uint32_t seq;               /* odd while the fields below change */
+    disp_area_t dirty;          /* changed by the frame that made seq */
+    uint64_t publish_ns;        /* CLOCK_MONOTONIC at publish() */
+    uint32_t frames;
+} shm_fb_header_t;
+
+class ShmFrameBuffer
+{
+private:
+    char m_name[64];
+    shm_fb_header_t *m_hdr;
+    size_t m_size;
+    bool m_owner;
+    uint32_t m_seen;            /* reader side, last seq handled */
+
+public:
+    ShmFrameBuffer();
+    ~ShmFrameBuffer();
+
+    bool create( const char *name, uint16_t width, uint16_t height,
+                 shm_fb_format_t format );
+    bool open( const char *name );
+    void close();
+
+    void *pixels() const
+    {
+        return ( uint8_t * )m_hdr + m_hdr->data_offset;
+    }
+
+    const shm_fb_header_t *header() const
+    {
+        return m_hdr;
+    }
+
+    void set_view( const disp_area_t *view );
+    void publish( const disp_area_t *dirty );
+    bool poll( disp_area_t *dirty, uint64_t *publish_ns );
+
+    static uint64_t now_ns();
+};
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file spi_adc_model.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Host model of an MCP3008 style ADC.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "spi_adc_model.h"
+#include "host_bus.h"
+
+// Constructors ////////////////////////////////////////////////////////////////
+SpiAdcModel::SpiAdcModel()
+{
+    memset( m_value, 0, sizeof( m_value ) );
+    m_phase = 0;
+    m_channel = 0;
+    m_clock = 0;
+    reset_stats();
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+uint8_t SpiAdcModel::transfer( bool dc, uint8_t b )
+{
+    ( void )dc;
+
+    switch( m_phase )
+    {
+    case 0:
+        /* leading zeros may pad the request, the start bit is the first one */
+        if( b & 0x01 ) {
+            m_phase = 1;
+        }
+
+        return 0xFF;
+
+    case 1:
+        m_channel = ( b >> 4 ) & ( SPI_ADC_MODEL_CHANNELS - 1 );
+        m_phase = 2;
+
+        return ( m_value[m_channel] >> 8 ) & 0x03;
+
+    case 2:
+        m_phase = 3;
+        m_stats.conversions++;
+        m_stats.last_ns = host_bus_spi_time_ns();
+
+        if( m_clock > SPI_ADC_MODEL_MAX_HZ ) {
+            m_stats.too_fast++;
+        }
+
+        return m_value[m_channel] & 0xFF;
+
+    default:
+        /* nothing more until CS goes high */
+        return 0xFF;
+    }
+}
+
+void SpiAdcModel::deselect()
+{
+    if( m_phase == 1 || m_phase == 2 ) {
+        m_stats.aborted++;
+    }
+
+    m_phase = 0;
+}
+
+void SpiAdcModel::reset_stats()
+{
+    memset( &m_stats, 0, sizeof( m_stats ) );
+}
@@ -0,0 +1,69 @@
+/**
+ * @file spi_adc_model.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Host model of an MCP3008 style ADC, a second device for the
+ * shared SPI bus.
+ *
+ * A conversion is three bytes with CS low: a start bit, then the mode and
+ * channel in the high nibble, answered with bits 9 ~ 8 of the result, then
+ * a dummy byte answered with bits 7 ~ 0. The result is whatever was set
+ * with set_channel(). Conversions are counted and timestamped with the
+ * bus time of host_bus_spi_time_ns(), so a benchmark can tell how long a
+ * request waited behind the display.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __SPI_ADC_MODEL_H
+#define __SPI_ADC_MODEL_H
+
+#include <inttypes.h>
+
+#include "spi_device_model.h"
+
+#define SPI_ADC_MODEL_CHANNELS (8)
+#define SPI_ADC_MODEL_MAX_HZ   (1350000UL)  /* MCP3008 at 2.7 V */
+
+typedef struct
+{
+    uint32_t conversions;
+    uint32_t aborted;           /* CS went high in the middle of one */
+    uint32_t too_fast;          /* conversions clocked past the limit */
+    uint64_t last_ns;           /* bus time the latest one finished */
+} spi_adc_model_stats_t;
+
+class SpiAdcModel : public SpiDeviceModel
+{
+private:
+    uint16_t m_value[SPI_ADC_MODEL_CHANNELS];
+    uint8_t m_phase;            /* 0 waits for the start bit */
+    uint8_t m_channel;
+    uint32_t m_clock;
+    spi_adc_model_stats_t m_stats;
+
+public:
+    SpiAdcModel();
+
+    uint8_t transfer( bool dc, uint8_t b );
+    void deselect();
+
+    void set_clock( uint32_t hz )
+    {
+        m_clock = hz;
+    }
+
+    /* 10 bit result of channel ch */
+    void set_channel( uint8_t ch, uint16_t value )
+    {
+        m_value[ch & ( SPI_ADC_MODEL_CHANNELS - 1 )] = value & 0x3FF;
+    }
+
+    const spi_adc_model_stats_t *stats() const
+    {
+        return &m_stats;
+    }
+
+    void reset_stats();
+};
+
+#endif
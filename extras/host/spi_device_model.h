@@ -0,0 +1,35 @@
+/**
+ * @file spi_device_model.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief What the host core needs from a model on the SPI bus.
+ *
+ * Several models may share the bus, each behind its own CS pin, see
+ * host_bus_attach_spi_device(). Bytes go to the one whose CS is low.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __SPI_DEVICE_MODEL_H
+#define __SPI_DEVICE_MODEL_H
+
+#include <inttypes.h>
+
+class SpiDeviceModel
+{
+public:
+    virtual ~SpiDeviceModel() {}
+
+    /* one byte with the DC level it was sent with, returns MISO */
+    virtual uint8_t transfer( bool dc, uint8_t b ) = 0;
+
+    /* CS went high */
+    virtual void deselect() {}
+
+    /* SPI clock of the transaction that follows, from the host core */
+    virtual void set_clock( uint32_t hz )
+    {
+        ( void )hz;
+    }
+};
+
+#endif
@@ -0,0 +1,284 @@
+/**
+ * @file ssd1306_model.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Host model of the ssd1306, fed one I2C transaction at a time.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "ssd1306_model.h"
+
+/* control byte */
+#define MODEL_CO 0x80           /* one more control byte follows the next byte */
+#define MODEL_DC 0x40           /* data instead of commands */
+
+static const disp_area_t model_empty = { 0, 0, -1, -1 };
+
+/* parameter bytes following a command */
+static uint8_t ssd1306_model_args( uint8_t cmd )
+{
+    switch( cmd )
+    {
+    case 0x20:
+    case 0x81:
+    case 0x8D:
+    case 0xA8:
+    case 0xD3:
+    case 0xD5:
+    case 0xD9:
+    case 0xDA:
+    case 0xDB:
+        return 1;
+
+    case 0x21:
+    case 0x22:
+    case 0xA3:
+        return 2;
+
+    case 0x29:
+    case 0x2A:
+        return 5;
+
+    case 0x26:
+    case 0x27:
+        return 6;
+
+    default:
+        return 0;
+    }
+}
+
+// Constructors ////////////////////////////////////////////////////////////////
+Ssd1306Model::Ssd1306Model( uint8_t width, uint8_t height, uint8_t *gram )
+{
+    m_width = width;
+    m_pages = height / 8;
+    m_own = gram == NULL;
+    m_gram = m_own ? new uint8_t[m_width * m_pages] : gram;
+    m_writes = new uint8_t[m_width * m_pages];
+
+    memset( m_gram, 0, m_width * m_pages );
+    reset();
+    reset_stats();
+}
+
+Ssd1306Model::~Ssd1306Model()
+{
+    if( m_own ) {
+        delete[] m_gram;
+    }
+
+    delete[] m_writes;
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+void Ssd1306Model::reset()
+{
+    m_cmd = 0x00;
+    m_argc = 0;
+    m_need = 0;
+
+    m_mode = 2;
+    m_col = 0;
+    m_col_start = 0;
+    m_col_end = m_width - 1;
+    m_page = 0;
+    m_page_start = 0;
+    m_page_end = m_pages - 1;
+
+    m_display_on = false;
+    m_contrast = 0x7F;
+    m_charge_pump = false;
+
+    m_dirty = model_empty;
+}
+
+void Ssd1306Model::reset_stats()
+{
+    memset( &m_stats, 0, sizeof( m_stats ) );
+    memset( m_writes, 0, m_width * m_pages );
+}
+
+/**
+ * @brief Control byte, then commands or data. With Co set only one byte
+ * follows before the next control byte.
+ */
+void Ssd1306Model::i2c_write( const uint8_t *buf, size_t len )
+{
+    m_stats.transactions++;
+
+    while( len )
+    {
+        uint8_t ctrl = *buf++;
+
+        len--;
+
+        if( ctrl & MODEL_CO )
+        {
+            if( len ) {
+                ( ctrl & MODEL_DC ) ? data( *buf ) : command( *buf );
+                buf++;
+                len--;
+            }
+
+            continue;
+        }
+
+        while( len-- ) {
+            ( ctrl & MODEL_DC ) ? data( *buf++ ) : command( *buf++ );
+        }
+
+        break;
+    }
+}
+
+bool Ssd1306Model::take_dirty( disp_area_t *area )
+{
+    if( disp_area_is_empty( &m_dirty ) ) {
+        return false;
+    }
+
+    *area = m_dirty;
+    m_dirty = model_empty;
+
+    return true;
+}
+
+// Private Methods //////////////////////////////////////////////////////////////
+void Ssd1306Model::command( uint8_t b )
+{
+    m_stats.cmd_bytes++;
+
+    /* parameter of a pending command */
+    if( m_need )
+    {
+        m_args[m_argc++] = b;
+
+        if( m_argc == m_need ) {
+            m_need = 0;
+            apply();
+        }
+
+        return;
+    }
+
+    m_cmd = b;
+    m_argc = 0;
+    m_need = ssd1306_model_args( b );
+
+    if( !m_need ) {
+        apply();
+    }
+}
+
+void Ssd1306Model::apply()
+{
+    uint8_t c = m_cmd, col = m_col, page = m_page;
+
+    if( c <= 0x0F ) {
+        m_col = ( m_col & 0xF0 ) | c;
+        m_stats.window_sets++;
+    }
+    else if( c <= 0x1F ) {
+        m_col = ( m_col & 0x0F ) | ( ( c & 0x0F ) << 4 );
+        m_stats.window_sets++;
+    }
+    else if( c >= 0xB0 && c <= 0xB7 ) {
+        m_page = c & 0x07;
+        m_stats.window_sets++;
+    }
+
+    if( c <= 0x1F || ( c >= 0xB0 && c <= 0xB7 ) ) {
+        m_stats.redundant_windows += col == m_col && page == m_page;
+    }
+
+    switch( c )
+    {
+    case 0x20:
+        m_mode = m_args[0] & 0x03;
+        break;
+
+    case 0x21:
+        m_col_start = m_col = m_args[0];
+        m_col_end = m_args[1];
+        m_stats.window_sets++;
+        break;
+
+    case 0x22:
+        m_page_start = m_page = m_args[0] & 0x07;
+        m_page_end = m_args[1] & 0x07;
+        m_stats.window_sets++;
+        break;
+
+    case 0x81:
+        m_contrast = m_args[0];
+        break;
+
+    case 0x8D:
+        m_charge_pump = ( m_args[0] & 0x04 ) != 0;
+        break;
+
+    case 0xAE:
+        m_display_on = false;
+        break;
+
+    case 0xAF:
+        m_display_on = true;
+        break;
+
+    default:
+        break;
+    }
+}
+
+void Ssd1306Model::data( uint8_t b )
+{
+    m_stats.data_bytes++;
+
+    if( m_col < m_width && m_page < m_pages )
+    {
+        disp_area_t col = { m_col, ( disp_coord_t )( m_page * 8 ),
+                            m_col, ( disp_coord_t )( m_page * 8 + 7 )
+                          };
+
+        uint16_t i = m_page * m_width + m_col;
+
+        m_stats.unique_bytes += !m_writes[i];
+        m_stats.noop_bytes += m_gram[i] == b;
+
+        if( m_writes[i] < 0xFF ) {
+            m_writes[i]++;
+        }
+
+        m_gram[i] = b;
+        disp_area_join( &m_dirty, &m_dirty, &col );
+    }
+
+    switch( m_mode )
+    {
+    case 0:
+        if( m_col++ >= m_col_end )
+        {
+            m_col = m_col_start;
+            m_page = m_page >= m_page_end ? m_page_start : m_page + 1;
+        }
+        break;
+
+    case 1:
+        if( m_page++ >= m_page_end )
+        {
+            m_page = m_page_start;
+            m_col = m_col >= m_col_end ? m_col_start : m_col + 1;
+        }
+        break;
+
+    default:
+        /* page mode wraps within the page */
+        if( m_col++ >= m_width - 1 ) {
+            m_col = 0;
+        }
+        break;
+    }
+}
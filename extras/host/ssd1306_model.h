@@ -0,0 +1,124 @@
+/**
+ * @file ssd1306_model.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Host model of the ssd1306, fed one I2C transaction at a time.
+ *
+ * GRAM uses the controller page layout, byte (page * width + col) holds
+ * rows page * 8 ~ page * 8 + 7 of one column, and may live in memory
+ * owned by someone else, e.g. a ShmFrameBuffer. Page, horizontal and
+ * vertical addressing, display on/off, contrast and the charge pump are
+ * modelled, other commands just swallow their parameters.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __SSD1306_MODEL_H
+#define __SSD1306_MODEL_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "disp_clip.h"
+
+typedef struct
+{
+    uint32_t transactions;
+    uint32_t cmd_bytes;         /* commands and their parameters */
+    uint32_t data_bytes;
+    uint32_t window_sets;       /* page or column address commands */
+    uint32_t redundant_windows; /* set to what it already was */
+    uint32_t unique_bytes;      /* distinct GRAM bytes among the data */
+    uint32_t noop_bytes;        /* written with the value already there */
+} ssd1306_model_stats_t;
+
+class Ssd1306Model
+{
+private:
+    uint8_t *m_gram;
+    bool m_own;
+    uint8_t m_width;
+    uint8_t m_pages;
+
+    uint8_t m_cmd;
+    uint8_t m_argc;
+    uint8_t m_need;
+    uint8_t m_args[6];
+
+    uint8_t m_mode;             /* 0 horizontal, 1 vertical, 2 page */
+    uint8_t m_col, m_col_start, m_col_end;
+    uint8_t m_page, m_page_start, m_page_end;
+
+    bool m_display_on;
+    uint8_t m_contrast;
+    bool m_charge_pump;
+
+    disp_area_t m_dirty;
+    ssd1306_model_stats_t m_stats;
+    uint8_t *m_writes;
+
+    void command( uint8_t b );
+    void apply();
+    void data( uint8_t b );
+
+public:
+    Ssd1306Model( uint8_t width = 128, uint8_t height = 64, uint8_t *gram = NULL );
+    ~Ssd1306Model();
+
+    void reset();
+
+    /* the bytes after the address of one write transaction */
+    void i2c_write( const uint8_t *buf, size_t len );
+
+    uint8_t *gram() const
+    {
+        return m_gram;
+    }
+
+    uint8_t width() const
+    {
+        return m_width;
+    }
+
+    uint8_t height() const
+    {
+        return m_pages * 8;
+    }
+
+    bool pixel( uint8_t x, uint8_t y ) const
+    {
+        return ( m_gram[( y >> 3 ) * m_width + x] >> ( y & 7 ) ) & 1;
+    }
+
+    bool display_on() const
+    {
+        return m_display_on;
+    }
+
+    uint8_t contrast() const
+    {
+        return m_contrast;
+    }
+
+    bool charge_pump() const
+    {
+        return m_charge_pump;
+    }
+
+    /* data writes to one GRAM byte this frame, saturates at 255 */
+    uint8_t writes( uint8_t col, uint8_t page ) const
+    {
+        return m_writes[page * m_width + col];
+    }
+
+    bool take_dirty( disp_area_t *area );
+
+    const ssd1306_model_stats_t *stats() const
+    {
+        return &m_stats;
+    }
+
+    /* counters are per frame, call this at every frame boundary */
+    void reset_stats();
+};
+
+#endif
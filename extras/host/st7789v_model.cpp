@@ -0,0 +1,344 @@
+/**
+ * @file st7789v_model.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Host model of the st7789v, fed one SPI byte at a time.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "st7789v_model.h"
+
+#define MODEL_SWRESET 0x01
+#define MODEL_SLPIN   0x10
+#define MODEL_SLPOUT  0x11
+#define MODEL_DISPOFF 0x28
+#define MODEL_DISPON  0x29
+#define MODEL_CASET   0x2A
+#define MODEL_RASET   0x2B
+#define MODEL_RAMWR   0x2C
+#define MODEL_RAMRD   0x2E
+#define MODEL_MADCTL  0x36
+#define MODEL_COLMOD  0x3A
+#define MODEL_RAMWRC  0x3C
+
+#define MODEL_MADCTL_MY 0x80
+#define MODEL_MADCTL_MX 0x40
+#define MODEL_MADCTL_MV 0x20
+
+static const disp_area_t model_empty = { 0, 0, -1, -1 };
+
+// Constructors ////////////////////////////////////////////////////////////////
+St7789vModel::St7789vModel( uint16_t *gram )
+{
+    m_own = gram == NULL;
+    m_gram = m_own ? new uint16_t[ST7789V_MODEL_WIDTH * ST7789V_MODEL_HEIGHT] : gram;
+
+    memset( m_gram, 0, ST7789V_MODEL_WIDTH * ST7789V_MODEL_HEIGHT * sizeof( uint16_t ) );
+
+    m_clock = 0;
+    m_write_limit = 0;
+    m_read_limit = 0;
+    m_noise = 0xACE1;
+
+    reset();
+    reset_stats();
+}
+
+St7789vModel::~St7789vModel()
+{
+    if( m_own ) {
+        delete[] m_gram;
+    }
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+/**
+ * @brief Registers to their power on values, GRAM is left as it is.
+ */
+void St7789vModel::reset()
+{
+    m_cmd = 0x00;
+    m_argc = 0;
+    m_xs = 0;
+    m_xe = ST7789V_MODEL_WIDTH - 1;
+    m_ys = 0;
+    m_ye = ST7789V_MODEL_HEIGHT - 1;
+    m_x = 0;
+    m_y = 0;
+    m_half = false;
+    m_read_phase = 0;
+
+    m_madctl = 0x00;
+    m_colmod = 0x66;
+    m_display_on = false;
+    m_sleeping = true;
+
+    m_dirty = model_empty;
+}
+
+void St7789vModel::reset_stats()
+{
+    memset( &m_stats, 0, sizeof( m_stats ) );
+    memset( m_writes, 0, sizeof( m_writes ) );
+}
+
+uint8_t St7789vModel::transfer( bool dc, uint8_t b )
+{
+    if( !dc ) {
+        m_stats.cmd_bytes++;
+        command( b );
+        return 0x00;
+    }
+
+    if( m_cmd == MODEL_RAMRD ) {
+        return read_data();
+    }
+
+    m_stats.data_bytes++;
+    data( b );
+
+    return 0x00;
+}
+
+void St7789vModel::deselect()
+{
+    if( m_cmd == MODEL_RAMRD ) {
+        m_cmd = 0x00;
+    }
+}
+
+/**
+ * @brief Physical area written since the previous call.
+ *
+ * @return false if nothing changed
+ */
+bool St7789vModel::take_dirty( disp_area_t *area )
+{
+    if( disp_area_is_empty( &m_dirty ) ) {
+        return false;
+    }
+
+    *area = m_dirty;
+    m_dirty = model_empty;
+
+    return true;
+}
+
+// Private Methods //////////////////////////////////////////////////////////////
+void St7789vModel::command( uint8_t cmd )
+{
+    m_cmd = cmd;
+    m_argc = 0;
+    m_half = false;
+
+    switch( cmd )
+    {
+    case MODEL_SWRESET:
+        reset();
+        break;
+
+    case MODEL_SLPIN:
+        m_sleeping = true;
+        break;
+
+    case MODEL_SLPOUT:
+        m_sleeping = false;
+        break;
+
+    case MODEL_DISPOFF:
+        m_display_on = false;
+        break;
+
+    case MODEL_DISPON:
+        m_display_on = true;
+        break;
+
+    case MODEL_CASET:
+    case MODEL_RASET:
+        m_stats.window_sets++;
+        break;
+
+    case MODEL_RAMWR:
+        m_x = m_xs;
+        m_y = m_ys;
+        break;
+
+    case MODEL_RAMRD:
+        m_x = m_xs;
+        m_y = m_ys;
+        m_read_phase = 0;
+        break;
+
+    default:
+        break;
+    }
+}
+
+void St7789vModel::data( uint8_t b )
+{
+    switch( m_cmd )
+    {
+    case MODEL_CASET:
+    case MODEL_RASET:
+        if( m_argc < 4 ) {
+            m_args[m_argc++] = b;
+        }
+
+        if( m_argc == 4 )
+        {
+            uint16_t s = ( m_args[0] << 8 ) | m_args[1];
+            uint16_t e = ( m_args[2] << 8 ) | m_args[3];
+
+            if( m_cmd == MODEL_CASET ) {
+                m_stats.redundant_windows += m_xs == s && m_xe == e;
+                m_xs = s;
+                m_xe = e;
+            }
+            else {
+                m_stats.redundant_windows += m_ys == s && m_ye == e;
+                m_ys = s;
+                m_ye = e;
+            }
+        }
+        break;
+
+    case MODEL_RAMWR:
+    case MODEL_RAMWRC:
+        b = bit_error( b, m_write_limit );
+
+        if( !m_half ) {
+            m_hi = b;
+            m_half = true;
+        }
+        else {
+            m_half = false;
+            write_pixel( ( uint16_t )( ( m_hi << 8 ) | b ) );
+        }
+        break;
+
+    case MODEL_MADCTL:
+        m_madctl = b;
+        break;
+
+    case MODEL_COLMOD:
+        m_colmod = b;
+        break;
+
+    default:
+        break;
+    }
+}
+
+/* dummy byte, then one byte per channel with the value in the upper bits */
+uint8_t St7789vModel::read_data()
+{
+    uint16_t col, row, c = 0;
+
+    if( m_read_phase == 0 ) {
+        m_read_phase = 1;
+        return 0x00;
+    }
+
+    if( map( m_x, m_y, &col, &row ) ) {
+        c = pixel( col, row );
+    }
+
+    switch( m_read_phase )
+    {
+    case 1:
+        m_read_phase = 2;
+        return bit_error( ( uint8_t )( ( c >> 11 ) << 3 ), m_read_limit );
+
+    case 2:
+        m_read_phase = 3;
+        return bit_error( ( uint8_t )( ( ( c >> 5 ) & 0x3F ) << 2 ), m_read_limit );
+
+    default:
+        m_read_phase = 1;
+        advance();
+        return bit_error( ( uint8_t )( ( c & 0x1F ) << 3 ), m_read_limit );
+    }
+}
+
+/* past a clock limit about one byte in eight gets a bit flipped */
+uint8_t St7789vModel::bit_error( uint8_t b, uint32_t limit )
+{
+    if( !limit || m_clock <= limit ) {
+        return b;
+    }
+
+    /* 16 bit galois lfsr, the same sequence every run */
+    m_noise = ( m_noise >> 1 ) ^ ( -( m_noise & 1 ) & 0xB400 );
+
+    if( m_noise & 0x0700 ) {
+        return b;
+    }
+
+    m_stats.bit_errors++;
+
+    return b ^ ( 0x80 >> ( m_noise & 0x03 ) );
+}
+
+void St7789vModel::advance()
+{
+    if( ++m_x > m_xe )
+    {
+        m_x = m_xs;
+
+        if( ++m_y > m_ye ) {
+            m_y = m_ys;
+        }
+    }
+}
+
+/**
+ * @brief MCU side address to GRAM column and row, MV exchanges the axes
+ * first, MX and MY then mirror the physical ones.
+ */
+bool St7789vModel::map( uint16_t x, uint16_t y, uint16_t *col, uint16_t *row ) const
+{
+    uint16_t c = x, r = y;
+
+    if( m_madctl & MODEL_MADCTL_MV ) {
+        c = y;
+        r = x;
+    }
+
+    if( c >= ST7789V_MODEL_WIDTH || r >= ST7789V_MODEL_HEIGHT ) {
+        return false;
+    }
+
+    *col = ( m_madctl & MODEL_MADCTL_MX ) ? ST7789V_MODEL_WIDTH - 1 - c : c;
+    *row = ( m_madctl & MODEL_MADCTL_MY ) ? ST7789V_MODEL_HEIGHT - 1 - r : r;
+
+    return true;
+}
+
+void St7789vModel::write_pixel( uint16_t color )
+{
+    uint16_t col, row;
+
+    if( map( m_x, m_y, &col, &row ) )
+    {
+        disp_area_t px = { ( disp_coord_t )col, ( disp_coord_t )row,
+                           ( disp_coord_t )col, ( disp_coord_t )row
+                         };
+        uint32_t i = ( uint32_t )row * ST7789V_MODEL_WIDTH + col;
+
+        m_stats.unique_pixels += !m_writes[i];
+        m_stats.noop_pixels += m_gram[i] == color;
+
+        if( m_writes[i] < 0xFF ) {
+            m_writes[i]++;
+        }
+
+        m_gram[i] = color;
+        disp_area_join( &m_dirty, &m_dirty, &px );
+    }
+
+    m_stats.pixels++;
+    advance();
+}
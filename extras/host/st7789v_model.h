@@ -0,0 +1,150 @@
+/**
+ * @file st7789v_model.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Host model of the st7789v, fed one SPI byte at a time.
+ *
+ * GRAM is kept in physical order, 240 columns by 320 rows of native
+ * endian RGB565, and may live in memory owned by someone else, e.g. a
+ * ShmFrameBuffer, so a viewer sees writes as they land. CASET, RASET,
+ * RAMWR, RAMWRC, RAMRD and MADCTL are modelled, COLMOD is assumed to be
+ * 16 bit, every other command just swallows its parameters.
+ *
+ * The host core hands over the SPI clock of every transaction. Past the
+ * limits of set_clock_limits() bits flip, in GRAM for writes and on MISO
+ * for reads, so RAMRD returns what a panel clocked too fast would and
+ * calibration can be exercised.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __ST7789V_MODEL_H
+#define __ST7789V_MODEL_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "disp_clip.h"
+#include "spi_device_model.h"
+
+#define ST7789V_MODEL_WIDTH  (240)
+#define ST7789V_MODEL_HEIGHT (320)
+
+typedef struct
+{
+    uint32_t cmd_bytes;
+    uint32_t data_bytes;
+    uint32_t window_sets;       /* CASET or RASET */
+    uint32_t redundant_windows; /* set to what it already was */
+    uint32_t pixels;            /* written through RAMWR */
+    uint32_t unique_pixels;     /* distinct GRAM pixels among them */
+    uint32_t noop_pixels;       /* written with the value already there */
+    uint32_t bit_errors;        /* bytes with a bit flipped by a fast clock */
+} st7789v_model_stats_t;
+
+class St7789vModel : public SpiDeviceModel
+{
+private:
+    uint16_t *m_gram;
+    bool m_own;
+
+    uint8_t m_cmd;
+    uint8_t m_argc;
+    uint8_t m_args[4];
+
+    /* window and pointer, in MCU side coordinates */
+    uint16_t m_xs, m_xe, m_ys, m_ye;
+    uint16_t m_x, m_y;
+    uint8_t m_hi;
+    bool m_half;
+    uint8_t m_read_phase;
+
+    uint32_t m_clock;           /* of the current transaction */
+    uint32_t m_write_limit;
+    uint32_t m_read_limit;
+    uint16_t m_noise;
+
+    uint8_t m_madctl;
+    uint8_t m_colmod;
+    bool m_display_on;
+    bool m_sleeping;
+
+    disp_area_t m_dirty;
+    st7789v_model_stats_t m_stats;
+    uint8_t m_writes[ST7789V_MODEL_WIDTH * ST7789V_MODEL_HEIGHT];
+
+    void command( uint8_t cmd );
+    void data( uint8_t b );
+    uint8_t read_data();
+    uint8_t bit_error( uint8_t b, uint32_t limit );
+    void advance();
+    bool map( uint16_t x, uint16_t y, uint16_t *col, uint16_t *row ) const;
+    void write_pixel( uint16_t color );
+
+public:
+    St7789vModel( uint16_t *gram = NULL );
+    ~St7789vModel();
+
+    void reset();
+
+    /* one byte with the DC level it was sent with, returns MISO */
+    uint8_t transfer( bool dc, uint8_t b );
+
+    /* CS went high, ends a read */
+    void deselect();
+
+    /* SPI clock of the transaction that follows, from the host core */
+    void set_clock( uint32_t hz )
+    {
+        m_clock = hz;
+    }
+
+    /* fastest clocks that still work for RAMWR and RAMRD, 0 is no limit */
+    void set_clock_limits( uint32_t write_hz, uint32_t read_hz )
+    {
+        m_write_limit = write_hz;
+        m_read_limit = read_hz;
+    }
+
+    uint16_t *gram() const
+    {
+        return m_gram;
+    }
+
+    uint16_t pixel( uint16_t col, uint16_t row ) const
+    {
+        return m_gram[( uint32_t )row * ST7789V_MODEL_WIDTH + col];
+    }
+
+    uint8_t madctl() const
+    {
+        return m_madctl;
+    }
+
+    bool display_on() const
+    {
+        return m_display_on;
+    }
+
+    bool sleeping() const
+    {
+        return m_sleeping;
+    }
+
+    /* RAMWR hits on one GRAM pixel this frame, saturates at 255 */
+    uint8_t writes( uint16_t col, uint16_t row ) const
+    {
+        return m_writes[( uint32_t )row * ST7789V_MODEL_WIDTH + col];
+    }
+
+    bool take_dirty( disp_area_t *area );
+
+    const st7789v_model_stats_t *stats() const
+    {
+        return &m_stats;
+    }
+
+    /* counters are per frame, call this at every frame boundary */
+    void reset_stats();
+};
+
+#endif
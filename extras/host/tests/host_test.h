@@ -0,0 +1,113 @@
+/**
+ * @file host_test.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Checks shared by the host tests, see run.sh.
+ *
+ * Every test is a program of its own that exits non zero when a check
+ * failed. Fast paths are compared pixel for pixel with a naive reference,
+ * the first mismatch of each comparison is printed. Tests of the st7789v
+ * share one model and panel, brought up by host_test_attach_tft().
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __HOST_TEST_H
+#define __HOST_TEST_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "st7789v.h"
+#include "host_bus.h"
+
+#define HOST_TEST_CS  10
+#define HOST_TEST_DC  9
+#define HOST_TEST_RST 8
+
+static unsigned host_test_checks;
+static unsigned host_test_failures;
+
+#define HOST_CHECK( cond ) host_check( ( cond ), #cond, __FILE__, __LINE__ )
+
+static inline bool host_check( bool ok, const char *what, const char *file, int line )
+{
+    host_test_checks++;
+
+    if( !ok ) {
+        host_test_failures++;
+        printf( "%s:%d: %s\n", file, line, what );
+    }
+
+    return ok;
+}
+
+/**
+ * @brief Compare two w x h images of row major RGB565.
+ */
+static inline bool host_check_px( const char *what, const uint16_t *got,
+                                  const uint16_t *want, uint32_t w, uint32_t h )
+{
+    uint32_t x, y;
+
+    host_test_checks++;
+
+    for( y = 0; y < h; y++ )
+    {
+        for( x = 0; x < w; x++ )
+        {
+            if( got[y * w + x] != want[y * w + x] )
+            {
+                host_test_failures++;
+                printf( "%s: (%u, %u) is %04X, want %04X\n", what, ( unsigned )x,
+                        ( unsigned )y, got[y * w + x], want[y * w + x] );
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/* xorshift32, the same cases every run */
+static inline uint32_t host_rand( uint32_t *s )
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+
+    return *s;
+}
+
+static inline int32_t host_rand_range( uint32_t *s, int32_t lo, int32_t hi )
+{
+    return lo + ( int32_t )( host_rand( s ) % ( uint32_t )( hi - lo + 1 ) );
+}
+
+// Fixture //////////////////////////////////////////////////////////////////////
+static St7789vModel host_test_model;
+
+/**
+ * @brief Attach host_test_model and init the panel at 240 x 135, the
+ * default rotation.
+ */
+static inline void host_test_attach_tft()
+{
+    host_bus_attach_spi( &host_test_model, HOST_TEST_CS, HOST_TEST_DC );
+
+    ST7789V tft( HOST_TEST_CS, HOST_TEST_DC, HOST_TEST_RST );
+    tft.init( 240, 135 );
+}
+
+/**
+ * @brief Print the summary line.
+ *
+ * @return the exit code of the test
+ */
+static inline int host_test_done( const char *name )
+{
+    printf( "%s: %u checks, %u failed\n", name, host_test_checks, host_test_failures );
+
+    return host_test_failures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#!/bin/sh
+#
+# Build every test_*.cpp next to this script against the library and the
+# host core, run them and exit non zero if any failed.
+#
+#   extras/host/tests/run.sh [test_name ...]
+#
+# CXX and CXXFLAGS are taken from the environment, objects go to
+# $TMPDIR/disp_host_tests.
+#
+# SPDX-License-Identifier: MIT
+
+set -e
+
+root=$(cd "$(dirname "$0")/../../.." && pwd)
+out=${TMPDIR:-/tmp}/disp_host_tests
+cxx=${CXX:-g++}
+flags="-std=gnu++11 -O2 -DST7789V_USE_SOFTWARE_SPI=0 ${CXXFLAGS:-}"
+incs="-I$root/extras/host/arduino -I$root/extras/host -I$root/src"
+
+mkdir -p "$out/obj"
+
+objs=
+for src in "$root"/src/*.cpp "$root"/extras/host/*.cpp; do
+    obj="$out/obj/$(basename "$src" .cpp).o"
+    $cxx $flags $incs -c "$src" -o "$obj"
+    objs="$objs $obj"
+done
+
+if [ $# -gt 0 ]; then
+    tests=
+    for t in "$@"; do
+        tests="$tests $root/extras/host/tests/$t.cpp"
+    done
+else
+    tests=$(ls "$root"/extras/host/tests/test_*.cpp)
+fi
+
+failed=0
+for src in $tests; do
+    name=$(basename "$src" .cpp)
+    $cxx $flags $incs "$src" $objs -lrt -o "$out/$name"
+
+    if ! "$out/$name"; then
+        failed=$((failed + 1))
+    fi
+done
+
+if [ $failed -ne 0 ]; then
+    echo "$failed test(s) failed"
+    exit 1
+fi
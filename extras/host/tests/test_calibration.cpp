@@ -0,0 +1,75 @@
+/**
+ * @file test_calibration.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief calibrate_spi_clock() against a model that flips bits past its clock limits.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "st7789v.h"
+#include "host_bus.h"
+#include "host_test.h"
+
+#define TEST_MIN_HZ  4000000UL
+#define TEST_MAX_HZ  40000000UL
+#define TEST_STEP_HZ 2000000UL
+
+static void test_settles_below( uint32_t limit )
+{
+    u32 hz;
+
+    host_test_model.set_clock_limits( limit, 0 );
+    ST7789V::m_st7789v_handle.spi_speed = ST7789V_SPI_SPEED;
+
+    hz = ST7789V::calibrate_spi_clock( TEST_MIN_HZ, TEST_MAX_HZ, TEST_STEP_HZ );
+
+    HOST_CHECK( hz != 0 );
+    HOST_CHECK( hz <= limit );
+    HOST_CHECK( hz >= ( limit - TEST_STEP_HZ ) / 100 * ( 100 - ST7789V_CALIB_MARGIN ) );
+    HOST_CHECK( ST7789V::m_st7789v_handle.spi_speed == hz );
+
+    /* the step past the limit really failed, the one below really passed */
+    HOST_CHECK( !ST7789V::self_test( limit + TEST_STEP_HZ ) );
+    HOST_CHECK( ST7789V::self_test( hz ) );
+
+    /* drawing now runs at the settled clock and reads back clean */
+    host_test_model.reset_stats();
+    ST7789V::fill_rect( 0, 0, 16, 16, 0x1234 );
+    HOST_CHECK( host_bus_spi_clock() == hz );
+    HOST_CHECK( ST7789V::self_test( hz ) );
+    HOST_CHECK( host_test_model.stats()->bit_errors == 0 );
+}
+
+static void test_nothing_passes()
+{
+    /* reads fail even at ST7789V_READ_SPEED, the clock must stay as it was */
+    host_test_model.set_clock_limits( 0, ST7789V_READ_SPEED / 2 );
+    ST7789V::m_st7789v_handle.spi_speed = ST7789V_SPI_SPEED;
+
+    HOST_CHECK( ST7789V::calibrate_spi_clock( TEST_MIN_HZ, TEST_MAX_HZ, TEST_STEP_HZ ) == 0 );
+    HOST_CHECK( ST7789V::m_st7789v_handle.spi_speed == ST7789V_SPI_SPEED );
+    HOST_CHECK( host_test_model.stats()->bit_errors != 0 );
+}
+
+static void test_no_limit()
+{
+    host_test_model.set_clock_limits( 0, 0 );
+    host_test_model.reset_stats();
+
+    HOST_CHECK( ST7789V::calibrate_spi_clock( TEST_MIN_HZ, TEST_MAX_HZ, TEST_STEP_HZ ) ==
+                TEST_MAX_HZ / 100 * ( 100 - ST7789V_CALIB_MARGIN ) );
+    HOST_CHECK( host_test_model.stats()->bit_errors == 0 );
+}
+
+int main()
+{
+    host_test_attach_tft();
+
+    test_settles_below( 10000000UL );
+    test_settles_below( 21000000UL );
+    test_settles_below( 33000000UL );
+    test_nothing_passes();
+    test_no_limit();
+
+    return host_test_done( "calibration" );
+}
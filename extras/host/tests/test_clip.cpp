@@ -0,0 +1,679 @@
+/**
+ * @file test_clip.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Clip rectangles and viewports of both drivers, fuzzed against a
+ * per pixel reference.
+ *
+ * Random viewport and clip pushes and pops are mixed with random draw
+ * calls, many of them partly or wholly off screen. Some pushes reach the
+ * ends of the 16 bit coordinates. The reference keeps its own stack in
+ * int and tests every pixel on its own; the ST7789V screen is read back
+ * through RAMRD and the SSD1306 frame buffer is compared bit by bit.
+ *
+ * Lines, circles, rounded rectangles and polygons go through
+ * ST7789V::raster() under the same stacks. Their reference is the same
+ * shape rasterized without any clip, test_raster checks that one, and
+ * masked with the reference clip area. disp_clip_line() is checked on
+ * its own: what it keeps must lie inside the clip area and on the line.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "st7789v.h"
+#include "SSD1306.h"
+#include "disp_raster.h"
+#include "host_bus.h"
+#include "host_test.h"
+
+#define TEST_OPS    4000
+#define TEST_CHECKS 40          /* screen comparisons per run */
+#define TEST_LINES  200000      /* disp_clip_line() cases */
+
+#define TEST_OLED_W 128
+#define TEST_OLED_H 64
+
+typedef struct
+{
+    int x1, y1, x2, y2;
+    int ox, oy;
+} ref_vp_t;
+
+typedef struct
+{
+    ref_vp_t stack[DISP_CLIP_STACK_DEPTH + 1];
+    int top;
+} ref_clip_t;
+
+// Reference ////////////////////////////////////////////////////////////////////
+/* disp_min() and disp_max() are 16 bit, the reference is not */
+static int ref_min( int a, int b )
+{
+    return a < b ? a : b;
+}
+
+static int ref_max( int a, int b )
+{
+    return a > b ? a : b;
+}
+
+static void ref_clip_init( ref_clip_t *c, int w, int h )
+{
+    ref_vp_t s = { 0, 0, w - 1, h - 1, 0, 0 };
+
+    c->stack[0] = s;
+    c->top = 0;
+}
+
+static bool ref_push( ref_clip_t *c, int x1, int y1, int x2, int y2, bool viewport,
+                      int x, int y )
+{
+    const ref_vp_t *cur = &c->stack[c->top];
+    ref_vp_t *vp;
+
+    if( c->top >= DISP_CLIP_STACK_DEPTH ) {
+        return false;
+    }
+
+    vp = &c->stack[++c->top];
+    vp->ox = cur->ox + ( viewport ? x : 0 );
+    vp->oy = cur->oy + ( viewport ? y : 0 );
+    vp->x1 = ref_max( cur->x1, x1 + cur->ox );
+    vp->y1 = ref_max( cur->y1, y1 + cur->oy );
+    vp->x2 = ref_min( cur->x2, x2 + cur->ox );
+    vp->y2 = ref_min( cur->y2, y2 + cur->oy );
+
+    return true;
+}
+
+static void ref_pop( ref_clip_t *c )
+{
+    if( c->top ) {
+        c->top--;
+    }
+}
+
+/* drawing call coordinates to the screen, false if clipped away */
+static bool ref_point( const ref_clip_t *c, int x, int y, int *sx, int *sy )
+{
+    const ref_vp_t *vp = &c->stack[c->top];
+
+    *sx = x + vp->ox;
+    *sy = y + vp->oy;
+
+    return *sx >= vp->x1 && *sx <= vp->x2 && *sy >= vp->y1 && *sy <= vp->y2;
+}
+
+/* one random push or pop on both stacks */
+static void fuzz_clip( uint32_t *seed, ref_clip_t *ref,
+                       bool ( *push_viewport )( void *, int, int, int, int ),
+                       bool ( *push_clip )( void *, int, int, int, int ),
+                       void ( *pop )( void * ), void *ctx, int w, int h )
+{
+    int x = host_rand_range( seed, -w / 4, w );
+    int y = host_rand_range( seed, -h / 4, h );
+    int cw = host_rand_range( seed, 0, w );
+    int ch = host_rand_range( seed, 0, h );
+    int cx = x, cy = y, cx2 = x + cw - 1, cy2 = y + ch - 1;
+    bool ok;
+
+    /* now and then sizes up to the end of the coordinates, "no clip", and
+     * clip corners at both ends; the origin itself stays near the screen */
+    if( host_rand( seed ) % 4 == 0 )
+    {
+        cw = 32767 - host_rand_range( seed, 0, 64 );
+        ch = 32767 - host_rand_range( seed, 0, 64 );
+        cx = host_rand( seed ) & 1 ? -32768 + host_rand_range( seed, 0, 64 ) : x;
+        cy = host_rand( seed ) & 1 ? -32768 + host_rand_range( seed, 0, 64 ) : y;
+        cx2 = host_rand( seed ) & 1 ? 32767 - host_rand_range( seed, 0, 64 ) : x + cw / 1024;
+        cy2 = host_rand( seed ) & 1 ? 32767 - host_rand_range( seed, 0, 64 ) : y + ch / 1024;
+    }
+
+    switch( host_rand( seed ) % 3 )
+    {
+    case 0:
+        ok = push_viewport( ctx, x, y, cw, ch );
+        HOST_CHECK( ok == ref_push( ref, x, y, x + cw - 1, y + ch - 1, true, x, y ) );
+        break;
+
+    case 1:
+        ok = push_clip( ctx, cx, cy, cx2, cy2 );
+        HOST_CHECK( ok == ref_push( ref, cx, cy, cx2, cy2, false, 0, 0 ) );
+        break;
+
+    default:
+        pop( ctx );
+        ref_pop( ref );
+        break;
+    }
+}
+
+// ST7789V //////////////////////////////////////////////////////////////////////
+static uint16_t tft_ref[240 * 240];
+static uint16_t tft_got[240 * 240];
+static uint16_t tft_bitmap[48 * 48];
+
+static bool tft_push_viewport( void *ctx, int x, int y, int w, int h )
+{
+    ( void )ctx;
+    return ST7789V::push_viewport( x, y, w, h );
+}
+
+static bool tft_push_clip( void *ctx, int x1, int y1, int x2, int y2 )
+{
+    ( void )ctx;
+    return ST7789V::push_clip( x1, y1, x2, y2 );
+}
+
+static void tft_pop( void *ctx )
+{
+    ( void )ctx;
+    ST7789V::pop_clip();
+}
+
+static void tft_ref_rect( const ref_clip_t *c, int x, int y, int w, int h,
+                          const uint16_t *bitmap, uint16_t color, int sw )
+{
+    int i, j, sx, sy;
+
+    for( j = 0; j < h; j++ )
+    {
+        for( i = 0; i < w; i++ )
+        {
+            if( ref_point( c, x + i, y + j, &sx, &sy ) ) {
+                tft_ref[sy * sw + sx] = bitmap ? bitmap[j * w + i] : color;
+            }
+        }
+    }
+}
+
+/* the reference raster: no clip, drawn at screen coordinates, masked */
+static void tft_ref_span( void *ctx, disp_coord_t x, disp_coord_t y,
+                          disp_coord_t len, uint16_t color )
+{
+    const ref_vp_t *vp = ( const ref_vp_t * )ctx;
+    int sw = ST7789V::m_st7789v_handle.width;
+
+    for( ; len > 0; x++, len-- )
+    {
+        if( x >= vp->x1 && x <= vp->x2 && y >= vp->y1 && y <= vp->y2 ) {
+            tft_ref[y * sw + x] = color;
+        }
+    }
+}
+
+static void tft_ref_blend( void *ctx, disp_coord_t x, disp_coord_t y,
+                           uint16_t color, uint8_t alpha )
+{
+    /* raster(&bg) mixes with bg and does not read GRAM back */
+    tft_ref_span( ctx, x, y, 1, disp_rgb565_mix( color, 0x0000, alpha ) );
+}
+
+/* one random shape, moved by (dx, dy) */
+static void tft_shape( disp_raster_t *r, uint32_t seed, int x, int y, int dx, int dy )
+{
+    int x1 = x + host_rand_range( &seed, -60, 60 );
+    int y1 = y + host_rand_range( &seed, -60, 60 );
+    int rad = host_rand_range( &seed, 0, 40 );
+    int rw = host_rand_range( &seed, 1, 80 ), rh = host_rand_range( &seed, 1, 80 );
+    int count = host_rand_range( &seed, 3, 8 );
+    uint16_t c = ( uint16_t )host_rand( &seed );
+    disp_coord_t xy[16];
+
+    x += dx;
+    y += dy;
+    x1 += dx;
+    y1 += dy;
+
+    switch( host_rand( &seed ) % 6 )
+    {
+    case 0:
+        disp_draw_line( r, x, y, x1, y1, c );
+        break;
+
+    case 1:
+        disp_draw_line_aa( r, x, y, x1, y1, c );
+        break;
+
+    case 2:
+        disp_draw_circle( r, x, y, rad, c );
+        break;
+
+    case 3:
+        disp_fill_circle( r, x, y, rad, c );
+        break;
+
+    case 4:
+        disp_fill_round_rect( r, x, y, rw, rh, rad / 3, c );
+        break;
+
+    default:
+        for( int i = 0; i < count; i++ ) {
+            xy[2 * i] = x + host_rand_range( &seed, -50, 50 );
+            xy[2 * i + 1] = y + host_rand_range( &seed, -50, 50 );
+        }
+
+        disp_fill_polygon( r, xy, count, c );
+        break;
+    }
+}
+
+static void test_st7789v()
+{
+    uint32_t seed = 0x13572468;
+    int w = ST7789V::m_st7789v_handle.width;
+    int h = ST7789V::m_st7789v_handle.height;
+    ref_clip_t ref;
+    uint16_t bg = 0x0000;
+    disp_raster_t got = ST7789V::raster( &bg );
+    disp_raster_t want = { tft_ref_span, NULL, tft_ref_blend, NULL, NULL, 0, 0 };
+    int op, i;
+
+    ST7789V::set_rotation( ST7789V_DEFAULT_ROTATION );
+    ST7789V::clear_screen_directly( 0x0000 );
+    memset( tft_ref, 0, sizeof( tft_ref ) );
+    ref_clip_init( &ref, w, h );
+
+    for( op = 1; op <= TEST_OPS; op++ )
+    {
+        int x = host_rand_range( &seed, -60, w + 10 );
+        int y = host_rand_range( &seed, -60, h + 10 );
+        int rw = host_rand_range( &seed, -2, 48 );
+        int rh = host_rand_range( &seed, -2, 48 );
+        uint16_t c = ( uint16_t )host_rand( &seed );
+
+        switch( host_rand( &seed ) % 9 )
+        {
+        case 0:
+            fuzz_clip( &seed, &ref, tft_push_viewport, tft_push_clip, tft_pop, NULL, w, h );
+            break;
+
+        case 7:
+        case 8:
+            want.ctx = &ref.stack[ref.top];
+            tft_shape( &got, seed, x, y, 0, 0 );
+            tft_shape( &want, seed, x, y, ref.stack[ref.top].ox, ref.stack[ref.top].oy );
+            host_rand( &seed );
+            break;
+
+        case 1:
+            ST7789V::put_pixel( x, y, c );
+            tft_ref_rect( &ref, x, y, 1, 1, NULL, c, w );
+            break;
+
+        case 2:
+            ST7789V::draw_hline( x, y, rw, c );
+            tft_ref_rect( &ref, x, y, rw, 1, NULL, c, w );
+            break;
+
+        case 3:
+            ST7789V::draw_vline( x, y, rh, c );
+            tft_ref_rect( &ref, x, y, 1, rh, NULL, c, w );
+            break;
+
+        case 4:
+        case 5:
+            ST7789V::fill_rect( x, y, rw, rh, c );
+            tft_ref_rect( &ref, x, y, rw, rh, NULL, c, w );
+            break;
+
+        default:
+            if( rw <= 0 || rh <= 0 ) {
+                break;
+            }
+
+            for( i = 0; i < rw * rh; i++ ) {
+                tft_bitmap[i] = ( uint16_t )host_rand( &seed );
+            }
+
+            ST7789V::draw_bitmap( x, y, rw, rh, tft_bitmap );
+            tft_ref_rect( &ref, x, y, rw, rh, tft_bitmap, 0, w );
+            break;
+        }
+
+        if( op % ( TEST_OPS / TEST_CHECKS ) == 0 )
+        {
+            HOST_CHECK( ST7789V::read_gram( 0, 0, w, h, tft_got ) );
+
+            if( !host_check_px( "st7789v clip", tft_got, tft_ref, w, h ) ) {
+                break;
+            }
+        }
+    }
+
+    while( ref.top ) {
+        ST7789V::pop_clip();
+        ref_pop( &ref );
+    }
+}
+
+// SSD1306 //////////////////////////////////////////////////////////////////////
+static uint8_t oled_ref[TEST_OLED_W * TEST_OLED_H];
+static uint8_t oled_src[48 * 6];
+
+static bool oled_push_viewport( void *ctx, int x, int y, int w, int h )
+{
+    return ( ( SSD1306 * )ctx )->push_viewport( x, y, w, h );
+}
+
+static bool oled_push_clip( void *ctx, int x1, int y1, int x2, int y2 )
+{
+    return ( ( SSD1306 * )ctx )->push_clip( x1, y1, x2, y2 );
+}
+
+static void oled_pop( void *ctx )
+{
+    ( ( SSD1306 * )ctx )->pop_clip();
+}
+
+static void oled_ref_rect( const ref_clip_t *c, int x, int y, int w, int h,
+                           const uint8_t *src, oled_blit_mode_t mode, bool on )
+{
+    int i, j, sx, sy;
+
+    for( j = 0; j < h; j++ )
+    {
+        for( i = 0; i < w; i++ )
+        {
+            uint8_t *p;
+            bool bit = src ? ( src[( j >> 3 ) * w + i] >> ( j & 7 ) ) & 1 : on;
+
+            if( !ref_point( c, x + i, y + j, &sx, &sy ) ) {
+                continue;
+            }
+
+            p = &oled_ref[sy * TEST_OLED_W + sx];
+
+            switch( mode )
+            {
+            case OLED_BLIT_COPY:
+                *p = bit;
+                break;
+
+            case OLED_BLIT_OR:
+                *p |= bit;
+                break;
+
+            case OLED_BLIT_CLR:
+                *p &= !bit;
+                break;
+
+            default:
+                *p ^= bit;
+                break;
+            }
+        }
+    }
+}
+
+static bool oled_compare( SSD1306 *oled )
+{
+    int x, y;
+
+    host_test_checks++;
+
+    for( y = 0; y < TEST_OLED_H; y++ )
+    {
+        for( x = 0; x < TEST_OLED_W; x++ )
+        {
+            if( oled->framebuffer()->get_pixel( x, y ) != oled_ref[y * TEST_OLED_W + x] )
+            {
+                host_test_failures++;
+                printf( "ssd1306 clip: (%d, %d) is %d, want %d\n", x, y,
+                        !oled_ref[y * TEST_OLED_W + x], oled_ref[y * TEST_OLED_W + x] );
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void test_ssd1306()
+{
+    SSD1306Buffered<TEST_OLED_W, TEST_OLED_H> oled( 1, 2 );
+    uint32_t seed = 0x0DDBA11;
+    ref_clip_t ref;
+    int op, i;
+
+    memset( oled_ref, 0, sizeof( oled_ref ) );
+    ref_clip_init( &ref, TEST_OLED_W, TEST_OLED_H );
+
+    for( op = 1; op <= TEST_OPS; op++ )
+    {
+        int x = host_rand_range( &seed, -40, TEST_OLED_W + 10 );
+        int y = host_rand_range( &seed, -40, TEST_OLED_H + 10 );
+        int rw = host_rand_range( &seed, -2, 48 );
+        int rh = host_rand_range( &seed, -2, 48 );
+        bool on = host_rand( &seed ) & 1;
+        oled_blit_mode_t mode = ( oled_blit_mode_t )( host_rand( &seed ) & 3 );
+
+        switch( host_rand( &seed ) % 5 )
+        {
+        case 0:
+            fuzz_clip( &seed, &ref, oled_push_viewport, oled_push_clip, oled_pop, &oled,
+                       TEST_OLED_W, TEST_OLED_H );
+            break;
+
+        case 1:
+            oled.set_pixel( x, y, on );
+            oled_ref_rect( &ref, x, y, 1, 1, NULL, OLED_BLIT_COPY, on );
+            break;
+
+        case 2:
+            oled.fill_rect( x, y, rw, rh, on );
+            oled_ref_rect( &ref, x, y, rw, rh, NULL, OLED_BLIT_COPY, on );
+            break;
+
+        default:
+            if( rw <= 0 || rh <= 0 ) {
+                break;
+            }
+
+            for( i = 0; i < rw * ( ( rh + 7 ) >> 3 ); i++ ) {
+                oled_src[i] = ( uint8_t )host_rand( &seed );
+            }
+
+            oled.draw_bitmap( x, y, oled_src, rw, rh, mode );
+            oled_ref_rect( &ref, x, y, rw, rh, oled_src, mode, false );
+            break;
+        }
+
+        if( op % ( TEST_OPS / TEST_CHECKS ) == 0 && !oled_compare( &oled ) ) {
+            break;
+        }
+    }
+}
+
+// disp_clip_t //////////////////////////////////////////////////////////////////
+static bool area_is( const disp_area_t *a, int x1, int y1, int x2, int y2 )
+{
+    return a->x1 == x1 && a->y1 == y1 && a->x2 == x2 && a->y2 == y2;
+}
+
+/* sizes and corners whose sums leave 16 bits */
+static void test_wrap()
+{
+    disp_clip_t clip;
+    disp_area_t a = { 0, 0, 32767, 32767 };
+
+    disp_clip_init( &clip, 240, 135 );
+    HOST_CHECK( disp_clip_push_viewport( &clip, 10, 20, 32767, 32767 ) );
+    HOST_CHECK( area_is( &disp_clip_current( &clip )->area, 10, 20, 239, 134 ) );
+    HOST_CHECK( disp_clip_area( &clip, &a ) );
+    HOST_CHECK( area_is( &a, 10, 20, 239, 134 ) );
+
+    a.x1 = 0;
+    a.y1 = 0;
+    a.x2 = 32767;
+    a.y2 = 32767;
+    HOST_CHECK( disp_clip_push( &clip, &a ) );
+    HOST_CHECK( area_is( &disp_clip_current( &clip )->area, 10, 20, 239, 134 ) );
+
+    disp_clip_init( &clip, 240, 135 );
+    HOST_CHECK( disp_clip_push_viewport( &clip, -1, -2, 50, 50 ) );
+    a.x1 = -32768;
+    a.y1 = -32768;
+    a.x2 = 10;
+    a.y2 = 10;
+    HOST_CHECK( disp_clip_push( &clip, &a ) );
+    HOST_CHECK( area_is( &disp_clip_current( &clip )->area, 0, 0, 9, 8 ) );
+
+    /* an origin past the end is empty, not wrapped onto the screen */
+    disp_clip_init( &clip, 240, 135 );
+    HOST_CHECK( disp_clip_push_viewport( &clip, 30000, 0, 100, 100 ) );
+    HOST_CHECK( disp_clip_push_viewport( &clip, 30000, 0, 100, 100 ) );
+    HOST_CHECK( disp_area_is_empty( &disp_clip_current( &clip )->area ) );
+}
+
+/* the Bresenham pixels of a line, true if any is inside a */
+static bool line_hits( const disp_area_t *a, int x0, int y0, int x1, int y1 )
+{
+    int dx = x1 > x0 ? x1 - x0 : x0 - x1, sx = x0 < x1 ? 1 : -1;
+    int dy = y1 > y0 ? y0 - y1 : y1 - y0, sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+
+    for( ;; )
+    {
+        int e2 = 2 * err;
+
+        if( x0 >= a->x1 && x0 <= a->x2 && y0 >= a->y1 && y0 <= a->y2 ) {
+            return true;
+        }
+
+        if( x0 == x1 && y0 == y1 ) {
+            return false;
+        }
+
+        if( e2 >= dy ) {
+            err += dy;
+            x0 += sx;
+        }
+
+        if( e2 <= dx ) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+/* distance of (x, y) from the line through a and b, in pixels */
+static double line_dist( double ax, double ay, double bx, double by, double x, double y )
+{
+    double dx = bx - ax, dy = by - ay;
+    double len = sqrt( dx * dx + dy * dy );
+    double cross = dx * ( y - ay ) - dy * ( x - ax );
+
+    return len ? fabs( cross ) / len : sqrt( ( x - ax ) * ( x - ax ) + ( y - ay ) * ( y - ay ) );
+}
+
+/*
+ * What disp_clip_line() keeps lies inside the clip area, inside the box
+ * of the line and within half a pixel of it; a line inside is only
+ * moved, and a line it drops has no pixel in the area but on its border.
+ */
+static void test_clip_line()
+{
+    uint32_t seed = 0x11E5C11F;
+
+    for( uint32_t n = 0; n < TEST_LINES; n++ )
+    {
+        disp_clip_t clip;
+        ref_clip_t ref;
+        const disp_area_t *a;
+        disp_area_t inner;
+        int span = n % 4 ? 160 : 32000;
+        int x0 = host_rand_range( &seed, -80, 320 ), y0 = host_rand_range( &seed, -80, 215 );
+        int x1 = 120 + host_rand_range( &seed, -span, span );
+        int y1 = 67 + host_rand_range( &seed, -span, span );
+        disp_coord_t cx0 = x0, cy0 = y0, cx1 = x1, cy1 = y1;
+        int pushes = host_rand_range( &seed, 0, DISP_CLIP_STACK_DEPTH );
+        int ax, ay, bx, by;
+        double off;
+        bool in, ok;
+
+        disp_clip_init( &clip, 240, 135 );
+        ref_clip_init( &ref, 240, 135 );
+
+        for( int i = 0; i < pushes; i++ )
+        {
+            int x = host_rand_range( &seed, -60, 240 ), y = host_rand_range( &seed, -60, 135 );
+            int w = host_rand_range( &seed, 0, 240 ), h = host_rand_range( &seed, 0, 135 );
+            disp_area_t c = { ( disp_coord_t )x, ( disp_coord_t )y,
+                              ( disp_coord_t )( x + w - 1 ), ( disp_coord_t )( y + h - 1 )
+                            };
+
+            if( host_rand( &seed ) & 1 ) {
+                disp_clip_push_viewport( &clip, x, y, w, h );
+                ref_push( &ref, x, y, x + w - 1, y + h - 1, true, x, y );
+            }
+            else {
+                disp_clip_push( &clip, &c );
+                ref_push( &ref, x, y, x + w - 1, y + h - 1, false, 0, 0 );
+            }
+        }
+
+        a = &disp_clip_current( &clip )->area;
+        ax = x0 + ref.stack[ref.top].ox;
+        ay = y0 + ref.stack[ref.top].oy;
+        bx = x1 + ref.stack[ref.top].ox;
+        by = y1 + ref.stack[ref.top].oy;
+        in = !disp_area_is_empty( a ) && disp_area_contains( a, ax, ay ) &&
+             disp_area_contains( a, bx, by );
+
+        ok = disp_clip_line( &clip, &cx0, &cy0, &cx1, &cy1 );
+
+        if( !ok )
+        {
+            HOST_CHECK( !in );
+
+            /* rounding at a corner may drop a pixel on the border, no more */
+            inner.x1 = a->x1 + 1;
+            inner.y1 = a->y1 + 1;
+            inner.x2 = a->x2 - 1;
+            inner.y2 = a->y2 - 1;
+
+            if( span < 1000 && !disp_area_is_empty( &inner ) &&
+                !host_check( !line_hits( &inner, ax, ay, bx, by ), "dropped line has pixels",
+                             __FILE__, __LINE__ ) ) {
+                printf( "  (%d, %d) - (%d, %d) in %d, %d - %d, %d\n", ax, ay, bx, by,
+                        a->x1, a->y1, a->x2, a->y2 );
+                return;
+            }
+
+            continue;
+        }
+
+        HOST_CHECK( disp_area_contains( a, cx0, cy0 ) && disp_area_contains( a, cx1, cy1 ) );
+        HOST_CHECK( cx0 >= ref_min( ax, bx ) && cx0 <= ref_max( ax, bx ) &&
+                    cy0 >= ref_min( ay, by ) && cy0 <= ref_max( ay, by ) &&
+                    cx1 >= ref_min( ax, bx ) && cx1 <= ref_max( ax, bx ) &&
+                    cy1 >= ref_min( ay, by ) && cy1 <= ref_max( ay, by ) );
+
+        if( in ) {
+            HOST_CHECK( cx0 == ax && cy0 == ay && cx1 == bx && cy1 == by );
+        }
+
+        off = fmax( line_dist( ax, ay, bx, by, cx0, cy0 ), line_dist( ax, ay, bx, by, cx1, cy1 ) );
+
+        if( !host_check( off <= 0.5 + 1e-9, "clipped end point off the line", __FILE__, __LINE__ ) ) {
+            printf( "  (%d, %d) - (%d, %d) to (%d, %d) - (%d, %d)\n", ax, ay, bx, by,
+                    cx0, cy0, cx1, cy1 );
+            return;
+        }
+    }
+}
+
+int main()
+{
+    host_test_attach_tft();
+
+    test_wrap();
+    test_clip_line();
+    test_st7789v();
+    test_ssd1306();
+
+    return host_test_done( "clip" );
+}
@@ -0,0 +1,337 @@
+/**
+ * @file test_compositor.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief DispCompositor output against a per pixel reference of the scene.
+ *
+ * A random sequence of moves, visibility, alpha, key color, pixel and
+ * background changes is composed frame by frame into a screen held in
+ * memory, through the window and line callbacks. Only the changed regions
+ * are sent, so after every frame the screen must equal the whole scene
+ * built from scratch: background, then every layer bottom to top with its
+ * key color and alpha, one pixel at a time. No pixel may be sent twice in
+ * a frame, also when merged regions grow into each other, and ids that
+ * add_layer() never returned must change nothing.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "disp_compositor.h"
+#include "host_test.h"
+
+#define TEST_W 200
+#define TEST_H 120
+
+#define TEST_FRAMES 2000
+#define TEST_LAYER_MAX 64       /* widest and tallest layer */
+
+typedef struct
+{
+    uint16_t px[TEST_W * TEST_H];
+    disp_area_t window;
+    disp_coord_t row;           /* next row of the window */
+    uint8_t sent[TEST_W * TEST_H];  /* times each pixel went out this frame */
+    bool twice;
+} test_screen_t;
+
+typedef struct
+{
+    int8_t id;
+    bool solid;
+    uint16_t color;
+    uint16_t key;
+    bool use_key;
+    bool visible;
+    uint8_t alpha;
+    int x, y, w, h;
+    uint16_t px[TEST_LAYER_MAX * TEST_LAYER_MAX];
+} test_layer_t;
+
+static test_screen_t screen;
+static uint16_t test_ref[TEST_W * TEST_H];
+static uint16_t test_bg[TEST_W * TEST_H];
+static test_layer_t layers[DISP_COMP_MAX_LAYERS];
+
+// Output ///////////////////////////////////////////////////////////////////////
+static void out_window( void *ctx, const disp_area_t *area )
+{
+    test_screen_t *s = ( test_screen_t * )ctx;
+
+    /* the previous window must have been sent in full */
+    HOST_CHECK( s->row > s->window.y2 );
+    HOST_CHECK( area->x1 >= 0 && area->y1 >= 0 && area->x2 < TEST_W && area->y2 < TEST_H );
+    HOST_CHECK( area->x1 <= area->x2 && area->y1 <= area->y2 );
+
+    s->window = *area;
+    s->row = area->y1;
+}
+
+static void out_line( void *ctx, const uint16_t *px, disp_coord_t n )
+{
+    test_screen_t *s = ( test_screen_t * )ctx;
+
+    if( !HOST_CHECK( n == s->window.x2 - s->window.x1 + 1 && s->row <= s->window.y2 ) ) {
+        return;
+    }
+
+    memcpy( &s->px[s->row * TEST_W + s->window.x1], px, n * sizeof( uint16_t ) );
+
+    for( int x = s->window.x1; x <= s->window.x2; x++ ) {
+        s->twice |= s->sent[s->row * TEST_W + x]++ != 0;
+    }
+
+    s->row++;
+}
+
+static void bg_func( void *ctx, disp_coord_t x, disp_coord_t y, disp_coord_t n, uint16_t *px )
+{
+    memcpy( px, ( const uint16_t * )ctx + y * TEST_W + x, n * sizeof( uint16_t ) );
+}
+
+// Reference ////////////////////////////////////////////////////////////////////
+/* 8 bit alpha, rounded per channel */
+static uint16_t ref_blend( uint16_t fg, uint16_t bg, uint8_t alpha )
+{
+    int ia = 255 - alpha;
+    int r = ( ( fg >> 11 ) * alpha + ( bg >> 11 ) * ia + 127 ) / 255;
+    int g = ( ( ( fg >> 5 ) & 0x3F ) * alpha + ( ( bg >> 5 ) & 0x3F ) * ia + 127 ) / 255;
+    int b = ( ( fg & 0x1F ) * alpha + ( bg & 0x1F ) * ia + 127 ) / 255;
+
+    return ( uint16_t )( ( r << 11 ) | ( g << 5 ) | b );
+}
+
+static void ref_scene( uint16_t background, bool use_func, int count )
+{
+    for( int y = 0; y < TEST_H; y++ )
+    {
+        for( int x = 0; x < TEST_W; x++ )
+        {
+            uint16_t c = use_func ? test_bg[y * TEST_W + x] : background;
+
+            for( int i = 0; i < count; i++ )
+            {
+                const test_layer_t *l = &layers[i];
+                uint16_t fg;
+
+                if( !l->visible || x < l->x || y < l->y || x >= l->x + l->w || y >= l->y + l->h ) {
+                    continue;
+                }
+
+                fg = l->solid ? l->color : l->px[( y - l->y ) * l->w + ( x - l->x )];
+
+                if( !l->solid && l->use_key && fg == l->key ) {
+                    continue;
+                }
+
+                c = ref_blend( fg, c, l->alpha );
+            }
+
+            test_ref[y * TEST_W + x] = c;
+        }
+    }
+}
+
+static void frame_begin()
+{
+    memset( screen.sent, 0, sizeof( screen.sent ) );
+    screen.twice = false;
+}
+
+// Test /////////////////////////////////////////////////////////////////////////
+static void layer_paint( uint32_t *seed, test_layer_t *l )
+{
+    /* a small palette, so the key color shows up often */
+    static const uint16_t palette[] = { 0x0000, 0xF800, 0x07E0, 0x001F, 0xFFFF, 0xF81F };
+
+    for( int i = 0; i < l->w * l->h; i++ ) {
+        l->px[i] = host_rand( seed ) & 1 ? palette[host_rand( seed ) % 6] : ( uint16_t )host_rand( seed );
+    }
+}
+
+/* two overlapping regions whose union reaches one checked before */
+static void test_merge()
+{
+    disp_line_ops_t ops = { out_window, out_line, &screen };
+    DispCompositor comp( TEST_W, TEST_H, 0x0000 );
+    static const int area[3][4] = { { 0, 0, 6, 7 }, { 12, 5, 19, 11 }, { 0, 12, 21, 19 } };
+
+    for( int i = 0; i < 3; i++ )
+    {
+        int8_t id = comp.add_solid( 0xF800 >> i, area[i][2], area[i][3] );
+
+        comp.move( id, area[i][0], area[i][1] );
+        comp.set_visible( id, true );
+    }
+
+    frame_begin();
+    comp.compose( &ops );
+
+    HOST_CHECK( comp.stats()->regions == 1 );
+    HOST_CHECK( !screen.twice );
+    HOST_CHECK( comp.stats()->pixels_sent == 31 * 31 );
+}
+
+/* ids add_layer() did not return are ignored */
+static void test_bad_ids()
+{
+    disp_line_ops_t ops = { out_window, out_line, &screen };
+    DispCompositor comp( TEST_W, TEST_H, 0x0000 );
+    static uint16_t px[4];
+    int8_t id = comp.add_solid( 0x1234, 2, 2 );
+
+    comp.set_visible( id, true );
+    comp.compose( &ops );
+
+    for( int bad = -2; bad <= DISP_COMP_MAX_LAYERS; bad++ )
+    {
+        if( bad == id ) {
+            continue;
+        }
+
+        comp.move( bad, 10, 10 );
+        comp.set_pixels( bad, px );
+        comp.set_visible( bad, false );
+        comp.set_alpha( bad, 7 );
+        comp.set_key( bad, true, 0 );
+    }
+
+    comp.compose( &ops );
+    HOST_CHECK( comp.stats()->regions == 0 );
+}
+
+int main()
+{
+    uint32_t seed = 0xC0FFEE11;
+    uint16_t background = 0x2104;
+    bool use_func = false;
+    disp_line_ops_t ops = { out_window, out_line, &screen };
+    DispCompositor comp( TEST_W, TEST_H, background );
+    disp_area_t all = { 0, 0, TEST_W - 1, TEST_H - 1 };
+    int count = 0;
+
+    memset( &screen, 0, sizeof( screen ) );
+    screen.window.y2 = -1;
+
+    test_merge();
+    test_bad_ids();
+
+    /* the screen starts unknown, send it all once */
+    comp.invalidate( &all );
+
+    for( int i = 0; i < DISP_COMP_MAX_LAYERS; i++ )
+    {
+        test_layer_t *l = &layers[i];
+
+        l->solid = i % 3 == 2;
+        l->w = host_rand_range( &seed, 1, TEST_LAYER_MAX );
+        l->h = host_rand_range( &seed, 1, TEST_LAYER_MAX );
+        l->color = ( uint16_t )host_rand( &seed );
+        l->alpha = 255;
+        layer_paint( &seed, l );
+
+        l->id = l->solid ? comp.add_solid( l->color, l->w, l->h ) : comp.add_layer( l->px, l->w, l->h );
+        HOST_CHECK( l->id == i );
+        count++;
+    }
+
+    /* one too many */
+    HOST_CHECK( comp.add_solid( 0, 1, 1 ) == -1 );
+
+    for( int frame = 0; frame < TEST_FRAMES; frame++ )
+    {
+        int changes = host_rand_range( &seed, 0, 4 );
+
+        while( changes-- )
+        {
+            test_layer_t *l = &layers[host_rand( &seed ) % count];
+
+            switch( host_rand( &seed ) % 8 )
+            {
+            case 0:
+            case 1:
+                l->x = host_rand_range( &seed, -TEST_LAYER_MAX, TEST_W );
+                l->y = host_rand_range( &seed, -TEST_LAYER_MAX, TEST_H );
+                comp.move( l->id, l->x, l->y );
+                break;
+
+            case 2:
+                l->visible = !l->visible;
+                comp.set_visible( l->id, l->visible );
+                break;
+
+            case 3:
+            {
+                static const uint8_t alphas[] = { 0, 1, 2, 3, 100, 128, 252, 254, 255 };
+
+                l->alpha = alphas[host_rand( &seed ) % 9];
+                comp.set_alpha( l->id, l->alpha );
+                break;
+            }
+
+            case 4:
+                l->use_key = host_rand( &seed ) & 1;
+                l->key = l->px[host_rand( &seed ) % ( l->w * l->h )];
+                comp.set_key( l->id, l->use_key, l->key );
+                break;
+
+            case 5:
+                if( !l->solid ) {
+                    layer_paint( &seed, l );
+                    comp.set_pixels( l->id, l->px );
+                }
+                break;
+
+            case 6:
+                /* the application redrew part of the background */
+                if( use_func )
+                {
+                    disp_area_t a;
+
+                    a.x1 = host_rand_range( &seed, 0, TEST_W - 1 );
+                    a.y1 = host_rand_range( &seed, 0, TEST_H - 1 );
+                    a.x2 = disp_min( a.x1 + host_rand_range( &seed, 0, 50 ), TEST_W - 1 );
+                    a.y2 = disp_min( a.y1 + host_rand_range( &seed, 0, 50 ), TEST_H - 1 );
+
+                    for( int y = a.y1; y <= a.y2; y++ ) {
+                        for( int x = a.x1; x <= a.x2; x++ ) {
+                            test_bg[y * TEST_W + x] = ( uint16_t )host_rand( &seed );
+                        }
+                    }
+
+                    comp.invalidate( &a );
+                }
+                break;
+
+            default:
+                if( !use_func && host_rand( &seed ) % 8 == 0 )
+                {
+                    for( int i = 0; i < TEST_W * TEST_H; i++ ) {
+                        test_bg[i] = ( uint16_t )( ( i % TEST_W ) * 0x0841 ^ ( i / TEST_W ) * 0x1003 );
+                    }
+
+                    use_func = true;
+                    comp.set_background( bg_func, test_bg );
+                }
+                break;
+            }
+        }
+
+        frame_begin();
+        comp.compose( &ops );
+
+        if( !HOST_CHECK( !screen.twice ) ) {
+            printf( "  frame %d sent a pixel twice\n", frame );
+            break;
+        }
+
+        ref_scene( background, use_func, count );
+
+        if( !host_check_px( "compositor", screen.px, test_ref, TEST_W, TEST_H ) ) {
+            printf( "  frame %d\n", frame );
+            break;
+        }
+    }
+
+    return host_test_done( "compositor" );
+}
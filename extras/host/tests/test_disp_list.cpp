@@ -0,0 +1,415 @@
+/**
+ * @file test_disp_list.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief DispList tiles against immediate drawing on the st7789v.
+ *
+ * Random scenes of rectangles, lines, text and 1bpp bitmaps, many of them
+ * across tile seams and the screen edges, are drawn once with the
+ * immediate API and once through DispList and ST7789V::flush_tile(); the
+ * two screens read back from the panel must be equal, in landscape and in
+ * portrait, where 135 x 240 needs 270 tiles. Rendering the same list
+ * again must send nothing, and changing one item must send exactly the
+ * tiles its old and new bounds touch.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "st7789v.h"
+#include "disp_list.h"
+#include "disp_raster.h"
+#include "font5x7.h"
+#include "host_bus.h"
+#include "host_test.h"
+
+#define TEST_SCENES    60
+#define TEST_ITEMS     24
+#define TEST_CHANGES   300
+#define TEST_MAX_TILES DISP_LIST_TILES( 240, 240 )
+
+typedef struct
+{
+    uint8_t type;
+    bool transparent;
+    disp_coord_t x, y, w, h;    /* lines: x, y to x + w, y + h */
+    uint16_t color, bg;
+    char str[12];
+    uint8_t bits[32];           /* up to 16 x 16 */
+} test_item_t;
+
+typedef struct
+{
+    disp_area_t area[TEST_MAX_TILES];
+    int count;
+} test_tile_log_t;
+
+static test_item_t scene[TEST_ITEMS];
+static int scene_count;
+
+static disp_hash_t tile_hash[TEST_MAX_TILES];
+static test_tile_log_t tile_log;
+
+static uint16_t screen_got[240 * 240];
+static uint16_t screen_want[240 * 240];
+
+// Scene ////////////////////////////////////////////////////////////////////////
+static void random_item( uint32_t *seed, test_item_t *it )
+{
+    static const char *strs[] = { "0", "12:34", "Hello", "TEMP 21.5", "~!@#", "Wxyz" };
+    int sw = ST7789V::m_st7789v_handle.width, sh = ST7789V::m_st7789v_handle.height;
+
+    memset( it, 0, sizeof( *it ) );
+    it->type = host_rand( seed ) % 5;
+    it->transparent = host_rand( seed ) & 1;
+    it->x = host_rand_range( seed, -24, sw + 4 );
+    it->y = host_rand_range( seed, -24, sh + 4 );
+    it->color = ( uint16_t )host_rand( seed );
+    it->bg = ( uint16_t )host_rand( seed );
+
+    switch( it->type )
+    {
+    case DISP_ITEM_LINE:
+        it->w = host_rand_range( seed, -sw, sw );
+        it->h = host_rand_range( seed, -sh, sh );
+        break;
+
+    case DISP_ITEM_TEXT:
+        strcpy( it->str, strs[host_rand( seed ) % 6] );
+        break;
+
+    case DISP_ITEM_BITMAP:
+        it->w = host_rand_range( seed, 1, 16 );
+        it->h = host_rand_range( seed, 1, 16 );
+
+        for( int i = 0; i < 32; i++ ) {
+            it->bits[i] = ( uint8_t )host_rand( seed );
+        }
+        break;
+
+    default:
+        it->w = host_rand_range( seed, 1, 80 );
+        it->h = host_rand_range( seed, 1, 50 );
+        break;
+    }
+}
+
+/* the area DispList hashes the item under */
+static disp_area_t item_bounds( const test_item_t *it )
+{
+    disp_area_t b = { it->x, it->y, ( disp_coord_t )( it->x + it->w - 1 ),
+                      ( disp_coord_t )( it->y + it->h - 1 )
+                    };
+
+    if( it->type == DISP_ITEM_LINE )
+    {
+        b.x1 = disp_min( it->x, it->x + it->w );
+        b.y1 = disp_min( it->y, it->y + it->h );
+        b.x2 = disp_max( it->x, it->x + it->w );
+        b.y2 = disp_max( it->y, it->y + it->h );
+    }
+    else if( it->type == DISP_ITEM_TEXT )
+    {
+        b.x2 = it->x + strlen( it->str ) * font5x7.advance - 1;
+        b.y2 = it->y + font5x7.height - 1;
+    }
+
+    return b;
+}
+
+static void add_item( DispList *list, const test_item_t *it )
+{
+    switch( it->type )
+    {
+    case DISP_ITEM_RECT:
+        HOST_CHECK( list->add_rect( it->x, it->y, it->w, it->h, it->color ) );
+        break;
+
+    case DISP_ITEM_FILL_RECT:
+        HOST_CHECK( list->add_fill_rect( it->x, it->y, it->w, it->h, it->color ) );
+        break;
+
+    case DISP_ITEM_LINE:
+        HOST_CHECK( list->add_line( it->x, it->y, it->x + it->w, it->y + it->h, it->color ) );
+        break;
+
+    case DISP_ITEM_TEXT:
+        HOST_CHECK( list->add_text( it->x, it->y, it->str, &font5x7, it->color, it->bg,
+                                    it->transparent ) );
+        break;
+
+    default:
+        HOST_CHECK( list->add_bitmap( it->x, it->y, it->w, it->h, it->bits, it->color, it->bg,
+                                      it->transparent ) );
+        break;
+    }
+}
+
+/* the same item through the immediate API */
+static void draw_item( const test_item_t *it )
+{
+    uint16_t bg = 0;
+    disp_raster_t r = ST7789V::raster( &bg );
+    uint16_t px[16 * 16];
+
+    switch( it->type )
+    {
+    case DISP_ITEM_RECT:
+        ST7789V::draw_hline( it->x, it->y, it->w, it->color );
+        ST7789V::draw_hline( it->x, it->y + it->h - 1, it->w, it->color );
+        ST7789V::draw_vline( it->x, it->y, it->h, it->color );
+        ST7789V::draw_vline( it->x + it->w - 1, it->y, it->h, it->color );
+        break;
+
+    case DISP_ITEM_FILL_RECT:
+        ST7789V::fill_rect( it->x, it->y, it->w, it->h, it->color );
+        break;
+
+    case DISP_ITEM_LINE:
+        disp_draw_line( &r, it->x, it->y, it->x + it->w, it->y + it->h, it->color );
+        break;
+
+    case DISP_ITEM_TEXT:
+        if( !it->transparent ) {
+            ST7789V::draw_string( it->x, it->y, it->str, &font5x7, it->color, it->bg );
+            break;
+        }
+
+        for( int i = 0; it->str[i]; i++ )
+        {
+            for( int col = 0; col < font5x7.advance; col++ )
+            {
+                uint8_t bits = disp_font_column( &font5x7, it->str[i], col );
+
+                for( int row = 0; row < font5x7.height; row++ )
+                {
+                    if( bits & ( 1 << row ) ) {
+                        ST7789V::put_pixel( it->x + i * font5x7.advance + col, it->y + row, it->color );
+                    }
+                }
+            }
+        }
+        break;
+
+    default:
+        for( int y = 0; y < it->h; y++ )
+        {
+            for( int x = 0; x < it->w; x++ )
+            {
+                bool on = it->bits[y * ( ( it->w + 7 ) / 8 ) + x / 8] & ( 0x80 >> ( x & 7 ) );
+
+                px[y * it->w + x] = on ? it->color : it->bg;
+
+                if( on && it->transparent ) {
+                    ST7789V::put_pixel( it->x + x, it->y + y, it->color );
+                }
+            }
+        }
+
+        if( !it->transparent ) {
+            ST7789V::draw_bitmap( it->x, it->y, it->w, it->h, px );
+        }
+        break;
+    }
+}
+
+static void draw_immediate( uint16_t background )
+{
+    int sw = ST7789V::m_st7789v_handle.width, sh = ST7789V::m_st7789v_handle.height;
+
+    ST7789V::fill_rect( 0, 0, sw, sh, background );
+
+    for( int i = 0; i < scene_count; i++ ) {
+        draw_item( &scene[i] );
+    }
+
+    ST7789V::read_gram( 0, 0, sw, sh, screen_want );
+}
+
+static void log_tile( void *ctx, const disp_area_t *area, const uint16_t *px )
+{
+    test_tile_log_t *log = ( test_tile_log_t * )ctx;
+
+    if( log->count < TEST_MAX_TILES ) {
+        log->area[log->count] = *area;
+    }
+
+    log->count++;
+    ST7789V::flush_tile( NULL, area, px );
+}
+
+static void render( DispList *list )
+{
+    disp_tile_ops_t ops = { log_tile, &tile_log };
+
+    list->begin();
+
+    for( int i = 0; i < scene_count; i++ ) {
+        add_item( list, &scene[i] );
+    }
+
+    tile_log.count = 0;
+    list->render( &ops );
+}
+
+static bool check_screen( const char *what )
+{
+    int sw = ST7789V::m_st7789v_handle.width, sh = ST7789V::m_st7789v_handle.height;
+
+    HOST_CHECK( ST7789V::read_gram( 0, 0, sw, sh, screen_got ) );
+
+    return host_check_px( what, screen_got, screen_want, sw, sh );
+}
+
+// Test /////////////////////////////////////////////////////////////////////////
+
+/* tile output equals immediate drawing, every tile of the panel is sent */
+static void test_scenes( DispList *list, uint32_t seed )
+{
+    int sw = ST7789V::m_st7789v_handle.width, sh = ST7789V::m_st7789v_handle.height;
+
+    for( int n = 0; n < TEST_SCENES; n++ )
+    {
+        uint16_t background = n & 1 ? ( uint16_t )host_rand( &seed ) : 0x0000;
+        DispList fresh( sw, sh, background, tile_hash );
+
+        scene_count = host_rand_range( &seed, 1, TEST_ITEMS );
+
+        for( int i = 0; i < scene_count; i++ ) {
+            random_item( &seed, &scene[i] );
+        }
+
+        draw_immediate( background );
+
+        /* a garbage screen, the first render must cover all of it */
+        ST7789V::fill_rect( 0, 0, sw, sh, 0xDEAD );
+        render( n & 1 ? &fresh : list );
+
+        HOST_CHECK( tile_log.count == DISP_LIST_TILES( sw, sh ) );
+        HOST_CHECK( ( n & 1 ? &fresh : list )->stats()->tiles_total == DISP_LIST_TILES( sw, sh ) );
+
+        if( !check_screen( "tiles vs immediate" ) ) {
+            printf( "  scene %d of %d items on %d x %d\n", n, scene_count, sw, sh );
+            break;
+        }
+
+        list->invalidate();
+    }
+}
+
+/* unchanged tiles are skipped, a change sends the tiles it touches */
+static void test_skipping()
+{
+    int sw = ST7789V::m_st7789v_handle.width, sh = ST7789V::m_st7789v_handle.height;
+    int cols = ( sw + DISP_TILE_W - 1 ) / DISP_TILE_W;
+    DispList list( sw, sh, 0x0000, tile_hash );
+    uint32_t seed = 0xD15711E5;
+
+    scene_count = TEST_ITEMS;
+
+    for( int i = 0; i < scene_count; i++ ) {
+        random_item( &seed, &scene[i] );
+    }
+
+    render( &list );
+    HOST_CHECK( tile_log.count == DISP_LIST_TILES( sw, sh ) );
+
+    for( int n = 0; n < TEST_CHANGES; n++ )
+    {
+        uint32_t bytes = host_test_model.stats()->data_bytes;
+        test_item_t *it = &scene[host_rand( &seed ) % scene_count];
+        disp_area_t before = item_bounds( it ), after;
+        bool want[TEST_MAX_TILES], got[TEST_MAX_TILES];
+        int expected = 0;
+
+        /* nothing changed, nothing goes out */
+        render( &list );
+
+        if( !HOST_CHECK( tile_log.count == 0 && list.stats()->tiles_rendered == 0 ) ||
+                !HOST_CHECK( host_test_model.stats()->data_bytes == bytes ) ) {
+            break;
+        }
+
+        switch( host_rand( &seed ) % 3 )
+        {
+        case 0:
+            it->x += host_rand_range( &seed, 1, 20 );
+            break;
+
+        case 1:
+            it->y -= host_rand_range( &seed, 1, 20 );
+            break;
+
+        default:
+            it->color ^= 1 + host_rand( &seed ) % 0xFFFF;
+            break;
+        }
+
+        after = item_bounds( it );
+        render( &list );
+        memset( got, 0, sizeof( got ) );
+
+        for( int t = 0; t < DISP_LIST_TILES( sw, sh ); t++ )
+        {
+            disp_area_t tile = { ( disp_coord_t )( t % cols * DISP_TILE_W ),
+                                 ( disp_coord_t )( t / cols * DISP_TILE_H ), 0, 0
+                               };
+            disp_area_t hit;
+
+            tile.x2 = disp_min( tile.x1 + DISP_TILE_W - 1, sw - 1 );
+            tile.y2 = disp_min( tile.y1 + DISP_TILE_H - 1, sh - 1 );
+            want[t] = disp_area_intersect( &hit, &before, &tile ) ||
+                      disp_area_intersect( &hit, &after, &tile );
+            expected += want[t];
+        }
+
+        for( int i = 0; i < tile_log.count && i < TEST_MAX_TILES; i++ ) {
+            got[tile_log.area[i].y1 / DISP_TILE_H * cols + tile_log.area[i].x1 / DISP_TILE_W] = true;
+        }
+
+        if( !HOST_CHECK( tile_log.count == expected ) ||
+                !HOST_CHECK( memcmp( got, want, DISP_LIST_TILES( sw, sh ) * sizeof( bool ) ) == 0 ) ) {
+            printf( "  change %d of a type %u item, %d tiles sent, want %d\n", n, it->type,
+                    tile_log.count, expected );
+            break;
+        }
+
+        draw_immediate( 0x0000 );
+        render( &list );
+
+        if( !check_screen( "tiles after a change" ) ) {
+            printf( "  change %d of a type %u item\n", n, it->type );
+            break;
+        }
+    }
+
+    /* invalidate() sends everything again */
+    list.invalidate();
+    render( &list );
+    HOST_CHECK( tile_log.count == DISP_LIST_TILES( sw, sh ) );
+}
+
+int main()
+{
+    static DispListBuffered<135, 240> portrait( 0x0000 );
+    DispList landscape( 240, 135, 0x0000, tile_hash );
+    uint8_t rotation;
+
+    host_test_attach_tft();
+    rotation = ST7789V::m_st7789v_handle.rotation;
+
+    test_scenes( &landscape, 0x7113AAAA );
+    test_skipping();
+
+    /* the default panel upright, 9 x 30 tiles */
+    ST7789V::set_rotation( rotation + 1 );
+    HOST_CHECK( ST7789V::m_st7789v_handle.width == 135 && ST7789V::m_st7789v_handle.height == 240 );
+    HOST_CHECK( DISP_LIST_TILES( 135, 240 ) == 270 );
+
+    test_scenes( &portrait, 0x90127A17 );
+    test_skipping();
+
+    ST7789V::set_rotation( rotation );
+
+    return host_test_done( "disp_list" );
+}
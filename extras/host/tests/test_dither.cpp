@@ -0,0 +1,308 @@
+/**
+ * @file test_dither.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief OledDither and OledGrayDither against naive references.
+ *
+ * Random gray and rgb565 images are dithered at random places of a frame
+ * buffer that holds random content. The references work on the whole
+ * image at once: threshold and Bayer test each pixel, the Bayer matrix
+ * built from its recursive definition, and Floyd-Steinberg keeps a full
+ * error image with each share rounded toward zero like the streaming
+ * version. The pseudo gray planes are checked frame by frame, together
+ * with the areas handed to the flush callback.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "oled_dither.h"
+#include "host_test.h"
+
+#define TEST_FB_W 128
+#define TEST_FB_H 64
+
+#define TEST_IMAGES 400
+
+static uint8_t fb_mem[TEST_FB_W * TEST_FB_H / 8];
+static uint8_t test_ref[TEST_FB_W * TEST_FB_H / 8];
+static uint8_t test_gray[TEST_FB_H][TEST_FB_W];
+static uint16_t test_rgb[TEST_FB_H][TEST_FB_W];
+static int test_err[TEST_FB_H + 1][TEST_FB_W];
+static uint8_t test_levels[OLED_GRAY_BUF_SIZE( TEST_FB_W, TEST_FB_H )];
+
+// Reference ////////////////////////////////////////////////////////////////////
+static void ref_set( int x, int y, bool on )
+{
+    if( on ) {
+        test_ref[( y >> 3 ) * TEST_FB_W + x] |= 1 << ( y & 7 );
+    }
+    else {
+        test_ref[( y >> 3 ) * TEST_FB_W + x] &= ~( 1 << ( y & 7 ) );
+    }
+}
+
+/* 8x8 ordered dither matrix, each 2x2 step splits a cell as 0 2 / 3 1 */
+static int ref_bayer( int x, int y )
+{
+    int v = 0;
+
+    for( int k = 0; k < 3; k++ )
+    {
+        int bx = ( x >> k ) & 1, by = ( y >> k ) & 1;
+        int q = by ? ( bx ? 1 : 3 ) : ( bx ? 2 : 0 );
+
+        v += q << ( 2 * ( 2 - k ) );
+    }
+
+    return v;
+}
+
+static uint8_t ref_gray565( uint16_t c )
+{
+    int r = ( c >> 11 ) * 8, g = ( ( c >> 5 ) & 0x3F ) * 4, b = ( c & 0x1F ) * 8;
+
+    return ( uint8_t )( ( r * 77 + g * 151 + b * 28 ) / 256 );
+}
+
+static void ref_dither( oled_dither_t method, int x0, int y0, int w, int h )
+{
+    memset( test_err, 0, sizeof( test_err ) );
+
+    for( int y = 0; y < h; y++ )
+    {
+        for( int x = 0; x < w; x++ )
+        {
+            int g = test_gray[y][x];
+
+            switch( method )
+            {
+            case OLED_DITHER_BAYER:
+                /* fb coordinates pick the cell, so tiles line up across images */
+                ref_set( x0 + x, y0 + y, g > ref_bayer( x0 + x, y0 + y ) * 4 + 1 );
+                break;
+
+            case OLED_DITHER_FLOYD:
+            {
+                int v = g + test_err[y][x];
+                int e = v >= 128 ? v - 255 : v;
+
+                ref_set( x0 + x, y0 + y, v >= 128 );
+
+                if( x + 1 < w ) {
+                    test_err[y][x + 1] += e * 7 / 16;
+                    test_err[y + 1][x + 1] += e / 16;
+                }
+
+                if( x > 0 ) {
+                    test_err[y + 1][x - 1] += e * 3 / 16;
+                }
+
+                test_err[y + 1][x] += e * 5 / 16;
+                break;
+            }
+
+            default:
+                ref_set( x0 + x, y0 + y, g >= 128 );
+                break;
+            }
+        }
+    }
+}
+
+// Test /////////////////////////////////////////////////////////////////////////
+static bool compare( const char *what, int n )
+{
+    host_test_checks++;
+
+    for( int i = 0; i < ( int )sizeof( fb_mem ); i++ )
+    {
+        if( fb_mem[i] != test_ref[i] )
+        {
+            host_test_failures++;
+            printf( "%s, image %d: page %d column %d is %02X, want %02X\n", what, n,
+                    i / TEST_FB_W, i % TEST_FB_W, fb_mem[i], test_ref[i] );
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void random_fb( uint32_t *seed )
+{
+    for( int i = 0; i < ( int )sizeof( fb_mem ); i++ ) {
+        fb_mem[i] = test_ref[i] = ( uint8_t )host_rand( seed );
+    }
+}
+
+static void random_image( uint32_t *seed, int w, int h, bool rgb )
+{
+    /* smooth ramps as well as noise, Floyd-Steinberg errors build up on ramps */
+    bool ramp = host_rand( seed ) & 1;
+
+    for( int y = 0; y < h; y++ )
+    {
+        for( int x = 0; x < w; x++ )
+        {
+            if( rgb ) {
+                test_rgb[y][x] = ramp ? ( uint16_t )( ( x * 31 / w ) << 11 | ( y * 63 / h ) << 5 )
+                                 : ( uint16_t )host_rand( seed );
+                test_gray[y][x] = ref_gray565( test_rgb[y][x] );
+            }
+            else {
+                test_gray[y][x] = ramp ? ( uint8_t )( ( x + y ) * 255 / ( w + h ) )
+                                  : ( uint8_t )host_rand( seed );
+            }
+        }
+    }
+}
+
+static void test_dither()
+{
+    static const char *names[] = { "threshold", "bayer", "floyd" };
+    uint32_t seed = 0xD1D1D1D1;
+    OledFrameBuffer fb( fb_mem, TEST_FB_W, TEST_FB_H );
+
+    for( int n = 0; n < TEST_IMAGES; n++ )
+    {
+        oled_dither_t method = ( oled_dither_t )( n % 3 );
+        OledDither dither( &fb, method );
+        int w = host_rand_range( &seed, 1, TEST_FB_W );
+        int h = host_rand_range( &seed, 1, TEST_FB_H );
+        int x = host_rand_range( &seed, 0, TEST_FB_W - w );
+        int y = host_rand_range( &seed, 0, TEST_FB_H - h );
+        bool rgb = host_rand( &seed ) & 1;
+
+        random_fb( &seed );
+        random_image( &seed, w, h, rgb );
+
+        HOST_CHECK( dither.begin( x, y, w, h ) );
+
+        for( int row = 0; row < h; row++ ) {
+            HOST_CHECK( rgb ? dither.push_rgb565( test_rgb[row] ) : dither.push_gray( test_gray[row] ) );
+        }
+
+        /* one row too many changes nothing */
+        HOST_CHECK( !dither.push_gray( test_gray[0] ) );
+
+        ref_dither( method, x, y, w, h );
+
+        if( !compare( names[method], n ) ) {
+            printf( "  %d x %d at %d, %d\n", w, h, x, y );
+            break;
+        }
+    }
+
+    /* images that do not fit are refused and draw nothing */
+    OledDither dither( &fb, OLED_DITHER_THRESHOLD );
+
+    HOST_CHECK( !dither.begin( -1, 0, 8, 8 ) );
+    HOST_CHECK( !dither.begin( TEST_FB_W - 7, 0, 8, 8 ) );
+    HOST_CHECK( !dither.begin( 0, TEST_FB_H - 7, 8, 8 ) );
+    HOST_CHECK( !dither.begin( 0, 0, 0, 8 ) );
+    HOST_CHECK( !dither.push_gray( test_gray[0] ) );
+}
+
+/* the flushed areas of one next_frame() call */
+typedef struct
+{
+    disp_area_t areas[TEST_FB_H / 8];
+    int count;
+} test_flush_t;
+
+static void on_flush( void *ctx, const disp_area_t *area )
+{
+    test_flush_t *f = ( test_flush_t * )ctx;
+
+    if( HOST_CHECK( f->count < TEST_FB_H / 8 ) ) {
+        f->areas[f->count++] = *area;
+    }
+}
+
+static void test_gray_planes()
+{
+    uint32_t seed = 0x6A6A6A6A;
+    OledFrameBuffer fb( fb_mem, TEST_FB_W, TEST_FB_H );
+
+    for( int n = 0; n < TEST_IMAGES / 4; n++ )
+    {
+        OledGrayDither gray( &fb, test_levels );
+        int w = host_rand_range( &seed, 1, TEST_FB_W );
+        int h = host_rand_range( &seed, 1, TEST_FB_H );
+        int x0 = host_rand_range( &seed, 0, TEST_FB_W - w );
+        int y0 = host_rand_range( &seed, 0, TEST_FB_H - h );
+        int frame;
+
+        random_fb( &seed );
+        random_image( &seed, w, h, false );
+
+        HOST_CHECK( gray.begin( x0, y0, w, h ) );
+
+        for( int row = 0; row < h; row++ ) {
+            HOST_CHECK( gray.push_gray( test_gray[row] ) );
+        }
+
+        HOST_CHECK( !gray.push_gray( test_gray[0] ) );
+
+        for( frame = 0; frame < 2 * OLED_GRAY_FRAMES; frame++ )
+        {
+            uint8_t before[sizeof( fb_mem )];
+            test_flush_t flushed;
+
+            memcpy( before, fb_mem, sizeof( fb_mem ) );
+            flushed.count = 0;
+
+            gray.next_frame( on_flush, &flushed );
+
+            for( int y = 0; y < h; y++ )
+            {
+                for( int x = 0; x < w; x++ )
+                {
+                    /* Bayer in image coordinates, levels 0 ~ OLED_GRAY_FRAMES */
+                    int level = ( test_gray[y][x] * OLED_GRAY_FRAMES * 64 + ref_bayer( x, y ) * 255 ) /
+                                ( 255 * 64 );
+
+                    level = level > OLED_GRAY_FRAMES ? OLED_GRAY_FRAMES : level;
+                    ref_set( x0 + x, y0 + y, ( frame % OLED_GRAY_FRAMES + x + y ) % OLED_GRAY_FRAMES < level );
+                }
+            }
+
+            if( !compare( "gray plane", n ) ) {
+                printf( "  %d x %d at %d, %d, frame %d\n", w, h, x0, y0, frame );
+                return;
+            }
+
+            /* every changed byte is flushed, nothing outside the image is */
+            for( int i = 0; i < ( int )sizeof( fb_mem ); i++ )
+            {
+                int page = i / TEST_FB_W, col = i % TEST_FB_W;
+                bool covered = false;
+
+                for( int k = 0; k < flushed.count; k++ )
+                {
+                    const disp_area_t *a = &flushed.areas[k];
+
+                    covered |= a->y1 == page * 8 && a->y2 == page * 8 + 7 && col >= a->x1 && col <= a->x2;
+                }
+
+                if( fb_mem[i] != before[i] && !HOST_CHECK( covered ) ) {
+                    return;
+                }
+
+                if( covered && !HOST_CHECK( col >= x0 && col < x0 + w &&
+                                            page >= y0 / 8 && page <= ( y0 + h - 1 ) / 8 ) ) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    test_dither();
+    test_gray_planes();
+
+    return host_test_done( "dither" );
+}
@@ -0,0 +1,429 @@
+/**
+ * @file test_jobs.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Resumable jobs against the blocking calls and a per pixel
+ * reference.
+ *
+ * ST7789V fill and clear jobs stepped one chunk at a time must leave the
+ * same screen as the reference and put the same command and data bytes
+ * on the bus as the blocking call, only in more transactions. Jobs of the
+ * same panel interleaved by a SpiScheduler, with direct draws between the
+ * steps, must land every pixel where the reference puts it: each step
+ * writes the next pixels of its job in row order, whatever ran before.
+ * SSD1306 flush jobs stepped between other flushes and draws must leave
+ * GDDRAM equal to the frame buffer and keep to their byte budget.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "st7789v.h"
+#include "SSD1306.h"
+#include "spi_scheduler.h"
+#include "host_bus.h"
+#include "host_test.h"
+
+#define TEST_CASES 60
+#define TEST_BUS_MAX 150000     /* command and data bytes of one call */
+#define TEST_JOBS 3
+
+static Ssd1306Model test_oled_model;
+
+static uint16_t screen_got[240 * 240];
+static uint16_t screen_want[240 * 240];
+
+typedef struct
+{
+    uint16_t bytes[TEST_BUS_MAX];   /* 'C' or 'D' << 8 | byte */
+    uint32_t n;
+    FILE *fp;
+} test_bus_t;
+
+static test_bus_t bus_stepped, bus_blocking;
+
+// Bus capture //////////////////////////////////////////////////////////////////
+static BusTraceWriter *bus_start( test_bus_t *b )
+{
+    BusTraceWriter *writer;
+
+    b->fp = tmpfile();
+    b->n = 0;
+    writer = new BusTraceWriter( b->fp );
+    host_bus_trace( writer );
+
+    return writer;
+}
+
+/* C and D bytes in order, transaction and line boundaries left out */
+static void bus_stop( test_bus_t *b, BusTraceWriter *writer )
+{
+    bus_trace_rec_t rec;
+
+    host_bus_trace( NULL );
+    writer->flush();
+    delete writer;
+    rewind( b->fp );
+
+    BusTraceReader reader( b->fp );
+
+    while( reader.next( &rec ) )
+    {
+        if( rec.kind != BUS_TRACE_CMD && rec.kind != BUS_TRACE_DATA ) {
+            continue;
+        }
+
+        for( uint16_t i = 0; i < rec.len && b->n < TEST_BUS_MAX; i++ ) {
+            b->bytes[b->n++] = ( uint16_t )( rec.kind << 8 | rec.bytes[i] );
+        }
+    }
+
+    fclose( b->fp );
+}
+
+// Reference ////////////////////////////////////////////////////////////////////
+static int screen_w()
+{
+    return ST7789V::m_st7789v_handle.width;
+}
+
+static int screen_h()
+{
+    return ST7789V::m_st7789v_handle.height;
+}
+
+static void ref_rect( int x, int y, int w, int h, uint16_t color )
+{
+    for( int j = disp_max( y, 0 ); j < disp_min( y + h, screen_h() ); j++ ) {
+        for( int i = disp_max( x, 0 ); i < disp_min( x + w, screen_w() ); i++ ) {
+            screen_want[j * screen_w() + i] = color;
+        }
+    }
+}
+
+/* pixels first ~ first + n - 1 of a job, in row order over its area */
+static void ref_job_pixels( const st7789v_stream_job_t *job, uint32_t first, uint32_t n )
+{
+    const disp_area_t *a = &job->area;
+    int w = a->x2 - a->x1 + 1;
+
+    for( uint32_t k = first; k < first + n; k++ ) {
+        screen_want[( a->y1 + k / w ) * screen_w() + a->x1 + k % w] = job->color;
+    }
+}
+
+static uint32_t job_total( const st7789v_stream_job_t *job )
+{
+    return ( uint32_t )( job->area.x2 - job->area.x1 + 1 ) * ( job->area.y2 - job->area.y1 + 1 );
+}
+
+static bool check_screen( const char *what, int n )
+{
+    HOST_CHECK( ST7789V::read_gram( 0, 0, screen_w(), screen_h(), screen_got ) );
+
+    if( !host_check_px( what, screen_got, screen_want, screen_w(), screen_h() ) ) {
+        printf( "  case %d\n", n );
+        return false;
+    }
+
+    return true;
+}
+
+// ST7789V //////////////////////////////////////////////////////////////////////
+
+/* one job stepped alone: same pixels, same bytes as the blocking call */
+static void test_stepped()
+{
+    uint32_t seed = 0x10B510B5;
+
+    ST7789V::clear_screen_directly( 0x0000 );
+    memset( screen_want, 0, sizeof( screen_want ) );
+
+    for( int n = 0; n < TEST_CASES; n++ )
+    {
+        int x = host_rand_range( &seed, -60, screen_w() );
+        int y = host_rand_range( &seed, -60, screen_h() );
+        int w = host_rand_range( &seed, 0, 200 );
+        int h = host_rand_range( &seed, 0, 120 );
+        uint16_t color = ( uint16_t )host_rand( &seed );
+        uint16_t chunk = host_rand_range( &seed, 1, 700 );
+        bool clear = n % 8 == 7;
+        st7789v_stream_job_t job;
+        BusTraceWriter *writer;
+        uint32_t steps = 0, bytes;
+
+        writer = bus_start( &bus_stepped );
+
+        if( clear ) {
+            ST7789V::clear_job( &job, color, chunk );
+        }
+        else {
+            ST7789V::fill_job( &job, x, y, w, h, color, chunk );
+        }
+
+        bytes = job.left * 2;
+
+        for( ;; )
+        {
+            uint32_t pixels = host_test_model.stats()->pixels;
+            bool done = ST7789V::job_step( &job );
+
+            /* a step never sends more pixels than its chunk allows */
+            HOST_CHECK( host_test_model.stats()->pixels - pixels <= ( uint32_t )( job.job.chunk / 2 ) );
+            steps++;
+
+            if( done ) {
+                break;
+            }
+        }
+
+        bus_stop( &bus_stepped, writer );
+
+        HOST_CHECK( steps <= ( bytes ? ( bytes + ( job.job.chunk & ~1 ) - 1 ) / ( job.job.chunk & ~1 ) : 1 ) );
+
+        if( clear ) {
+            ref_rect( 0, 0, screen_w(), screen_h(), color );
+        }
+        else {
+            ref_rect( x, y, w, h, color );
+        }
+
+        if( !check_screen( clear ? "clear_job" : "fill_job", n ) ) {
+            return;
+        }
+
+        /* the blocking call again, same bytes on the bus */
+        writer = bus_start( &bus_blocking );
+
+        if( clear ) {
+            ST7789V::clear_screen_directly( color );
+        }
+        else {
+            ST7789V::fill_rect( x, y, w, h, color );
+        }
+
+        bus_stop( &bus_blocking, writer );
+
+        HOST_CHECK( bus_stepped.n == bus_blocking.n && bus_stepped.n < TEST_BUS_MAX );
+
+        if( !HOST_CHECK( !memcmp( bus_stepped.bytes, bus_blocking.bytes,
+                                  bus_stepped.n * sizeof( uint16_t ) ) ) ) {
+            printf( "  case %d, %d x %d at %d, %d, chunk %u\n", n, w, h, x, y, chunk );
+            return;
+        }
+    }
+}
+
+/* jobs of one panel cut into each other and into direct draws */
+static void test_interleaved()
+{
+    uint32_t seed = 0x1A7E1EA5;
+    SpiScheduler sched;
+
+    ST7789V::clear_screen_directly( 0x0000 );
+    memset( screen_want, 0, sizeof( screen_want ) );
+
+    for( int n = 0; n < TEST_CASES; n++ )
+    {
+        st7789v_stream_job_t jobs[TEST_JOBS];
+        uint32_t polls = 0;
+
+        for( int i = 0; i < TEST_JOBS; i++ )
+        {
+            int x = host_rand_range( &seed, -40, screen_w() - 1 );
+            int y = host_rand_range( &seed, -40, screen_h() - 1 );
+
+            ST7789V::fill_job( &jobs[i], x, y, host_rand_range( &seed, 1, 160 ),
+                               host_rand_range( &seed, 1, 100 ), ( uint16_t )host_rand( &seed ),
+                               host_rand_range( &seed, 2, 300 ) );
+            jobs[i].job.priority = host_rand( &seed ) % 3;
+            sched.submit( &jobs[i].job );
+        }
+
+        while( sched.busy() )
+        {
+            uint32_t left[TEST_JOBS];
+
+            for( int i = 0; i < TEST_JOBS; i++ ) {
+                left[i] = jobs[i].left;
+            }
+
+            HOST_CHECK( sched.poll() );
+            polls++;
+
+            for( int i = 0; i < TEST_JOBS; i++ ) {
+                ref_job_pixels( &jobs[i], job_total( &jobs[i] ) - left[i], left[i] - jobs[i].left );
+            }
+
+            /* other traffic to the same panel between steps */
+            switch( host_rand( &seed ) % 4 )
+            {
+            case 0:
+            {
+                int x = host_rand_range( &seed, 0, screen_w() - 1 );
+                int y = host_rand_range( &seed, 0, screen_h() - 1 );
+                uint16_t c = ( uint16_t )host_rand( &seed );
+
+                ST7789V::put_pixel( x, y, c );
+                ref_rect( x, y, 1, 1, c );
+                break;
+            }
+
+            case 1:
+            {
+                int x = host_rand_range( &seed, -10, screen_w() - 1 );
+                int y = host_rand_range( &seed, -10, screen_h() - 1 );
+                int w = host_rand_range( &seed, 1, 30 ), h = host_rand_range( &seed, 1, 30 );
+                uint16_t c = ( uint16_t )host_rand( &seed );
+
+                ST7789V::fill_rect( x, y, w, h, c );
+                ref_rect( x, y, w, h, c );
+                break;
+            }
+
+            case 2:
+            {
+                /* a job raised above the others cuts in mid row */
+                st7789v_stream_job_t *job = &jobs[host_rand( &seed ) % TEST_JOBS];
+
+                if( job->left ) {
+                    sched.cancel( &job->job );
+                    job->job.priority = host_rand( &seed ) % 4;
+                    sched.submit( &job->job );
+                }
+                break;
+            }
+
+            default:
+                break;
+            }
+
+            if( !HOST_CHECK( polls < 100000 ) ) {
+                return;
+            }
+        }
+
+        for( int i = 0; i < TEST_JOBS; i++ ) {
+            HOST_CHECK( jobs[i].left == 0 );
+        }
+
+        if( !check_screen( "interleaved jobs", n ) ) {
+            return;
+        }
+    }
+}
+
+// SSD1306 //////////////////////////////////////////////////////////////////////
+static bool check_oled( SSD1306 *oled, const char *what, int n )
+{
+    host_test_checks++;
+
+    if( memcmp( test_oled_model.gram(), oled->framebuffer()->buffer(), oled->framebuffer()->size() ) )
+    {
+        host_test_failures++;
+
+        for( int i = 0; i < oled->framebuffer()->size(); i++ )
+        {
+            if( test_oled_model.gram()[i] != oled->framebuffer()->buffer()[i] ) {
+                printf( "%s, case %d: page %d column %d is %02X, want %02X\n", what, n,
+                        i / 128, i % 128, test_oled_model.gram()[i], oled->framebuffer()->buffer()[i] );
+                break;
+            }
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+static void random_area( uint32_t *seed, disp_area_t *a )
+{
+    a->x1 = host_rand_range( seed, -20, 127 );
+    a->y1 = host_rand_range( seed, -20, 63 );
+    a->x2 = a->x1 + host_rand_range( seed, -1, 100 );
+    a->y2 = a->y1 + host_rand_range( seed, -1, 60 );
+}
+
+static void test_flush_jobs()
+{
+    SSD1306Buffered<128, 64> oled( 1, 2 );
+    uint32_t seed = 0xF1F1F1F1;
+    disp_area_t all = { 0, 0, 127, 63 };
+
+    oled.flush();
+
+    for( int n = 0; n < TEST_CASES * 4; n++ )
+    {
+        oled_flush_job_t job;
+        disp_area_t a, b, screen, pages;
+        uint16_t budget = host_rand_range( &seed, 0, 200 );
+
+        for( int i = 0; i < 20; i++ ) {
+            oled.fill_rect( host_rand_range( &seed, -10, 127 ), host_rand_range( &seed, -10, 63 ),
+                            host_rand_range( &seed, 1, 40 ), host_rand_range( &seed, 1, 40 ),
+                            ( oled_color_t )( host_rand( &seed ) & 1 ) );
+        }
+
+        random_area( &seed, &a );
+        oled.flush_job( &job, &a, budget );
+
+        /* other flushes of a second area, then everything must match */
+        random_area( &seed, &b );
+
+        for( ;; )
+        {
+            uint32_t bytes = test_oled_model.stats()->data_bytes;
+            bool done = oled.flush_step( &job );
+
+            HOST_CHECK( test_oled_model.stats()->data_bytes - bytes <= ( budget ? budget : 1 ) );
+
+            if( done ) {
+                break;
+            }
+
+            if( host_rand( &seed ) & 1 ) {
+                oled.flush_area( &b );
+            }
+        }
+
+        oled.flush_area( &b );
+
+        /* outside the two areas GDDRAM keeps the old frame, so send it all to compare */
+        if( disp_area_intersect( &pages, &a, &all ) )
+        {
+            bool ok = true;
+
+            for( int p = pages.y1 >> 3; ok && p <= pages.y2 >> 3; p++ ) {
+                ok = !memcmp( test_oled_model.gram() + p * 128 + pages.x1,
+                              oled.framebuffer()->buffer() + p * 128 + pages.x1, pages.x2 - pages.x1 + 1 );
+            }
+
+            if( !HOST_CHECK( ok ) ) {
+                printf( "  flush_job case %d, area %d, %d - %d, %d, budget %u\n", n,
+                        a.x1, a.y1, a.x2, a.y2, budget );
+                return;
+            }
+        }
+
+        screen = all;
+        oled.flush_area( &screen );
+
+        if( !check_oled( &oled, "flush_area", n ) ) {
+            return;
+        }
+    }
+}
+
+int main()
+{
+    host_bus_attach_i2c( &test_oled_model, SSD1306_DEVICE_ADDR );
+    host_test_attach_tft();
+
+    test_stepped();
+    test_interleaved();
+    test_flush_jobs();
+
+    return host_test_done( "jobs" );
+}
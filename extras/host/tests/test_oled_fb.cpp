@@ -0,0 +1,189 @@
+/**
+ * @file test_oled_fb.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief OledFrameBuffer fills and blits against a per pixel reference.
+ *
+ * Random fill_area() calls and blit() calls in every mode, at any y and
+ * hanging over any edge, are made on buffers of a few sizes, each at every
+ * offset from a word boundary so the word wide runs start and end in all
+ * positions. The reference sets each pixel on its own.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "oled_fb.h"
+#include "host_test.h"
+
+#define TEST_CASES 20000
+#define TEST_SRC_MAX 40         /* widest and tallest source image */
+
+typedef struct
+{
+    disp_coord_t w, h;
+} test_size_t;
+
+static const test_size_t test_sizes[] = { { 128, 64 }, { 128, 32 }, { 83, 40 }, { 7, 8 } };
+
+static uint8_t test_mem[128 * 8 + 4];
+static uint8_t test_ref[128 * 8];
+static uint8_t test_src[TEST_SRC_MAX * ( ( TEST_SRC_MAX + 7 ) / 8 )];
+
+// Reference ////////////////////////////////////////////////////////////////////
+static bool ref_get( int w, int x, int y )
+{
+    return ( test_ref[( y >> 3 ) * w + x] >> ( y & 7 ) ) & 1;
+}
+
+static void ref_set( int w, int x, int y, bool on )
+{
+    if( on ) {
+        test_ref[( y >> 3 ) * w + x] |= 1 << ( y & 7 );
+    }
+    else {
+        test_ref[( y >> 3 ) * w + x] &= ~( 1 << ( y & 7 ) );
+    }
+}
+
+static void ref_blit( int fw, int fh, int x, int y, int w, int h, oled_blit_mode_t mode )
+{
+    for( int j = 0; j < h; j++ )
+    {
+        for( int i = 0; i < w; i++ )
+        {
+            bool bit = ( test_src[( j >> 3 ) * w + i] >> ( j & 7 ) ) & 1;
+            int dx = x + i, dy = y + j;
+            bool old;
+
+            if( dx < 0 || dy < 0 || dx >= fw || dy >= fh ) {
+                continue;
+            }
+
+            old = ref_get( fw, dx, dy );
+
+            switch( mode )
+            {
+            case OLED_BLIT_COPY:
+                ref_set( fw, dx, dy, bit );
+                break;
+
+            case OLED_BLIT_OR:
+                ref_set( fw, dx, dy, old || bit );
+                break;
+
+            case OLED_BLIT_CLR:
+                ref_set( fw, dx, dy, old && !bit );
+                break;
+
+            default:
+                ref_set( fw, dx, dy, old != bit );
+                break;
+            }
+        }
+    }
+}
+
+// Test /////////////////////////////////////////////////////////////////////////
+static bool compare( const OledFrameBuffer *fb, const char *what )
+{
+    host_test_checks++;
+
+    for( int y = 0; y < fb->height(); y++ )
+    {
+        for( int x = 0; x < fb->width(); x++ )
+        {
+            if( fb->get_pixel( x, y ) != ref_get( fb->width(), x, y ) )
+            {
+                host_test_failures++;
+                printf( "%s on %d x %d: (%d, %d) is %d, want %d\n", what, fb->width(),
+                        fb->height(), x, y, fb->get_pixel( x, y ), ref_get( fb->width(), x, y ) );
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int main()
+{
+    uint32_t seed = 0x0F0F1234;
+    int n = 0;
+
+    for( size_t s = 0; s < sizeof( test_sizes ) / sizeof( test_sizes[0] ); s++ )
+    {
+        for( int offset = 0; offset < 4; offset++ )
+        {
+            int fw = test_sizes[s].w, fh = test_sizes[s].h;
+            OledFrameBuffer fb( test_mem + offset, fw, fh );
+            bool on = host_rand( &seed ) & 1;
+
+            fb.clear( on );
+            memset( test_ref, on ? 0xFF : 0x00, sizeof( test_ref ) );
+            HOST_CHECK( compare( &fb, "clear" ) );
+
+            for( int i = 0; i < TEST_CASES / 16; i++, n++ )
+            {
+                const char *what;
+
+                if( host_rand( &seed ) % 3 == 0 )
+                {
+                    disp_area_t a;
+
+                    /* fill_area() takes an area already clipped to the buffer */
+                    a.x1 = host_rand_range( &seed, 0, fw - 1 );
+                    a.y1 = host_rand_range( &seed, 0, fh - 1 );
+                    a.x2 = host_rand_range( &seed, a.x1, fw - 1 );
+                    a.y2 = host_rand_range( &seed, a.y1, fh - 1 );
+                    on = host_rand( &seed ) & 1;
+
+                    fb.fill_area( &a, on );
+
+                    for( int y = a.y1; y <= a.y2; y++ ) {
+                        for( int x = a.x1; x <= a.x2; x++ ) {
+                            ref_set( fw, x, y, on );
+                        }
+                    }
+
+                    what = "fill_area";
+                }
+                else
+                {
+                    int w = host_rand_range( &seed, 1, TEST_SRC_MAX );
+                    int h = host_rand_range( &seed, 1, TEST_SRC_MAX );
+                    int x = host_rand_range( &seed, -w, fw );
+                    int y = host_rand_range( &seed, -h, fh );
+                    oled_blit_mode_t mode = ( oled_blit_mode_t )( host_rand( &seed ) & 3 );
+
+                    for( int k = 0; k < w * ( ( h + 7 ) >> 3 ); k++ ) {
+                        test_src[k] = ( uint8_t )host_rand( &seed );
+                    }
+
+                    fb.blit( x, y, test_src, w, h, mode );
+                    ref_blit( fw, fh, x, y, w, h, mode );
+
+                    what = "blit";
+                }
+
+                if( !compare( &fb, what ) ) {
+                    printf( "  case %d\n", n );
+                    return host_test_done( "oled_fb" );
+                }
+            }
+
+            /* nothing may be written around the buffer */
+            for( int k = 0; k < offset; k++ ) {
+                HOST_CHECK( test_mem[k] == 0 );
+            }
+
+            for( int k = offset + fb.size(); k < ( int )sizeof( test_mem ); k++ ) {
+                HOST_CHECK( test_mem[k] == 0 );
+            }
+
+            memset( test_mem, 0, sizeof( test_mem ) );
+        }
+    }
+
+    return host_test_done( "oled_fb" );
+}
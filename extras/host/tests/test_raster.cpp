@@ -0,0 +1,674 @@
+/**
+ * @file test_raster.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Span rasterizer shapes against per pixel references.
+ *
+ * Shapes are drawn into a memory canvas through span, fill and blend
+ * sinks. Lines, anti-aliased lines with their coverage, circles, arcs
+ * of any quadrants, rounded rectangles and polygons are each compared
+ * with a naive reference that works out every pixel on its own. A shape
+ * drawn without the fill sink must come out the same as with it, and a
+ * shape drawn under a viewport and clip, sloped lines included, must equal
+ * the unclipped shape, moved by the origin and masked by the clip area.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "disp_raster.h"
+#include "host_test.h"
+
+#define TEST_W 160
+#define TEST_H 120
+
+#define TEST_BG 0x1082
+
+#define TEST_CASES 3000
+
+typedef struct
+{
+    uint16_t px[TEST_W * TEST_H];
+    uint32_t blends;
+} test_canvas_t;
+
+static test_canvas_t canvas_got, canvas_want;
+
+/* reference pixels outside it are dropped */
+static disp_area_t ref_mask = { 0, 0, TEST_W - 1, TEST_H - 1 };
+
+// Sinks ////////////////////////////////////////////////////////////////////////
+static void canvas_put( test_canvas_t *c, int x, int y, uint16_t color )
+{
+    /* the rasterizer must have clipped already */
+    if( x < 0 || y < 0 || x >= TEST_W || y >= TEST_H ) {
+        host_check( false, "pixel outside the canvas", __FILE__, __LINE__ );
+        return;
+    }
+
+    c->px[y * TEST_W + x] = color;
+}
+
+static void sink_span( void *ctx, disp_coord_t x, disp_coord_t y,
+                       disp_coord_t len, uint16_t color )
+{
+    while( len-- > 0 ) {
+        canvas_put( ( test_canvas_t * )ctx, x++, y, color );
+    }
+}
+
+static void sink_fill( void *ctx, disp_coord_t x, disp_coord_t y,
+                       disp_coord_t w, disp_coord_t h, uint16_t color )
+{
+    for( disp_coord_t j = 0; j < h; j++ ) {
+        sink_span( ctx, x, y + j, w, color );
+    }
+}
+
+static void sink_blend( void *ctx, disp_coord_t x, disp_coord_t y,
+                        uint16_t color, uint8_t alpha )
+{
+    test_canvas_t *c = ( test_canvas_t * )ctx;
+
+    c->blends++;
+    canvas_put( c, x, y, disp_rgb565_mix( color, c->px[y * TEST_W + x], alpha ) );
+}
+
+static void canvas_clear( test_canvas_t *c )
+{
+    for( int i = 0; i < TEST_W * TEST_H; i++ ) {
+        c->px[i] = TEST_BG;
+    }
+
+    c->blends = 0;
+}
+
+static void raster_init( disp_raster_t *r, test_canvas_t *c, const disp_clip_t *clip, bool fill )
+{
+    memset( r, 0, sizeof( *r ) );
+    r->span = sink_span;
+    r->fill = fill ? sink_fill : NULL;
+    r->blend = sink_blend;
+    r->ctx = c;
+    r->clip = clip;
+}
+
+// Reference ////////////////////////////////////////////////////////////////////
+static void ref_put( int x, int y, uint16_t color )
+{
+    if( x >= ref_mask.x1 && y >= ref_mask.y1 && x <= ref_mask.x2 && y <= ref_mask.y2 ) {
+        canvas_want.px[y * TEST_W + x] = color;
+    }
+}
+
+static void ref_blend( int x, int y, uint16_t color, uint8_t alpha )
+{
+    if( alpha && x >= ref_mask.x1 && y >= ref_mask.y1 && x <= ref_mask.x2 && y <= ref_mask.y2 ) {
+        canvas_want.px[y * TEST_W + x] = disp_rgb565_mix( color, canvas_want.px[y * TEST_W + x], alpha );
+    }
+}
+
+static void ref_line( int x0, int y0, int x1, int y1, uint16_t color )
+{
+    int dx = x1 > x0 ? x1 - x0 : x0 - x1, dy = y1 > y0 ? y0 - y1 : y1 - y0;
+    int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+
+    for( ;; )
+    {
+        int e2 = 2 * err;
+
+        ref_put( x0, y0, color );
+
+        if( x0 == x1 && y0 == y1 ) {
+            break;
+        }
+
+        if( e2 >= dy ) {
+            err += dy;
+            x0 += sx;
+        }
+
+        if( e2 <= dx ) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+/*
+ * Wu line, each step on its own: y at step i is y0 + i * dy / dx in 16.16
+ * with the slope truncated, the pixel below gets the fraction as coverage
+ * and the one above the rest. Axis aligned and 45 degree lines are plain.
+ */
+static void ref_line_aa( int x0, int y0, int x1, int y1, uint16_t color )
+{
+    int dx = x1 - x0, dy = y1 - y0;
+    bool steep = ( dy < 0 ? -dy : dy ) > ( dx < 0 ? -dx : dx );
+    int64_t grad;
+
+    if( dx == 0 || dy == 0 || dx == dy || dx == -dy ) {
+        ref_line( x0, y0, x1, y1, color );
+        return;
+    }
+
+    if( steep ) {
+        int t = x0;
+        x0 = y0;
+        y0 = t;
+        t = x1;
+        x1 = y1;
+        y1 = t;
+    }
+
+    if( x0 > x1 ) {
+        int t = x0;
+        x0 = x1;
+        x1 = t;
+        t = y0;
+        y0 = y1;
+        y1 = t;
+    }
+
+    grad = ( ( int64_t )( y1 - y0 ) * 65536 ) / ( x1 - x0 );
+
+    for( int i = x0; i <= x1; i++ )
+    {
+        int64_t inter = ( int64_t )y0 * 65536 + grad * ( i - x0 );
+        int y = ( int )( inter >= 0 ? inter / 65536 : -( ( -inter + 65535 ) / 65536 ) );
+        int cover = ( int )( ( inter - ( int64_t )y * 65536 ) / 256 );
+
+        if( steep ) {
+            ref_blend( y, i, color, 255 - cover );
+            ref_blend( y + 1, i, color, cover );
+        }
+        else {
+            ref_blend( i, y, color, 255 - cover );
+            ref_blend( i, y + 1, color, cover );
+        }
+    }
+}
+
+/*
+ * Arc of a circle around (cx, cy): row dy of a quadrant reaches out to the
+ * widest w with w * w + dy * dy <= r * r + r. The outline keeps the pixels
+ * of each row past the width of the next row out, at least the last one.
+ * A pixel on an axis belongs to both quadrants beside it.
+ */
+static int ref_width( int r, int dy )
+{
+    int w = -1;
+
+    while( dy <= r && ( w + 1 ) * ( w + 1 ) + dy * dy <= r * r + r ) {
+        w++;
+    }
+
+    return w;
+}
+
+static void ref_arc( int cx, int cy, int r, uint8_t quads, bool filled, uint16_t color )
+{
+    for( int y = cy - r; y <= cy + r; y++ )
+    {
+        int dy = y < cy ? cy - y : y - cy;
+        int w = ref_width( r, dy ), next = ref_width( r, dy + 1 );
+        int inner = filled ? 0 : ( next < w ? next + 1 : w );
+
+        for( int x = cx - r; x <= cx + r; x++ )
+        {
+            int dx = x < cx ? cx - x : x - cx;
+            uint8_t mine = 0;
+
+            if( dx > w || dx < inner ) {
+                continue;
+            }
+
+            if( y <= cy ) {
+                mine |= ( x <= cx ? DISP_QUAD_TOP_LEFT : 0 ) | ( x >= cx ? DISP_QUAD_TOP_RIGHT : 0 );
+            }
+
+            if( y >= cy ) {
+                mine |= ( x <= cx ? DISP_QUAD_BOTTOM_LEFT : 0 ) | ( x >= cx ? DISP_QUAD_BOTTOM_RIGHT : 0 );
+            }
+
+            if( mine & quads ) {
+                ref_put( x, y, color );
+            }
+        }
+    }
+}
+
+/* the reference of any shape, see shape_draw() */
+static void ref_shape( const struct test_shape *s, int dx, int dy );
+
+/*
+ * Rounded rectangle with corner centers (lx, ty) and (rx, by): a pixel is
+ * inside when its distance to the center box is within r * r + r, the
+ * same bound as the rasterizer's rows. A circle has a single center.
+ */
+static bool ref_inside( int lx, int ty, int rx, int by, int r, int x, int y )
+{
+    int dx = x < lx ? lx - x : ( x > rx ? x - rx : 0 );
+    int dy = y < ty ? ty - y : ( y > by ? y - by : 0 );
+
+    return dx * dx + dy * dy <= r * r + r;
+}
+
+static void ref_round( int lx, int ty, int rx, int by, int r, bool filled, uint16_t color )
+{
+    for( int y = ty - r; y <= by + r; y++ )
+    {
+        for( int x = lx - r; x <= rx + r; x++ )
+        {
+            if( !ref_inside( lx, ty, rx, by, r, x, y ) ) {
+                continue;
+            }
+
+            /* the outline is every inside pixel next to an outside one */
+            if( filled ||
+                !ref_inside( lx, ty, rx, by, r, x - 1, y ) ||
+                !ref_inside( lx, ty, rx, by, r, x + 1, y ) ||
+                !ref_inside( lx, ty, rx, by, r, x, y - 1 ) ||
+                !ref_inside( lx, ty, rx, by, r, x, y + 1 ) ) {
+                ref_put( x, y, color );
+            }
+        }
+    }
+}
+
+static void ref_round_rect( int x, int y, int w, int h, int radius, bool filled, uint16_t color )
+{
+    int r = disp_max( 0, disp_min( radius, disp_min( w, h ) / 2 - 1 ) );
+
+    if( w > 0 && h > 0 ) {
+        ref_round( x + r, y + r, x + w - 1 - r, y + h - 1 - r, r, filled, color );
+    }
+}
+
+/* even-odd on pixel centers, exact in integers */
+static void ref_polygon( const disp_coord_t *xy, int count, uint16_t color )
+{
+    for( int y = 0; y < TEST_H; y++ )
+    {
+        for( int x = 0; x < TEST_W; x++ )
+        {
+            bool in = false;
+
+            for( int i = 0; i < count; i++ )
+            {
+                int j = ( i + 1 ) % count;
+                int xa = xy[2 * i], ya = xy[2 * i + 1];
+                int xb = xy[2 * j], yb = xy[2 * j + 1];
+
+                if( ya > yb ) {
+                    int t = xa;
+                    xa = xb;
+                    xb = t;
+                    t = ya;
+                    ya = yb;
+                    yb = t;
+                }
+
+                /* edge spans the row center, crossing at or left of the pixel center */
+                if( ya != yb && 2 * ya <= 2 * y + 1 && 2 * y + 1 < 2 * yb &&
+                    ( 2 * x + 1 ) * 2 * ( yb - ya ) >=
+                    2 * ( xa * 2 * ( yb - ya ) + ( 2 * y + 1 - 2 * ya ) * ( xb - xa ) ) ) {
+                    in = !in;
+                }
+            }
+
+            if( in ) {
+                ref_put( x, y, color );
+            }
+        }
+    }
+}
+
+// Shapes ///////////////////////////////////////////////////////////////////////
+typedef struct test_shape
+{
+    uint8_t kind;
+    int x, y, w, h, r;
+    uint8_t quads;
+    uint8_t count;
+    disp_coord_t xy[2 * 8];
+    uint16_t color;
+} test_shape_t;
+
+enum
+{
+    SHAPE_LINE,
+    SHAPE_LINE_AA,
+    SHAPE_CIRCLE,
+    SHAPE_FILL_CIRCLE,
+    SHAPE_ARC,
+    SHAPE_FILL_ARC,
+    SHAPE_ROUND_RECT,
+    SHAPE_FILL_ROUND_RECT,
+    SHAPE_POLYGON,
+    SHAPE_KINDS
+};
+
+static void shape_random( uint32_t *seed, test_shape_t *s )
+{
+    s->kind = host_rand( seed ) % SHAPE_KINDS;
+    s->x = host_rand_range( seed, -30, TEST_W + 10 );
+    s->y = host_rand_range( seed, -30, TEST_H + 10 );
+    s->w = host_rand_range( seed, -10, 90 );
+    s->h = host_rand_range( seed, -10, 90 );
+    s->r = host_rand_range( seed, -1, 40 );
+    s->quads = host_rand( seed ) & DISP_QUAD_ALL;
+    s->count = host_rand_range( seed, 3, 8 );
+    s->color = ( uint16_t )host_rand( seed );
+
+    for( int i = 0; i < s->count; i++ ) {
+        s->xy[2 * i] = host_rand_range( seed, -30, TEST_W + 30 );
+        s->xy[2 * i + 1] = host_rand_range( seed, -30, TEST_H + 30 );
+    }
+}
+
+/* draw s with every coordinate moved by (dx, dy) */
+static void shape_draw( disp_raster_t *r, const test_shape_t *s, int dx, int dy )
+{
+    disp_coord_t xy[2 * 8];
+    int x = s->x + dx, y = s->y + dy;
+
+    switch( s->kind )
+    {
+    case SHAPE_LINE:
+        disp_draw_line( r, x, y, x + s->w, y + s->h, s->color );
+        break;
+
+    case SHAPE_LINE_AA:
+        disp_draw_line_aa( r, x, y, x + s->w, y + s->h, s->color );
+        break;
+
+    case SHAPE_CIRCLE:
+        disp_draw_circle( r, x, y, s->r, s->color );
+        break;
+
+    case SHAPE_FILL_CIRCLE:
+        disp_fill_circle( r, x, y, s->r, s->color );
+        break;
+
+    case SHAPE_ARC:
+        disp_draw_arc( r, x, y, s->r, s->quads, s->color );
+        break;
+
+    case SHAPE_FILL_ARC:
+        disp_fill_arc( r, x, y, s->r, s->quads, s->color );
+        break;
+
+    case SHAPE_ROUND_RECT:
+        disp_draw_round_rect( r, x, y, s->w, s->h, s->r, s->color );
+        break;
+
+    case SHAPE_FILL_ROUND_RECT:
+        disp_fill_round_rect( r, x, y, s->w, s->h, s->r, s->color );
+        break;
+
+    default:
+        for( int i = 0; i < s->count; i++ ) {
+            xy[2 * i] = s->xy[2 * i] + dx;
+            xy[2 * i + 1] = s->xy[2 * i + 1] + dy;
+        }
+
+        HOST_CHECK( disp_fill_polygon( r, xy, s->count, s->color ) );
+        break;
+    }
+}
+
+static void ref_shape( const test_shape_t *s, int dx, int dy )
+{
+    disp_coord_t xy[2 * 8];
+    int x = s->x + dx, y = s->y + dy;
+
+    switch( s->kind )
+    {
+    case SHAPE_LINE:
+        ref_line( x, y, x + s->w, y + s->h, s->color );
+        break;
+
+    case SHAPE_LINE_AA:
+        ref_line_aa( x, y, x + s->w, y + s->h, s->color );
+        break;
+
+    case SHAPE_CIRCLE:
+    case SHAPE_FILL_CIRCLE:
+        if( s->r >= 0 ) {
+            ref_round( x, y, x, y, s->r, s->kind == SHAPE_FILL_CIRCLE, s->color );
+        }
+        break;
+
+    case SHAPE_ARC:
+    case SHAPE_FILL_ARC:
+        if( s->r >= 0 ) {
+            ref_arc( x, y, s->r, s->quads, s->kind == SHAPE_FILL_ARC, s->color );
+        }
+        break;
+
+    case SHAPE_ROUND_RECT:
+    case SHAPE_FILL_ROUND_RECT:
+        ref_round_rect( x, y, s->w, s->h, s->r, s->kind == SHAPE_FILL_ROUND_RECT, s->color );
+        break;
+
+    default:
+        for( int i = 0; i < s->count; i++ ) {
+            xy[2 * i] = s->xy[2 * i] + dx;
+            xy[2 * i + 1] = s->xy[2 * i + 1] + dy;
+        }
+
+        ref_polygon( xy, s->count, s->color );
+        break;
+    }
+}
+
+// Tests ////////////////////////////////////////////////////////////////////////
+
+/* lines with both ends inside the viewport, plain and anti-aliased */
+static void test_lines()
+{
+    uint32_t seed = 0x5EED0001;
+    disp_clip_t clip;
+    disp_raster_t r;
+
+    for( int n = 0; n < TEST_CASES; n++ )
+    {
+        int vx = host_rand_range( &seed, 0, TEST_W / 2 );
+        int vy = host_rand_range( &seed, 0, TEST_H / 2 );
+        int vw = host_rand_range( &seed, 1, TEST_W - vx );
+        int vh = host_rand_range( &seed, 1, TEST_H - vy );
+        int x0 = host_rand_range( &seed, 0, vw - 1 ), y0 = host_rand_range( &seed, 0, vh - 1 );
+        int x1 = host_rand_range( &seed, 0, vw - 1 ), y1 = host_rand_range( &seed, 0, vh - 1 );
+        uint16_t color = ( uint16_t )host_rand( &seed );
+        bool aa = n & 1;
+
+        /* every 4th line axis aligned or 45 degrees, for aa the plain fallback */
+        if( ( n & 6 ) == 0 )
+        {
+            int len = disp_min( vw - 1 - x0, vh - 1 - y0 );
+
+            switch( host_rand( &seed ) % 3 )
+            {
+            case 0:
+                y1 = y0;
+                break;
+
+            case 1:
+                x1 = x0;
+                break;
+
+            default:
+                x1 = x0 + len;
+                y1 = y0 + len;
+                break;
+            }
+        }
+
+        disp_clip_init( &clip, TEST_W, TEST_H );
+        disp_clip_push_viewport( &clip, vx, vy, vw, vh );
+        raster_init( &r, &canvas_got, &clip, true );
+
+        canvas_clear( &canvas_got );
+        canvas_clear( &canvas_want );
+
+        if( aa ) {
+            ref_line_aa( x0 + vx, y0 + vy, x1 + vx, y1 + vy, color );
+            disp_draw_line_aa( &r, x0, y0, x1, y1, color );
+
+            if( ( n & 6 ) == 0 ) {
+                HOST_CHECK( canvas_got.blends == 0 );
+            }
+        }
+        else {
+            ref_line( x0 + vx, y0 + vy, x1 + vx, y1 + vy, color );
+            disp_draw_line( &r, x0, y0, x1, y1, color );
+        }
+
+        if( !host_check_px( aa ? "line aa" : "line", canvas_got.px,
+                            canvas_want.px, TEST_W, TEST_H ) ) {
+            printf( "  viewport %d, %d %d x %d, (%d, %d) - (%d, %d)\n",
+                    vx, vy, vw, vh, x0, y0, x1, y1 );
+            break;
+        }
+    }
+}
+
+static void test_round()
+{
+    uint32_t seed = 0x5EED0002;
+    disp_clip_t clip;
+    disp_raster_t r;
+
+    disp_clip_init( &clip, TEST_W, TEST_H );
+
+    for( int n = 0; n < TEST_CASES; n++ )
+    {
+        test_shape_t s;
+        const char *what;
+
+        static const uint8_t kinds[] = { SHAPE_CIRCLE, SHAPE_FILL_CIRCLE, SHAPE_ARC, SHAPE_FILL_ARC,
+                                         SHAPE_ROUND_RECT, SHAPE_FILL_ROUND_RECT, SHAPE_POLYGON
+                                       };
+        static const char *names[] = { "circle", "fill circle", "arc", "fill arc",
+                                       "round rect", "fill round rect", "polygon"
+                                     };
+
+        shape_random( &seed, &s );
+        s.kind = kinds[n % 7];
+        what = names[n % 7];
+        raster_init( &r, &canvas_got, &clip, n & 1 );
+        canvas_clear( &canvas_got );
+        canvas_clear( &canvas_want );
+
+        ref_shape( &s, 0, 0 );
+        shape_draw( &r, &s, 0, 0 );
+
+        if( !host_check_px( what, canvas_got.px, canvas_want.px, TEST_W, TEST_H ) ) {
+            printf( "  at %d, %d size %d x %d radius %d quadrants %X\n", s.x, s.y, s.w, s.h, s.r, s.quads );
+            break;
+        }
+    }
+}
+
+/* the fill sink is an optimization only, spans must paint the same */
+static void test_no_fill()
+{
+    uint32_t seed = 0x5EED0003;
+    disp_clip_t clip;
+    disp_raster_t with, without;
+
+    disp_clip_init( &clip, TEST_W, TEST_H );
+
+    for( int n = 0; n < TEST_CASES; n++ )
+    {
+        test_shape_t s;
+
+        shape_random( &seed, &s );
+        canvas_clear( &canvas_got );
+        canvas_clear( &canvas_want );
+        raster_init( &with, &canvas_want, &clip, true );
+        raster_init( &without, &canvas_got, &clip, false );
+
+        shape_draw( &with, &s, 0, 0 );
+        shape_draw( &without, &s, 0, 0 );
+
+        if( !host_check_px( "without fill", canvas_got.px, canvas_want.px, TEST_W, TEST_H ) ) {
+            printf( "  shape %u at %d, %d\n", s.kind, s.x, s.y );
+            break;
+        }
+    }
+}
+
+/*
+ * a clipped shape is the unclipped one moved by the origin, then masked;
+ * lines may reach far past the screen and must not bend at the edge
+ */
+static void test_clipped()
+{
+    uint32_t seed = 0x5EED0004;
+    disp_clip_t clip;
+    disp_raster_t r;
+
+    for( int n = 0; n < TEST_CASES; n++ )
+    {
+        const disp_viewport_t *vp;
+        disp_area_t a;
+        test_shape_t s;
+
+        shape_random( &seed, &s );
+
+        if( ( s.kind == SHAPE_LINE || s.kind == SHAPE_LINE_AA ) && ( host_rand( &seed ) & 3 ) == 0 ) {
+            s.x = host_rand_range( &seed, -3000, 3000 );
+            s.y = host_rand_range( &seed, -3000, 3000 );
+            s.w = TEST_W / 2 - 2 * s.x + host_rand_range( &seed, -40, 40 );
+            s.h = TEST_H / 2 - 2 * s.y + host_rand_range( &seed, -40, 40 );
+        }
+
+        disp_clip_init( &clip, TEST_W, TEST_H );
+        disp_clip_push_viewport( &clip, host_rand_range( &seed, -20, TEST_W / 2 ),
+                                 host_rand_range( &seed, -20, TEST_H / 2 ),
+                                 host_rand_range( &seed, 0, TEST_W ),
+                                 host_rand_range( &seed, 0, TEST_H ) );
+
+        if( host_rand( &seed ) & 1 )
+        {
+            a.x1 = host_rand_range( &seed, -10, TEST_W / 2 );
+            a.y1 = host_rand_range( &seed, -10, TEST_H / 2 );
+            a.x2 = a.x1 + host_rand_range( &seed, -1, TEST_W / 2 );
+            a.y2 = a.y1 + host_rand_range( &seed, -1, TEST_H / 2 );
+            disp_clip_push( &clip, &a );
+        }
+
+        vp = disp_clip_current( &clip );
+
+        canvas_clear( &canvas_got );
+        canvas_clear( &canvas_want );
+
+        ref_mask = vp->area;
+        ref_shape( &s, vp->ox, vp->oy );
+        ref_mask.x1 = ref_mask.y1 = 0;
+        ref_mask.x2 = TEST_W - 1;
+        ref_mask.y2 = TEST_H - 1;
+
+        raster_init( &r, &canvas_got, &clip, n & 1 );
+        shape_draw( &r, &s, 0, 0 );
+
+        if( !host_check_px( "clipped", canvas_got.px, canvas_want.px, TEST_W, TEST_H ) ) {
+            printf( "  shape %u at %d, %d size %d x %d, origin %d, %d, clip %d, %d - %d, %d\n",
+                    s.kind, s.x, s.y, s.w, s.h, vp->ox, vp->oy,
+                    vp->area.x1, vp->area.y1, vp->area.x2, vp->area.y2 );
+            break;
+        }
+    }
+}
+
+int main()
+{
+    test_lines();
+    test_round();
+    test_no_fill();
+    test_clipped();
+
+    return host_test_done( "raster" );
+}
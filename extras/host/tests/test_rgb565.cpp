@@ -0,0 +1,266 @@
+/**
+ * @file test_rgb565.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Word wide RGB565 kernels against their scalar references.
+ *
+ * Every kernel runs over random lengths at every alignment of its
+ * pointers, with guard pixels around the span that must stay untouched,
+ * and must match rgb565_*_ref(). rgb565_mix_px() is checked for every
+ * alpha and channel pair. rgb565_gradient_part() must give the
+ * same pixels as the matching slice of the whole gradient, and
+ * ST7789V::fill_gradient(), which builds long gradients chunk by chunk,
+ * is read back from the panel and compared with a reference screen.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "st7789v.h"
+#include "rgb565.h"
+#include "host_bus.h"
+#include "host_test.h"
+
+#define TEST_SPANS 20000
+#define TEST_SPAN_MAX 300
+#define TEST_GUARD 4
+#define TEST_GUARD_PX 0xA5C3
+
+#define TEST_PANEL_CASES 150
+
+static uint16_t buf_got[TEST_SPAN_MAX + 2 * TEST_GUARD + 4];
+static uint16_t buf_want[TEST_SPAN_MAX + 2 * TEST_GUARD + 4];
+static uint16_t buf_src[TEST_SPAN_MAX + 4];
+
+static uint16_t screen_got[240 * 240];
+static uint16_t screen_want[240 * 240];
+
+// Kernels //////////////////////////////////////////////////////////////////////
+static void fill_random( uint32_t *seed, uint16_t *p, size_t n )
+{
+    while( n-- ) {
+        *p++ = ( uint16_t )host_rand( seed );
+    }
+}
+
+static uint8_t random_alpha( uint32_t *seed )
+{
+    /* the ends of the 5 bit rounding, the 8 bit ends and everything between */
+    static const uint8_t edges[] = { 0, 1, 2, 3, 4, 11, 12, 128, 251, 252, 253, 254, 255 };
+
+    return host_rand( seed ) & 1 ? edges[host_rand( seed ) % 13] : ( uint8_t )host_rand( seed );
+}
+
+static void test_kernels()
+{
+    static const char *names[] = { "fill", "gradient", "blend", "blend_color", "mix", "mix_color",
+                                   "swap", "swap in place"
+                                 };
+    uint32_t seed = 0x565565AA;
+
+    for( int n = 0; n < TEST_SPANS; n++ )
+    {
+        int kernel = n % 8;
+        size_t len = host_rand_range( &seed, 0, TEST_SPAN_MAX );
+        int dst_off = TEST_GUARD + host_rand_range( &seed, 0, 3 );
+        int src_off = host_rand_range( &seed, 0, 3 );
+        uint16_t *got = buf_got + dst_off, *want = buf_want + dst_off;
+        uint16_t *src = buf_src + src_off;
+        uint16_t c0 = ( uint16_t )host_rand( &seed ), c1 = ( uint16_t )host_rand( &seed );
+        uint8_t alpha = random_alpha( &seed );
+
+        for( size_t i = 0; i < sizeof( buf_got ) / sizeof( buf_got[0] ); i++ ) {
+            buf_got[i] = buf_want[i] = TEST_GUARD_PX;
+        }
+
+        fill_random( &seed, got, len );
+        memcpy( want, got, len * sizeof( uint16_t ) );
+        fill_random( &seed, buf_src, sizeof( buf_src ) / sizeof( buf_src[0] ) );
+
+        switch( kernel )
+        {
+        case 0:
+            rgb565_fill( got, c0, len );
+            rgb565_fill_ref( want, c0, len );
+            break;
+
+        case 1:
+            rgb565_gradient( got, c0, c1, len );
+            rgb565_gradient_ref( want, c0, c1, len );
+            break;
+
+        case 2:
+            rgb565_blend( got, src, len, alpha );
+            rgb565_blend_ref( want, src, len, alpha );
+            break;
+
+        case 3:
+            rgb565_blend_color( got, c0, len, alpha );
+            rgb565_fill_ref( src, c0, len );
+            rgb565_blend_ref( want, src, len, alpha );
+            break;
+
+        case 4:
+            rgb565_mix( got, src, len, alpha );
+            rgb565_mix_ref( want, src, len, alpha );
+            break;
+
+        case 5:
+            rgb565_mix_color( got, c0, len, alpha );
+            rgb565_fill_ref( src, c0, len );
+            rgb565_mix_ref( want, src, len, alpha );
+            break;
+
+        case 6:
+            rgb565_swap( got, src, len );
+            rgb565_swap_ref( want, src, len );
+            break;
+
+        default:
+            rgb565_swap( got, got, len );
+            rgb565_swap_ref( want, want, len );
+            break;
+        }
+
+        if( !host_check_px( names[kernel], buf_got, buf_want,
+                            sizeof( buf_got ) / sizeof( buf_got[0] ), 1 ) ) {
+            printf( "  %u pixels, dst +%d, src +%d, alpha %u\n", ( unsigned )len,
+                    dst_off - TEST_GUARD, src_off, alpha );
+            break;
+        }
+    }
+}
+
+/* every alpha against every pair of channel values */
+static void test_mix_px()
+{
+    for( int a = 0; a < 256; a++ )
+    {
+        for( int f = 0; f < 64; f++ )
+        {
+            for( int b = 0; b < 64; b++ )
+            {
+                uint16_t fg = ( uint16_t )( ( f >> 1 ) << 11 | f << 5 | ( 31 - ( f >> 1 ) ) );
+                uint16_t bg = ( uint16_t )( ( b >> 1 ) << 11 | b << 5 | ( 31 - ( b >> 1 ) ) );
+                uint16_t got = rgb565_mix_px( fg, bg, a ), want = bg;
+
+                rgb565_mix_ref( &want, &fg, 1, a );
+
+                if( got != want ) {
+                    printf( "mix_px: %04X over %04X at %d is %04X, want %04X\n", fg, bg, a, got, want );
+                    HOST_CHECK( false );
+                    return;
+                }
+            }
+        }
+    }
+
+    HOST_CHECK( true );
+}
+
+static void test_gradient_part()
+{
+    uint32_t seed = 0x9A4D1E27;
+
+    for( int n = 0; n < TEST_SPANS; n++ )
+    {
+        size_t len = host_rand_range( &seed, 1, TEST_SPAN_MAX );
+        size_t first = host_rand_range( &seed, 0, len - 1 );
+        size_t count = host_rand_range( &seed, 0, len - first );
+        int dst_off = TEST_GUARD + host_rand_range( &seed, 0, 3 );
+        uint16_t c0 = ( uint16_t )host_rand( &seed ), c1 = ( uint16_t )host_rand( &seed );
+
+        for( size_t i = 0; i < sizeof( buf_got ) / sizeof( buf_got[0] ); i++ ) {
+            buf_got[i] = buf_want[i] = TEST_GUARD_PX;
+        }
+
+        rgb565_gradient_ref( buf_src, c0, c1, len );
+        memcpy( buf_want + dst_off, buf_src + first, count * sizeof( uint16_t ) );
+        rgb565_gradient_part( buf_got + dst_off, c0, c1, len, first, count );
+
+        if( !host_check_px( "gradient_part", buf_got, buf_want,
+                            sizeof( buf_got ) / sizeof( buf_got[0] ), 1 ) ) {
+            printf( "  pixels %u ~ %u of %u\n", ( unsigned )first,
+                    ( unsigned )( first + count - 1 ), ( unsigned )len );
+            break;
+        }
+    }
+}
+
+// Panel ////////////////////////////////////////////////////////////////////////
+static void test_fill_gradient()
+{
+    uint32_t seed = 0x0BADF00D;
+    int sw = ST7789V::m_st7789v_handle.width, sh = ST7789V::m_st7789v_handle.height;
+    uint16_t row[512], col[512];
+
+    ST7789V::clear_screen_directly( 0x0000 );
+    memset( screen_want, 0, sizeof( screen_want ) );
+
+    for( int n = 0; n < TEST_PANEL_CASES; n++ )
+    {
+        int x = host_rand_range( &seed, -120, sw - 1 );
+        int y = host_rand_range( &seed, -60, sh - 1 );
+        int w = host_rand_range( &seed, 1, 400 );
+        int h = host_rand_range( &seed, 1, 200 );
+        uint16_t c0 = ( uint16_t )host_rand( &seed ), c1 = ( uint16_t )host_rand( &seed );
+        bool vertical = host_rand( &seed ) & 1;
+        bool viewport = host_rand( &seed ) & 1;
+        int vx = 0, vy = 0;
+        disp_area_t clip = { 0, 0, ( disp_coord_t )( sw - 1 ), ( disp_coord_t )( sh - 1 ) };
+
+        if( viewport )
+        {
+            vx = host_rand_range( &seed, 0, sw / 2 );
+            vy = host_rand_range( &seed, 0, sh / 2 );
+            clip.x1 = vx;
+            clip.y1 = vy;
+            clip.x2 = disp_min( sw - 1, vx + host_rand_range( &seed, 0, sw ) );
+            clip.y2 = disp_min( sh - 1, vy + host_rand_range( &seed, 0, sh ) );
+
+            HOST_CHECK( ST7789V::push_viewport( vx, vy, clip.x2 - vx + 1, clip.y2 - vy + 1 ) );
+        }
+
+        ST7789V::fill_gradient( x, y, w, h, c0, c1, vertical );
+
+        if( viewport ) {
+            ST7789V::pop_clip();
+        }
+
+        /* both directions follow the same rounding */
+        rgb565_gradient_ref( row, c0, c1, w );
+        rgb565_gradient_ref( col, c0, c1, h );
+
+        for( int j = 0; j < h; j++ )
+        {
+            for( int i = 0; i < w; i++ )
+            {
+                int sx = vx + x + i, sy = vy + y + j;
+
+                if( sx >= clip.x1 && sx <= clip.x2 && sy >= clip.y1 && sy <= clip.y2 ) {
+                    screen_want[sy * sw + sx] = vertical ? col[j] : row[i];
+                }
+            }
+        }
+
+        HOST_CHECK( ST7789V::read_gram( 0, 0, sw, sh, screen_got ) );
+
+        if( !host_check_px( vertical ? "vertical fill_gradient" : "horizontal fill_gradient",
+                            screen_got, screen_want, sw, sh ) ) {
+            printf( "  %d x %d at %d, %d, viewport at %d, %d\n", w, h, x, y, vx, vy );
+            break;
+        }
+    }
+}
+
+int main()
+{
+    host_test_attach_tft();
+
+    test_kernels();
+    test_mix_px();
+    test_gradient_part();
+    test_fill_gradient();
+
+    return host_test_done( "rgb565" );
+}
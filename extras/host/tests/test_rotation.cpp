@@ -0,0 +1,222 @@
+/**
+ * @file test_rotation.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief ST7789V rotations 0 ~ 3 against a per pixel reference of GRAM.
+ *
+ * Each rotation draws the same scene with put_pixel(), the fixed view
+ * put_pixel<VIEW>(), fill_rect() and clear_screen_directly(). The
+ * reference places every pixel on the panel by plain geometry, turning
+ * the screen clockwise, and the whole physical GRAM of the model must
+ * come out the same. With ST7789V_ASSERT on, a view that is not the
+ * current rotation must abort.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* only this file instantiates put_pixel<VIEW>() */
+#define ST7789V_ASSERT (1)
+
+#include "st7789v.h"
+#include "host_bus.h"
+#include "host_test.h"
+
+#define TEST_PW ST7789V_PANEL_WIDTH
+#define TEST_PH ST7789V_PANEL_HEIGHT
+
+static uint16_t test_ref[ST7789V_MODEL_WIDTH * ST7789V_MODEL_HEIGHT];
+
+/* screen (x, y) under rotation to its GRAM column and row */
+static void ref_map( uint8_t rot, int x, int y, int *col, int *row )
+{
+    int px, py;
+
+    switch( rot )
+    {
+    case 0:
+        px = x;
+        py = y;
+        break;
+
+    case 1:
+        px = TEST_PW - 1 - y;
+        py = x;
+        break;
+
+    case 2:
+        px = TEST_PW - 1 - x;
+        py = TEST_PH - 1 - y;
+        break;
+
+    default:
+        px = y;
+        py = TEST_PH - 1 - x;
+        break;
+    }
+
+    *col = ST7789V_PANEL_COL_OFFSET + px;
+    *row = ST7789V_PANEL_ROW_OFFSET + py;
+}
+
+static void ref_pixel( uint8_t rot, int x, int y, uint16_t color )
+{
+    int w = rot & 1 ? TEST_PH : TEST_PW, h = rot & 1 ? TEST_PW : TEST_PH;
+    int col, row;
+
+    if( x < 0 || y < 0 || x >= w || y >= h ) {
+        return;
+    }
+
+    ref_map( rot, x, y, &col, &row );
+    test_ref[row * ST7789V_MODEL_WIDTH + col] = color;
+}
+
+static void ref_rect( uint8_t rot, int x, int y, int w, int h, uint16_t color )
+{
+    int i, j;
+
+    for( j = y; j < y + h; j++ ) {
+        for( i = x; i < x + w; i++ ) {
+            ref_pixel( rot, i, j, color );
+        }
+    }
+}
+
+template <u8 ROTATION>
+static void view_pixel( u16 x, u16 y, u16 color )
+{
+    ST7789V::put_pixel< st7789v_view<st7789v_default_panel_t, ROTATION> >( x, y, color );
+}
+
+static void test_view_pixel( uint8_t rot, u16 x, u16 y, u16 color )
+{
+    switch( rot )
+    {
+    case 0:
+        view_pixel<0>( x, y, color );
+        break;
+
+    case 1:
+        view_pixel<1>( x, y, color );
+        break;
+
+    case 2:
+        view_pixel<2>( x, y, color );
+        break;
+
+    default:
+        view_pixel<3>( x, y, color );
+        break;
+    }
+}
+
+static void test_rotation( uint8_t rot )
+{
+    uint32_t seed = 0x2468ACE1 + rot;
+    int w, h, i;
+    char what[32];
+
+    memset( host_test_model.gram(), 0, sizeof( test_ref ) );
+    memset( test_ref, 0, sizeof( test_ref ) );
+
+    ST7789V::set_rotation( rot );
+    w = ST7789V::m_st7789v_handle.width;
+    h = ST7789V::m_st7789v_handle.height;
+
+    HOST_CHECK( w == ( rot & 1 ? TEST_PH : TEST_PW ) );
+    HOST_CHECK( h == ( rot & 1 ? TEST_PW : TEST_PH ) );
+    HOST_CHECK( ST7789V::m_st7789v_handle.rotation == rot );
+
+    ST7789V::clear_screen_directly( 0x0841 );
+    ref_rect( rot, 0, 0, w, h, 0x0841 );
+
+    /* corners tell a mirror from a rotation */
+    ST7789V::put_pixel( 0, 0, 0xF800 );
+    ST7789V::put_pixel( w - 1, 0, 0x07E0 );
+    ST7789V::put_pixel( 0, h - 1, 0x001F );
+    ST7789V::put_pixel( w - 1, h - 1, 0xFFFF );
+    ref_pixel( rot, 0, 0, 0xF800 );
+    ref_pixel( rot, w - 1, 0, 0x07E0 );
+    ref_pixel( rot, 0, h - 1, 0x001F );
+    ref_pixel( rot, w - 1, h - 1, 0xFFFF );
+
+    for( i = 0; i < 200; i++ )
+    {
+        int x = host_rand_range( &seed, -20, w + 20 );
+        int y = host_rand_range( &seed, -20, h + 20 );
+        int rw = host_rand_range( &seed, 1, 60 );
+        int rh = host_rand_range( &seed, 1, 60 );
+        uint16_t c = ( uint16_t )host_rand( &seed );
+
+        switch( i % 3 )
+        {
+        case 0:
+            ST7789V::put_pixel( x, y, c );
+            ref_pixel( rot, x, y, c );
+            break;
+
+        case 1:
+            /* the fixed view takes unsigned coordinates */
+            if( x >= 0 && y >= 0 ) {
+                test_view_pixel( rot, x, y, c );
+                ref_pixel( rot, x, y, c );
+            }
+            break;
+
+        default:
+            ST7789V::fill_rect( x, y, rw, rh, c );
+            ref_rect( rot, x, y, rw, rh, c );
+            break;
+        }
+    }
+
+    snprintf( what, sizeof( what ), "rotation %u", rot );
+    host_check_px( what, host_test_model.gram(), test_ref, ST7789V_MODEL_WIDTH, ST7789V_MODEL_HEIGHT );
+}
+
+/* put_pixel<VIEW>() under another rotation, in a child that must abort */
+static void test_view_mismatch()
+{
+    int status = 0;
+    pid_t pid;
+
+    fflush( stdout );
+    pid = fork();
+
+    if( pid == 0 )
+    {
+        /* the assert message is expected, keep it out of the output */
+        if( !freopen( "/dev/null", "w", stderr ) ) {
+            _exit( 2 );
+        }
+
+        ST7789V::set_rotation( 1 );
+        view_pixel<0>( 0, 0, 0xFFFF );
+        _exit( 0 );
+    }
+
+    HOST_CHECK( pid > 0 && waitpid( pid, &status, 0 ) == pid );
+    HOST_CHECK( WIFSIGNALED( status ) && WTERMSIG( status ) == SIGABRT );
+}
+
+int main()
+{
+    uint8_t rot;
+
+    host_test_attach_tft();
+
+    for( rot = 0; rot < 4; rot++ ) {
+        test_rotation( rot );
+    }
+
+    /* and back, nothing may be left over from the previous rotation */
+    test_rotation( 1 );
+    test_view_mismatch();
+
+    return host_test_done( "rotation" );
+}
@@ -0,0 +1,296 @@
+/**
+ * @file test_scheduler.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief SpiScheduler on a bus shared by the st7789v and an ADC model.
+ *
+ * The host core counts transactions and the bytes of each, so every
+ * poll() must open exactly one, put at most one chunk plus a window on the
+ * bus, talk to one device only and close it again. A higher priority ADC
+ * request submitted while a fill is running must run on the very next
+ * poll(), between two chunks, and the fill must then carry on where it
+ * stopped. Requests at random bus times may wait at most one display
+ * chunk, measured on the bus clock of the host core.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "st7789v.h"
+#include "spi_scheduler.h"
+#include "spi_adc_model.h"
+#include "host_bus.h"
+#include "host_test.h"
+
+#define TEST_ADC_CS 7
+#define TEST_ADC_HZ 1000000UL
+
+#define TEST_WINDOW_BYTES 13    /* CASET, RASET and RAMWR with parameters */
+#define TEST_OVERHEAD_NS  2000
+#define TEST_REQUESTS     200
+
+typedef struct
+{
+    spi_job_t job;
+    uint8_t channel;
+    uint16_t value;
+} test_adc_job_t;
+
+static SpiAdcModel test_adc;
+static spi_device_t test_adc_device = { SPISettings( TEST_ADC_HZ, MSBFIRST, SPI_MODE0 ), NULL, NULL, NULL };
+
+static uint16_t screen_got[240 * 240];
+
+// ADC //////////////////////////////////////////////////////////////////////////
+static bool adc_step( void *ctx, uint16_t budget )
+{
+    test_adc_job_t *job = ( test_adc_job_t * )ctx;
+    uint8_t hi, lo;
+
+    ( void )budget;
+
+    digitalWrite( TEST_ADC_CS, LOW );
+    SPI.transfer( 0x01 );
+    hi = SPI.transfer( 0x80 | job->channel << 4 );
+    lo = SPI.transfer( 0x00 );
+    digitalWrite( TEST_ADC_CS, HIGH );
+
+    job->value = ( uint16_t )( hi & 0x03 ) << 8 | lo;
+
+    return true;
+}
+
+static void adc_job( test_adc_job_t *job, uint8_t channel, uint8_t priority )
+{
+    memset( job, 0, sizeof( *job ) );
+    job->job.device = &test_adc_device;
+    job->job.step = adc_step;
+    job->job.ctx = job;
+    job->job.priority = priority;
+    job->job.chunk = 3;
+    job->channel = channel;
+    job->value = 0xFFFF;
+}
+
+static bool check_screen( uint16_t color )
+{
+    int sw = ST7789V::m_st7789v_handle.width, sh = ST7789V::m_st7789v_handle.height;
+
+    HOST_CHECK( ST7789V::read_gram( 0, 0, sw, sh, screen_got ) );
+
+    for( int i = 0; i < sw * sh; i++ )
+    {
+        if( screen_got[i] != color ) {
+            printf( "screen: (%d, %d) is %04X, want %04X\n", i % sw, i / sw, screen_got[i], color );
+            return HOST_CHECK( false );
+        }
+    }
+
+    return HOST_CHECK( true );
+}
+
+// Test /////////////////////////////////////////////////////////////////////////
+
+/* bytes only reach the model whose CS is low */
+static void test_devices()
+{
+    uint32_t data = host_test_model.stats()->data_bytes;
+    uint32_t conversions = test_adc.stats()->conversions;
+    test_adc_job_t adc;
+    SpiScheduler sched;
+
+    host_bus_spi_reset_stats();
+    test_adc.set_channel( 3, 0x2A5 );
+    adc_job( &adc, 3, 0 );
+    sched.submit( &adc.job );
+    sched.flush();
+
+    HOST_CHECK( adc.value == 0x2A5 );
+    HOST_CHECK( test_adc.stats()->conversions == conversions + 1 );
+    HOST_CHECK( host_test_model.stats()->data_bytes == data );
+    HOST_CHECK( host_bus_spi_stats()->last_cs == TEST_ADC_CS );
+
+    ST7789V::fill_rect( 0, 0, 10, 10, 0x1234 );
+    HOST_CHECK( test_adc.stats()->conversions == conversions + 1 );
+    HOST_CHECK( host_bus_spi_stats()->last_cs == HOST_TEST_CS );
+
+    /* two CS low at once is a wiring fault, nobody gets the byte */
+    digitalWrite( TEST_ADC_CS, LOW );
+    digitalWrite( HOST_TEST_CS, LOW );
+    SPI.beginTransaction( test_adc_device.settings );
+    SPI.transfer( 0x01 );
+    SPI.endTransaction();
+    digitalWrite( HOST_TEST_CS, HIGH );
+    digitalWrite( TEST_ADC_CS, HIGH );
+
+    HOST_CHECK( host_bus_spi_stats()->conflicts == 1 );
+    HOST_CHECK( host_bus_spi_stats()->nested == 0 );
+    HOST_CHECK( host_bus_spi_stats()->stray_bytes == 0 );
+}
+
+/* one transaction per step, at most one chunk in it */
+static void test_transactions()
+{
+    static const uint16_t chunks[] = { 2, 64, 333, 4096 };
+
+    for( size_t c = 0; c < sizeof( chunks ) / sizeof( chunks[0] ); c++ )
+    {
+        st7789v_stream_job_t fill;
+        SpiScheduler sched;
+        uint16_t color = ( uint16_t )( 0x1111 * ( c + 1 ) );
+        int steps = 0;
+
+        ST7789V::clear_job( &fill, color, chunks[c] );
+        sched.submit( &fill.job );
+        host_bus_spi_reset_stats();
+
+        while( sched.busy() )
+        {
+            uint32_t transactions = host_bus_spi_stats()->transactions;
+            uint32_t pixels = host_test_model.stats()->pixels;
+
+            sched.poll();
+            steps++;
+
+            const host_spi_stats_t *s = host_bus_spi_stats();
+
+            if( !HOST_CHECK( s->transactions == transactions + 1 && !s->open ) ||
+                !HOST_CHECK( s->last_bytes <= fill.job.chunk + TEST_WINDOW_BYTES ) ||
+                !HOST_CHECK( s->last_cs == HOST_TEST_CS ) ||
+                !HOST_CHECK( host_test_model.stats()->pixels - pixels <= fill.job.chunk / 2u ) ) {
+                printf( "  chunk %u, step %d\n", chunks[c], steps );
+                break;
+            }
+        }
+
+        HOST_CHECK( host_bus_spi_stats()->nested == 0 );
+        HOST_CHECK( host_bus_spi_stats()->stray_bytes == 0 );
+        HOST_CHECK( steps >= ( int )( 240UL * 135 * 2 / fill.job.chunk ) );
+        check_screen( color );
+    }
+}
+
+/* a more urgent request runs between two chunks, an equal one waits */
+static void test_preemption()
+{
+    st7789v_stream_job_t fill;
+    test_adc_job_t urgent, equal;
+    SpiScheduler sched;
+    uint32_t conversions;
+
+    test_adc.set_channel( 5, 0x155 );
+    ST7789V::clear_job( &fill, 0xBEEF, 512 );
+    adc_job( &urgent, 5, 1 );
+    adc_job( &equal, 5, 0 );
+    sched.submit( &fill.job );
+
+    for( int i = 0; i < 3; i++ ) {
+        sched.poll();
+    }
+
+    conversions = test_adc.stats()->conversions;
+    sched.submit( &equal.job );
+    sched.submit( &urgent.job );
+
+    HOST_CHECK( sched.poll() );
+    HOST_CHECK( urgent.value == 0x155 && equal.value == 0xFFFF );
+    HOST_CHECK( test_adc.stats()->conversions == conversions + 1 );
+    HOST_CHECK( host_bus_spi_stats()->last_cs == TEST_ADC_CS );
+    HOST_CHECK( fill.left == 240UL * 135 - 3 * 256 );
+    HOST_CHECK( sched.stats()->preemptions == 1 );
+
+    /* the fill picks up where it stopped, the equal request after it */
+    HOST_CHECK( sched.poll() );
+    HOST_CHECK( host_bus_spi_stats()->last_cs == HOST_TEST_CS );
+    HOST_CHECK( fill.left == 240UL * 135 - 4 * 256 );
+
+    while( fill.left ) {
+        HOST_CHECK( sched.poll() );
+    }
+
+    HOST_CHECK( equal.value == 0xFFFF );
+    sched.flush();
+    HOST_CHECK( equal.value == 0x155 );
+    HOST_CHECK( test_adc.stats()->aborted == 0 );
+
+    check_screen( 0xBEEF );
+}
+
+/* requests at random bus times wait for one display chunk at most */
+static void test_latency()
+{
+    const uint16_t chunk = 1024;
+    uint32_t hz = ST7789V::m_st7789v_handle.spi_speed;
+    /* a chunk with its window, then the request itself */
+    uint64_t bound = 2ULL * TEST_OVERHEAD_NS + ( chunk + TEST_WINDOW_BYTES ) * 8000000000ULL / hz +
+                     3 * 8000000000ULL / TEST_ADC_HZ;
+    uint32_t seed = 0x5C4ED000;
+    st7789v_stream_job_t fill;
+    test_adc_job_t adc;
+    SpiScheduler sched;
+    uint64_t arrival = 0, worst = 0;
+    bool pending = false;
+    int served = 0;
+
+    host_bus_spi_overhead( TEST_OVERHEAD_NS );
+    test_adc.reset_stats();
+
+    for( int frame = 0; served < TEST_REQUESTS && frame < 50; frame++ )
+    {
+        ST7789V::clear_job( &fill, ( uint16_t )( frame * 0x0841 ), chunk );
+        sched.submit( &fill.job );
+
+        while( sched.busy() )
+        {
+            uint64_t now = host_bus_spi_time_ns();
+
+            if( !pending && !arrival ) {
+                arrival = now + host_rand_range( &seed, 0, 400000 );
+            }
+
+            if( !pending && now >= arrival )
+            {
+                adc_job( &adc, 0, 1 );
+                sched.submit( &adc.job );
+                pending = true;
+            }
+
+            sched.poll();
+
+            if( pending && adc.value != 0xFFFF )
+            {
+                uint64_t wait = test_adc.stats()->last_ns - arrival;
+
+                if( wait > worst ) {
+                    worst = wait;
+                }
+
+                pending = false;
+                arrival = 0;
+                served++;
+            }
+        }
+    }
+
+    HOST_CHECK( served >= TEST_REQUESTS );
+    host_check( worst <= bound, "worst ADC latency within one display chunk", __FILE__, __LINE__ );
+
+    if( worst > bound ) {
+        printf( "  worst %llu ns, bound %llu ns\n", ( unsigned long long )worst, ( unsigned long long )bound );
+    }
+
+    host_bus_spi_overhead( 0 );
+}
+
+int main()
+{
+    host_test_attach_tft();
+    host_bus_attach_spi_device( &test_adc, TEST_ADC_CS );
+
+    test_devices();
+    test_transactions();
+    test_preemption();
+    test_latency();
+
+    return host_test_done( "scheduler" );
+}
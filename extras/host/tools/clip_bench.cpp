@@ -0,0 +1,310 @@
+/**
+ * @file clip_bench.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Cost of the clip stack per drawing primitive of the st7789v.
+ *
+ * The same random calls of each primitive are made three times into an
+ * St7789vModel:
+ *
+ *   root     nothing pushed
+ *   enclose  a viewport at (0, 0) over the whole screen, every call is
+ *            translated and tested but nothing is cut
+ *   half     a viewport over the left half with its origin in the middle
+ *            of it, so about half of every shape is cut away
+ *
+ * For each it prints the host time, the best of a few rounds, and the
+ * bus bytes per call. Root and enclose send the same bytes, their time
+ * difference is what translating and testing costs; half shows what
+ * cutting saves on the bus. The host time includes the bus model, so a
+ * second table times disp_clip_point(), disp_clip_area() and
+ * disp_clip_line() alone, on the screen and with the stack full.
+ *
+ *   g++ -std=gnu++11 -O2 -DST7789V_USE_SOFTWARE_SPI=0 \
+ *       -Iextras/host/arduino -Iextras/host -Isrc \
+ *       $(find src extras/host -maxdepth 1 -name '*.cpp') \
+ *       extras/host/tools/clip_bench.cpp -lrt -o clip_bench
+ *   ./clip_bench [-n calls]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "st7789v.h"
+#include "host_bus.h"
+
+#define BENCH_CS  10
+#define BENCH_DC  9
+#define BENCH_RST 8
+
+#define BENCH_W 240
+#define BENCH_H 135
+
+#define BENCH_ROUNDS 5
+
+enum
+{
+    BENCH_PIXEL,
+    BENCH_HLINE,
+    BENCH_FILL_RECT,
+    BENCH_BITMAP,
+    BENCH_LINE,
+    BENCH_CIRCLE,
+    BENCH_FILL_CIRCLE,
+    BENCH_POLYGON,
+    BENCH_KINDS
+};
+
+static const char *bench_names[BENCH_KINDS] = {
+    "put_pixel", "hline", "fill_rect", "bitmap", "line", "circle", "fill circle", "polygon"
+};
+
+static const char *bench_cases[] = { "root", "enclose", "half" };
+
+static St7789vModel bench_model;
+static uint16_t bench_bitmap[32 * 32];
+
+static uint32_t bench_rand( uint32_t *s )
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+
+    return *s;
+}
+
+static int bench_range( uint32_t *s, int lo, int hi )
+{
+    return lo + ( int )( bench_rand( s ) % ( uint32_t )( hi - lo + 1 ) );
+}
+
+static uint64_t bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t bench_bytes()
+{
+    return ( uint64_t )bench_model.stats()->cmd_bytes + bench_model.stats()->data_bytes;
+}
+
+/* (x, y) is in the coordinates of the current viewport */
+static void bench_draw( disp_raster_t *r, int kind, uint32_t *seed, int x, int y )
+{
+    int w = bench_range( seed, 4, 32 ), h = bench_range( seed, 4, 32 );
+    uint16_t color = ( uint16_t )bench_rand( seed );
+    disp_coord_t xy[12];
+
+    switch( kind )
+    {
+    case BENCH_PIXEL:
+        ST7789V::put_pixel( x, y, color );
+        break;
+
+    case BENCH_HLINE:
+        ST7789V::draw_hline( x, y, w, color );
+        break;
+
+    case BENCH_FILL_RECT:
+        ST7789V::fill_rect( x, y, w, h, color );
+        break;
+
+    case BENCH_BITMAP:
+        ST7789V::draw_bitmap( x, y, w, h, bench_bitmap );
+        break;
+
+    case BENCH_LINE:
+        disp_draw_line( r, x, y, x + w - 16, y + h - 16, color );
+        break;
+
+    case BENCH_CIRCLE:
+        disp_draw_circle( r, x, y, w / 2, color );
+        break;
+
+    case BENCH_FILL_CIRCLE:
+        disp_fill_circle( r, x, y, w / 2, color );
+        break;
+
+    default:
+        for( int i = 0; i < 6; i++ ) {
+            xy[2 * i] = x + bench_range( seed, -16, 16 );
+            xy[2 * i + 1] = y + bench_range( seed, -16, 16 );
+        }
+
+        disp_fill_polygon( r, xy, 6, color );
+        break;
+    }
+}
+
+static void bench_run( int kind, int which, uint32_t calls, uint64_t *ns, uint64_t *bytes )
+{
+    uint16_t bg = 0x0000;
+    disp_raster_t r = ST7789V::raster( &bg );
+    uint32_t seed = 0xC11B0000 + kind;
+    int ox = 0;
+
+    if( which == 1 ) {
+        ST7789V::push_viewport( 0, 0, BENCH_W, BENCH_H );
+    }
+    else if( which == 2 ) {
+        ox = BENCH_W / 4;
+        ST7789V::push_viewport( ox, 0, BENCH_W / 2, BENCH_H );
+    }
+
+    *ns = 0;
+    *bytes = 0;
+
+    for( uint32_t i = 0; i < calls; i++ )
+    {
+        /* the same screen positions in every case */
+        int x = bench_range( &seed, 0, BENCH_W - 1 ) - ox;
+        int y = bench_range( &seed, 0, BENCH_H - 1 );
+        uint64_t b0 = bench_bytes(), t0 = bench_now_ns();
+
+        bench_draw( &r, kind, &seed, x, y );
+
+        *ns += bench_now_ns() - t0;
+        *bytes += bench_bytes() - b0;
+    }
+
+    if( which ) {
+        ST7789V::pop_clip();
+    }
+}
+
+/* ns per call of one clip helper, best of BENCH_ROUNDS */
+static double bench_helper( int helper, int depth, uint32_t calls )
+{
+    disp_clip_t clip;
+    uint32_t seed = 0xC11B0100 + helper;
+    uint64_t best = ~0ULL;
+    volatile int sink = 0;
+    static disp_coord_t xy[1024][4];
+
+    disp_clip_init( &clip, BENCH_W, BENCH_H );
+
+    for( int i = 0; i < depth; i++ ) {
+        disp_clip_push_viewport( &clip, 4, 4, BENCH_W - 8 * i - 8, BENCH_H - 8 * i - 8 );
+    }
+
+    for( int i = 0; i < 1024; i++ ) {
+        xy[i][0] = bench_range( &seed, -40, BENCH_W + 40 );
+        xy[i][1] = bench_range( &seed, -40, BENCH_H + 40 );
+        xy[i][2] = bench_range( &seed, -40, BENCH_W + 40 );
+        xy[i][3] = bench_range( &seed, -40, BENCH_H + 40 );
+    }
+
+    for( int round = 0; round < BENCH_ROUNDS; round++ )
+    {
+        uint64_t t0 = bench_now_ns(), ns;
+        int kept = 0;
+
+        for( uint32_t i = 0; i < calls; i++ )
+        {
+            const disp_coord_t *p = xy[i & 1023];
+            disp_coord_t x0 = p[0], y0 = p[1], x1 = p[2], y1 = p[3];
+            disp_area_t a = { x0, y0, ( disp_coord_t )( x0 + 31 ), ( disp_coord_t )( y0 + 31 ) };
+
+            if( helper == 0 ) {
+                kept += disp_clip_point( &clip, &x0, &y0 );
+            }
+            else if( helper == 1 ) {
+                kept += disp_clip_area( &clip, &a );
+            }
+            else {
+                kept += disp_clip_line( &clip, &x0, &y0, &x1, &y1 );
+            }
+        }
+
+        ns = bench_now_ns() - t0;
+        best = ns < best ? ns : best;
+        sink += kept;
+    }
+
+    ( void )sink;
+
+    return ( double )best / calls;
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t calls = 20000;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "n:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'n':
+            calls = strtoul( optarg, NULL, 0 );
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-n calls]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( !calls ) {
+        fprintf( stderr, "need at least one call\n" );
+        return 1;
+    }
+
+    for( int i = 0; i < 32 * 32; i++ ) {
+        bench_bitmap[i] = ( uint16_t )( i * 0x2F1B );
+    }
+
+    host_bus_attach_spi( &bench_model, BENCH_CS, BENCH_DC );
+    ST7789V tft( BENCH_CS, BENCH_DC, BENCH_RST );
+    tft.init( BENCH_W, BENCH_H );
+
+    printf( "%u calls per primitive and case on %d x %d, shapes up to 32 px\n\n", calls,
+            BENCH_W, BENCH_H );
+    printf( "%-12s", "primitive" );
+
+    for( int c = 0; c < 3; c++ ) {
+        printf( " %8s ns %7s B", bench_cases[c], bench_cases[c] );
+    }
+
+    printf( "\n" );
+
+    for( int kind = 0; kind < BENCH_KINDS; kind++ )
+    {
+        printf( "%-12s", bench_names[kind] );
+
+        for( int c = 0; c < 3; c++ )
+        {
+            uint64_t best = ~0ULL, ns, bytes;
+
+            for( int round = 0; round < BENCH_ROUNDS; round++ )
+            {
+                bench_run( kind, c, calls, &ns, &bytes );
+                best = ns < best ? ns : best;
+            }
+
+            printf( " %11.1f %9.1f", ( double )best / calls, ( double )bytes / calls );
+        }
+
+        printf( "\n" );
+    }
+
+    printf( "\n%-12s %11s %11s\n", "helper", "screen ns", "full ns" );
+
+    for( int helper = 0; helper < 3; helper++ )
+    {
+        static const char *names[] = { "clip_point", "clip_area", "clip_line" };
+
+        printf( "%-12s %11.2f %11.2f\n", names[helper], bench_helper( helper, 0, calls * 50 ),
+                bench_helper( helper, DISP_CLIP_STACK_DEPTH, calls * 50 ) );
+    }
+
+    return 0;
+}
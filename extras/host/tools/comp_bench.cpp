@@ -0,0 +1,259 @@
+/**
+ * @file comp_bench.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Bus bytes per frame of DispCompositor's damage regions against
+ * redrawing one bounding box or the whole screen.
+ *
+ * Sprites of 16 x 16 bounce over a gradient background on 240 x 135 and
+ * a score layer changes every 10 frames. The same motion is composed
+ * three ways into an St7789vModel through ST7789V::line_ops():
+ *
+ *   regions  what compose() does, the merged old and new areas
+ *   bbox     one region, the bounding box of everything that changed
+ *   full     the whole screen every frame
+ *
+ * For each it prints regions, pixels and bus bytes per frame, the bus
+ * time of those bytes at the panel clock of the host core and the host
+ * CPU time per frame.
+ *
+ *   g++ -std=gnu++11 -O2 -DST7789V_USE_SOFTWARE_SPI=0 \
+ *       -Iextras/host/arduino -Iextras/host -Isrc \
+ *       $(find src extras/host -maxdepth 1 -name '*.cpp') \
+ *       extras/host/tools/comp_bench.cpp -lrt -o comp_bench
+ *   ./comp_bench [-s sprites] [-n frames]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "st7789v.h"
+#include "disp_compositor.h"
+#include "rgb565.h"
+#include "host_bus.h"
+
+#define BENCH_CS  10
+#define BENCH_DC  9
+#define BENCH_RST 8
+
+#define BENCH_W      240
+#define BENCH_H      135
+#define BENCH_SPRITE 16
+
+typedef struct
+{
+    int x, y, dx, dy;
+    int8_t id;
+} bench_sprite_t;
+
+typedef struct
+{
+    uint64_t regions;
+    uint64_t pixels;
+    uint64_t bytes;
+    uint64_t bus_ns;
+    uint64_t cpu_ns;
+} bench_stats_t;
+
+static St7789vModel bench_model;
+static uint16_t bench_ball[BENCH_SPRITE * BENCH_SPRITE];
+static bench_sprite_t bench_sprites[DISP_COMP_MAX_LAYERS];
+
+static uint64_t bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t bench_bytes()
+{
+    return ( uint64_t )bench_model.stats()->cmd_bytes + bench_model.stats()->data_bytes;
+}
+
+static void bench_background( void *ctx, disp_coord_t x, disp_coord_t y,
+                              disp_coord_t n, uint16_t *px )
+{
+    ( void )ctx;
+
+    rgb565_gradient_part( px, 0x001F, 0xF800, BENCH_W, x, n );
+
+    /* a darker band every 16 rows */
+    if( y & 16 ) {
+        rgb565_blend_color( px, 0x0000, n, 64 );
+    }
+}
+
+static void bench_area( disp_area_t *a, int x, int y, int w, int h )
+{
+    a->x1 = x;
+    a->y1 = y;
+    a->x2 = x + w - 1;
+    a->y2 = y + h - 1;
+}
+
+static void bench_run( int mode, int sprites, uint32_t frames, bench_stats_t *s )
+{
+    DispCompositor comp( BENCH_W, BENCH_H, 0x0000 );
+    disp_line_ops_t ops = ST7789V::line_ops();
+    disp_area_t screen = { 0, 0, BENCH_W - 1, BENCH_H - 1 };
+    uint32_t seed = 0xC0B7E000;
+    int8_t hud;
+
+    memset( s, 0, sizeof( *s ) );
+    comp.set_background( bench_background, NULL );
+
+    for( int i = 0; i < sprites; i++ )
+    {
+        bench_sprite_t *b = &bench_sprites[i];
+
+        seed = seed * 1103515245 + 12345;
+        b->x = seed % ( BENCH_W - BENCH_SPRITE );
+        b->y = ( seed >> 8 ) % ( BENCH_H - BENCH_SPRITE );
+        b->dx = 1 + ( seed >> 16 ) % 3;
+        b->dy = 1 + ( seed >> 20 ) % 2;
+        b->id = comp.add_layer( bench_ball, BENCH_SPRITE, BENCH_SPRITE );
+        comp.set_key( b->id, true, 0x0000 );
+        comp.move( b->id, b->x, b->y );
+        comp.set_visible( b->id, true );
+    }
+
+    hud = comp.add_solid( 0x07E0, 40, 8 );
+    comp.move( hud, BENCH_W - 44, 4 );
+    comp.set_alpha( hud, 192 );
+    comp.set_visible( hud, true );
+
+    /* the first frame sends everything in every mode */
+    comp.compose( &ops );
+
+    for( uint32_t f = 0; f < frames; f++ )
+    {
+        disp_area_t box = { 0, 0, -1, -1 };
+        uint64_t b0, t0, c0;
+
+        for( int i = 0; i < sprites; i++ )
+        {
+            bench_sprite_t *b = &bench_sprites[i];
+            disp_area_t was, now;
+
+            bench_area( &was, b->x, b->y, BENCH_SPRITE, BENCH_SPRITE );
+
+            if( b->x + b->dx < 0 || b->x + b->dx > BENCH_W - BENCH_SPRITE ) {
+                b->dx = -b->dx;
+            }
+
+            if( b->y + b->dy < 0 || b->y + b->dy > BENCH_H - BENCH_SPRITE ) {
+                b->dy = -b->dy;
+            }
+
+            b->x += b->dx;
+            b->y += b->dy;
+            comp.move( b->id, b->x, b->y );
+
+            bench_area( &now, b->x, b->y, BENCH_SPRITE, BENCH_SPRITE );
+            disp_area_join( &box, &box, &was );
+            disp_area_join( &box, &box, &now );
+        }
+
+        if( f % 10 == 0 )
+        {
+            disp_area_t a;
+
+            /* a solid layer has no pixels to replace, set_key() marks it
+             * dirty the way set_pixels() would for a new score */
+            comp.set_key( hud, false, 0 );
+            bench_area( &a, BENCH_W - 44, 4, 40, 8 );
+            disp_area_join( &box, &box, &a );
+        }
+
+        if( mode == 1 ) {
+            comp.invalidate( &box );
+        }
+        else if( mode == 2 ) {
+            comp.invalidate( &screen );
+        }
+
+        b0 = bench_bytes();
+        t0 = host_bus_spi_time_ns();
+        c0 = bench_now_ns();
+
+        comp.compose( &ops );
+
+        s->cpu_ns += bench_now_ns() - c0;
+        s->bus_ns += host_bus_spi_time_ns() - t0;
+        s->bytes += bench_bytes() - b0;
+        s->regions += comp.stats()->regions;
+        s->pixels += comp.stats()->pixels_sent;
+    }
+}
+
+int main( int argc, char **argv )
+{
+    static const char *names[] = { "regions", "bbox", "full" };
+    int sprites = 4;
+    uint32_t frames = 600;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "s:n:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 's':
+            sprites = atoi( optarg );
+            break;
+
+        case 'n':
+            frames = strtoul( optarg, NULL, 0 );
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-s sprites] [-n frames]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( sprites < 1 || sprites > DISP_COMP_MAX_LAYERS - 1 || !frames ) {
+        fprintf( stderr, "1 ~ %d sprites, at least one frame\n", DISP_COMP_MAX_LAYERS - 1 );
+        return 1;
+    }
+
+    /* a round ball on the key color */
+    for( int y = 0; y < BENCH_SPRITE; y++ )
+    {
+        for( int x = 0; x < BENCH_SPRITE; x++ )
+        {
+            int dx = 2 * x - BENCH_SPRITE + 1, dy = 2 * y - BENCH_SPRITE + 1;
+
+            bench_ball[y * BENCH_SPRITE + x] = dx * dx + dy * dy < BENCH_SPRITE * BENCH_SPRITE ?
+                                               0xFFE0 : 0x0000;
+        }
+    }
+
+    host_bus_attach_spi( &bench_model, BENCH_CS, BENCH_DC );
+    ST7789V tft( BENCH_CS, BENCH_DC, BENCH_RST );
+    tft.init( BENCH_W, BENCH_H );
+
+    printf( "%u frames, %d sprites of %d x %d and a score on %d x %d at %.1f MHz\n\n", frames,
+            sprites, BENCH_SPRITE, BENCH_SPRITE, BENCH_W, BENCH_H,
+            ST7789V::m_st7789v_handle.spi_speed / 1e6 );
+    printf( "%-8s %8s %9s %10s %9s %9s\n", "mode", "regions", "pixels", "bytes", "bus ms", "cpu us" );
+
+    for( int mode = 0; mode < 3; mode++ )
+    {
+        bench_stats_t s;
+        double n = frames;
+
+        bench_run( mode, sprites, frames, &s );
+
+        printf( "%-8s %8.2f %9.1f %10.1f %9.3f %9.1f\n", names[mode], s.regions / n,
+                s.pixels / n, s.bytes / n, s.bus_ns / n / 1e6, s.cpu_ns / n / 1e3 );
+    }
+
+    return 0;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file dither_bench.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Pixels per second and RAM of the ssd1306 dither modes.
+ *
+ * A 128 x 64 image, a radial gradient with some noise so no mode gets an
+ * easy ride, is streamed row by row into an OledFrameBuffer:
+ *
+ *   threshold  OledDither, OLED_DITHER_THRESHOLD
+ *   bayer      OledDither, OLED_DITHER_BAYER
+ *   floyd      OledDither, OLED_DITHER_FLOYD
+ *   rgb floyd  the same from rgb565 rows, with the gray conversion
+ *   gray       OledGrayDither::push_gray(), levels of the whole image
+ *   gray frame OledGrayDither::next_frame(), one plane into the buffer
+ *              and its changed bytes to a flush callback that counts them
+ *
+ * Each rate is the best of a few rounds. RAM is what a sketch needs for
+ * the mode besides the 1 KB frame buffer: the object, the level buffer of
+ * OledGrayDither and one input row. The dither calls keep only scalars on
+ * the stack, so that is the peak. Object sizes are those of this host,
+ * the working arrays, given apart, are the same on an MCU.
+ *
+ *   g++ -std=gnu++11 -O2 -Iextras/host/arduino -Iextras/host -Isrc \
+ *       $(find src extras/host -maxdepth 1 -name '*.cpp') \
+ *       extras/host/tools/dither_bench.cpp -lrt -o dither_bench
+ *   ./dither_bench [-n frames]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "oled_dither.h"
+
+#define BENCH_W 128
+#define BENCH_H 64
+
+#define BENCH_ROUNDS 5
+
+enum
+{
+    BENCH_THRESHOLD,
+    BENCH_BAYER,
+    BENCH_FLOYD,
+    BENCH_RGB_FLOYD,
+    BENCH_GRAY,
+    BENCH_GRAY_FRAME,
+    BENCH_MODES
+};
+
+static const char *bench_names[BENCH_MODES] = {
+    "threshold", "bayer", "floyd", "rgb floyd", "gray", "gray frame"
+};
+
+static uint8_t bench_fb[BENCH_W * BENCH_H / 8];
+static uint8_t bench_gray[BENCH_H][BENCH_W];
+static uint16_t bench_rgb[BENCH_H][BENCH_W];
+static uint8_t bench_levels[OLED_GRAY_BUF_SIZE( BENCH_W, BENCH_H )];
+static uint32_t bench_flushed;
+
+static uint32_t bench_rand( uint32_t *s )
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+
+    return *s;
+}
+
+static uint64_t bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_flush( void *ctx, const disp_area_t *area )
+{
+    ( void )ctx;
+
+    bench_flushed += ( area->x2 - area->x1 + 1 ) * ( ( area->y2 - area->y1 + 1 ) >> 3 );
+}
+
+static void bench_image()
+{
+    uint32_t seed = 0xD17E0001;
+
+    for( int y = 0; y < BENCH_H; y++ )
+    {
+        for( int x = 0; x < BENCH_W; x++ )
+        {
+            int dx = x - BENCH_W / 2, dy = 2 * ( y - BENCH_H / 2 );
+            int v = 255 - ( dx * dx + dy * dy ) / 32 + ( int )( bench_rand( &seed ) % 33 ) - 16;
+
+            v = v < 0 ? 0 : v > 255 ? 255 : v;
+            bench_gray[y][x] = v;
+            bench_rgb[y][x] = ( ( v >> 3 ) << 11 ) | ( ( v >> 2 ) << 5 ) | ( v >> 3 );
+        }
+    }
+}
+
+/* pixels per second, best of BENCH_ROUNDS */
+static double bench_rate( OledFrameBuffer *fb, int mode, uint32_t frames )
+{
+    static const oled_dither_t methods[] = {
+        OLED_DITHER_THRESHOLD, OLED_DITHER_BAYER, OLED_DITHER_FLOYD, OLED_DITHER_FLOYD
+    };
+    OledDither dither( fb, methods[mode < BENCH_GRAY ? mode : 0] );
+    OledGrayDither gray( fb, bench_levels );
+    uint64_t best = ~0ULL;
+
+    if( mode == BENCH_GRAY_FRAME )
+    {
+        gray.begin( 0, 0, BENCH_W, BENCH_H );
+
+        for( int y = 0; y < BENCH_H; y++ ) {
+            gray.push_gray( bench_gray[y] );
+        }
+    }
+
+    for( int round = 0; round < BENCH_ROUNDS; round++ )
+    {
+        uint64_t t0 = bench_now_ns(), ns;
+
+        bench_flushed = 0;
+
+        for( uint32_t f = 0; f < frames; f++ )
+        {
+            if( mode == BENCH_GRAY_FRAME ) {
+                gray.next_frame( bench_flush, NULL );
+                continue;
+            }
+
+            if( mode == BENCH_GRAY ) {
+                gray.begin( 0, 0, BENCH_W, BENCH_H );
+            }
+            else {
+                dither.begin( 0, 0, BENCH_W, BENCH_H );
+            }
+
+            for( int y = 0; y < BENCH_H; y++ )
+            {
+                if( mode == BENCH_GRAY ) {
+                    gray.push_gray( bench_gray[y] );
+                }
+                else if( mode == BENCH_RGB_FLOYD ) {
+                    dither.push_rgb565( bench_rgb[y] );
+                }
+                else {
+                    dither.push_gray( bench_gray[y] );
+                }
+            }
+        }
+
+        ns = bench_now_ns() - t0;
+        best = ns < best ? ns : best;
+    }
+
+    return ( double )frames * BENCH_W * BENCH_H / ( best / 1e9 );
+}
+
+static uint32_t bench_ram( int mode, uint32_t *arrays )
+{
+    if( mode < BENCH_GRAY ) {
+        *arrays = OledDither::working_memory();
+
+        return sizeof( OledDither ) + BENCH_W * ( mode == BENCH_RGB_FLOYD ? 2 : 1 );
+    }
+
+    *arrays = sizeof( bench_levels );
+
+    return sizeof( OledGrayDither ) + sizeof( bench_levels ) +
+           ( mode == BENCH_GRAY ? BENCH_W : 0 );
+}
+
+int main( int argc, char **argv )
+{
+    OledFrameBuffer fb( bench_fb, BENCH_W, BENCH_H );
+    uint32_t frames = 2000;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "n:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'n':
+            frames = strtoul( optarg, NULL, 0 );
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-n frames]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( !frames ) {
+        fprintf( stderr, "need at least one frame\n" );
+        return 1;
+    }
+
+    bench_image();
+
+    printf( "%u frames of %d x %d per mode, OLED_DITHER_MAX_W %d\n\n", frames, BENCH_W, BENCH_H,
+            OLED_DITHER_MAX_W );
+    printf( "%-10s %10s %9s %8s %8s\n", "mode", "Mpx/s", "fps", "RAM B", "arrays" );
+
+    for( int mode = 0; mode < BENCH_MODES; mode++ )
+    {
+        double rate = bench_rate( &fb, mode, frames );
+        uint32_t arrays, ram = bench_ram( mode, &arrays );
+
+        printf( "%-10s %10.2f %9.0f %8u %8u\n", bench_names[mode], rate / 1e6,
+                rate / ( BENCH_W * BENCH_H ), ram, arrays );
+    }
+
+    printf( "\ngray frame flushes %.1f bytes per plane\n", ( double )bench_flushed / frames );
+
+    return 0;
+}
@@ -0,0 +1,296 @@
+/**
+ * @file fb_bench.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief ST7789V frames produced into a ShmFrameBuffer at a fixed rate.
+ *
+ * The driver draws through the host bus into an St7789vModel whose GRAM
+ * is the pixel memory of a ShmFrameBuffer. On every tick the workload is
+ * drawn, the area the model saw written is taken with take_dirty() and
+ * handed to publish(), so fb_viewer can watch the frames as they come.
+ * Once a second it prints frames made and deadlines missed, the latency
+ * from the tick to publish() returning, average and worst, what publish()
+ * itself took, and the CPU time used in that second from getrusage(),
+ * user and system, as a share of one core.
+ *
+ * Built in workloads:
+ *
+ *   anim       a bouncing 24 x 24 box over a background, plus a gradient
+ *              bar that changes colors every frame
+ *   full       the whole panel redrawn as a gradient every frame
+ *
+ *   g++ -std=gnu++11 -O2 -DST7789V_USE_SOFTWARE_SPI=0 \
+ *       -Iextras/host/arduino -Iextras/host -Isrc \
+ *       $(find src extras/host -maxdepth 1 -name '*.cpp') \
+ *       extras/host/tools/fb_bench.cpp -lrt -o fb_bench
+ *   ./fb_bench [-f fps] [-d seconds] [-n /name] [anim|full]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "st7789v.h"
+#include "host_bus.h"
+#include "shm_fb.h"
+
+#define BENCH_CS  10
+#define BENCH_DC  9
+#define BENCH_RST 8
+
+#define BENCH_BOX 24
+#define BENCH_BAR 10
+
+typedef void ( *bench_frame_t )( uint32_t frame );
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t missed;            /* ticks dropped while a frame was late */
+    uint64_t latency;           /* tick to publish() returning, summed, ns */
+    uint64_t worst;
+    uint64_t publish;           /* inside publish(), summed, ns */
+    uint64_t cpu_user;          /* us */
+    uint64_t cpu_sys;
+} bench_stats_t;
+
+static volatile bool bench_quit;
+
+static void bench_on_signal( int sig )
+{
+    ( void )sig;
+    bench_quit = true;
+}
+
+static uint64_t bench_tv_us( const struct timeval *tv )
+{
+    return ( uint64_t )tv->tv_sec * 1000000ULL + tv->tv_usec;
+}
+
+static void bench_cpu( uint64_t *user, uint64_t *sys )
+{
+    struct rusage ru;
+
+    getrusage( RUSAGE_SELF, &ru );
+    *user = bench_tv_us( &ru.ru_utime );
+    *sys = bench_tv_us( &ru.ru_stime );
+}
+
+static void bench_sleep_until( uint64_t ns )
+{
+    struct timespec ts;
+
+    ts.tv_sec = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+
+    while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL ) );
+}
+
+// Workloads ////////////////////////////////////////////////////////////////////
+static void bench_anim( uint32_t frame )
+{
+    static int16_t x, y, dx = 3, dy = 2;
+    int16_t w = ST7789V::m_st7789v_handle.width;
+    int16_t h = ST7789V::m_st7789v_handle.height - BENCH_BAR;
+    uint16_t c0 = ( uint16_t )( frame * 0x0841 ), c1 = ( uint16_t )~c0;
+
+    if( !frame ) {
+        ST7789V::fill_rect( 0, 0, w, h, 0x0010 );
+    }
+    else {
+        ST7789V::fill_rect( x, y, BENCH_BOX, BENCH_BOX, 0x0010 );
+    }
+
+    if( x + dx < 0 || x + dx + BENCH_BOX > w ) {
+        dx = -dx;
+    }
+
+    if( y + dy < 0 || y + dy + BENCH_BOX > h ) {
+        dy = -dy;
+    }
+
+    x += dx;
+    y += dy;
+
+    ST7789V::fill_rect( x, y, BENCH_BOX, BENCH_BOX, 0xFFE0 );
+    ST7789V::fill_gradient( 0, h, w, BENCH_BAR, c0, c1, false );
+}
+
+static void bench_full( uint32_t frame )
+{
+    uint16_t c0 = ( uint16_t )( frame * 0x0821 ), c1 = ( uint16_t )( c0 ^ 0xF81F );
+
+    ST7789V::fill_gradient( 0, 0, ST7789V::m_st7789v_handle.width,
+                            ST7789V::m_st7789v_handle.height, c0, c1, frame & 1 );
+}
+
+// Main /////////////////////////////////////////////////////////////////////////
+static void bench_print( const char *label, const bench_stats_t *s, double seconds )
+{
+    printf( "%-8s %6u %6u %9llu %9llu %9.1f %6.1f%% %6.1f%%\n", label, s->frames, s->missed,
+            ( unsigned long long )( s->frames ? s->latency / s->frames / 1000 : 0 ),
+            ( unsigned long long )( s->worst / 1000 ),
+            s->frames ? s->publish / ( double )s->frames / 1000.0 : 0.0,
+            s->cpu_user / ( seconds * 1e4 ), s->cpu_sys / ( seconds * 1e4 ) );
+}
+
+static void bench_add( bench_stats_t *total, const bench_stats_t *s )
+{
+    total->frames += s->frames;
+    total->missed += s->missed;
+    total->latency += s->latency;
+    total->publish += s->publish;
+    total->cpu_user += s->cpu_user;
+    total->cpu_sys += s->cpu_sys;
+
+    if( s->worst > total->worst ) {
+        total->worst = s->worst;
+    }
+}
+
+int main( int argc, char **argv )
+{
+    const char *name = "/st7789v";
+    bench_frame_t draw = bench_anim;
+    uint32_t fps = 60, seconds = 10, frame = 0, second = 0;
+    bench_stats_t sec, total;
+    uint64_t start, tick, n = 0, user0, sys0;
+    disp_area_t view;
+    ShmFrameBuffer fb;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "f:d:n:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'f':
+            fps = strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'd':
+            seconds = strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'n':
+            name = optarg;
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-f fps] [-d seconds] [-n /name] [anim|full]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( optind < argc )
+    {
+        if( !strcmp( argv[optind], "full" ) ) {
+            draw = bench_full;
+        }
+        else if( strcmp( argv[optind], "anim" ) ) {
+            fprintf( stderr, "%s: unknown workload\n", argv[optind] );
+            return 1;
+        }
+    }
+
+    if( !fps || !fb.create( name, ST7789V_MODEL_WIDTH, ST7789V_MODEL_HEIGHT, SHM_FB_RGB565 ) ) {
+        fprintf( stderr, "can not create %s\n", name );
+        return 1;
+    }
+
+    /* the panel part of GRAM, in physical order like the model keeps it */
+    view.x1 = ST7789V_PANEL_COL_OFFSET;
+    view.y1 = ST7789V_PANEL_ROW_OFFSET;
+    view.x2 = ST7789V_PANEL_COL_OFFSET + ST7789V_PANEL_WIDTH - 1;
+    view.y2 = ST7789V_PANEL_ROW_OFFSET + ST7789V_PANEL_HEIGHT - 1;
+    fb.set_view( &view );
+
+    St7789vModel model( ( uint16_t * )fb.pixels() );
+
+    host_bus_attach_spi( &model, BENCH_CS, BENCH_DC );
+    ST7789V tft( BENCH_CS, BENCH_DC, BENCH_RST );
+    tft.init( ST7789V_PANEL_WIDTH, ST7789V_PANEL_HEIGHT );
+
+    signal( SIGINT, bench_on_signal );
+
+    printf( "%s at %u fps into %s, %u s\n", draw == bench_full ? "full" : "anim", fps, name, seconds );
+    printf( "%-8s %6s %6s %9s %9s %9s %7s %7s\n", "second", "frames", "missed",
+            "avg us", "worst us", "pub us", "user", "sys" );
+
+    memset( &sec, 0, sizeof( sec ) );
+    memset( &total, 0, sizeof( total ) );
+
+    tick = start = ShmFrameBuffer::now_ns();
+    bench_cpu( &user0, &sys0 );
+
+    while( !bench_quit )
+    {
+        uint64_t t0, t1, lat;
+        disp_area_t dirty;
+
+        if( n >= ( uint64_t )( second + 1 ) * fps )
+        {
+            uint64_t user, sys;
+            char label[16];
+
+            bench_cpu( &user, &sys );
+            sec.cpu_user = user - user0;
+            sec.cpu_sys = sys - sys0;
+            user0 = user;
+            sys0 = sys;
+
+            snprintf( label, sizeof( label ), "%u", ++second );
+            bench_print( label, &sec, 1.0 );
+            bench_add( &total, &sec );
+
+            memset( &sec, 0, sizeof( sec ) );
+
+            if( second >= seconds ) {
+                break;
+            }
+        }
+
+        draw( frame++ );
+
+        if( model.take_dirty( &dirty ) )
+        {
+            t0 = ShmFrameBuffer::now_ns();
+            fb.publish( &dirty );
+            t1 = ShmFrameBuffer::now_ns();
+            sec.publish += t1 - t0;
+        }
+        else {
+            t1 = ShmFrameBuffer::now_ns();
+        }
+
+        lat = t1 - tick;
+        sec.latency += lat;
+        sec.frames++;
+
+        if( lat > sec.worst ) {
+            sec.worst = lat;
+        }
+
+        tick = start + ++n * 1000000000ULL / fps;
+
+        /* ticks that passed while a frame was late are dropped, not caught up */
+        while( tick < t1 ) {
+            tick = start + ++n * 1000000000ULL / fps;
+            sec.missed++;
+        }
+
+        bench_sleep_until( tick );
+    }
+
+    if( second ) {
+        bench_print( "total", &total, second );
+    }
+
+    fb.close();
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file fb_viewer.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Terminal viewer for a ShmFrameBuffer, repaints only what changed.
+ *
+ * Two pixel rows per character cell in 24 bit color, so the terminal needs
+ * to be at least view width / step columns wide.
+ *
+ *   g++ -std=gnu++11 -O2 -Iextras/host -Isrc extras/host/tools/fb_viewer.cpp \
+ *       extras/host/shm_fb.cpp -lrt -o fb_viewer
+ *   ./fb_viewer /st7789v [step]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "shm_fb.h"
+
+static volatile bool viewer_quit;
+
+static void viewer_on_signal( int sig )
+{
+    ( void )sig;
+    viewer_quit = true;
+}
+
+/* pixel as 24 bit rgb */
+static uint32_t viewer_pixel( const ShmFrameBuffer *fb, int x, int y )
+{
+    const shm_fb_header_t *h = fb->header();
+    const uint8_t *base = ( const uint8_t * )fb->pixels();
+
+    if( h->format == SHM_FB_MONO_PAGE ) {
+        return ( ( base[( y >> 3 ) * h->stride + x] >> ( y & 7 ) ) & 1 ) ? 0xFFFFFF : 0x000000;
+    }
+
+    uint16_t c = *( const uint16_t * )( base + y * h->stride + x * 2 );
+    uint32_t r = ( c >> 11 ) << 3, g = ( ( c >> 5 ) & 0x3F ) << 2, b = ( c & 0x1F ) << 3;
+
+    return ( ( r | r >> 5 ) << 16 ) | ( ( g | g >> 6 ) << 8 ) | ( b | b >> 5 );
+}
+
+/**
+ * @brief Repaint the cells covering area, in pixel memory coordinates.
+ */
+static void viewer_paint( const ShmFrameBuffer *fb, const disp_area_t *area, int step )
+{
+    const disp_area_t *v = &fb->header()->view;
+    disp_area_t a;
+    int cx, cy, cx1, cx2, cy1, cy2;
+
+    if( !disp_area_intersect( &a, area, v ) ) {
+        return;
+    }
+
+    /* cell rows hold 2 * step pixel rows, columns step pixels */
+    cx1 = ( a.x1 - v->x1 ) / step;
+    cx2 = ( a.x2 - v->x1 ) / step;
+    cy1 = ( a.y1 - v->y1 ) / ( 2 * step );
+    cy2 = ( a.y2 - v->y1 ) / ( 2 * step );
+
+    for( cy = cy1; cy <= cy2; cy++ )
+    {
+        int top = v->y1 + cy * 2 * step, bottom = top + step;
+
+        printf( "\x1b[%d;%dH", cy + 1, cx1 + 1 );
+
+        for( cx = cx1; cx <= cx2; cx++ )
+        {
+            int x = v->x1 + cx * step;
+            uint32_t t = viewer_pixel( fb, x, top );
+            uint32_t b = bottom <= v->y2 ? viewer_pixel( fb, x, bottom ) : 0;
+
+            printf( "\x1b[38;2;%u;%u;%um\x1b[48;2;%u;%u;%um\xe2\x96\x80",
+                    t >> 16, ( t >> 8 ) & 0xFF, t & 0xFF,
+                    b >> 16, ( b >> 8 ) & 0xFF, b & 0xFF );
+        }
+    }
+
+    printf( "\x1b[0m" );
+}
+
+int main( int argc, char **argv )
+{
+    ShmFrameBuffer fb;
+    int step = argc > 2 ? atoi( argv[2] ) : 1;
+    uint64_t worst = 0, total = 0, frames = 0;
+
+    if( argc < 2 ) {
+        fprintf( stderr, "usage: %s /name [step]\n", argv[0] );
+        return 1;
+    }
+
+    if( step < 1 ) {
+        step = 1;
+    }
+
+    while( !fb.open( argv[1] ) )
+    {
+        struct timespec ts = { 0, 100000000 };
+
+        nanosleep( &ts, NULL );
+    }
+
+    signal( SIGINT, viewer_on_signal );
+    printf( "\x1b[2J\x1b[?25l" );
+
+    while( !viewer_quit )
+    {
+        const disp_area_t *v = &fb.header()->view;
+        struct timespec ts = { 0, 1000000 };
+        disp_area_t dirty;
+        uint64_t published, lag;
+
+        if( !fb.poll( &dirty, &published ) ) {
+            nanosleep( &ts, NULL );
+            continue;
+        }
+
+        viewer_paint( &fb, &dirty, step );
+
+        /* publish to repainted, the cost a developer actually waits for */
+        lag = ShmFrameBuffer::now_ns() - published;
+        total += lag;
+        frames++;
+
+        if( lag > worst ) {
+            worst = lag;
+        }
+
+        printf( "\x1b[%d;1Hframe %u  lag %llu us  avg %llu us  worst %llu us\x1b[K",
+                ( v->y2 - v->y1 ) / ( 2 * step ) + 2, fb.header()->frames,
+                ( unsigned long long )( lag / 1000 ),
+                ( unsigned long long )( total / frames / 1000 ),
+                ( unsigned long long )( worst / 1000 ) );
+        fflush( stdout );
+    }
+
+    printf( "\x1b[0m\x1b[?25h\n" );
+
+    return 0;
+}
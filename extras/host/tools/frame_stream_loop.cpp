@@ -0,0 +1,272 @@
+/**
+ * @file frame_stream_loop.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Frame stream encoder and receiver talking through a pty.
+ *
+ * Renders a typical dashboard, a gradient background, a bouncing sprite,
+ * a counter and a scrolling plot, encodes every frame with FrameStreamTx
+ * and pushes it through a raw pty into FrameStreamRx, whose line sink
+ * fills a framebuffer the way RAMWR fills GRAM. Every received frame is
+ * checked against the rendered one. Prints frames per second over the
+ * pty, bytes per frame, and the frame rate a UART of the given baud would
+ * allow at 10 bits per byte.
+ *
+ *   g++ -std=gnu++11 -O2 -Iextras/host/arduino -Iextras/host -Isrc \
+ *       extras/host/tools/frame_stream_loop.cpp extras/host/frame_stream_tx.cpp \
+ *       src/frame_stream.cpp src/font5x7.cpp -o frame_stream_loop
+ *   ./frame_stream_loop [-n frames] [-b baud]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "frame_stream_tx.h"
+#include "font5x7.h"
+
+#define LOOP_W 320
+#define LOOP_H 240
+
+/* receiver side framebuffer, filled like GRAM through a window */
+typedef struct
+{
+    uint16_t fb[LOOP_W * LOOP_H];
+    disp_area_t win;
+    disp_coord_t x, y;
+} loop_sink_t;
+
+static void loop_window( void *ctx, const disp_area_t *area )
+{
+    loop_sink_t *s = ( loop_sink_t * )ctx;
+
+    s->win = *area;
+    s->x = area->x1;
+    s->y = area->y1;
+}
+
+static void loop_line( void *ctx, const uint16_t *px, disp_coord_t n )
+{
+    loop_sink_t *s = ( loop_sink_t * )ctx;
+
+    while( n-- )
+    {
+        s->fb[s->y * LOOP_W + s->x] = *px++;
+
+        if( ++s->x > s->win.x2 ) {
+            s->x = s->win.x1;
+            s->y = s->y >= s->win.y2 ? s->win.y1 : s->y + 1;
+        }
+    }
+}
+
+static uint64_t loop_now_us()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void loop_rect( uint16_t *fb, int x, int y, int w, int h, uint16_t c )
+{
+    int i, j;
+
+    for( j = y; j < y + h; j++ ) {
+        for( i = x; i < x + w; i++ ) {
+            fb[j * LOOP_W + i] = c;
+        }
+    }
+}
+
+static void loop_text( uint16_t *fb, int x, int y, const char *s, uint16_t fg, uint16_t bg )
+{
+    for( ; *s; s++, x += font5x7.advance * 2 )
+    {
+        for( int col = 0; col < font5x7.advance; col++ )
+        {
+            uint8_t bits = disp_font_column( &font5x7, *s, col );
+
+            for( int row = 0; row < 8; row++ ) {
+                loop_rect( fb, x + col * 2, y + row * 2, 2, 2, ( bits >> row ) & 1 ? fg : bg );
+            }
+        }
+    }
+}
+
+/* frame n of the dashboard */
+static void loop_render( uint16_t *fb, uint32_t n )
+{
+    static uint8_t plot[200];
+    char text[32];
+    int x, y, sx, sy;
+
+    for( y = 0; y < LOOP_H; y++ ) {
+        loop_rect( fb, 0, y, LOOP_W, 1, ( uint16_t )( ( y * 31 / LOOP_H ) | ( ( y * 63 / LOOP_H ) << 5 ) ) );
+    }
+
+    /* counter */
+    snprintf( text, sizeof( text ), "FRAME %06u", n );
+    loop_rect( fb, 8, 8, 150, 20, 0x0010 );
+    loop_text( fb, 12, 10, text, 0xFFFF, 0x0010 );
+
+    /* scrolling plot */
+    memmove( plot, plot + 1, sizeof( plot ) - 1 );
+    plot[sizeof( plot ) - 1] = ( uint8_t )( 30 + 25 * ( ( n * 7 ) % 23 ) / 23 - ( n % 5 ) );
+    loop_rect( fb, 110, 170, 200, 60, 0x0000 );
+
+    for( x = 0; x < ( int )sizeof( plot ); x++ ) {
+        loop_rect( fb, 110 + x, 170 + 59 - plot[x], 1, 2, 0x07E0 );
+    }
+
+    /* bouncing checkered sprite */
+    sx = n * 3 % ( 2 * ( LOOP_W - 32 ) );
+    sy = n * 2 % ( 2 * ( 160 - 32 ) );
+    sx = sx < LOOP_W - 32 ? sx : 2 * ( LOOP_W - 32 ) - sx;
+    sy = sy < 160 - 32 ? sy : 2 * ( 160 - 32 ) - sy;
+
+    for( y = 0; y < 32; y++ ) {
+        for( x = 0; x < 32; x++ ) {
+            fb[( sy + y ) * LOOP_W + sx + x] = ( ( x >> 2 ) ^ ( y >> 2 ) ) & 1 ? 0xF800 : 0xFFE0;
+        }
+    }
+}
+
+static int loop_open_pty( int *slave )
+{
+    struct termios tio;
+    int master = posix_openpt( O_RDWR | O_NOCTTY );
+
+    if( master < 0 || grantpt( master ) || unlockpt( master ) ) {
+        return -1;
+    }
+
+    *slave = open( ptsname( master ), O_RDWR | O_NOCTTY );
+
+    if( *slave < 0 ) {
+        return -1;
+    }
+
+    tcgetattr( *slave, &tio );
+    cfmakeraw( &tio );
+    tcsetattr( *slave, TCSANOW, &tio );
+
+    fcntl( master, F_SETFL, O_NONBLOCK );
+    fcntl( *slave, F_SETFL, O_NONBLOCK );
+
+    return master;
+}
+
+int main( int argc, char **argv )
+{
+    static uint16_t frame[LOOP_W * LOOP_H];
+    static loop_sink_t sink;
+    disp_line_ops_t ops = { loop_window, loop_line, &sink };
+    FrameStreamTx tx( LOOP_W, LOOP_H );
+    FrameStreamRx rx( &ops, LOOP_W, LOOP_H );
+    uint32_t frames = 300, baud = 2000000, n, bad = 0, errors = 0;
+    size_t max_bytes = 0;
+    uint64_t start;
+    int opt, master, slave;
+
+    while( ( opt = getopt( argc, argv, "n:b:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'n':
+            frames = strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'b':
+            baud = strtoul( optarg, NULL, 0 );
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-n frames] [-b baud]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( ( master = loop_open_pty( &slave ) ) < 0 ) {
+        perror( "pty" );
+        return 1;
+    }
+
+    start = loop_now_us();
+
+    for( n = 0; n < frames; n++ )
+    {
+        const uint8_t *out;
+        size_t len, sent = 0;
+        bool done = false;
+
+        loop_render( frame, n );
+        out = tx.encode( frame, &len );
+
+        if( len > max_bytes ) {
+            max_bytes = len;
+        }
+
+        /* the pty buffers a few KB, so write and read in turns */
+        while( !done && len )
+        {
+            uint8_t buf[4096];
+            ssize_t r;
+
+            if( sent < len && ( r = write( master, out + sent, len - sent ) ) > 0 ) {
+                sent += r;
+            }
+
+            r = read( slave, buf, sizeof( buf ) );
+
+            for( ssize_t i = 0; i < r; i++ )
+            {
+                frame_stream_event_t ev = rx.feed( buf[i] );
+
+                if( ev == FRAME_STREAM_ERROR ) {
+                    errors++;
+                    tx.keyframe();
+                    done = true;
+                }
+                else if( ev == FRAME_STREAM_DONE ) {
+                    done = true;
+                }
+            }
+
+            if( r < 0 && errno != EAGAIN ) {
+                perror( "read" );
+                return 1;
+            }
+        }
+
+        bad += memcmp( sink.fb, frame, sizeof( frame ) ) != 0;
+    }
+
+    {
+        const frame_stream_tx_stats_t *st = tx.stats();
+        double secs = ( loop_now_us() - start ) / 1e6;
+        double avg = st->frames ? ( double )st->bytes / st->frames : 0.0;
+
+        printf( "%u frames in %.2f s, %.1f fps over the pty\n", frames, secs, frames / secs );
+        printf( "%.0f bytes per frame on average, %zu at most, %u raw\n",
+                avg, max_bytes, LOOP_W * LOOP_H * 2 );
+        printf( "%.1f fps at %u baud\n", avg ? baud / 10.0 / avg : 0.0, baud );
+        printf( "pixels %llu: run %llu, index %llu, raw %llu, palette sets %u, rects %u\n",
+                ( unsigned long long )st->pixels, ( unsigned long long )st->run_pixels,
+                ( unsigned long long )st->index_pixels, ( unsigned long long )st->raw_pixels,
+                st->palette_sets, st->rects );
+        printf( "%u frames differ, %u receive errors\n", bad, errors );
+    }
+
+    close( slave );
+    close( master );
+
+    return bad ? 1 : 0;
+}
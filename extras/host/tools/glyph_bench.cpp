@@ -0,0 +1,402 @@
+/**
+ * @file glyph_bench.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief ST7789V text drawing with and without the glyph cache.
+ *
+ * Runs text workloads with nothing attached to the bus, so the time goes
+ * to the driver, then through the controller model to check that the
+ * cache leaves the same GRAM. Prints the hit rate and evictions of one
+ * pass, then glyphs per second: turning glyphs into pixels with
+ * glyph_expand() against fetching them from the cache, and whole
+ * ST7789V::draw_string() calls with the cache off and on. The host SPI
+ * stand-in costs more per byte than the expansion, so the draw columns
+ * understate what an MCU gains. Slot counts here are those of a 64 bit
+ * host, the entries are smaller on an MCU.
+ *
+ * Built in workloads:
+ *
+ *   clock      hh:mm:ss redrawn 20 times a second
+ *   menu       eight items, the highlighted one in swapped colors
+ *   log        a scrolling 40 x 16 console in three colors
+ *
+ * A workload file holds one string per line, a blank line ends a frame:
+ *
+ *   x y fg bg text      colors in hex
+ *
+ *   g++ -std=gnu++11 -O2 -DST7789V_USE_SOFTWARE_SPI=0 \
+ *       -Iextras/host/arduino -Iextras/host -Isrc \
+ *       $(find src extras/host -maxdepth 1 -name '*.cpp') \
+ *       extras/host/tools/glyph_bench.cpp -lrt -o glyph_bench
+ *   ./glyph_bench [-b bytes] [-n frames] [workload|file ...]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "st7789v.h"
+#include "font5x7.h"
+#include "host_bus.h"
+
+#define BENCH_CS    5
+#define BENCH_DC    16
+#define BENCH_RST   23
+
+#define BENCH_COLOR_TEXT   0xFFFF
+#define BENCH_COLOR_BACK   0x0000
+#define BENCH_COLOR_WARN   0xFFE0
+#define BENCH_COLOR_ERROR  0xF800
+
+typedef struct
+{
+    disp_coord_t x, y;
+    uint16_t fg, bg;
+    char text[48];
+} bench_line_t;
+
+/* a file workload, frames of lines */
+typedef struct
+{
+    bench_line_t *lines;
+    uint32_t *frame_end;        /* index past the last line of each frame */
+    uint32_t nlines, nframes;
+} bench_file_t;
+
+typedef void ( *bench_frame_fn )( const void *arg, uint32_t frame, uint32_t *glyphs );
+
+static St7789vModel bench_model;
+
+/* what bench_string() does with a string */
+typedef enum
+{
+    BENCH_DRAW = 0,             /* draw_string(), through the cache if set */
+    BENCH_EXPAND,               /* only turn glyphs into pixels */
+    BENCH_LOOKUP,               /* only fetch glyphs from the cache */
+} bench_mode_t;
+
+static bench_mode_t bench_mode;
+static GlyphCache *bench_cache;
+static uint32_t bench_sink;
+
+static uint64_t bench_now_us()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void bench_string( disp_coord_t x, disp_coord_t y, const char *s,
+                          uint16_t fg, uint16_t bg, uint32_t *glyphs )
+{
+    uint16_t px[GLYPH_CACHE_SLOT_PX];
+    const char *c;
+
+    *glyphs += strlen( s );
+
+    if( bench_mode == BENCH_DRAW ) {
+        ST7789V::draw_string( x, y, s, &font5x7, fg, bg );
+        return;
+    }
+
+    /* keep the compiler from dropping the work */
+    for( c = s; *c; c++ )
+    {
+        const uint16_t *hit = bench_mode == BENCH_LOOKUP ?
+                              bench_cache->get( &font5x7, *c, fg, bg ) : NULL;
+
+        if( !hit ) {
+            glyph_expand( &font5x7, *c, fg, bg, px );
+            hit = px;
+        }
+
+        bench_sink += hit[20];
+    }
+}
+
+static void bench_clock( const void *arg, uint32_t frame, uint32_t *glyphs )
+{
+    uint32_t s = frame / 20;
+    char text[16];
+
+    ( void )arg;
+    snprintf( text, sizeof( text ), "%02u:%02u:%02u", s / 3600 % 24, s / 60 % 60, s % 60 );
+    bench_string( 96, 60, text, BENCH_COLOR_TEXT, BENCH_COLOR_BACK, glyphs );
+}
+
+static void bench_menu( const void *arg, uint32_t frame, uint32_t *glyphs )
+{
+    static const char *items[8] = {
+        "Brightness", "Contrast", "Refresh rate", "Sleep after",
+        "Font", "Rotation", "Calibrate", "About"
+    };
+    uint8_t i, sel = frame / 4 % 8;
+
+    ( void )arg;
+
+    for( i = 0; i < 8; i++ )
+    {
+        bool hl = i == sel;
+
+        bench_string( 8, 8 + i * 12, items[i], hl ? BENCH_COLOR_BACK : BENCH_COLOR_TEXT,
+                      hl ? BENCH_COLOR_TEXT : BENCH_COLOR_BACK, glyphs );
+    }
+}
+
+/* line n of the console, what a busy device would print */
+static void bench_log_line( uint32_t n, char *text, uint16_t *fg )
+{
+    static const char *what[6] = {
+        "rx frame", "tx ack", "adc", "temp", "retry", "bus fault"
+    };
+    uint32_t k = n * 2654435761u;
+    uint8_t w = ( k >> 24 ) % 6;
+
+    snprintf( text, 41, "%07u %-9s %5u %04X %s", n * 37, what[w],
+              ( k >> 8 ) % 65536, k & 0xFFFF, w < 4 ? "ok" : "FAIL" );
+    *fg = w < 4 ? BENCH_COLOR_TEXT : ( w == 4 ? BENCH_COLOR_WARN : BENCH_COLOR_ERROR );
+}
+
+static void bench_log( const void *arg, uint32_t frame, uint32_t *glyphs )
+{
+    char text[48];
+    uint16_t fg;
+    uint8_t row;
+
+    ( void )arg;
+
+    for( row = 0; row < 16; row++ ) {
+        bench_log_line( frame + row, text, &fg );
+        bench_string( 0, row * 8, text, fg, BENCH_COLOR_BACK, glyphs );
+    }
+}
+
+static void bench_file( const void *arg, uint32_t frame, uint32_t *glyphs )
+{
+    const bench_file_t *f = ( const bench_file_t * )arg;
+    uint32_t i, k = frame % f->nframes;
+
+    for( i = k ? f->frame_end[k - 1] : 0; i < f->frame_end[k]; i++ )
+    {
+        const bench_line_t *l = &f->lines[i];
+
+        bench_string( l->x, l->y, l->text, l->fg, l->bg, glyphs );
+    }
+}
+
+static bool bench_load( bench_file_t *f, const char *path )
+{
+    FILE *fp = fopen( path, "r" );
+    char line[128];
+
+    if( !fp ) {
+        return false;
+    }
+
+    memset( f, 0, sizeof( *f ) );
+
+    while( fgets( line, sizeof( line ), fp ) )
+    {
+        bench_line_t *l;
+        int x, y, n = 0;
+        unsigned fg, bg;
+
+        if( line[0] == '\n' )
+        {
+            if( f->nlines && ( !f->nframes || f->frame_end[f->nframes - 1] != f->nlines ) ) {
+                f->frame_end = ( uint32_t * )realloc( f->frame_end, ( f->nframes + 1 ) * sizeof( uint32_t ) );
+                f->frame_end[f->nframes++] = f->nlines;
+            }
+
+            continue;
+        }
+
+        if( sscanf( line, "%d %d %x %x %n", &x, &y, &fg, &bg, &n ) != 4 || !n ) {
+            continue;
+        }
+
+        f->lines = ( bench_line_t * )realloc( f->lines, ( f->nlines + 1 ) * sizeof( bench_line_t ) );
+        l = &f->lines[f->nlines++];
+        l->x = x;
+        l->y = y;
+        l->fg = fg;
+        l->bg = bg;
+        snprintf( l->text, sizeof( l->text ), "%s", line + n );
+        l->text[strcspn( l->text, "\r\n" )] = 0;
+    }
+
+    fclose( fp );
+
+    if( f->nlines && ( !f->nframes || f->frame_end[f->nframes - 1] != f->nlines ) ) {
+        f->frame_end = ( uint32_t * )realloc( f->frame_end, ( f->nframes + 1 ) * sizeof( uint32_t ) );
+        f->frame_end[f->nframes++] = f->nlines;
+    }
+
+    return f->nframes != 0;
+}
+
+/* glyphs per second over frames frames, the best of three runs */
+static double bench_time( bench_mode_t mode, bench_frame_fn fn, const void *arg, uint32_t frames )
+{
+    double best = 0.0;
+    uint8_t run;
+
+    bench_mode = mode;
+
+    for( run = 0; run < 3; run++ )
+    {
+        uint32_t i, glyphs = 0;
+        uint64_t start = bench_now_us();
+        double rate;
+
+        for( i = 0; i < frames; i++ ) {
+            fn( arg, i, &glyphs );
+        }
+
+        rate = glyphs / ( ( bench_now_us() - start + 1 ) / 1e6 );
+        best = rate > best ? rate : best;
+    }
+
+    bench_mode = BENCH_DRAW;
+
+    return best;
+}
+
+static void bench_run( const char *name, bench_frame_fn fn, const void *arg,
+                       GlyphCache *cache, uint32_t frames )
+{
+    static uint16_t gram[ST7789V_MODEL_WIDTH * ST7789V_MODEL_HEIGHT];
+    const glyph_cache_stats_t *st = cache->stats();
+    double expand, lookup, off, on, rate;
+    uint32_t i, glyphs = 0;
+    bool same;
+
+    bench_cache = cache;
+    host_bus_attach_spi( NULL, BENCH_CS, BENCH_DC );
+
+    /* the hit rate of one pass, the timed passes run on a warm cache */
+    cache->clear();
+    cache->reset_stats();
+
+    for( i = 0; i < frames; i++ ) {
+        bench_mode = BENCH_LOOKUP;
+        fn( arg, i, &glyphs );
+    }
+
+    rate = st->hits + st->misses ? st->hits * 100.0 / ( st->hits + st->misses ) : 0.0;
+    printf( "%-10s %7.1f%% %8u", name, rate, st->evictions );
+
+    expand = bench_time( BENCH_EXPAND, fn, arg, frames );
+    lookup = bench_time( BENCH_LOOKUP, fn, arg, frames );
+
+    ST7789V::set_glyph_cache( NULL );
+    off = bench_time( BENCH_DRAW, fn, arg, frames );
+    ST7789V::set_glyph_cache( cache );
+    on = bench_time( BENCH_DRAW, fn, arg, frames );
+
+    printf( " %11.0f %11.0f %11.0f %11.0f\n", expand, lookup, off, on );
+
+    /* same GRAM both ways */
+    host_bus_attach_spi( &bench_model, BENCH_CS, BENCH_DC );
+    ST7789V::set_glyph_cache( NULL );
+    ST7789V::clear_screen_directly( 0x0000 );
+
+    for( i = 0; i < frames && i < 200; i++ ) {
+        fn( arg, i, &glyphs );
+    }
+
+    memcpy( gram, bench_model.gram(), sizeof( gram ) );
+
+    cache->clear();
+    ST7789V::set_glyph_cache( cache );
+    ST7789V::clear_screen_directly( 0x0000 );
+
+    for( i = 0; i < frames && i < 200; i++ ) {
+        fn( arg, i, &glyphs );
+    }
+
+    same = !memcmp( gram, bench_model.gram(), sizeof( gram ) );
+
+    if( !same ) {
+        printf( "%-10s GRAM differs with the cache on\n", name );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t bytes = 4096, frames = 2000;
+    GlyphCache *cache;
+    void *pool;
+    int opt, i;
+
+    while( ( opt = getopt( argc, argv, "b:n:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'b':
+            bytes = strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'n':
+            frames = strtoul( optarg, NULL, 0 );
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-b bytes] [-n frames] [clock|menu|log|file ...]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    pool = malloc( bytes );
+    cache = new GlyphCache( pool, bytes );
+
+    host_bus_attach_spi( &bench_model, BENCH_CS, BENCH_DC );
+    ST7789V tft( BENCH_CS, BENCH_DC, BENCH_RST );
+    tft.init( 240, 135 );
+
+    printf( "%u byte cache, %u slots of %u px, %u frames\n",
+            bytes, cache->slots(), GLYPH_CACHE_SLOT_PX, frames );
+    printf( "%-10s %8s %8s %11s %11s %11s %11s\n", "glyph/s", "hits", "evicted",
+            "expand", "cached", "draw off", "draw on" );
+
+    if( optind == argc )
+    {
+        bench_run( "clock", bench_clock, NULL, cache, frames * 10 );
+        bench_run( "menu", bench_menu, NULL, cache, frames );
+        bench_run( "log", bench_log, NULL, cache, frames );
+    }
+
+    for( i = optind; i < argc; i++ )
+    {
+        bench_file_t f;
+
+        if( !strcmp( argv[i], "clock" ) ) {
+            bench_run( "clock", bench_clock, NULL, cache, frames * 10 );
+        }
+        else if( !strcmp( argv[i], "menu" ) ) {
+            bench_run( "menu", bench_menu, NULL, cache, frames );
+        }
+        else if( !strcmp( argv[i], "log" ) ) {
+            bench_run( "log", bench_log, NULL, cache, frames );
+        }
+        else if( bench_load( &f, argv[i] ) ) {
+            bench_run( argv[i], bench_file, &f, cache, frames );
+            free( f.lines );
+            free( f.frame_end );
+        }
+        else {
+            fprintf( stderr, "%s: no frames\n", argv[i] );
+            return 1;
+        }
+    }
+
+    delete cache;
+    free( pool );
+
+    return 0;
+}
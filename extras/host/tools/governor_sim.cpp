@@ -0,0 +1,435 @@
+/**
+ * @file governor_sim.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief DispGovernor against a fixed 30 fps refresh on a simulated clock.
+ *
+ * Replays a workload of content changes and user activity on an SSD1306
+ * model, once through DispGovernor and once redrawing the whole screen
+ * every 33 ms the way a plain loop() does. Time is virtual, the MCU is
+ * taken to sleep between events and whatever next_poll() asks for. Bus
+ * time follows from the bytes the model saw at 400 kHz I2C, 9 bits a byte
+ * plus start, address, control byte and stop per transaction. Per minute
+ * it prints bus active time and MCU wake-ups, then flushes, the average
+ * delay from a change to its flush while the panel is on, brightness
+ * steps and time asleep.
+ *
+ * Built in workloads are clock, anim, dashboard and interact. A workload
+ * file holds one event per line, sorted by time in ms:
+ *
+ *   t x1 y1 x2 y2       content in the area changed
+ *   w t                 user activity
+ *
+ *   g++ -std=gnu++11 -O2 -DST7789V_USE_SOFTWARE_SPI=0 \
+ *       -Iextras/host/arduino -Iextras/host -Isrc \
+ *       $(find src extras/host -maxdepth 1 -name '*.cpp') \
+ *       extras/host/tools/governor_sim.cpp -lrt -o governor_sim
+ *   ./governor_sim [-d seconds] [workload|file ...]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "SSD1306.h"
+#include "disp_governor.h"
+#include "host_bus.h"
+
+#define SIM_FIXED_MS    33
+#define SIM_I2C_HZ      400000UL
+#define SIM_XFER_BITS   20      /* start, address, control byte, stop */
+
+typedef struct
+{
+    uint32_t t;
+    bool wake;
+    disp_area_t area;
+} sim_event_t;
+
+typedef struct
+{
+    const char *name;
+    sim_event_t *ev;
+    uint32_t n, cap;
+} sim_workload_t;
+
+typedef struct
+{
+    uint64_t bus_bits;
+    uint32_t wakeups;
+    uint32_t flushes;
+    uint32_t changes;
+    uint64_t latency;           /* summed over changes, ms */
+    uint32_t ramp_steps;
+    uint32_t asleep;            /* ms */
+
+    /* changes waiting for a flush */
+    uint32_t pending;
+    uint64_t pending_t;
+} sim_result_t;
+
+typedef struct
+{
+    SSD1306 *oled;
+    sim_result_t *res;
+    uint32_t now;
+} sim_ctx_t;
+
+static Ssd1306Model sim_model;
+
+static void sim_add( sim_workload_t *w, uint32_t t, bool wake,
+                     disp_coord_t x1, disp_coord_t y1, disp_coord_t x2, disp_coord_t y2 )
+{
+    sim_event_t *e;
+
+    if( w->n == w->cap ) {
+        w->cap = w->cap ? w->cap * 2 : 256;
+        w->ev = ( sim_event_t * )realloc( w->ev, w->cap * sizeof( sim_event_t ) );
+    }
+
+    e = &w->ev[w->n++];
+    e->t = t;
+    e->wake = wake;
+    e->area.x1 = x1;
+    e->area.y1 = y1;
+    e->area.x2 = x2;
+    e->area.y2 = y2;
+}
+
+static int sim_event_cmp( const void *a, const void *b )
+{
+    const sim_event_t *x = ( const sim_event_t * )a;
+    const sim_event_t *y = ( const sim_event_t * )b;
+
+    /* wakes first, so a change at the same time finds the panel awake */
+    if( x->t != y->t ) {
+        return x->t < y->t ? -1 : 1;
+    }
+
+    return ( int )y->wake - ( int )x->wake;
+}
+
+/* a clock ticking every second, looked at every five minutes */
+static void sim_clock( sim_workload_t *w, uint32_t dur )
+{
+    uint32_t t;
+
+    for( t = 0; t < dur; t += 1000 )
+    {
+        if( t % 300000 == 0 ) {
+            sim_add( w, t, true, 0, 0, -1, -1 );
+        }
+
+        sim_add( w, t, false, 80, 24, 111, 39 );
+
+        /* minutes roll over */
+        if( t % 60000 == 0 ) {
+            sim_add( w, t, false, 16, 24, 63, 39 );
+        }
+    }
+}
+
+/* a button starts a 2 s sprite animation at 60 fps every 20 s */
+static void sim_anim( sim_workload_t *w, uint32_t dur )
+{
+    uint32_t t, f;
+
+    for( t = 0; t < dur; t += 20000 )
+    {
+        sim_add( w, t, true, 0, 0, -1, -1 );
+
+        for( f = 0; f < 120; f++ )
+        {
+            disp_coord_t x = ( f * 3 ) % 112;
+
+            sim_add( w, t + f * 16, false, x, 20, x + 18, 43 );
+        }
+    }
+}
+
+/* four gauges at their own rates, checked once a minute */
+static void sim_dashboard( sim_workload_t *w, uint32_t dur )
+{
+    static const uint16_t period[4] = { 250, 700, 1000, 5000 };
+    uint32_t t;
+    uint8_t g;
+
+    for( t = 0; t < dur; t += 50 )
+    {
+        if( t % 60000 == 0 ) {
+            sim_add( w, t, true, 0, 0, -1, -1 );
+        }
+
+        for( g = 0; g < 4; g++ )
+        {
+            if( t % period[g] == 0 ) {
+                sim_add( w, t, false, ( g & 1 ) * 64, ( g >> 1 ) * 32,
+                         ( g & 1 ) * 64 + 63, ( g >> 1 ) * 32 + 15 );
+            }
+        }
+    }
+}
+
+/* two minutes of key presses moving a menu cursor, then left alone */
+static void sim_interact( sim_workload_t *w, uint32_t dur )
+{
+    uint32_t t = 0, seed = 1;
+    uint8_t row = 0;
+
+    while( t < dur && t < 120000 )
+    {
+        seed = seed * 1103515245 + 12345;
+        t += 200 + ( seed >> 16 ) % 2800;
+
+        sim_add( w, t, true, 0, 0, -1, -1 );
+        sim_add( w, t, false, 0, row * 8, 127, row * 8 + 7 );
+        row = ( row + 1 ) & 7;
+        sim_add( w, t, false, 0, row * 8, 127, row * 8 + 7 );
+    }
+}
+
+static bool sim_load( sim_workload_t *w, const char *path )
+{
+    FILE *fp = fopen( path, "r" );
+    char line[128];
+
+    if( !fp ) {
+        return false;
+    }
+
+    while( fgets( line, sizeof( line ), fp ) )
+    {
+        unsigned t, x1, y1, x2, y2;
+
+        if( line[0] == 'w' && sscanf( line + 1, "%u", &t ) == 1 ) {
+            sim_add( w, t, true, 0, 0, -1, -1 );
+        }
+        else if( sscanf( line, "%u %u %u %u %u", &t, &x1, &y1, &x2, &y2 ) == 5 ) {
+            sim_add( w, t, false, x1, y1, x2, y2 );
+        }
+    }
+
+    fclose( fp );
+
+    return true;
+}
+
+/* what the model saw since the last call, in bits on the wire */
+static void sim_account( sim_result_t *res )
+{
+    const ssd1306_model_stats_t *st = sim_model.stats();
+
+    res->bus_bits += ( uint64_t )st->transactions * SIM_XFER_BITS +
+                     ( uint64_t )( st->cmd_bytes + st->data_bytes ) * 9;
+    sim_model.reset_stats();
+}
+
+static void sim_flushed( sim_result_t *res, uint32_t now )
+{
+    res->latency += ( uint64_t )res->pending * now - res->pending_t;
+    res->pending = 0;
+    res->pending_t = 0;
+    res->flushes++;
+}
+
+static void sim_flush( void *ctx, const disp_area_t *area )
+{
+    sim_ctx_t *sim = ( sim_ctx_t * )ctx;
+
+    SSD1306::flush_cb( sim->oled, area );
+    sim_flushed( sim->res, sim->now );
+}
+
+static void sim_sleep( void *ctx, bool sleep )
+{
+    SSD1306::sleep_cb( ( ( sim_ctx_t * )ctx )->oled, sleep );
+}
+
+static void sim_brightness( void *ctx, uint8_t level )
+{
+    SSD1306::brightness_cb( ( ( sim_ctx_t * )ctx )->oled, level );
+}
+
+/* draw the change into the buffer, a new pattern each time */
+static void sim_draw( SSD1306 *oled, const sim_event_t *e, uint32_t k )
+{
+    oled->fill_rect( e->area.x1, e->area.y1, e->area.x2 - e->area.x1 + 1,
+                     e->area.y2 - e->area.y1 + 1, k & 1 );
+}
+
+static void sim_reset( SSD1306 *oled, sim_result_t *res )
+{
+    oled->framebuffer()->clear( false );
+    sim_model.reset();
+    memset( res, 0, sizeof( *res ) );
+}
+
+static void sim_governed( SSD1306 *oled, const sim_workload_t *w, uint32_t dur, sim_result_t *res )
+{
+    disp_governor_cfg_t cfg = DISP_GOVERNOR_DEFAULTS;
+    sim_ctx_t sim = { oled, res, 0 };
+    disp_power_ops_t ops = { sim_flush, sim_sleep, sim_brightness, &sim };
+    DispGovernor gov( &ops, &cfg );
+    uint32_t now = 0, i = 0;
+
+    sim_reset( oled, res );
+
+    while( now < dur )
+    {
+        uint32_t next, t;
+
+        sim.now = now;
+
+        for( ; i < w->n && w->ev[i].t <= now; i++ )
+        {
+            if( w->ev[i].wake ) {
+                gov.wake( now );
+                continue;
+            }
+
+            /* nobody sees a sleeping panel, those changes have no delay */
+            if( gov.state() != DISP_GOV_SLEEP ) {
+                res->changes++;
+                res->pending++;
+                res->pending_t += now;
+            }
+
+            sim_draw( oled, &w->ev[i], i );
+            gov.changed( now, &w->ev[i].area );
+        }
+
+        gov.poll( now );
+        sim_account( res );
+        res->wakeups++;
+
+        next = gov.next_poll( now );
+        t = i < w->n ? w->ev[i].t : dur;
+
+        if( next != UINT32_MAX ) {
+            next = now + ( next ? next : 1 );
+            t = next < t ? next : t;
+        }
+
+        t = t < dur ? t : dur;
+
+        if( gov.state() == DISP_GOV_SLEEP ) {
+            res->asleep += t - now;
+        }
+
+        now = t;
+    }
+
+    res->ramp_steps = gov.stats()->ramp_steps;
+}
+
+static void sim_fixed( SSD1306 *oled, const sim_workload_t *w, uint32_t dur, sim_result_t *res )
+{
+    uint32_t now = 0, frame = 0, i = 0;
+
+    sim_reset( oled, res );
+
+    while( now < dur )
+    {
+        for( ; i < w->n && w->ev[i].t <= now; i++ )
+        {
+            if( !w->ev[i].wake ) {
+                sim_draw( oled, &w->ev[i], i );
+                res->changes++;
+                res->pending++;
+                res->pending_t += now;
+            }
+        }
+
+        if( now == frame ) {
+            oled->flush();
+            sim_flushed( res, now );
+            frame += SIM_FIXED_MS;
+        }
+
+        sim_account( res );
+        res->wakeups++;
+
+        now = i < w->n && w->ev[i].t < frame ? w->ev[i].t : frame;
+    }
+}
+
+static void sim_print( const char *name, const sim_result_t *res, uint32_t dur )
+{
+    double min = dur / 60000.0;
+
+    printf( "  %-9s %9.1f %9.1f %8u %8.1f %6u %5.1f%%\n", name,
+            res->bus_bits * 1000.0 / SIM_I2C_HZ / min,
+            res->wakeups / min, res->flushes,
+            res->changes ? ( double )res->latency / res->changes : 0.0,
+            res->ramp_steps, res->asleep * 100.0 / dur );
+}
+
+static void sim_run( SSD1306 *oled, sim_workload_t *w, uint32_t dur )
+{
+    sim_result_t gov, fixed;
+
+    qsort( w->ev, w->n, sizeof( sim_event_t ), sim_event_cmp );
+
+    sim_governed( oled, w, dur, &gov );
+    sim_fixed( oled, w, dur, &fixed );
+
+    printf( "%s, %u events over %u s\n", w->name, w->n, dur / 1000 );
+    printf( "  %-9s %9s %9s %8s %8s %6s %6s\n", "",
+            "bus ms/m", "wakeup/m", "flushes", "delay ms", "ramps", "asleep" );
+    sim_print( "governed", &gov, dur );
+    sim_print( "30 fps", &fixed, dur );
+    printf( "  bus time %.1f%% of the fixed refresh\n\n",
+            fixed.bus_bits ? gov.bus_bits * 100.0 / fixed.bus_bits : 0.0 );
+}
+
+int main( int argc, char **argv )
+{
+    static SSD1306Buffered<> oled( 19, 18 );
+    static const char *builtin[] = { "clock", "anim", "dashboard", "interact" };
+    uint32_t dur = 600000;
+    int opt, i, n;
+
+    while( ( opt = getopt( argc, argv, "d:" ) ) != -1 )
+    {
+        if( opt != 'd' ) {
+            fprintf( stderr, "usage: %s [-d seconds] [clock|anim|dashboard|interact|file ...]\n", argv[0] );
+            return 1;
+        }
+
+        dur = strtoul( optarg, NULL, 0 ) * 1000;
+    }
+
+    host_bus_attach_i2c( &sim_model, SSD1306_DEVICE_ADDR );
+
+    n = optind < argc ? argc - optind : 4;
+
+    for( i = 0; i < n; i++ )
+    {
+        const char *name = optind < argc ? argv[optind + i] : builtin[i];
+        sim_workload_t w = { name, NULL, 0, 0 };
+
+        if( !strcmp( name, "clock" ) ) {
+            sim_clock( &w, dur );
+        }
+        else if( !strcmp( name, "anim" ) ) {
+            sim_anim( &w, dur );
+        }
+        else if( !strcmp( name, "dashboard" ) ) {
+            sim_dashboard( &w, dur );
+        }
+        else if( !strcmp( name, "interact" ) ) {
+            sim_interact( &w, dur );
+        }
+        else if( !sim_load( &w, name ) ) {
+            perror( name );
+            return 1;
+        }
+
+        sim_run( &oled, &w, dur );
+        free( w.ev );
+    }
+
+    return 0;
+}
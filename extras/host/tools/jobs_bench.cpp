@@ -0,0 +1,315 @@
+/**
+ * @file jobs_bench.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Time per step of the resumable jobs against the blocking calls.
+ *
+ * A sketch's loop() is simulated: one job_step() per pass, and in the
+ * interleaved runs a put_pixel() of the job's own color inside its area,
+ * the way other drawing would run there. It costs the job a new window
+ * per step but leaves the same screen. For the ST7789V a clear_job() of
+ * 240 x 135 and a fill_job() of 120 x 60 are run with a range of chunks
+ * and compared with clear_screen_directly() and fill_rect():
+ *
+ *   steps    job_step() calls until it returned true
+ *   worst    the longest step, in bus time of the host core and in host
+ *            time with nothing attached, so only the driver is timed
+ *   bus ms   all steps together, against the blocking call
+ *   extra    bytes on top of the blocking call, the window set again
+ *   same     the model's GRAM equals what the blocking call left
+ *
+ * Every transaction costs the bus overhead of -o on top of its bytes.
+ * An SSD1306 flush_job() of the whole 128 x 64 frame is stepped with a
+ * range of budgets; the worst step is given in bytes and in time on a
+ * 400 kHz I2C bus at 9 clocks a byte, the address byte included.
+ *
+ *   g++ -std=gnu++11 -O2 -DST7789V_USE_SOFTWARE_SPI=0 \
+ *       -Iextras/host/arduino -Iextras/host -Isrc \
+ *       $(find src extras/host -maxdepth 1 -name '*.cpp') \
+ *       extras/host/tools/jobs_bench.cpp -lrt -o jobs_bench
+ *   ./jobs_bench [-o overhead_ns]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "st7789v.h"
+#include "SSD1306.h"
+#include "host_bus.h"
+
+#define BENCH_CS  10
+#define BENCH_DC  9
+#define BENCH_RST 8
+
+#define BENCH_W 240
+#define BENCH_H 135
+
+#define BENCH_ROUNDS 5
+#define BENCH_CHUNKS 5
+
+#define BENCH_I2C_HZ 400000
+
+static const uint16_t bench_chunks[BENCH_CHUNKS] = { 64, 256, 1024, 4096, 16384 };
+static const uint16_t bench_budgets[] = { 16, 64, 128, 256, 1024 };
+
+typedef struct
+{
+    uint32_t steps;
+    uint64_t worst_bus_ns;
+    uint64_t bus_ns;
+    uint64_t bytes;
+    bool same;
+} bench_stats_t;
+
+static St7789vModel bench_model;
+static Ssd1306Model bench_oled_model;
+
+static uint64_t bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t bench_bytes()
+{
+    return ( uint64_t )bench_model.stats()->cmd_bytes + bench_model.stats()->data_bytes;
+}
+
+static void bench_start( st7789v_stream_job_t *job, bool fill, uint16_t color, uint16_t chunk )
+{
+    if( fill ) {
+        ST7789V::fill_job( job, 30, 40, 120, 60, color, chunk );
+    }
+    else {
+        ST7789V::clear_job( job, color, chunk );
+    }
+}
+
+/* GRAM the blocking call left, of the case being run */
+static uint16_t bench_want[ST7789V_MODEL_WIDTH * ST7789V_MODEL_HEIGHT];
+
+static bool bench_same()
+{
+    return !memcmp( bench_model.gram(), bench_want, sizeof( bench_want ) );
+}
+
+/* chunk 0 is the blocking call */
+static void bench_run( bool fill, uint16_t chunk, bool between, bench_stats_t *s )
+{
+    st7789v_stream_job_t job;
+    uint16_t color = fill ? 0x07E0 : 0x001F;
+
+    memset( s, 0, sizeof( *s ) );
+
+    /* something else on screen first, so same means the job drew it */
+    ST7789V::clear_screen_directly( 0xF800 );
+
+    if( !chunk )
+    {
+        uint64_t b0 = bench_bytes(), t0 = host_bus_spi_time_ns();
+
+        if( fill ) {
+            ST7789V::fill_rect( 30, 40, 120, 60, color );
+        }
+        else {
+            ST7789V::clear_screen_directly( color );
+        }
+
+        s->steps = 1;
+        s->bus_ns = s->worst_bus_ns = host_bus_spi_time_ns() - t0;
+        s->bytes = bench_bytes() - b0;
+        memcpy( bench_want, bench_model.gram(), sizeof( bench_want ) );
+        s->same = true;
+
+        return;
+    }
+
+    bench_start( &job, fill, color, chunk );
+
+    for( bool done = false; !done; )
+    {
+        uint64_t b0 = bench_bytes(), t0 = host_bus_spi_time_ns(), ns;
+
+        done = ST7789V::job_step( &job );
+
+        ns = host_bus_spi_time_ns() - t0;
+        s->worst_bus_ns = ns > s->worst_bus_ns ? ns : s->worst_bus_ns;
+        s->bus_ns += ns;
+        s->bytes += bench_bytes() - b0;
+        s->steps++;
+
+        if( between && !done ) {
+            ST7789V::put_pixel( 30, 40, color );
+        }
+    }
+
+    s->same = bench_same();
+}
+
+/* the longest step with nothing on the bus, best of BENCH_ROUNDS */
+static uint64_t bench_host( bool fill, uint16_t chunk, bool between )
+{
+    uint64_t best = ~0ULL;
+
+    host_bus_attach_spi( NULL, BENCH_CS, BENCH_DC );
+
+    for( int round = 0; round < BENCH_ROUNDS; round++ )
+    {
+        st7789v_stream_job_t job;
+        uint64_t worst = 0;
+
+        if( !chunk )
+        {
+            uint64_t t0 = bench_now_ns();
+
+            if( fill ) {
+                ST7789V::fill_rect( 30, 40, 120, 60, 0x07E0 );
+            }
+            else {
+                ST7789V::clear_screen_directly( 0x001F );
+            }
+
+            worst = bench_now_ns() - t0;
+        }
+        else
+        {
+            bench_start( &job, fill, 0x07E0, chunk );
+
+            for( bool done = false; !done; )
+            {
+                uint64_t t0 = bench_now_ns(), ns;
+
+                done = ST7789V::job_step( &job );
+
+                ns = bench_now_ns() - t0;
+                worst = ns > worst ? ns : worst;
+
+                if( between && !done ) {
+                    ST7789V::put_pixel( 30, 40, 0x07E0 );
+                }
+            }
+        }
+
+        best = worst < best ? worst : best;
+    }
+
+    host_bus_attach_spi( &bench_model, BENCH_CS, BENCH_DC );
+
+    return best;
+}
+
+static void bench_st7789v( bool fill )
+{
+    bench_stats_t block;
+
+    bench_run( fill, 0, false, &block );
+
+    printf( "%s, blocking: %llu bytes, %.3f bus ms, %.1f host us\n\n",
+            fill ? "fill_job 120 x 60" : "clear_job 240 x 135",
+            ( unsigned long long )block.bytes, block.bus_ns / 1e6,
+            bench_host( fill, 0, false ) / 1e3 );
+    printf( "%-6s %-6s %6s %10s %10s %9s %7s %5s\n", "chunk", "loop", "steps", "worst bus",
+            "worst host", "bus ms", "extra B", "same" );
+
+    for( int i = 0; i < BENCH_CHUNKS; i++ )
+    {
+        for( int between = 0; between < 2; between++ )
+        {
+            bench_stats_t s;
+
+            bench_run( fill, bench_chunks[i], between, &s );
+
+            /* the put_pixel() calls are not the job's, leave them out */
+            printf( "%-6u %-6s %6u %8.1fus %8.1fus %9.3f %7lld %5s\n", bench_chunks[i],
+                    between ? "draws" : "alone", s.steps, s.worst_bus_ns / 1e3,
+                    bench_host( fill, bench_chunks[i], between ) / 1e3, s.bus_ns / 1e6,
+                    ( long long )( s.bytes - block.bytes ), s.same ? "yes" : "NO" );
+        }
+    }
+
+    printf( "\n" );
+}
+
+static void bench_ssd1306()
+{
+    SSD1306Buffered<128, 64> oled( 19, 18 );
+    disp_area_t all = { 0, 0, 127, 63 };
+
+    host_bus_attach_i2c( &bench_oled_model, SSD1306_DEVICE_ADDR );
+
+    printf( "flush_job 128 x 64 at %u kHz I2C\n\n", BENCH_I2C_HZ / 1000 );
+    printf( "%-6s %6s %10s %10s %10s %5s\n", "budget", "steps", "worst B", "worst us", "total ms",
+            "same" );
+
+    for( size_t i = 0; i < sizeof( bench_budgets ) / sizeof( bench_budgets[0] ); i++ )
+    {
+        oled_flush_job_t job;
+        uint32_t steps = 0;
+        uint64_t worst = 0, total = 0;
+
+        for( int n = 0; n < 64; n++ ) {
+            oled.fill_rect( n * 2, n, 12, 12, ( oled_color_t )( n & 1 ) );
+        }
+
+        oled.flush_job( &job, &all, bench_budgets[i] );
+
+        for( bool done = false; !done; steps++ )
+        {
+            const ssd1306_model_stats_t *st = bench_oled_model.stats();
+            uint64_t b0 = st->cmd_bytes + st->data_bytes + st->transactions, b;
+
+            done = oled.flush_step( &job );
+
+            /* every transaction adds its address byte */
+            b = st->cmd_bytes + st->data_bytes + st->transactions - b0;
+            worst = b > worst ? b : worst;
+            total += b;
+        }
+
+        printf( "%-6u %6u %10llu %10.1f %10.2f %5s\n", bench_budgets[i], steps,
+                ( unsigned long long )worst, worst * 9 * 1e6 / BENCH_I2C_HZ,
+                total * 9 * 1e3 / BENCH_I2C_HZ,
+                memcmp( bench_oled_model.gram(), oled.framebuffer()->buffer(), 1024 ) ? "NO" : "yes" );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t overhead_ns = 2000;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "o:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'o':
+            overhead_ns = strtoul( optarg, NULL, 0 );
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-o overhead_ns]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    host_bus_attach_spi( &bench_model, BENCH_CS, BENCH_DC );
+    host_bus_spi_overhead( overhead_ns );
+    ST7789V tft( BENCH_CS, BENCH_DC, BENCH_RST );
+    tft.init( BENCH_W, BENCH_H );
+
+    printf( "%d x %d at %.1f MHz, %u ns per transaction\n\n", BENCH_W, BENCH_H,
+            ST7789V::m_st7789v_handle.spi_speed / 1e6, overhead_ns );
+
+    bench_st7789v( false );
+    bench_st7789v( true );
+    bench_ssd1306();
+
+    return 0;
+}
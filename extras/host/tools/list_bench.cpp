@@ -0,0 +1,406 @@
+/**
+ * @file list_bench.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Tiles, bus bytes and CPU time of DispList against immediate
+ * drawing, on a dashboard trace.
+ *
+ * The dashboard is the usual status screen: a frame and title that never
+ * change, a clock that ticks once a second, two readouts, a bar, a
+ * scrolling line chart and a blinking icon, at 30 frames per second.
+ * The same frames are drawn three ways into an St7789vModel:
+ *
+ *   full     clear the screen and draw every widget, every frame
+ *   widgets  clear and redraw the box of each widget whose content
+ *            changed, the dirty tracking an application would write
+ *   list     rebuild a DispList each frame and render() it
+ *
+ * For each it prints tiles and bus bytes per frame, the bus time those
+ * bytes take at the panel clock of the host core, and the host CPU time
+ * per frame, which includes the model.
+ *
+ *   g++ -std=gnu++11 -O2 -DST7789V_USE_SOFTWARE_SPI=0 \
+ *       -Iextras/host/arduino -Iextras/host -Isrc \
+ *       $(find src extras/host -maxdepth 1 -name '*.cpp') \
+ *       extras/host/tools/list_bench.cpp -lrt -o list_bench
+ *   ./list_bench [-n frames]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "st7789v.h"
+#include "disp_list.h"
+#include "disp_raster.h"
+#include "font5x7.h"
+#include "host_bus.h"
+
+#define BENCH_CS  10
+#define BENCH_DC  9
+#define BENCH_RST 8
+
+#define BENCH_FPS     30
+#define BENCH_HISTORY 20
+#define BENCH_ITEMS   DISP_LIST_MAX_ITEMS
+
+#define BENCH_BG    0x0000
+#define BENCH_FG    0xFFFF
+#define BENCH_GRAY  0x8410
+#define BENCH_GREEN 0x07E0
+#define BENCH_AMBER 0xFD20
+
+enum
+{
+    WIDGET_STATIC,
+    WIDGET_CLOCK,
+    WIDGET_SPEED,
+    WIDGET_TEMP,
+    WIDGET_BAR,
+    WIDGET_CHART,
+    WIDGET_ICON,
+    WIDGETS
+};
+
+typedef struct
+{
+    uint8_t type;               /* disp_item_type_t */
+    uint8_t widget;
+    disp_coord_t x, y, w, h;    /* lines: x, y to w, h */
+    uint16_t color;
+    char str[12];
+} bench_item_t;
+
+typedef struct
+{
+    bench_item_t item[BENCH_ITEMS];
+    int count;
+} bench_frame_t;
+
+typedef struct
+{
+    uint64_t tiles;
+    uint64_t bytes;
+    uint64_t bus_ns;
+    uint64_t cpu_ns;
+} bench_stats_t;
+
+/* widget boxes, cleared by the widgets mode */
+static const disp_area_t bench_box[WIDGETS] = {
+    { 0, 0, 239, 134 },
+    { 186, 4, 233, 10 },
+    { 6, 22, 77, 28 },
+    { 6, 34, 77, 40 },
+    { 6, 50, 205, 59 },
+    { 6, 66, 233, 128 },
+    { 216, 22, 231, 37 },
+};
+
+static const uint8_t bench_icon[32] = {
+    0x07, 0xE0, 0x18, 0x18, 0x20, 0x04, 0x4C, 0x32, 0x4C, 0x32, 0x80, 0x01,
+    0x80, 0x01, 0x80, 0x01, 0x88, 0x11, 0x84, 0x21, 0x43, 0xC2, 0x40, 0x02,
+    0x20, 0x04, 0x18, 0x18, 0x07, 0xE0, 0x00, 0x00,
+};
+
+static St7789vModel bench_model;
+static disp_hash_t bench_hash[DISP_LIST_TILES( 240, 135 )];
+
+static uint64_t bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t bench_bytes()
+{
+    return ( uint64_t )bench_model.stats()->cmd_bytes + bench_model.stats()->data_bytes;
+}
+
+// Trace ////////////////////////////////////////////////////////////////////////
+static bench_item_t *bench_add( bench_frame_t *f, uint8_t widget, uint8_t type,
+                                int x, int y, int w, int h, uint16_t color )
+{
+    bench_item_t *it = &f->item[f->count++];
+
+    memset( it, 0, sizeof( *it ) );
+    it->type = type;
+    it->widget = widget;
+    it->x = x;
+    it->y = y;
+    it->w = w;
+    it->h = h;
+    it->color = color;
+
+    return it;
+}
+
+/* a slow engine: speed and temperature drift, the chart gets a sample
+ * every 4 frames */
+static int bench_sample( uint32_t n )
+{
+    return 30 + ( int )( ( n * 7 ) % 61 ) - ( int )( ( n * 3 ) % 29 );
+}
+
+static void bench_trace( uint32_t frame, bench_frame_t *f )
+{
+    uint32_t s = frame / BENCH_FPS, t = frame / 4;
+    int speed = 80 + ( int )( frame % 90 ) - ( int )( frame % 45 ) * 2 / 3;
+    int temp = 850 + ( int )( frame / 40 % 30 );
+    bench_item_t *it;
+
+    f->count = 0;
+
+    bench_add( f, WIDGET_STATIC, DISP_ITEM_RECT, 0, 0, 240, 135, BENCH_GRAY );
+    it = bench_add( f, WIDGET_STATIC, DISP_ITEM_TEXT, 6, 4, 0, 0, BENCH_FG );
+    strcpy( it->str, "ENGINE 1" );
+    bench_add( f, WIDGET_STATIC, DISP_ITEM_FILL_RECT, 1, 14, 238, 1, BENCH_GRAY );
+
+    it = bench_add( f, WIDGET_CLOCK, DISP_ITEM_TEXT, 186, 4, 0, 0, BENCH_FG );
+    snprintf( it->str, sizeof( it->str ), "%02u:%02u:%02u", s / 3600 % 24, s / 60 % 60, s % 60 );
+
+    it = bench_add( f, WIDGET_SPEED, DISP_ITEM_TEXT, 6, 22, 0, 0, BENCH_GREEN );
+    snprintf( it->str, sizeof( it->str ), "SPD %3d", speed );
+
+    it = bench_add( f, WIDGET_TEMP, DISP_ITEM_TEXT, 6, 34, 0, 0, BENCH_AMBER );
+    snprintf( it->str, sizeof( it->str ), "TMP %2d.%d", temp / 10, temp % 10 );
+
+    bench_add( f, WIDGET_BAR, DISP_ITEM_RECT, 6, 50, 200, 10, BENCH_GRAY );
+    bench_add( f, WIDGET_BAR, DISP_ITEM_FILL_RECT, 7, 51, speed * 198 / 160, 8, BENCH_GREEN );
+
+    bench_add( f, WIDGET_CHART, DISP_ITEM_RECT, 6, 66, 228, 63, BENCH_GRAY );
+
+    for( int i = 0; i + 1 < BENCH_HISTORY; i++ )
+    {
+        int x = 8 + i * 224 / ( BENCH_HISTORY - 1 ), x1 = 8 + ( i + 1 ) * 224 / ( BENCH_HISTORY - 1 );
+
+        bench_add( f, WIDGET_CHART, DISP_ITEM_LINE, x, 126 - bench_sample( t + i ),
+                   x1, 126 - bench_sample( t + i + 1 ), BENCH_GREEN );
+    }
+
+    if( frame / 15 % 2 ) {
+        bench_add( f, WIDGET_ICON, DISP_ITEM_BITMAP, 216, 22, 16, 16, BENCH_AMBER );
+    }
+}
+
+// Drawing //////////////////////////////////////////////////////////////////////
+static void bench_draw( disp_raster_t *r, const bench_item_t *it )
+{
+    uint16_t px[16 * 16];
+
+    switch( it->type )
+    {
+    case DISP_ITEM_RECT:
+        ST7789V::draw_hline( it->x, it->y, it->w, it->color );
+        ST7789V::draw_hline( it->x, it->y + it->h - 1, it->w, it->color );
+        ST7789V::draw_vline( it->x, it->y, it->h, it->color );
+        ST7789V::draw_vline( it->x + it->w - 1, it->y, it->h, it->color );
+        break;
+
+    case DISP_ITEM_FILL_RECT:
+        ST7789V::fill_rect( it->x, it->y, it->w, it->h, it->color );
+        break;
+
+    case DISP_ITEM_LINE:
+        disp_draw_line( r, it->x, it->y, it->w, it->h, it->color );
+        break;
+
+    case DISP_ITEM_TEXT:
+        ST7789V::draw_string( it->x, it->y, it->str, &font5x7, it->color, BENCH_BG );
+        break;
+
+    default:
+        for( int i = 0; i < 16 * 16; i++ ) {
+            px[i] = bench_icon[i / 8] & ( 0x80 >> ( i & 7 ) ) ? it->color : BENCH_BG;
+        }
+
+        ST7789V::draw_bitmap( it->x, it->y, 16, 16, px );
+        break;
+    }
+}
+
+static void bench_list( DispList *list, const bench_frame_t *f )
+{
+    static const disp_tile_ops_t ops = { ST7789V::flush_tile, NULL };
+
+    list->begin();
+
+    for( int i = 0; i < f->count; i++ )
+    {
+        const bench_item_t *it = &f->item[i];
+
+        switch( it->type )
+        {
+        case DISP_ITEM_RECT:
+            list->add_rect( it->x, it->y, it->w, it->h, it->color );
+            break;
+
+        case DISP_ITEM_FILL_RECT:
+            list->add_fill_rect( it->x, it->y, it->w, it->h, it->color );
+            break;
+
+        case DISP_ITEM_LINE:
+            list->add_line( it->x, it->y, it->w, it->h, it->color );
+            break;
+
+        case DISP_ITEM_TEXT:
+            list->add_text( it->x, it->y, it->str, &font5x7, it->color, BENCH_BG );
+            break;
+
+        default:
+            list->add_bitmap( it->x, it->y, 16, 16, bench_icon, it->color, BENCH_BG );
+            break;
+        }
+    }
+
+    list->render( &ops );
+}
+
+static bool bench_widget_changed( const bench_frame_t *a, const bench_frame_t *b, int widget )
+{
+    int i = 0, j = 0;
+
+    for( ;; )
+    {
+        while( i < a->count && a->item[i].widget != widget ) {
+            i++;
+        }
+
+        while( j < b->count && b->item[j].widget != widget ) {
+            j++;
+        }
+
+        if( i == a->count || j == b->count ) {
+            return i != a->count || j != b->count;
+        }
+
+        if( memcmp( &a->item[i++], &b->item[j++], sizeof( bench_item_t ) ) ) {
+            return true;
+        }
+    }
+}
+
+static void bench_run( int mode, uint32_t frames, bench_stats_t *s )
+{
+    static bench_frame_t frame[2];
+    DispList list( 240, 135, BENCH_BG, bench_hash );
+    uint16_t bg = BENCH_BG;
+    disp_raster_t r = ST7789V::raster( &bg );
+
+    memset( s, 0, sizeof( *s ) );
+    frame[1].count = 0;
+
+    for( uint32_t n = 0; n < frames; n++ )
+    {
+        bench_frame_t *f = &frame[n & 1], *prev = &frame[!( n & 1 )];
+        uint64_t b0, t0, c0;
+
+        bench_trace( n, f );
+        b0 = bench_bytes();
+        t0 = host_bus_spi_time_ns();
+        c0 = bench_now_ns();
+
+        if( mode == 0 )
+        {
+            ST7789V::fill_rect( 0, 0, 240, 135, BENCH_BG );
+
+            for( int i = 0; i < f->count; i++ ) {
+                bench_draw( &r, &f->item[i] );
+            }
+        }
+        else if( mode == 1 )
+        {
+            for( int w = 0; w < WIDGETS; w++ )
+            {
+                const disp_area_t *box = &bench_box[w];
+
+                if( n && !bench_widget_changed( f, prev, w ) ) {
+                    continue;
+                }
+
+                if( w != WIDGET_STATIC ) {
+                    ST7789V::fill_rect( box->x1, box->y1, box->x2 - box->x1 + 1,
+                                        box->y2 - box->y1 + 1, BENCH_BG );
+                }
+                else {
+                    ST7789V::fill_rect( 0, 0, 240, 135, BENCH_BG );
+                }
+
+                for( int i = 0; i < f->count; i++ )
+                {
+                    if( f->item[i].widget == w ) {
+                        bench_draw( &r, &f->item[i] );
+                    }
+                }
+            }
+        }
+        else
+        {
+            bench_list( &list, f );
+            s->tiles += list.stats()->tiles_rendered;
+        }
+
+        s->cpu_ns += bench_now_ns() - c0;
+        s->bus_ns += host_bus_spi_time_ns() - t0;
+        s->bytes += bench_bytes() - b0;
+    }
+}
+
+int main( int argc, char **argv )
+{
+    static const char *names[] = { "full", "widgets", "list" };
+    uint32_t frames = 30 * BENCH_FPS;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "n:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'n':
+            frames = strtoul( optarg, NULL, 0 );
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-n frames]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( !frames ) {
+        fprintf( stderr, "need at least one frame\n" );
+        return 1;
+    }
+
+    host_bus_attach_spi( &bench_model, BENCH_CS, BENCH_DC );
+    ST7789V tft( BENCH_CS, BENCH_DC, BENCH_RST );
+    tft.init( 240, 135 );
+
+    printf( "%u dashboard frames on 240 x 135 at %.1f MHz, %u tiles of %u x %u\n\n", frames,
+            ST7789V::m_st7789v_handle.spi_speed / 1e6, DISP_LIST_TILES( 240, 135 ),
+            DISP_TILE_W, DISP_TILE_H );
+    printf( "%-8s %8s %11s %11s %11s\n", "mode", "tiles", "bytes", "bus ms", "cpu us" );
+
+    for( int mode = 0; mode < 3; mode++ )
+    {
+        bench_stats_t s;
+        double n = frames;
+
+        bench_run( mode, frames, &s );
+
+        if( mode == 2 ) {
+            printf( "%-8s %8.1f ", names[mode], s.tiles / n );
+        }
+        else {
+            printf( "%-8s %8s ", names[mode], "-" );
+        }
+
+        printf( "%11.1f %11.3f %11.1f\n", s.bytes / n, s.bus_ns / n / 1e6, s.cpu_ns / n / 1e3 );
+    }
+
+    return 0;
+}
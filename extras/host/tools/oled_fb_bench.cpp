@@ -0,0 +1,233 @@
+/**
+ * @file oled_fb_bench.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief ns per pixel of OledFrameBuffer fills and blits against a set_pixel()
+ * loop.
+ *
+ * Every operation covers the same random rectangles of a 128 x 64 buffer,
+ * once through OledFrameBuffer and once pixel by pixel with get_pixel()
+ * and set_pixel(), the way the driver drew before the frame buffer had
+ * kernels of its own. Rows either start on a page boundary, so whole
+ * bytes are written, or anywhere, so the first and last page take a mask
+ * and a blit source is shifted. Each time is the best of a few rounds.
+ *
+ * The word wide paths follow OLED_FB_WORD_OPS, which is on for this host;
+ * build with -DOLED_FB_WORD_OPS=0 to see the byte paths an AVR takes.
+ *
+ *   g++ -std=gnu++11 -O2 -Isrc src/oled_fb.cpp \
+ *       extras/host/tools/oled_fb_bench.cpp -lrt -o oled_fb_bench
+ *   ./oled_fb_bench [-s size] [-n mpixels]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "oled_fb.h"
+
+#define BENCH_W 128
+#define BENCH_H 64
+
+#define BENCH_ROUNDS 5
+#define BENCH_RECTS  256
+
+enum
+{
+    BENCH_FILL,
+    BENCH_COPY,
+    BENCH_OR,
+    BENCH_CLR,
+    BENCH_XOR,
+    BENCH_OPS
+};
+
+static const char *bench_names[BENCH_OPS] = { "fill", "blit copy", "blit or", "blit clr", "blit xor" };
+
+static uint8_t bench_buf[BENCH_W * BENCH_H / 8];
+static uint8_t bench_src[BENCH_W * BENCH_H / 8];
+static disp_area_t bench_rects[BENCH_RECTS];
+
+static uint32_t bench_rand( uint32_t *s )
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+
+    return *s;
+}
+
+static uint64_t bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* what the frame buffer replaces, one pixel at a time */
+static void bench_ref( OledFrameBuffer *fb, int op, const disp_area_t *a, bool on )
+{
+    disp_coord_t w = a->x2 - a->x1 + 1;
+
+    for( disp_coord_t y = a->y1; y <= a->y2; y++ )
+    {
+        for( disp_coord_t x = a->x1; x <= a->x2; x++ )
+        {
+            disp_coord_t sy = y - a->y1;
+            bool bit = ( bench_src[( sy >> 3 ) * w + x - a->x1] >> ( sy & 7 ) ) & 1;
+
+            switch( op )
+            {
+            case BENCH_FILL:
+                fb->set_pixel( x, y, on );
+                break;
+
+            case BENCH_COPY:
+                fb->set_pixel( x, y, bit );
+                break;
+
+            case BENCH_OR:
+                fb->set_pixel( x, y, fb->get_pixel( x, y ) | bit );
+                break;
+
+            case BENCH_CLR:
+                fb->set_pixel( x, y, fb->get_pixel( x, y ) & !bit );
+                break;
+
+            default:
+                fb->set_pixel( x, y, fb->get_pixel( x, y ) ^ bit );
+                break;
+            }
+        }
+    }
+}
+
+static void bench_op( OledFrameBuffer *fb, int op, const disp_area_t *a, bool on )
+{
+    if( op == BENCH_FILL ) {
+        fb->fill_area( a, on );
+    }
+    else {
+        fb->blit( a->x1, a->y1, bench_src, a->x2 - a->x1 + 1, a->y2 - a->y1 + 1,
+                  ( oled_blit_mode_t )( op - BENCH_COPY ) );
+    }
+}
+
+/* ns per pixel, best of BENCH_ROUNDS */
+static double bench_rate( OledFrameBuffer *fb, int op, bool ref, uint64_t pixels )
+{
+    uint64_t best = ~0ULL, done = 0;
+
+    for( int round = 0; round < BENCH_ROUNDS; round++ )
+    {
+        uint64_t t0 = bench_now_ns(), ns;
+
+        done = 0;
+
+        for( uint32_t i = 0; done < pixels; i++ )
+        {
+            const disp_area_t *a = &bench_rects[i % BENCH_RECTS];
+
+            if( ref ) {
+                bench_ref( fb, op, a, i & 1 );
+            }
+            else {
+                bench_op( fb, op, a, i & 1 );
+            }
+
+            done += ( uint32_t )( a->x2 - a->x1 + 1 ) * ( a->y2 - a->y1 + 1 );
+        }
+
+        ns = bench_now_ns() - t0;
+        best = ns < best ? ns : best;
+    }
+
+    return ( double )best / done;
+}
+
+static void bench_layout( bool aligned, int size )
+{
+    uint32_t seed = aligned ? 0xFB000A11 : 0xFB00F4EE;
+
+    for( int i = 0; i < BENCH_RECTS; i++ )
+    {
+        disp_area_t *a = &bench_rects[i];
+        int w = size / 2 + bench_rand( &seed ) % ( size / 2 + 1 );
+        int h = size / 2 + bench_rand( &seed ) % ( size / 2 + 1 );
+
+        if( aligned ) {
+            h = ( h + 7 ) & ~7;
+        }
+
+        w = w > BENCH_W ? BENCH_W : w;
+        h = h > BENCH_H ? BENCH_H : h;
+        a->x1 = bench_rand( &seed ) % ( BENCH_W - w + 1 );
+        a->y1 = bench_rand( &seed ) % ( BENCH_H - h + 1 );
+
+        if( aligned ) {
+            a->y1 &= ~7;
+        }
+
+        a->x2 = a->x1 + w - 1;
+        a->y2 = a->y1 + h - 1;
+    }
+}
+
+int main( int argc, char **argv )
+{
+    OledFrameBuffer fb( bench_buf, BENCH_W, BENCH_H );
+    uint32_t mpixels = 20, seed = 0x5EED0B17;
+    int size = 32, opt;
+
+    while( ( opt = getopt( argc, argv, "s:n:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 's':
+            size = atoi( optarg );
+            break;
+
+        case 'n':
+            mpixels = strtoul( optarg, NULL, 0 );
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-s size] [-n mpixels]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( size < 2 || size > BENCH_H || !mpixels ) {
+        fprintf( stderr, "size 2 ~ %d, at least one Mpixel\n", BENCH_H );
+        return 1;
+    }
+
+    for( size_t i = 0; i < sizeof( bench_src ); i++ ) {
+        bench_src[i] = ( uint8_t )bench_rand( &seed );
+    }
+
+    printf( "%u Mpixels per operation, rectangles of %d ~ %d px on %d x %d, word ops %d\n\n",
+            mpixels, size / 2, size, BENCH_W, BENCH_H, OLED_FB_WORD_OPS );
+    printf( "%-10s %-9s %9s %9s %8s\n", "op", "rows", "ns/px", "ref ns/px", "ratio" );
+
+    for( int aligned = 1; aligned >= 0; aligned-- )
+    {
+        bench_layout( aligned, size );
+
+        for( int op = 0; op < BENCH_OPS; op++ )
+        {
+            double fast = bench_rate( &fb, op, false, mpixels * 1000000ULL );
+            double ref = bench_rate( &fb, op, true, mpixels * 1000000ULL );
+
+            printf( "%-10s %-9s %9.3f %9.3f %7.1fx\n", bench_names[op],
+                    aligned ? "paged" : "any", fast, ref, ref / fast );
+        }
+    }
+
+    return 0;
+}
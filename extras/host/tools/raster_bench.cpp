@@ -0,0 +1,223 @@
+/**
+ * @file raster_bench.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Spans per shape and st7789v bus bytes of the span rasterizer.
+ *
+ * Random shapes of every kind are drawn through ST7789V::raster() into an
+ * St7789vModel. For each kind it prints the spans and pixels per shape,
+ * the command and data bytes the panel received, the bytes the same
+ * pixels cost when each is sent as a window of its own, as put_pixel()
+ * does, and the host time per shape. Half of the shapes hang over the
+ * screen edge, so clipping is part of the numbers.
+ *
+ *   g++ -std=gnu++11 -O2 -DST7789V_USE_SOFTWARE_SPI=0 \
+ *       -Iextras/host/arduino -Iextras/host -Isrc \
+ *       $(find src extras/host -maxdepth 1 -name '*.cpp') \
+ *       extras/host/tools/raster_bench.cpp -lrt -o raster_bench
+ *   ./raster_bench [-n shapes] [-s size]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "st7789v.h"
+#include "host_bus.h"
+
+#define BENCH_CS  10
+#define BENCH_DC  9
+#define BENCH_RST 8
+
+typedef struct
+{
+    uint32_t shapes;
+    uint32_t spans;
+    uint32_t pixels;
+    uint64_t bytes;             /* command and data bytes on the bus */
+    uint64_t ns;
+} bench_stats_t;
+
+enum
+{
+    BENCH_LINE,
+    BENCH_LINE_AA,
+    BENCH_CIRCLE,
+    BENCH_FILL_CIRCLE,
+    BENCH_ARC,
+    BENCH_ROUND_RECT,
+    BENCH_FILL_ROUND_RECT,
+    BENCH_POLYGON,
+    BENCH_KINDS
+};
+
+static const char *bench_names[BENCH_KINDS] = {
+    "line", "line aa", "circle", "fill circle", "arc",
+    "round rect", "fill rect", "polygon"
+};
+
+static St7789vModel bench_model;
+
+static uint32_t bench_rand( uint32_t *s )
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+
+    return *s;
+}
+
+static int bench_range( uint32_t *s, int lo, int hi )
+{
+    return lo + ( int )( bench_rand( s ) % ( uint32_t )( hi - lo + 1 ) );
+}
+
+static uint64_t bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t bench_bytes()
+{
+    return ( uint64_t )bench_model.stats()->cmd_bytes + bench_model.stats()->data_bytes;
+}
+
+static void bench_draw( disp_raster_t *r, int kind, uint32_t *seed, int size )
+{
+    int sw = ST7789V::m_st7789v_handle.width, sh = ST7789V::m_st7789v_handle.height;
+    int x = bench_range( seed, -size / 2, sw - size / 2 );
+    int y = bench_range( seed, -size / 2, sh - size / 2 );
+    int w = bench_range( seed, size / 4, size ), h = bench_range( seed, size / 4, size );
+    uint16_t color = ( uint16_t )bench_rand( seed );
+    disp_coord_t xy[12];
+
+    switch( kind )
+    {
+    case BENCH_LINE:
+        disp_draw_line( r, x, y, x + w - size / 2, y + h - size / 2, color );
+        break;
+
+    case BENCH_LINE_AA:
+        disp_draw_line_aa( r, x, y, x + w - size / 2, y + h - size / 2, color );
+        break;
+
+    case BENCH_CIRCLE:
+        disp_draw_circle( r, x, y, w / 2, color );
+        break;
+
+    case BENCH_FILL_CIRCLE:
+        disp_fill_circle( r, x, y, w / 2, color );
+        break;
+
+    case BENCH_ARC:
+        disp_draw_arc( r, x, y, w / 2, 1 + bench_rand( seed ) % DISP_QUAD_ALL, color );
+        break;
+
+    case BENCH_ROUND_RECT:
+        disp_draw_round_rect( r, x, y, w, h, size / 8, color );
+        break;
+
+    case BENCH_FILL_ROUND_RECT:
+        disp_fill_round_rect( r, x, y, w, h, size / 8, color );
+        break;
+
+    default:
+        for( int i = 0; i < 6; i++ ) {
+            xy[2 * i] = x + bench_range( seed, 0, size );
+            xy[2 * i + 1] = y + bench_range( seed, 0, size );
+        }
+
+        disp_fill_polygon( r, xy, 6, color );
+        break;
+    }
+}
+
+/* the window and two bytes of one pixel, as put_pixel() sends it */
+static uint32_t bench_pixel_bytes()
+{
+    uint64_t b0 = bench_bytes();
+
+    ST7789V::put_pixel( 1, 1, 0x1234 );
+    ST7789V::put_pixel( 2, 2, 0x4321 );
+
+    return ( uint32_t )( ( bench_bytes() - b0 ) / 2 );
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t shapes = 2000, size = 60, pixel_bytes;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "n:s:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'n':
+            shapes = strtoul( optarg, NULL, 0 );
+            break;
+
+        case 's':
+            size = strtoul( optarg, NULL, 0 );
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-n shapes] [-s size]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( !shapes || size < 8 ) {
+        fprintf( stderr, "need at least one shape of size 8 or more\n" );
+        return 1;
+    }
+
+    host_bus_attach_spi( &bench_model, BENCH_CS, BENCH_DC );
+    ST7789V tft( BENCH_CS, BENCH_DC, BENCH_RST );
+    tft.init( 240, 135 );
+
+    pixel_bytes = bench_pixel_bytes();
+
+    printf( "%u shapes per kind up to %u px on 240 x 135, %u bus bytes per lone pixel\n\n",
+            shapes, size, pixel_bytes );
+    printf( "%-12s %9s %9s %11s %11s %7s %9s\n", "shape", "spans", "pixels",
+            "bytes", "per pixel", "ratio", "us" );
+
+    for( int kind = 0; kind < BENCH_KINDS; kind++ )
+    {
+        uint16_t bg = 0x0000;
+        disp_raster_t r = ST7789V::raster( &bg );
+        uint32_t seed = 0xBE4C0000 + kind;
+        bench_stats_t s;
+        double n;
+
+        memset( &s, 0, sizeof( s ) );
+
+        for( uint32_t i = 0; i < shapes; i++ )
+        {
+            uint64_t b0 = bench_bytes(), t0 = bench_now_ns();
+
+            bench_draw( &r, kind, &seed, size );
+
+            s.ns += bench_now_ns() - t0;
+            s.bytes += bench_bytes() - b0;
+            s.shapes++;
+        }
+
+        s.spans = r.spans;
+        s.pixels = r.pixels;
+        n = s.shapes;
+
+        printf( "%-12s %9.1f %9.1f %11.1f %11.1f %6.1fx %9.2f\n", bench_names[kind],
+                s.spans / n, s.pixels / n, s.bytes / n, ( double )s.pixels * pixel_bytes / n,
+                s.bytes ? ( double )s.pixels * pixel_bytes / s.bytes : 0.0, s.ns / n / 1e3 );
+    }
+
+    return 0;
+}
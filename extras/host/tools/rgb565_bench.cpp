@@ -0,0 +1,173 @@
+/**
+ * @file rgb565_bench.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Mpixels/s of the word wide RGB565 kernels against their scalar
+ * references.
+ *
+ * Each kernel runs over a row buffer of one length, repeated until about
+ * the given number of pixels went through, once as rgb565_*() and once as
+ * the matching reference; the color blends have none of their own, so
+ * their reference fills a source row first. The references are plain C
+ * and the host compiler may vectorize them, so on a desktop the ratio is
+ * a lower bound of what the word tricks buy on a 32 bit MCU without SIMD.
+ *
+ *   g++ -std=gnu++11 -O2 -Isrc src/rgb565.cpp \
+ *       extras/host/tools/rgb565_bench.cpp -lrt -o rgb565_bench
+ *   ./rgb565_bench [-l length] [-n mpixels]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rgb565.h"
+
+#define BENCH_MAX_LEN 4096
+
+enum
+{
+    BENCH_FILL,
+    BENCH_GRADIENT,
+    BENCH_BLEND,
+    BENCH_BLEND_COLOR,
+    BENCH_MIX,
+    BENCH_MIX_COLOR,
+    BENCH_SWAP,
+    BENCH_KERNELS
+};
+
+static const char *bench_names[BENCH_KERNELS] = {
+    "fill", "gradient", "blend", "blend_color", "mix", "mix_color", "swap"
+};
+
+static uint16_t bench_dst[BENCH_MAX_LEN];
+static uint16_t bench_src[BENCH_MAX_LEN];
+
+static uint64_t bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_kernel( int kernel, bool ref, uint16_t *dst, size_t n, uint32_t i )
+{
+    uint16_t c0 = ( uint16_t )( i * 0x9E37 ), c1 = ( uint16_t )~c0;
+    uint8_t alpha = ( uint8_t )( 1 + i % 253 );
+
+    switch( kernel )
+    {
+    case BENCH_FILL:
+        ref ? rgb565_fill_ref( dst, c0, n ) : rgb565_fill( dst, c0, n );
+        break;
+
+    case BENCH_GRADIENT:
+        ref ? rgb565_gradient_ref( dst, c0, c1, n ) : rgb565_gradient( dst, c0, c1, n );
+        break;
+
+    case BENCH_BLEND:
+        ref ? rgb565_blend_ref( dst, bench_src, n, alpha ) : rgb565_blend( dst, bench_src, n, alpha );
+        break;
+
+    case BENCH_BLEND_COLOR:
+        if( ref ) {
+            rgb565_fill_ref( bench_src, c0, n );
+            rgb565_blend_ref( dst, bench_src, n, alpha );
+        }
+        else {
+            rgb565_blend_color( dst, c0, n, alpha );
+        }
+        break;
+
+    case BENCH_MIX:
+        ref ? rgb565_mix_ref( dst, bench_src, n, alpha ) : rgb565_mix( dst, bench_src, n, alpha );
+        break;
+
+    case BENCH_MIX_COLOR:
+        if( ref ) {
+            rgb565_fill_ref( bench_src, c0, n );
+            rgb565_mix_ref( dst, bench_src, n, alpha );
+        }
+        else {
+            rgb565_mix_color( dst, c0, n, alpha );
+        }
+        break;
+
+    default:
+        ref ? rgb565_swap_ref( dst, bench_src, n ) : rgb565_swap( dst, bench_src, n );
+        break;
+    }
+}
+
+/* Mpixels/s */
+static double bench_rate( int kernel, bool ref, size_t len, uint64_t pixels )
+{
+    uint32_t rounds = ( uint32_t )( pixels / len ) + 1;
+    volatile uint16_t sink;
+    uint64_t t0;
+
+    for( size_t i = 0; i < len; i++ ) {
+        bench_src[i] = ( uint16_t )( i * 0x2F1B );
+    }
+
+    t0 = bench_now_ns();
+
+    for( uint32_t i = 0; i < rounds; i++ ) {
+        /* odd offset every other round, the kernels' unaligned heads */
+        bench_kernel( kernel, ref, bench_dst + ( i & 1 ), len - ( i & 1 ), i );
+    }
+
+    sink = bench_dst[len / 2];
+    ( void )sink;
+
+    return ( double )rounds * len / ( ( bench_now_ns() - t0 ) / 1e3 );
+}
+
+int main( int argc, char **argv )
+{
+    size_t len = 240;
+    uint32_t mpixels = 50;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "l:n:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'l':
+            len = strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'n':
+            mpixels = strtoul( optarg, NULL, 0 );
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-l length] [-n mpixels]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( len < 2 || len > BENCH_MAX_LEN || !mpixels ) {
+        fprintf( stderr, "length 2 ~ %u, at least one Mpixel\n", BENCH_MAX_LEN );
+        return 1;
+    }
+
+    printf( "%u Mpixels per kernel in spans of %u\n\n", mpixels, ( unsigned )len );
+    printf( "%-12s %10s %10s %7s\n", "kernel", "Mpx/s", "ref Mpx/s", "ratio" );
+
+    for( int k = 0; k < BENCH_KERNELS; k++ )
+    {
+        double fast = bench_rate( k, false, len, mpixels * 1000000ULL );
+        double ref = bench_rate( k, true, len, mpixels * 1000000ULL );
+
+        printf( "%-12s %10.1f %10.1f %6.2fx\n", bench_names[k], fast, ref, fast / ref );
+    }
+
+    return 0;
+}
@@ -0,0 +1,256 @@
+/**
+ * @file sched_sim.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Latency of a second SPI device while the st7789v streams frames
+ * through a SpiScheduler.
+ *
+ * The panel and an MCP3008 style ADC model share the host bus. Full
+ * screen fills run as scheduler jobs of one chunk size while the ADC
+ * asks for a conversion every period, each request a higher priority job.
+ * All times are bus times of the host core, 8 bits per byte at the clock
+ * of the transaction plus a fixed cost per transaction, so the numbers
+ * stand for the wire and not for this machine.
+ *
+ * For every chunk size it prints how long ADC requests waited from their
+ * arrival to the end of their conversion, average and worst, requests
+ * that found the previous one still waiting, and the display throughput
+ * against the same frames sent blocking, in one transaction each. The
+ * loss is what the extra transactions and windows cost the panel, the
+ * ADC's own bus time is not counted against it.
+ *
+ *   g++ -std=gnu++11 -O2 -DST7789V_USE_SOFTWARE_SPI=0 \
+ *       -Iextras/host/arduino -Iextras/host -Isrc \
+ *       $(find src extras/host -maxdepth 1 -name '*.cpp') \
+ *       extras/host/tools/sched_sim.cpp -lrt -o sched_sim
+ *   ./sched_sim [-c display_hz] [-a adc_hz] [-p period_us] [-o overhead_ns]
+ *               [-n frames] [chunk ...]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "st7789v.h"
+#include "spi_scheduler.h"
+#include "spi_adc_model.h"
+#include "host_bus.h"
+
+#define SIM_CS     10
+#define SIM_DC     9
+#define SIM_RST    8
+#define SIM_ADC_CS 7
+
+typedef struct
+{
+    spi_job_t job;
+    bool busy;
+    uint64_t arrival;           /* bus time of the request */
+} sim_adc_job_t;
+
+typedef struct
+{
+    uint32_t requests;
+    uint32_t overruns;          /* arrived while the previous one waited */
+    uint64_t wait;              /* summed, ns */
+    uint64_t worst;
+    uint64_t display_ns;        /* bus time of the panel's steps */
+    uint32_t steps;
+    uint32_t preemptions;
+} sim_result_t;
+
+static St7789vModel sim_model;
+static SpiAdcModel sim_adc;
+static spi_device_t sim_adc_device = { SPISettings( 1000000UL, MSBFIRST, SPI_MODE0 ), NULL, NULL, NULL };
+
+// ADC //////////////////////////////////////////////////////////////////////////
+static bool sim_adc_step( void *ctx, uint16_t budget )
+{
+    ( void )ctx;
+    ( void )budget;
+
+    digitalWrite( SIM_ADC_CS, LOW );
+    SPI.transfer( 0x01 );
+    SPI.transfer( 0x80 );
+    SPI.transfer( 0x00 );
+    digitalWrite( SIM_ADC_CS, HIGH );
+
+    return true;
+}
+
+static void sim_adc_done( void *ctx )
+{
+    ( ( sim_adc_job_t * )ctx )->busy = false;
+}
+
+// Simulation ///////////////////////////////////////////////////////////////////
+
+/* frames sent blocking, bus ns */
+static uint64_t sim_blocking( uint32_t frames )
+{
+    uint64_t t0 = host_bus_spi_time_ns();
+
+    for( uint32_t f = 0; f < frames; f++ ) {
+        ST7789V::clear_screen_directly( ( uint16_t )( f * 0x0841 ) );
+    }
+
+    return host_bus_spi_time_ns() - t0;
+}
+
+static void sim_run( uint16_t chunk, uint32_t frames, uint64_t period, sim_result_t *r )
+{
+    SpiScheduler sched;
+    sim_adc_job_t adc;
+    uint64_t next = period;
+
+    memset( r, 0, sizeof( *r ) );
+    memset( &adc, 0, sizeof( adc ) );
+    adc.job.device = &sim_adc_device;
+    adc.job.step = sim_adc_step;
+    adc.job.done = sim_adc_done;
+    adc.job.ctx = &adc;
+    adc.job.priority = 1;
+    adc.job.chunk = 3;
+
+    /* requests are timed from the start of this run */
+    next += host_bus_spi_time_ns();
+
+    for( uint32_t f = 0; f < frames; f++ )
+    {
+        st7789v_stream_job_t fill;
+
+        ST7789V::clear_job( &fill, ( uint16_t )( f * 0x0841 ), chunk );
+        sched.submit( &fill.job );
+
+        while( sched.busy() )
+        {
+            uint64_t t0 = host_bus_spi_time_ns();
+            uint32_t conversions = sim_adc.stats()->conversions;
+
+            while( next <= t0 )
+            {
+                if( adc.busy ) {
+                    r->overruns++;
+                }
+                else {
+                    adc.busy = true;
+                    adc.arrival = next;
+                    sched.submit( &adc.job );
+                    r->requests++;
+                }
+
+                next += period;
+            }
+
+            sched.poll();
+
+            if( sim_adc.stats()->conversions != conversions )
+            {
+                uint64_t waited = sim_adc.stats()->last_ns - adc.arrival;
+
+                r->wait += waited;
+
+                if( waited > r->worst ) {
+                    r->worst = waited;
+                }
+            }
+            else {
+                r->display_ns += host_bus_spi_time_ns() - t0;
+            }
+        }
+    }
+
+    r->steps = sched.stats()->steps;
+    r->preemptions = sched.stats()->preemptions;
+}
+
+int main( int argc, char **argv )
+{
+    uint16_t chunks[16] = { 64, 256, 1024, 4096, 16384 };
+    int count = 5;
+    uint32_t display_hz = ST7789V_SPI_SPEED, adc_hz = 1000000UL;
+    uint32_t period_us = 1000, overhead_ns = 2000, frames = 20;
+    uint64_t blocking;
+    uint32_t pixels;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "c:a:p:o:n:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'c':
+            display_hz = strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'a':
+            adc_hz = strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'p':
+            period_us = strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'o':
+            overhead_ns = strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'n':
+            frames = strtoul( optarg, NULL, 0 );
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-c display_hz] [-a adc_hz] [-p period_us] [-o overhead_ns] "
+                     "[-n frames] [chunk ...]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( optind < argc )
+    {
+        for( count = 0; optind < argc && count < 16; count++ ) {
+            chunks[count] = ( uint16_t )strtoul( argv[optind++], NULL, 0 );
+        }
+    }
+
+    if( !display_hz || !adc_hz || !period_us || !frames ) {
+        fprintf( stderr, "clocks, period and frames must not be 0\n" );
+        return 1;
+    }
+
+    host_bus_attach_spi( &sim_model, SIM_CS, SIM_DC );
+    host_bus_attach_spi_device( &sim_adc, SIM_ADC_CS );
+
+    ST7789V tft( SIM_CS, SIM_DC, SIM_RST );
+    tft.init( 240, 135 );
+
+    ST7789V::m_st7789v_handle.spi_speed = display_hz;
+    sim_adc_device.settings.clock = adc_hz;
+    host_bus_spi_overhead( overhead_ns );
+
+    pixels = ( uint32_t )ST7789V::m_st7789v_handle.width * ST7789V::m_st7789v_handle.height * frames;
+    blocking = sim_blocking( frames );
+
+    printf( "%u frames of %u x %u at %.1f MHz, ADC at %.2f MHz every %u us, %u ns per transaction\n",
+            frames, ST7789V::m_st7789v_handle.width, ST7789V::m_st7789v_handle.height,
+            display_hz / 1e6, adc_hz / 1e6, period_us, overhead_ns );
+    printf( "blocking: %.3f Mpx/s\n\n", pixels / ( blocking / 1e3 ) );
+    printf( "%6s %7s %6s %9s %9s %8s %9s %6s\n", "chunk", "steps", "preem",
+            "avg us", "worst us", "overrun", "Mpx/s", "loss" );
+
+    for( int i = 0; i < count; i++ )
+    {
+        sim_result_t r;
+        double rate;
+
+        sim_run( chunks[i], frames, ( uint64_t )period_us * 1000, &r );
+        rate = pixels / ( r.display_ns / 1e3 );
+
+        printf( "%6u %7u %6u %9.1f %9.1f %8u %9.3f %5.1f%%\n", chunks[i], r.steps, r.preemptions,
+                r.requests ? r.wait / ( double )r.requests / 1e3 : 0.0, r.worst / 1e3, r.overruns,
+                rate, 100.0 * ( 1.0 - rate / ( pixels / ( blocking / 1e3 ) ) ) );
+    }
+
+    return 0;
+}
@@ -0,0 +1,485 @@
+/**
+ * @file trace_replay.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Replay bus traces through the controller models, frame by frame.
+ *
+ * With one trace it prints what every frame cost on the bus. With two,
+ * e.g. before and after a driver change, they are replayed side by side
+ * and frames that got more expensive or render differently are marked.
+ *
+ *   g++ -std=gnu++11 -O2 -Iextras/host -Isrc extras/host/tools/trace_replay.cpp \
+ *       extras/host/bus_trace.cpp extras/host/st7789v_model.cpp \
+ *       extras/host/ssd1306_model.cpp -o trace_replay
+ *   ./trace_replay [-o dir] [-m] before.trace [after.trace]
+ *
+ * -o writes every frame a panel took part in as dir/<tag>st7789v_NNNN.ppm
+ * or dir/<tag>ssd1306_NNNN.ppm, tag being a_ or b_ when diffing. -m adds
+ * a <tag>st7789v_heat_NNNN.ppm / <tag>ssd1306_heat_NNNN.ppm next to each,
+ * pixels written once are green, twice yellow, three times orange, more
+ * red, and one written but left as it was when the frame began is blue.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bus_trace.h"
+#include "st7789v_model.h"
+#include "ssd1306_model.h"
+
+/* a frame costing this many percent more bytes is flagged */
+#define REPLAY_WORSE_PCT 5
+
+typedef struct
+{
+    FILE *fp;
+    BusTraceReader *reader;
+    St7789vModel *lcd;
+    Ssd1306Model *oled;
+    const char *tag;
+    bool done;
+
+    /* GRAM as the frame began, for the heatmaps */
+    uint16_t *lcd_prev;
+    uint8_t *oled_prev;
+
+    /* of the frame just replayed */
+    st7789v_model_stats_t lcd_stats;
+    ssd1306_model_stats_t oled_stats;
+
+    /* whole trace */
+    uint64_t lcd_bytes, oled_bytes;
+    uint64_t lcd_pixels, lcd_unique, lcd_noop;
+    uint64_t oled_data, oled_unique, oled_noop;
+    uint32_t frames;
+} replay_t;
+
+static const char *replay_dir;
+static bool replay_heat;
+
+static void replay_heat_rgb( FILE *fp, uint8_t writes, bool noop )
+{
+    static const uint8_t heat[5][3] =
+    {
+        { 0x00, 0x00, 0x00 },
+        { 0x00, 0xA0, 0x00 },
+        { 0xFF, 0xE0, 0x00 },
+        { 0xFF, 0x80, 0x00 },
+        { 0xFF, 0x00, 0x00 },
+    };
+    const uint8_t *c = heat[writes > 4 ? 4 : writes];
+
+    if( writes && noop ) {
+        fputc( 0x20, fp );
+        fputc( 0x40, fp );
+        fputc( 0xFF, fp );
+        return;
+    }
+
+    fputc( c[0], fp );
+    fputc( c[1], fp );
+    fputc( c[2], fp );
+}
+
+static bool replay_open( replay_t *r, const char *path, const char *tag )
+{
+    memset( r, 0, sizeof( *r ) );
+
+    r->fp = fopen( path, "r" );
+
+    if( !r->fp ) {
+        perror( path );
+        return false;
+    }
+
+    r->reader = new BusTraceReader( r->fp );
+    r->lcd = new St7789vModel();
+    r->oled = new Ssd1306Model();
+    r->tag = tag;
+    r->lcd_prev = new uint16_t[ST7789V_MODEL_WIDTH * ST7789V_MODEL_HEIGHT];
+    r->oled_prev = new uint8_t[r->oled->width() * r->oled->height() / 8];
+
+    return true;
+}
+
+static void replay_close( replay_t *r )
+{
+    if( r->fp ) {
+        fclose( r->fp );
+    }
+
+    delete r->reader;
+    delete r->lcd;
+    delete r->oled;
+    delete[] r->lcd_prev;
+    delete[] r->oled_prev;
+}
+
+static void replay_save( const replay_t *r )
+{
+    char path[512];
+    FILE *fp;
+    int x, y;
+
+    if( !replay_dir ) {
+        return;
+    }
+
+    if( r->lcd_stats.cmd_bytes + r->lcd_stats.data_bytes )
+    {
+        snprintf( path, sizeof( path ), "%s/%sst7789v_%04u.ppm", replay_dir, r->tag, r->frames );
+
+        if( ( fp = fopen( path, "wb" ) ) != NULL )
+        {
+            fprintf( fp, "P6\n%d %d\n255\n", ST7789V_MODEL_WIDTH, ST7789V_MODEL_HEIGHT );
+
+            for( y = 0; y < ST7789V_MODEL_HEIGHT; y++ )
+            {
+                for( x = 0; x < ST7789V_MODEL_WIDTH; x++ )
+                {
+                    uint16_t c = r->lcd->pixel( x, y );
+
+                    fputc( ( c >> 11 ) << 3, fp );
+                    fputc( ( ( c >> 5 ) & 0x3F ) << 2, fp );
+                    fputc( ( c & 0x1F ) << 3, fp );
+                }
+            }
+
+            fclose( fp );
+        }
+
+        snprintf( path, sizeof( path ), "%s/%sst7789v_heat_%04u.ppm", replay_dir, r->tag, r->frames );
+
+        if( replay_heat && ( fp = fopen( path, "wb" ) ) != NULL )
+        {
+            fprintf( fp, "P6\n%d %d\n255\n", ST7789V_MODEL_WIDTH, ST7789V_MODEL_HEIGHT );
+
+            for( y = 0; y < ST7789V_MODEL_HEIGHT; y++ )
+            {
+                for( x = 0; x < ST7789V_MODEL_WIDTH; x++ )
+                {
+                    uint32_t i = ( uint32_t )y * ST7789V_MODEL_WIDTH + x;
+
+                    replay_heat_rgb( fp, r->lcd->writes( x, y ), r->lcd_prev[i] == r->lcd->gram()[i] );
+                }
+            }
+
+            fclose( fp );
+        }
+    }
+
+    if( r->oled_stats.cmd_bytes + r->oled_stats.data_bytes )
+    {
+        snprintf( path, sizeof( path ), "%s/%sssd1306_%04u.ppm", replay_dir, r->tag, r->frames );
+
+        if( ( fp = fopen( path, "wb" ) ) != NULL )
+        {
+            fprintf( fp, "P6\n%d %d\n255\n", r->oled->width(), r->oled->height() );
+
+            for( y = 0; y < r->oled->height(); y++ )
+            {
+                for( x = 0; x < r->oled->width(); x++ )
+                {
+                    uint8_t v = r->oled->pixel( x, y ) ? 0xFF : 0x00;
+
+                    fputc( v, fp );
+                    fputc( v, fp );
+                    fputc( v, fp );
+                }
+            }
+
+            fclose( fp );
+        }
+
+        snprintf( path, sizeof( path ), "%s/%sssd1306_heat_%04u.ppm", replay_dir, r->tag, r->frames );
+
+        /* one GRAM byte covers 8 rows, they share its count */
+        if( replay_heat && ( fp = fopen( path, "wb" ) ) != NULL )
+        {
+            fprintf( fp, "P6\n%d %d\n255\n", r->oled->width(), r->oled->height() );
+
+            for( y = 0; y < r->oled->height(); y++ )
+            {
+                for( x = 0; x < r->oled->width(); x++ )
+                {
+                    uint16_t i = ( y >> 3 ) * r->oled->width() + x;
+
+                    replay_heat_rgb( fp, r->oled->writes( x, y >> 3 ), r->oled_prev[i] == r->oled->gram()[i] );
+                }
+            }
+
+            fclose( fp );
+        }
+    }
+}
+
+/**
+ * @brief Feed records up to the next frame mark.
+ *
+ * @return false once the trace is exhausted
+ */
+static bool replay_frame( replay_t *r )
+{
+    bus_trace_rec_t rec;
+    bool any = false;
+    uint16_t i;
+
+    if( r->done ) {
+        return false;
+    }
+
+    r->lcd->reset_stats();
+    r->oled->reset_stats();
+
+    if( replay_heat ) {
+        memcpy( r->lcd_prev, r->lcd->gram(), ST7789V_MODEL_WIDTH * ST7789V_MODEL_HEIGHT * sizeof( uint16_t ) );
+        memcpy( r->oled_prev, r->oled->gram(), r->oled->width() * r->oled->height() / 8 );
+    }
+
+    while( !( r->done = !r->reader->next( &rec ) ) )
+    {
+        any = true;
+
+        if( rec.kind == BUS_TRACE_FRAME ) {
+            break;
+        }
+
+        switch( rec.kind )
+        {
+        case BUS_TRACE_CMD:
+        case BUS_TRACE_DATA:
+            for( i = 0; i < rec.len; i++ ) {
+                r->lcd->transfer( rec.kind == BUS_TRACE_DATA, rec.bytes[i] );
+            }
+            break;
+
+        case BUS_TRACE_DESELECT:
+            r->lcd->deselect();
+            break;
+
+        case BUS_TRACE_I2C:
+            if( rec.len > 1 ) {
+                r->oled->i2c_write( rec.bytes + 1, rec.len - 1 );
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if( !any ) {
+        return false;
+    }
+
+    r->lcd_stats = *r->lcd->stats();
+    r->oled_stats = *r->oled->stats();
+    r->lcd_bytes += r->lcd_stats.cmd_bytes + r->lcd_stats.data_bytes;
+    r->oled_bytes += r->oled_stats.cmd_bytes + r->oled_stats.data_bytes;
+    r->lcd_pixels += r->lcd_stats.pixels;
+    r->lcd_unique += r->lcd_stats.unique_pixels;
+    r->lcd_noop += r->lcd_stats.noop_pixels;
+    r->oled_data += r->oled_stats.data_bytes;
+    r->oled_unique += r->oled_stats.unique_bytes;
+    r->oled_noop += r->oled_stats.noop_bytes;
+    r->frames++;
+
+    replay_save( r );
+
+    return true;
+}
+
+static double replay_ratio( uint32_t n, uint32_t unique )
+{
+    return unique ? ( double )n / unique : 0.0;
+}
+
+static void replay_print_one( const replay_t *r )
+{
+    const st7789v_model_stats_t *l = &r->lcd_stats;
+    const ssd1306_model_stats_t *o = &r->oled_stats;
+
+    if( l->cmd_bytes + l->data_bytes ) {
+        printf( "%6u  st7789v %8u %9u %6u %7u %9u %9u %8.2f %9u\n", r->frames,
+                l->cmd_bytes, l->data_bytes, l->window_sets, l->redundant_windows,
+                l->pixels, l->unique_pixels, replay_ratio( l->pixels, l->unique_pixels ),
+                l->noop_pixels * 2 );
+    }
+
+    if( o->cmd_bytes + o->data_bytes ) {
+        printf( "%6u  ssd1306 %8u %9u %6u %7u %9u %9u %8.2f %9u\n", r->frames,
+                o->cmd_bytes, o->data_bytes, o->window_sets, o->redundant_windows,
+                o->data_bytes, o->unique_bytes, replay_ratio( o->data_bytes, o->unique_bytes ),
+                o->noop_bytes );
+    }
+}
+
+/* pixels that differ between the two replays right now */
+static uint32_t replay_lcd_diff( const replay_t *a, const replay_t *b )
+{
+    uint32_t i, n = 0;
+
+    for( i = 0; i < ST7789V_MODEL_WIDTH * ST7789V_MODEL_HEIGHT; i++ ) {
+        n += a->lcd->gram()[i] != b->lcd->gram()[i];
+    }
+
+    return n;
+}
+
+static uint32_t replay_oled_diff( const replay_t *a, const replay_t *b )
+{
+    uint32_t i, n = 0;
+
+    for( i = 0; i < ( uint32_t )a->oled->width() * a->oled->height() / 8; i++ ) {
+        n += __builtin_popcount( a->oled->gram()[i] ^ b->oled->gram()[i] );
+    }
+
+    return n;
+}
+
+static void replay_print_diff( const char *dev, uint32_t frame,
+                               uint32_t bytes_a, uint32_t bytes_b,
+                               double over_a, double over_b, uint32_t diff )
+{
+    double pct = bytes_a ? 100.0 * ( ( double )bytes_b - bytes_a ) / bytes_a : 0.0;
+    bool worse = ( bytes_a ? pct > REPLAY_WORSE_PCT : bytes_b > 0 ) || over_b > over_a + 0.05;
+
+    if( !bytes_a && !bytes_b ) {
+        return;
+    }
+
+    printf( "%6u  %s %9u %9u %+8.1f%% %8.2f %8.2f %8u %s\n", frame, dev,
+            bytes_a, bytes_b, pct, over_a, over_b, diff,
+            worse ? "<< slower" : diff ? "<< differs" : "" );
+}
+
+/* overdraw is writes per distinct pixel, summed over frames */
+static void replay_summary( const char *dev, uint64_t bytes, uint64_t writes,
+                            uint64_t unique, uint64_t noop, uint8_t bytes_per_write )
+{
+    if( !bytes ) {
+        return;
+    }
+
+    printf( "%s: %llu bus bytes, overdraw %.2f, %llu no-op bytes (%.1f%% of GRAM writes)\n",
+            dev, ( unsigned long long )bytes, unique ? ( double )writes / unique : 0.0,
+            ( unsigned long long )( noop * bytes_per_write ), writes ? 100.0 * noop / writes : 0.0 );
+}
+
+static int replay_single( const char *path )
+{
+    replay_t r;
+
+    if( !replay_open( &r, path, "" ) ) {
+        return 1;
+    }
+
+    printf( " frame  device       cmd      data    win  redund    pixels    unique overdraw noop byte\n" );
+
+    while( replay_frame( &r ) ) {
+        replay_print_one( &r );
+    }
+
+    printf( "%u frames\n", r.frames );
+    replay_summary( "st7789v", r.lcd_bytes, r.lcd_pixels, r.lcd_unique, r.lcd_noop, 2 );
+    replay_summary( "ssd1306", r.oled_bytes, r.oled_data, r.oled_unique, r.oled_noop, 1 );
+
+    replay_close( &r );
+
+    return 0;
+}
+
+static int replay_diff( const char *path_a, const char *path_b )
+{
+    replay_t a, b;
+
+    if( !replay_open( &a, path_a, "a_" ) || !replay_open( &b, path_b, "b_" ) ) {
+        return 1;
+    }
+
+    printf( " frame  device     bytes a   bytes b    delta   over a   over b  px diff\n" );
+
+    for( ;; )
+    {
+        bool more_a = replay_frame( &a ), more_b = replay_frame( &b );
+
+        if( !more_a && !more_b ) {
+            break;
+        }
+
+        /* the shorter trace keeps its last image and counts as idle */
+        if( !more_a ) {
+            memset( &a.lcd_stats, 0, sizeof( a.lcd_stats ) );
+            memset( &a.oled_stats, 0, sizeof( a.oled_stats ) );
+        }
+
+        if( !more_b ) {
+            memset( &b.lcd_stats, 0, sizeof( b.lcd_stats ) );
+            memset( &b.oled_stats, 0, sizeof( b.oled_stats ) );
+        }
+
+        replay_print_diff( "st7789v", more_a ? a.frames : b.frames,
+                           a.lcd_stats.cmd_bytes + a.lcd_stats.data_bytes,
+                           b.lcd_stats.cmd_bytes + b.lcd_stats.data_bytes,
+                           replay_ratio( a.lcd_stats.pixels, a.lcd_stats.unique_pixels ),
+                           replay_ratio( b.lcd_stats.pixels, b.lcd_stats.unique_pixels ),
+                           replay_lcd_diff( &a, &b ) );
+
+        replay_print_diff( "ssd1306", more_a ? a.frames : b.frames,
+                           a.oled_stats.cmd_bytes + a.oled_stats.data_bytes,
+                           b.oled_stats.cmd_bytes + b.oled_stats.data_bytes,
+                           replay_ratio( a.oled_stats.data_bytes, a.oled_stats.unique_bytes ),
+                           replay_ratio( b.oled_stats.data_bytes, b.oled_stats.unique_bytes ),
+                           replay_oled_diff( &a, &b ) );
+    }
+
+    printf( "a: %u frames\n", a.frames );
+    replay_summary( "st7789v", a.lcd_bytes, a.lcd_pixels, a.lcd_unique, a.lcd_noop, 2 );
+    replay_summary( "ssd1306", a.oled_bytes, a.oled_data, a.oled_unique, a.oled_noop, 1 );
+    printf( "b: %u frames\n", b.frames );
+    replay_summary( "st7789v", b.lcd_bytes, b.lcd_pixels, b.lcd_unique, b.lcd_noop, 2 );
+    replay_summary( "ssd1306", b.oled_bytes, b.oled_data, b.oled_unique, b.oled_noop, 1 );
+
+    replay_close( &a );
+    replay_close( &b );
+
+    return 0;
+}
+
+int main( int argc, char **argv )
+{
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "o:m" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'o':
+            replay_dir = optarg;
+            break;
+
+        case 'm':
+            replay_heat = true;
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-o dir] [-m] a.trace [b.trace]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( optind == argc - 1 ) {
+        return replay_single( argv[optind] );
+    }
+
+    if( optind == argc - 2 ) {
+        return replay_diff( argv[optind], argv[optind + 1] );
+    }
+
+    fprintf( stderr, "usage: %s [-o dir] [-m] a.trace [b.trace]\n", argv[0] );
+
+    return 1;
+}
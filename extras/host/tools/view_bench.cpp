@@ -0,0 +1,186 @@
+/**
+ * @file view_bench.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Cost per pixel of put_pixel<VIEW>() against the runtime put_pixel().
+ *
+ * The same random pixels, a tenth of them off screen, are drawn with
+ *
+ *   view     put_pixel<VIEW>() of the default rotation, bounds and window
+ *            offsets are constants and the clip stack is not looked at
+ *   runtime  put_pixel() with nothing pushed
+ *   nested   put_pixel() with the clip stack full of screen sized
+ *            viewports, which costs the same as one
+ *
+ * once with nothing attached to the bus, so the time goes to the driver,
+ * and once into an St7789vModel, which adds the host SPI stand-in and
+ * counts the bytes. Each time is the best of a few rounds. Both sides
+ * send the same window and color, so the bytes must match.
+ *
+ *   g++ -std=gnu++11 -O2 -DST7789V_USE_SOFTWARE_SPI=0 \
+ *       -Iextras/host/arduino -Iextras/host -Isrc \
+ *       $(find src extras/host -maxdepth 1 -name '*.cpp') \
+ *       extras/host/tools/view_bench.cpp -lrt -o view_bench
+ *   ./view_bench [-n pixels]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "st7789v.h"
+#include "host_bus.h"
+
+#define BENCH_CS  10
+#define BENCH_DC  9
+#define BENCH_RST 8
+
+#define BENCH_ROUNDS 5
+#define BENCH_POINTS 4096
+
+typedef st7789v_view<st7789v_default_panel_t, ST7789V_DEFAULT_ROTATION> bench_view_t;
+
+enum
+{
+    BENCH_VIEW,
+    BENCH_RUNTIME,
+    BENCH_NESTED,
+    BENCH_PATHS
+};
+
+static const char *bench_names[BENCH_PATHS] = { "view", "runtime", "nested" };
+
+static St7789vModel bench_model;
+static uint16_t bench_xy[BENCH_POINTS][2];
+
+static uint32_t bench_rand( uint32_t *s )
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+
+    return *s;
+}
+
+static uint64_t bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t bench_bytes()
+{
+    return ( uint64_t )bench_model.stats()->cmd_bytes + bench_model.stats()->data_bytes;
+}
+
+/* ns per pixel, best of BENCH_ROUNDS */
+static double bench_run( int path, uint32_t pixels, uint64_t *bytes )
+{
+    uint64_t best = ~0ULL;
+    int pushed = 0;
+
+    if( path == BENCH_NESTED )
+    {
+        while( ST7789V::push_viewport( 0, 0, bench_view_t::width, bench_view_t::height ) ) {
+            pushed++;
+        }
+    }
+
+    for( int round = 0; round < BENCH_ROUNDS; round++ )
+    {
+        uint64_t b0 = bench_bytes(), t0 = bench_now_ns(), ns;
+
+        for( uint32_t i = 0; i < pixels; i++ )
+        {
+            const uint16_t *p = bench_xy[i % BENCH_POINTS];
+            uint16_t color = ( uint16_t )i;
+
+            if( path == BENCH_VIEW ) {
+                ST7789V::put_pixel<bench_view_t>( p[0], p[1], color );
+            }
+            else {
+                ST7789V::put_pixel( p[0], p[1], color );
+            }
+        }
+
+        ns = bench_now_ns() - t0;
+        best = ns < best ? ns : best;
+        *bytes = bench_bytes() - b0;
+    }
+
+    while( pushed-- ) {
+        ST7789V::pop_clip();
+    }
+
+    return ( double )best / pixels;
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t pixels = 1000000, seed = 0x5E1F0000;
+    double ns[2][BENCH_PATHS];
+    uint64_t bytes[BENCH_PATHS];
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "n:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'n':
+            pixels = strtoul( optarg, NULL, 0 );
+            break;
+
+        default:
+            fprintf( stderr, "usage: %s [-n pixels]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( !pixels ) {
+        fprintf( stderr, "need at least one pixel\n" );
+        return 1;
+    }
+
+    for( int i = 0; i < BENCH_POINTS; i++ )
+    {
+        /* about one in ten lands past the right or bottom edge */
+        bench_xy[i][0] = bench_rand( &seed ) % ( bench_view_t::width + bench_view_t::width / 20 );
+        bench_xy[i][1] = bench_rand( &seed ) % ( bench_view_t::height + bench_view_t::height / 20 );
+    }
+
+    ST7789V tft( BENCH_CS, BENCH_DC, BENCH_RST );
+
+    host_bus_attach_spi( &bench_model, BENCH_CS, BENCH_DC );
+    tft.init( bench_view_t::width, bench_view_t::height );
+
+    for( int path = 0; path < BENCH_PATHS; path++ ) {
+        ns[1][path] = bench_run( path, pixels, &bytes[path] );
+    }
+
+    host_bus_attach_spi( NULL, BENCH_CS, BENCH_DC );
+
+    for( int path = 0; path < BENCH_PATHS; path++ )
+    {
+        uint64_t none;
+
+        ns[0][path] = bench_run( path, pixels, &none );
+    }
+
+    printf( "%u pixels per path on %u x %u, rotation %u\n\n", pixels, bench_view_t::width,
+            bench_view_t::height, bench_view_t::rotation );
+    printf( "%-8s %12s %12s %10s %10s\n", "path", "driver ns", "model ns", "bytes/px", "vs view" );
+
+    for( int path = 0; path < BENCH_PATHS; path++ )
+    {
+        printf( "%-8s %12.2f %12.2f %10.2f %9.2fx\n", bench_names[path], ns[0][path], ns[1][path],
+                ( double )bytes[path] / pixels, ns[0][path] / ns[0][BENCH_VIEW] );
+    }
+
+    return 0;
+}
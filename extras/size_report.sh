@@ -0,0 +1,57 @@
+#!/bin/sh
+#
+# Flash and SRAM of every example, and of the feature variants below,
+# as built by arduino-cli for an AVR board.
+#
+#   extras/size_report.sh [fqbn]
+#
+# Needs arduino-cli with the core of fqbn installed, arduino:avr:uno by
+# default. Flags go through compiler.cpp.extra_flags, which reaches the
+# library sources as well as the sketch, so the same works for any of the
+# #ifndef options in src/.
+#
+# SPDX-License-Identifier: MIT
+
+set -e
+
+FQBN=${1:-arduino:avr:uno}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+# example|extra flags, one build per line
+CONFIGS="
+Blink|
+OledBuffers|-DOLED_BUFFER_MODE=0
+OledBuffers|-DOLED_BUFFER_MODE=1
+OledBuffers|-DOLED_BUFFER_MODE=2
+FrameStream|
+FrameStream|-DST7789V_USE_SOFTWARE_SPI=0
+FrameStream|-DST7789V_USE_SOFTWARE_SPI=0 -DFRAME_STREAM_PALETTE_SIZE=16
+"
+
+command -v arduino-cli >/dev/null || {
+    echo "arduino-cli not found, see https://arduino.github.io/arduino-cli/" >&2
+    exit 1
+}
+
+printf '%-12s %-64s %8s %8s\n' example flags flash sram
+
+n=0
+echo "$CONFIGS" | while IFS='|' read -r example flags; do
+    [ -n "$example" ] || continue
+
+    n=$((n + 1))
+    out=$(arduino-cli compile --fqbn "$FQBN" --library "$ROOT" \
+              --build-path "$BUILD/$n" \
+              --build-property "compiler.cpp.extra_flags=$flags" \
+              "$ROOT/examples/$example" 2>&1) || {
+        printf '%-12s %-64s %8s %8s\n' "$example" "${flags:--}" failed -
+        continue
+    }
+
+    flash=$(echo "$out" | sed -n 's/^Sketch uses \([0-9]*\) bytes.*/\1/p')
+    sram=$(echo "$out" | sed -n 's/^Global variables use \([0-9]*\) bytes.*/\1/p')
+
+    printf '%-12s %-64s %8s %8s\n' "$example" "${flags:--}" "$flash" "$sram"
+done
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "SSD1306.h"
 
 #if SSD1306_BS_MODE_I2C
@@ -6,20 +8,24 @@
     
 #endif
 
-oled_handle_t SSD1306::m_oled_handle = {
-    .interface = OLED_INTERFACE_I2C,
-    .width = 128,
-    .height = 64,
-    .depth = OLED_COLOR_DEPTH_1,
-    0,
-};
-uint8_t SSD1306::m_oled_buffer[1024] = {0};
-
 // Constructors ////////////////////////////////////////////////////////////////
+
+/**
+ * @param buffer width * height / 8 bytes owned by the caller, cleared
+ * here, or NULL to stream draws without a buffer
+ */
 SSD1306::SSD1306( oled_size_t width, oled_size_t height,
                   oled_color_depth_t depth,
-                  oled_pin_t scl, oled_pin_t sda )
+                  oled_pin_t scl, oled_pin_t sda,
+                  oled_buffer_t *buffer )
+    : m_fb( buffer, width, height )
 {
+    memset( &m_oled_handle, 0, sizeof( m_oled_handle ) );
+    
+    if( buffer ) {
+        memset( buffer, 0, m_fb.size() );
+    }
+    
     m_oled_handle.interface = OLED_INTERFACE_I2C;
     m_oled_handle.width     = width;
     m_oled_handle.height    = height;
@@ -30,13 +36,20 @@ SSD1306::SSD1306( oled_size_t width, oled_size_t height,
     
     m_oled_handle.status    = OLED_STATUS_UNINITIALIZED;
     m_oled_handle.lock      = OLED_LOCKED;
+    
+    disp_clip_init( &m_clip, width, height );
 }
 
 SSD1306::SSD1306( oled_size_t width, oled_size_t height,
                   oled_color_depth_t depth,
                   oled_pin_t sclk, oled_pin_t mosi,
-                  oled_pin_t miso, oled_pin_t nss )
+                  oled_pin_t miso, oled_pin_t nss,
+                  oled_buffer_t *buffer )
+    : m_fb( buffer, width, height )
 {
+    memset( &m_oled_handle, 0, sizeof( m_oled_handle ) );
+    disp_clip_init( &m_clip, width, height );
+    
     // m_oled_handle.interface = OLED_INTERFACE_I2C;
     // m_oled_handle.width     = width;
     // m_oled_handle.height    = height;
@@ -83,6 +96,22 @@ init_failed:
     
 }
 
+/**
+ * @brief Blank the panel, and the buffer if there is one.
+ */
+void SSD1306::clear()
+{
+    disp_area_t screen = { 0, 0, ( disp_coord_t )( m_fb.width() - 1 ),
+                           ( disp_coord_t )( m_fb.height() - 1 )
+                         };
+                         
+    if( buffered() ) {
+        m_fb.clear( false );
+    }
+    
+    stream_area( &screen, 0 );
+}
+
 void SSD1306::test()
 {
     Wire.begin();
@@ -91,6 +120,401 @@ void SSD1306::test()
     Wire.write( 0x01 );
     Wire.endTransmission();
 }
+/**
+ * @brief Set or clear one pixel in the display buffer, nothing is sent
+ * until flush().
+ */
+void SSD1306::set_pixel( disp_coord_t x, disp_coord_t y, oled_color_t color )
+{
+    if( !buffered() || !disp_clip_point( &m_clip, &x, &y ) ) {
+        return;
+    }
+    
+    m_fb.set_pixel( x, y, color );
+}
+
+/**
+ * @brief Fill a rectangle in the display buffer, clipped once up front.
+ * Without a buffer the covered pages are sent right away.
+ */
+void SSD1306::fill_rect( disp_coord_t x, disp_coord_t y,
+                         disp_coord_t w, disp_coord_t h, oled_color_t color )
+{
+    disp_area_t area = { x, y, ( disp_coord_t )( x + w - 1 ),
+                         ( disp_coord_t )( y + h - 1 )
+                       };
+                       
+    if( w <= 0 || h <= 0 || !disp_clip_area( &m_clip, &area ) ) {
+        return;
+    }
+    
+    if( buffered() ) {
+        fill_area( &area, color );
+    }
+    else {
+        stream_area( &area, color );
+    }
+}
+
+/**
+ * @brief Fill a clipped screen area of the buffer.
+ */
+void SSD1306::fill_area( const disp_area_t *area, oled_color_t color )
+{
+    if( buffered() ) {
+        m_fb.fill_area( area, color );
+    }
+}
+
+/**
+ * @brief Send a clipped screen area filled with one color, page by page,
+ * leaving the buffer alone.
+ */
+void SSD1306::stream_area( const disp_area_t *area, oled_color_t color )
+{
+    disp_coord_t page;
+    
+    for( page = area->y1 >> 3; page <= area->y2 >> 3; page++ )
+    {
+        disp_coord_t top = disp_max( area->y1, page * 8 ) & 7;
+        disp_coord_t bottom = disp_min( area->y2, page * 8 + 7 ) & 7;
+        uint8_t mask = ( uint8_t )( ( 0xFF << top ) & ( 0xFF >> ( 7 - bottom ) ) );
+        
+        set_pos( page, area->x1 );
+        write_fill( color ? mask : 0x00, area->x2 - area->x1 + 1 );
+    }
+}
+
+/**
+ * @brief Point the controller at a page and column, for page addressing
+ * mode.
+ */
+void SSD1306::set_pos( uint8_t page, uint8_t col )
+{
+    write_cmd( 0xB0 | ( page & 0x07 ) );
+    write_cmd( 0x00 | ( col & 0x0F ) );
+    write_cmd( 0x10 | ( col >> 4 ) );
+}
+
+/**
+ * @brief Send the whole display buffer.
+ */
+void SSD1306::flush()
+{
+    disp_area_t area = { 0, 0, ( disp_coord_t )( m_fb.width() - 1 ),
+                         ( disp_coord_t )( m_fb.height() - 1 )
+                       };
+    
+    flush_area( &area );
+}
+
+/**
+ * @brief Send the pages and columns covering an area, in screen
+ * coordinates.
+ */
+void SSD1306::flush_area( const disp_area_t *area )
+{
+    oled_flush_job_t job;
+    
+    flush_job( &job, area, 0xFFFF );
+    
+    while( !flush_step( &job ) );
+}
+
+/**
+ * @brief Prepare flush_area() as a job, so a full flush can be spread
+ * over several passes of loop() between sensor reads.
+ *
+ * @param budget data bytes sent per flush_step(), at least 1
+ */
+void SSD1306::flush_job( oled_flush_job_t *job, const disp_area_t *area,
+                         uint16_t budget )
+{
+    disp_area_t screen = { 0, 0, ( disp_coord_t )( m_fb.width() - 1 ),
+                           ( disp_coord_t )( m_fb.height() - 1 )
+                         };
+                         
+    if( !buffered() || !disp_area_intersect( &job->area, area, &screen ) ) {
+        /* page 0 is already past the last page -1 */
+        job->area.x1 = 0;
+        job->area.x2 = -1;
+        job->area.y1 = 0;
+        job->area.y2 = -1;
+    }
+    
+    job->page = job->area.y1 >> 3;
+    job->col = job->area.x1;
+    job->budget = budget ? budget : 1;
+}
+
+/**
+ * @brief Send the next budget bytes of a flush job. The position is set
+ * again every step, so other traffic to the panel may come in between.
+ *
+ * @return true when the job is finished
+ */
+bool SSD1306::flush_step( oled_flush_job_t *job )
+{
+    uint16_t left = job->budget;
+    
+    while( left && job->page <= ( job->area.y2 >> 3 ) )
+    {
+        uint16_t n = job->area.x2 - job->col + 1;
+        
+        if( n > left ) {
+            n = left;
+        }
+        
+        set_pos( job->page, job->col );
+        write_dat( m_fb.buffer() + job->page * m_fb.width() + job->col, n );
+        
+        left -= n;
+        job->col += n;
+        
+        if( job->col > job->area.x2 ) {
+            job->col = job->area.x1;
+            job->page++;
+        }
+    }
+    
+    return job->page > ( job->area.y2 >> 3 );
+}
+
+void SSD1306::flush_cb( void *ctx, const disp_area_t *area )
+{
+    ( ( SSD1306 * )ctx )->flush_area( area );
+}
+
+/**
+ * @brief Display on or off, GDDRAM keeps its content while off.
+ */
+void SSD1306::set_display_on( bool on )
+{
+    write_cmd( on ? 0xAF : 0xAE );
+}
+
+/**
+ * @brief Contrast, i.e. segment current, 0 is dimmest but not dark.
+ */
+void SSD1306::set_contrast( uint8_t level )
+{
+    write_cmd( 0x81 );
+    write_cmd( level );
+}
+
+/**
+ * @brief The charge pump feeds the panel, switch it off only while the
+ * display is off, and on again before the display.
+ */
+void SSD1306::set_charge_pump( bool on )
+{
+    write_cmd( 0x8D );
+    write_cmd( on ? 0x14 : 0x10 );
+}
+
+void SSD1306::sleep_cb( void *ctx, bool sleep )
+{
+    SSD1306 *oled = ( SSD1306 * )ctx;
+    
+    if( sleep ) {
+        oled->set_display_on( false );
+        oled->set_charge_pump( false );
+    }
+    else {
+        oled->set_charge_pump( true );
+        oled->set_display_on( true );
+    }
+}
+
+/**
+ * @brief There is no hardware ramp, the governor steps the contrast.
+ */
+void SSD1306::brightness_cb( void *ctx, uint8_t level )
+{
+    ( ( SSD1306 * )ctx )->set_contrast( level );
+}
+
+/**
+ * @brief This panel as a DispGovernor target, flushes go through flush_area().
+ */
+disp_power_ops_t SSD1306::power_ops()
+{
+    disp_power_ops_t ops = { flush_cb, sleep_cb, brightness_cb, this };
+    
+    return ops;
+}
+
+/**
+ * @brief Without a buffer the tile is packed into page bytes on the fly,
+ * DispList tiles of 8 rows map onto one page each.
+ */
+void SSD1306::flush_tile( void *ctx, const disp_area_t *area, const uint16_t *px )
+{
+    SSD1306 *oled = ( SSD1306 * )ctx;
+    disp_coord_t x, y, page, w = area->x2 - area->x1 + 1;
+    oled_dc_t bytes[SSD1306_I2C_CHUNK];
+    uint8_t n;
+    
+    if( oled->buffered() )
+    {
+        for( y = area->y1; y <= area->y2; y++ )
+        {
+            for( x = area->x1; x <= area->x2; x++ ) {
+                oled->m_fb.set_pixel( x, y, *px++ != 0 );
+            }
+        }
+        
+        oled->flush_area( area );
+        return;
+    }
+    
+    for( page = area->y1 >> 3; page <= area->y2 >> 3; page++ )
+    {
+        oled->set_pos( page, area->x1 );
+        n = 0;
+        
+        for( x = area->x1; x <= area->x2; x++ )
+        {
+            oled_dc_t b = 0;
+            
+            for( y = disp_max( area->y1, page * 8 ); y <= disp_min( area->y2, page * 8 + 7 ); y++ ) {
+                b |= ( px[( y - area->y1 ) * w + ( x - area->x1 )] != 0 ) << ( y & 7 );
+            }
+            
+            bytes[n++] = b;
+            
+            if( n == SSD1306_I2C_CHUNK || x == area->x2 ) {
+                oled->write_dat( bytes, n );
+                n = 0;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Draw a 1bpp image in page layout, see OledFrameBuffer::blit().
+ * Images inside the clip area take the shifted byte path, images crossing
+ * its edge fall back to clipped pixels.
+ */
+void SSD1306::draw_bitmap( disp_coord_t x, disp_coord_t y, const uint8_t *src,
+                           disp_coord_t w, disp_coord_t h, oled_blit_mode_t mode )
+{
+    const disp_viewport_t *vp = disp_clip_current( &m_clip );
+    disp_area_t area = { x, y, ( disp_coord_t )( x + w - 1 ),
+                         ( disp_coord_t )( y + h - 1 )
+                       };
+    disp_coord_t px, py;
+    
+    if( w <= 0 || h <= 0 || !disp_clip_area( &m_clip, &area ) ) {
+        return;
+    }
+    
+    x += vp->ox;
+    y += vp->oy;
+    
+    /* streamed only when whole, unmodified and on a page boundary */
+    if( !buffered() )
+    {
+        if( mode == OLED_BLIT_COPY && !( y & 7 ) && area.x1 == x && area.y1 == y &&
+            area.x2 == x + w - 1 && area.y2 == y + h - 1 )
+        {
+            for( py = 0; py < ( h + 7 ) >> 3; py++ ) {
+                set_pos( ( y >> 3 ) + py, x );
+                write_dat( src + py * w, w );
+            }
+        }
+        
+        return;
+    }
+    
+    if( area.x1 == x && area.y1 == y && area.x2 == x + w - 1 && area.y2 == y + h - 1 ) {
+        m_fb.blit( x, y, src, w, h, mode );
+        return;
+    }
+    
+    for( py = area.y1; py <= area.y2; py++ )
+    {
+        for( px = area.x1; px <= area.x2; px++ )
+        {
+            disp_coord_t sx = px - x, sy = py - y;
+            bool bit = ( src[( sy >> 3 ) * w + sx] >> ( sy & 7 ) ) & 1;
+            
+            switch( mode )
+            {
+            case OLED_BLIT_COPY:
+                m_fb.set_pixel( px, py, bit );
+                break;
+                
+            case OLED_BLIT_OR:
+                if( bit ) {
+                    m_fb.set_pixel( px, py, true );
+                }
+                break;
+                
+            case OLED_BLIT_CLR:
+                if( bit ) {
+                    m_fb.set_pixel( px, py, false );
+                }
+                break;
+                
+            default:
+                if( bit ) {
+                    m_fb.set_pixel( px, py, !m_fb.get_pixel( px, py ) );
+                }
+                break;
+            }
+        }
+    }
+}
+
+void SSD1306::raster_span( void *ctx, disp_coord_t x, disp_coord_t y,
+                           disp_coord_t len, uint16_t color )
+{
+    disp_area_t area = { x, y, ( disp_coord_t )( x + len - 1 ), y };
+    
+    ( ( SSD1306 * )ctx )->fill_area( &area, color != 0 );
+}
+
+void SSD1306::raster_fill( void *ctx, disp_coord_t x, disp_coord_t y,
+                           disp_coord_t w, disp_coord_t h, uint16_t color )
+{
+    disp_area_t area = { x, y, ( disp_coord_t )( x + w - 1 ),
+                         ( disp_coord_t )( y + h - 1 )
+                       };
+                       
+    ( ( SSD1306 * )ctx )->fill_area( &area, color != 0 );
+}
+
+/**
+ * @brief A rasterizer drawing into the display buffer, clipped by the
+ * viewport stack. Anti-aliased pixels are thresholded at half coverage.
+ */
+disp_raster_t SSD1306::raster()
+{
+    disp_raster_t r = { raster_span, raster_fill, NULL, this, &m_clip, 0, 0 };
+    
+    return r;
+}
+
+bool SSD1306::push_viewport( disp_coord_t x, disp_coord_t y,
+                             disp_coord_t w, disp_coord_t h )
+{
+    return disp_clip_push_viewport( &m_clip, x, y, w, h );
+}
+
+bool SSD1306::push_clip( disp_coord_t x1, disp_coord_t y1,
+                         disp_coord_t x2, disp_coord_t y2 )
+{
+    disp_area_t area = { x1, y1, x2, y2 };
+    
+    return disp_clip_push( &m_clip, &area );
+}
+
+void SSD1306::pop_clip()
+{
+    disp_clip_pop( &m_clip );
+}
+
 /*
     i2c_start();
     i2c_sendbyte(0x78); //slave address
@@ -107,9 +531,9 @@ void SSD1306::write_cmd( oled_dc_t val )
 #if SSD1306_BS_MODE_I2C
     /* I2C logic here*/
     Wire.beginTransmission( SSD1306_DEVICE_ADDR );
-    // Wire.write( SSD1306_COMMAND );
-    // Wire.write( val );
-    // Wire.endTransmission();
+    Wire.write( SSD1306_COMMAND );
+    Wire.write( val );
+    Wire.endTransmission();
 #else
     /* SPI logic here*/
     
@@ -129,4 +553,56 @@ void SSD1306::write_dat( oled_dc_t val )
 #endif
 }
 
-SSD1306 ssd1306 = SSD1306( 128, 64, OLED_COLOR_DEPTH_1, 19, 18 );
\ No newline at end of file
+/**
+ * @brief Send a run of display data, one control byte per I2C chunk
+ * instead of one per byte.
+ */
+void SSD1306::write_dat( const oled_dc_t *buf, uint16_t len )
+{
+#if SSD1306_BS_MODE_I2C
+    while( len )
+    {
+        uint16_t n = len > SSD1306_I2C_CHUNK ? SSD1306_I2C_CHUNK : len;
+        
+        Wire.beginTransmission( SSD1306_DEVICE_ADDR );
+        Wire.write( SSD1306_DATA );
+        
+        for( uint16_t i = 0; i < n; i++ ) {
+            Wire.write( buf[i] );
+        }
+        
+        Wire.endTransmission();
+        
+        buf += n;
+        len -= n;
+    }
+#else
+    /* SPI logic here*/
+#endif
+}
+
+/**
+ * @brief Send len copies of one display data byte.
+ */
+void SSD1306::write_fill( oled_dc_t val, uint16_t len )
+{
+#if SSD1306_BS_MODE_I2C
+    while( len )
+    {
+        uint16_t n = len > SSD1306_I2C_CHUNK ? SSD1306_I2C_CHUNK : len;
+        
+        Wire.beginTransmission( SSD1306_DEVICE_ADDR );
+        Wire.write( SSD1306_DATA );
+        
+        for( uint16_t i = 0; i < n; i++ ) {
+            Wire.write( val );
+        }
+        
+        Wire.endTransmission();
+        
+        len -= n;
+    }
+#else
+    /* SPI logic here*/
+#endif
+}
\ No newline at end of file
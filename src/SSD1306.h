@@ -2,21 +2,41 @@
 #define __SSD1306_H
 
 #include <inttypes.h>
+#include <stddef.h>
+
+#include "disp_clip.h"
+#include "disp_governor.h"
+#include "disp_raster.h"
+#include "oled_fb.h"
 
 /* using i2c interface of ssd1306 as default */
 #ifndef SSD1306_BS_MODE
     #define SSD1306_BS_MODE_I2C 1
 #endif
 
-/* oled param */
-#define OLED_HOR_RES_MAX (128)
-#define OLED_VER_RES_MAX (64)
+/* oled param, override these before including this header */
+#ifndef OLED_HOR_RES_MAX
+    #define OLED_HOR_RES_MAX (128)
+#endif
+
+#ifndef OLED_VER_RES_MAX
+    #define OLED_VER_RES_MAX (64)
+#endif
+
 #define OLED_COLOR_DEPTH (1)
 
+/* each page holds 8 rows, one byte per column */
+#define OLED_PAGE_MAX    (OLED_VER_RES_MAX / 8)
+#define OLED_BUFFER_SIZE (OLED_HOR_RES_MAX * OLED_PAGE_MAX)
+
+#if (OLED_VER_RES_MAX % 8)
+    #error "OLED_VER_RES_MAX must be a multiple of 8"
+#endif
+
 /* useful defines like buffer operation */
-#define OFFSET(p, c) ((p)*128 + (c)-1)
-#define GET_PAGE_FROM_BUFFER(i) (i / 128)
-#define GET_COL_FROM_BUFFER(i) (i % 128)
+#define OFFSET(p, c) ((p)*OLED_HOR_RES_MAX + (c))
+#define GET_PAGE_FROM_BUFFER(i) ((i) / OLED_HOR_RES_MAX)
+#define GET_COL_FROM_BUFFER(i) ((i) % OLED_HOR_RES_MAX)
 
 /* pc means page and coloumn */
 #define GET_PAGE(pc) (pc >> 16)
@@ -34,6 +54,11 @@
 #define SSD1306_COMMAND 0x00
 #define SSD1306_DATA    0x40
 
+/* the Wire buffer is 32 bytes, one goes to the control byte */
+#ifndef SSD1306_I2C_CHUNK
+    #define SSD1306_I2C_CHUNK (31)
+#endif
+
 /* the ssd1306 command table */
 
 /* for small oled, a uint8_t is enough to save a point data */
@@ -116,6 +141,15 @@ typedef enum
     OLED_UNLOCKED = 0x01,
 }oled_lock_t;
 
+/* flush_area() split into steps, see SSD1306::flush_job() */
+typedef struct
+{
+    disp_area_t area;       /* clipped to the screen */
+    disp_coord_t page;      /* next page to send */
+    disp_coord_t col;       /* next column of that page */
+    uint16_t budget;        /* data bytes per step */
+} oled_flush_job_t;
+
 /* a handle struct for ssd1306 */
 typedef struct
 {
@@ -141,24 +175,45 @@ typedef struct
     
 } oled_handle_t;
 
+/**
+ * Who owns the display buffer is up to the caller:
+ *
+ *   SSD1306Buffered<> oled( ... );          buffer inside the object, a
+ *                                           file scope object keeps it in .bss
+ *   SSD1306 oled( ..., my_buf );            any OLED_BUFFER_SIZE bytes
+ *   SSD1306 oled( ... );                    no buffer, draws go straight out
+ *
+ * Without a buffer set_pixel(), raster() and flush() do nothing, since
+ * the controller can not be read back over I2C. fill_rect(), clear(),
+ * draw_bitmap() at a page aligned y and flush_tile() are streamed whole
+ * pages at a time, rows of a partly covered page outside the area go dark.
+ */
 class SSD1306
 {
 private:
     void write_cmd( oled_dc_t val );
     void write_dat( oled_dc_t val );
+    void write_dat( const oled_dc_t *buf, uint16_t len );
+    void write_fill( oled_dc_t val, uint16_t len );
+    
+    disp_clip_t m_clip;
+    OledFrameBuffer m_fb;
     
-    static oled_buffer_t m_oled_buffer[1024]; /* oled display buffer */
+    void fill_area( const disp_area_t *area, oled_color_t color );
+    void stream_area( const disp_area_t *area, oled_color_t color );
 
 public:
-    static oled_handle_t m_oled_handle;
+    oled_handle_t m_oled_handle;
 
     SSD1306( oled_size_t width, oled_size_t height,
              oled_color_depth_t depth,
-             oled_pin_t scl, oled_pin_t sda );
+             oled_pin_t scl, oled_pin_t sda,
+             oled_buffer_t *buffer = NULL );
     SSD1306( oled_size_t width, oled_size_t height,
              oled_color_depth_t depth,
              oled_pin_t sclk, oled_pin_t mosi,
-             oled_pin_t miso, oled_pin_t nss );
+             oled_pin_t miso, oled_pin_t nss,
+             oled_buffer_t *buffer = NULL );
              
     void init( oled_handle_t *handle );
     void deinit(oled_handle_t *handle);
@@ -172,14 +227,80 @@ public:
     void put_string( uint8_t page, uint8_t col, uint8_t *str );
     
     /* new api */
-    void set_pixel( oled_coord_t x, oled_coord_t y, oled_color_t color );
+    void set_pixel( disp_coord_t x, disp_coord_t y, oled_color_t color );
+    void fill_rect( disp_coord_t x, disp_coord_t y,
+                    disp_coord_t w, disp_coord_t h, oled_color_t color );
+    void draw_bitmap( disp_coord_t x, disp_coord_t y, const uint8_t *src,
+                      disp_coord_t w, disp_coord_t h,
+                      oled_blit_mode_t mode = OLED_BLIT_COPY );
+    
+    OledFrameBuffer *framebuffer()
+    {
+        return &m_fb;
+    }
+    
+    bool buffered() const
+    {
+        return m_fb.buffer() != NULL;
+    }
+    
+    /* clip api, see disp_clip.h */
+    bool push_viewport( disp_coord_t x, disp_coord_t y,
+                        disp_coord_t w, disp_coord_t h );
+    bool push_clip( disp_coord_t x1, disp_coord_t y1,
+                    disp_coord_t x2, disp_coord_t y2 );
+    void pop_clip();
     void put_ascii( oled_coord_t x, oled_coord_t y, uint16_t c );
     void put_asciistring( oled_coord_t x, oled_coord_t y, uint16_t *str );
     
     void flush();
+    void flush_area( const disp_area_t *area );
+    
+    /* resumable flush, at most budget bytes per flush_step() */
+    void flush_job( oled_flush_job_t *job, const disp_area_t *area, uint16_t budget );
+    bool flush_step( oled_flush_job_t *job );
+    
+    /* flush_area() as an oled_flush_func_t, ctx is the SSD1306 object */
+    static void flush_cb( void *ctx, const disp_area_t *area );
+    
+    /* power api */
+    void set_display_on( bool on );
+    void set_contrast( uint8_t level );
+    void set_charge_pump( bool on );
+    
+    /* panel off with the charge pump, or back on, and contrast, ctx is the SSD1306 object */
+    static void sleep_cb( void *ctx, bool sleep );
+    static void brightness_cb( void *ctx, uint8_t level );
+    disp_power_ops_t power_ops();
+    
+    /* span sinks for disp_raster.h, ctx is the SSD1306 object, nothing is sent until flush() */
+    static void raster_span( void *ctx, disp_coord_t x, disp_coord_t y,
+                             disp_coord_t len, uint16_t color );
+    static void raster_fill( void *ctx, disp_coord_t x, disp_coord_t y,
+                             disp_coord_t w, disp_coord_t h, uint16_t color );
+    disp_raster_t raster();
+    
+    /* tile sink for DispList, ctx is the SSD1306 object */
+    static void flush_tile( void *ctx, const disp_area_t *area, const uint16_t *px );
 
 };
 
-extern SSD1306 ssd1306;
+/**
+ * @brief SSD1306 carrying a W x H buffer of its own, sized at compile time.
+ */
+template <oled_size_t W = OLED_HOR_RES_MAX, oled_size_t H = OLED_VER_RES_MAX>
+class SSD1306Buffered : public SSD1306
+{
+    static_assert( H % 8 == 0, "height must be a multiple of 8" );
+
+private:
+    oled_buffer_t m_buffer[W * ( H / 8 )];
+
+public:
+    SSD1306Buffered( oled_pin_t scl, oled_pin_t sda )
+        : SSD1306( W, H, OLED_COLOR_DEPTH_1, scl, sda, m_buffer )
+    {
+    }
+};
 
 #endif
\ No newline at end of file
@@ -0,0 +1,359 @@
+/**
+ * @file disp_clip.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Clip rectangle and viewport stack shared by the display drivers.
+ *
+ * Primitives are clipped once per call against the top of the stack, so a
+ * shape that lies fully outside costs a few compares and never reaches
+ * the bus.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __DISP_CLIP_H
+#define __DISP_CLIP_H
+
+#include <inttypes.h>
+
+#ifndef DISP_CLIP_STACK_DEPTH
+    #define DISP_CLIP_STACK_DEPTH (4)
+#endif
+
+/* signed, so shapes may start left of or above the screen */
+typedef int16_t disp_coord_t;
+
+/* inclusive rectangle, empty when x2 < x1 or y2 < y1 */
+typedef struct
+{
+    disp_coord_t x1;
+    disp_coord_t y1;
+    disp_coord_t x2;
+    disp_coord_t y2;
+} disp_area_t;
+
+/* a clip area in screen coordinates plus the origin for drawing calls */
+typedef struct
+{
+    disp_area_t area;
+    disp_coord_t ox;
+    disp_coord_t oy;
+} disp_viewport_t;
+
+typedef struct
+{
+    disp_viewport_t stack[DISP_CLIP_STACK_DEPTH + 1]; /* [0] is the screen */
+    uint8_t top;
+} disp_clip_t;
+
+static inline disp_coord_t disp_min( disp_coord_t a, disp_coord_t b )
+{
+    return a < b ? a : b;
+}
+
+static inline disp_coord_t disp_max( disp_coord_t a, disp_coord_t b )
+{
+    return a > b ? a : b;
+}
+
+static inline bool disp_area_is_empty( const disp_area_t *a )
+{
+    return a->x2 < a->x1 || a->y2 < a->y1;
+}
+
+static inline bool disp_area_contains( const disp_area_t *a,
+                                       disp_coord_t x, disp_coord_t y )
+{
+    return x >= a->x1 && x <= a->x2 && y >= a->y1 && y <= a->y2;
+}
+
+/**
+ * @brief res = a & b, res may alias a or b.
+ *
+ * @return false if the result is empty
+ */
+static inline bool disp_area_intersect( disp_area_t *res,
+                                        const disp_area_t *a,
+                                        const disp_area_t *b )
+{
+    res->x1 = disp_max( a->x1, b->x1 );
+    res->y1 = disp_max( a->y1, b->y1 );
+    res->x2 = disp_min( a->x2, b->x2 );
+    res->y2 = disp_min( a->y2, b->y2 );
+
+    return !disp_area_is_empty( res );
+}
+
+/* smallest area holding both, an empty input is ignored */
+static inline void disp_area_join( disp_area_t *res,
+                                   const disp_area_t *a,
+                                   const disp_area_t *b )
+{
+    if( disp_area_is_empty( a ) ) {
+        *res = *b;
+        return;
+    }
+
+    if( disp_area_is_empty( b ) ) {
+        *res = *a;
+        return;
+    }
+
+    res->x1 = disp_min( a->x1, b->x1 );
+    res->y1 = disp_min( a->y1, b->y1 );
+    res->x2 = disp_max( a->x2, b->x2 );
+    res->y2 = disp_max( a->y2, b->y2 );
+}
+
+/* coordinate arithmetic is done in 32 bits and saturated on the way back */
+static inline disp_coord_t disp_coord_clamp( int32_t v )
+{
+    return v < -32768 ? -32768 : v > 32767 ? 32767 : ( disp_coord_t )v;
+}
+
+static inline void disp_clip_init( disp_clip_t *clip,
+                                   disp_coord_t width, disp_coord_t height )
+{
+    disp_viewport_t *vp = &clip->stack[0];
+
+    vp->area.x1 = 0;
+    vp->area.y1 = 0;
+    vp->area.x2 = width - 1;
+    vp->area.y2 = height - 1;
+    vp->ox = 0;
+    vp->oy = 0;
+
+    clip->top = 0;
+}
+
+static inline const disp_viewport_t *disp_clip_current( const disp_clip_t *clip )
+{
+    return &clip->stack[clip->top];
+}
+
+/**
+ * @brief Push a viewport, given in the coordinates of the current one.
+ * Later calls draw relative to (x, y) and are clipped to w x h.
+ *
+ * @return false if the stack is full
+ */
+static inline bool disp_clip_push_viewport( disp_clip_t *clip,
+        disp_coord_t x, disp_coord_t y,
+        disp_coord_t w, disp_coord_t h )
+{
+    const disp_viewport_t *cur = disp_clip_current( clip );
+    int32_t ox = ( int32_t )cur->ox + x, oy = ( int32_t )cur->oy + y;
+    disp_viewport_t *vp;
+    disp_area_t area;
+
+    if( clip->top >= DISP_CLIP_STACK_DEPTH ) {
+        return false;
+    }
+
+    /* an origin that saturates leaves an empty area, nothing is drawn */
+    vp = &clip->stack[++clip->top];
+    vp->ox = disp_coord_clamp( ox );
+    vp->oy = disp_coord_clamp( oy );
+
+    area.x1 = disp_coord_clamp( ox );
+    area.y1 = disp_coord_clamp( oy );
+    area.x2 = disp_coord_clamp( ox + w - 1 );
+    area.y2 = disp_coord_clamp( oy + h - 1 );
+
+    /* an empty result is kept, it simply rejects everything */
+    disp_area_intersect( &vp->area, &area, &cur->area );
+
+    return true;
+}
+
+/**
+ * @brief Narrow the clip area without moving the origin.
+ */
+static inline bool disp_clip_push( disp_clip_t *clip, const disp_area_t *a )
+{
+    const disp_viewport_t *cur = disp_clip_current( clip );
+    disp_viewport_t *vp;
+    disp_area_t area;
+
+    if( clip->top >= DISP_CLIP_STACK_DEPTH ) {
+        return false;
+    }
+
+    area.x1 = disp_coord_clamp( ( int32_t )a->x1 + cur->ox );
+    area.y1 = disp_coord_clamp( ( int32_t )a->y1 + cur->oy );
+    area.x2 = disp_coord_clamp( ( int32_t )a->x2 + cur->ox );
+    area.y2 = disp_coord_clamp( ( int32_t )a->y2 + cur->oy );
+
+    vp = &clip->stack[++clip->top];
+    vp->ox = cur->ox;
+    vp->oy = cur->oy;
+    disp_area_intersect( &vp->area, &area, &cur->area );
+
+    return true;
+}
+
+static inline void disp_clip_pop( disp_clip_t *clip )
+{
+    if( clip->top ) {
+        clip->top--;
+    }
+}
+
+/**
+ * @brief Translate a point to screen coordinates and test it.
+ */
+static inline bool disp_clip_point( const disp_clip_t *clip,
+                                    disp_coord_t *x, disp_coord_t *y )
+{
+    const disp_viewport_t *vp = disp_clip_current( clip );
+
+    *x += vp->ox;
+    *y += vp->oy;
+
+    return disp_area_contains( &vp->area, *x, *y );
+}
+
+/**
+ * @brief Translate an area to screen coordinates and clip it in place.
+ *
+ * @return false if nothing is left to draw
+ */
+static inline bool disp_clip_area( const disp_clip_t *clip, disp_area_t *a )
+{
+    const disp_viewport_t *vp = disp_clip_current( clip );
+
+    a->x1 = disp_coord_clamp( ( int32_t )a->x1 + vp->ox );
+    a->x2 = disp_coord_clamp( ( int32_t )a->x2 + vp->ox );
+    a->y1 = disp_coord_clamp( ( int32_t )a->y1 + vp->oy );
+    a->y2 = disp_coord_clamp( ( int32_t )a->y2 + vp->oy );
+
+    return disp_area_intersect( a, a, &vp->area );
+}
+
+#define DISP_OUT_LEFT   (0x01)
+#define DISP_OUT_RIGHT  (0x02)
+#define DISP_OUT_TOP    (0x04)
+#define DISP_OUT_BOTTOM (0x08)
+
+static inline uint8_t disp_outcode( const disp_area_t *a,
+                                    int32_t x, int32_t y )
+{
+    uint8_t code = 0;
+
+    if( x < a->x1 ) {
+        code |= DISP_OUT_LEFT;
+    }
+    else if( x > a->x2 ) {
+        code |= DISP_OUT_RIGHT;
+    }
+
+    if( y < a->y1 ) {
+        code |= DISP_OUT_TOP;
+    }
+    else if( y > a->y2 ) {
+        code |= DISP_OUT_BOTTOM;
+    }
+
+    return code;
+}
+
+/* n / d rounded to nearest, halves away from zero */
+static inline int32_t disp_div_round( int64_t n, int32_t d )
+{
+    if( d < 0 ) {
+        n = -n;
+        d = -d;
+    }
+
+    return ( int32_t )( n >= 0 ? ( n + d / 2 ) / d : -( ( -n + d / 2 ) / d ) );
+}
+
+/**
+ * @brief Cohen-Sutherland, translates the end points and clips them in
+ * place.
+ *
+ * Every cut is taken on the original line and rounded to the nearest
+ * pixel, so a kept end point is at most half a pixel off along one axis.
+ * A point cut back over an edge it was already moved onto means the line
+ * only grazes a corner outside the area.
+ *
+ * @return false if the whole line is outside
+ */
+static inline bool disp_clip_line( const disp_clip_t *clip,
+                                   disp_coord_t *x0, disp_coord_t *y0,
+                                   disp_coord_t *x1, disp_coord_t *y1 )
+{
+    const disp_viewport_t *vp = disp_clip_current( clip );
+    const disp_area_t *a = &vp->area;
+    const int32_t px = ( int32_t )*x0 + vp->ox, py = ( int32_t )*y0 + vp->oy;
+    const int32_t qx = ( int32_t )*x1 + vp->ox, qy = ( int32_t )*y1 + vp->oy;
+    int32_t ax = px, ay = py, bx = qx, by = qy;
+    uint8_t ca = disp_outcode( a, ax, ay ), cut_a = 0;
+    uint8_t cb = disp_outcode( a, bx, by ), cut_b = 0;
+
+    if( disp_area_is_empty( a ) ) {
+        return false;
+    }
+
+    while( ca | cb )
+    {
+        uint8_t out, edge;
+        int32_t x, y;
+
+        if( ca & cb ) {
+            return false;
+        }
+
+        out = ca ? ca : cb;
+
+        if( out & DISP_OUT_TOP ) {
+            edge = DISP_OUT_TOP;
+            y = a->y1;
+            x = px + disp_div_round( ( int64_t )( qx - px ) * ( y - py ), qy - py );
+        }
+        else if( out & DISP_OUT_BOTTOM ) {
+            edge = DISP_OUT_BOTTOM;
+            y = a->y2;
+            x = px + disp_div_round( ( int64_t )( qx - px ) * ( y - py ), qy - py );
+        }
+        else if( out & DISP_OUT_LEFT ) {
+            edge = DISP_OUT_LEFT;
+            x = a->x1;
+            y = py + disp_div_round( ( int64_t )( qy - py ) * ( x - px ), qx - px );
+        }
+        else {
+            edge = DISP_OUT_RIGHT;
+            x = a->x2;
+            y = py + disp_div_round( ( int64_t )( qy - py ) * ( x - px ), qx - px );
+        }
+
+        if( out == ca ) {
+            ax = x;
+            ay = y;
+            cut_a |= edge;
+            ca = disp_outcode( a, ax, ay );
+
+            if( ca & cut_a ) {
+                return false;
+            }
+        }
+        else {
+            bx = x;
+            by = y;
+            cut_b |= edge;
+            cb = disp_outcode( a, bx, by );
+
+            if( cb & cut_b ) {
+                return false;
+            }
+        }
+    }
+
+    *x0 = ax;
+    *y0 = ay;
+    *x1 = bx;
+    *y1 = by;
+
+    return true;
+}
+
+#endif
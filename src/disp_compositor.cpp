@@ -0,0 +1,302 @@
+/**
+ * @file disp_compositor.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Sprite and layer compositor with a single line buffer.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "disp_compositor.h"
+#include "rgb565.h"
+
+static const disp_area_t disp_comp_empty = { 0, 0, -1, -1 };
+
+// Constructors ////////////////////////////////////////////////////////////////
+DispCompositor::DispCompositor( disp_coord_t width, disp_coord_t height,
+                                uint16_t background )
+{
+    m_screen.x1 = 0;
+    m_screen.y1 = 0;
+    m_screen.x2 = disp_min( width, DISP_COMP_LINE_MAX ) - 1;
+    m_screen.y2 = height - 1;
+
+    m_background = background;
+    m_bg_func = NULL;
+    m_bg_ctx = NULL;
+
+    m_count = 0;
+    m_damage = disp_comp_empty;
+    memset( &m_stats, 0, sizeof( m_stats ) );
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+/**
+ * @brief Draw the background with a callback instead of a solid color,
+ * e.g. a gauge face. The whole screen is recomposed on the next call.
+ */
+void DispCompositor::set_background( disp_bg_func_t func, void *ctx )
+{
+    m_bg_func = func;
+    m_bg_ctx = ctx;
+    invalidate( &m_screen );
+}
+
+/**
+ * @brief Add a layer on top of the others, hidden at (0, 0) until moved.
+ * The setters ignore ids that were never returned here.
+ *
+ * @return layer id, or -1 if DISP_COMP_MAX_LAYERS is reached
+ */
+int8_t DispCompositor::add_layer( const uint16_t *pixels,
+                                  disp_coord_t w, disp_coord_t h )
+{
+    disp_layer_t *l;
+
+    if( m_count >= DISP_COMP_MAX_LAYERS ) {
+        return -1;
+    }
+
+    l = &m_layers[m_count];
+    memset( l, 0, sizeof( *l ) );
+    l->pixels = pixels;
+    l->w = w;
+    l->h = h;
+    l->alpha = 255;
+    l->shown = disp_comp_empty;
+
+    return m_count++;
+}
+
+int8_t DispCompositor::add_solid( uint16_t color, disp_coord_t w, disp_coord_t h )
+{
+    int8_t id = add_layer( NULL, w, h );
+
+    if( id >= 0 ) {
+        m_layers[id].color = color;
+    }
+
+    return id;
+}
+
+void DispCompositor::move( int8_t id, disp_coord_t x, disp_coord_t y )
+{
+    disp_layer_t *l = layer( id );
+
+    if( l && ( l->x != x || l->y != y ) ) {
+        l->x = x;
+        l->y = y;
+        l->dirty = 1;
+    }
+}
+
+/**
+ * @brief New content for a layer, also call it when the pixels behind the
+ * same pointer changed.
+ */
+void DispCompositor::set_pixels( int8_t id, const uint16_t *pixels )
+{
+    disp_layer_t *l = layer( id );
+
+    if( l ) {
+        l->pixels = pixels;
+        l->dirty = 1;
+    }
+}
+
+void DispCompositor::set_visible( int8_t id, bool visible )
+{
+    disp_layer_t *l = layer( id );
+
+    if( l && l->visible != visible ) {
+        l->visible = visible;
+        l->dirty = 1;
+    }
+}
+
+void DispCompositor::set_alpha( int8_t id, uint8_t alpha )
+{
+    disp_layer_t *l = layer( id );
+
+    if( l && l->alpha != alpha ) {
+        l->alpha = alpha;
+        l->dirty = 1;
+    }
+}
+
+void DispCompositor::set_key( int8_t id, bool use_key, uint16_t key )
+{
+    disp_layer_t *l = layer( id );
+
+    if( l ) {
+        l->use_key = use_key;
+        l->key = key;
+        l->dirty = 1;
+    }
+}
+
+void DispCompositor::invalidate( const disp_area_t *area )
+{
+    disp_area_join( &m_damage, &m_damage, area );
+}
+
+/**
+ * @brief Recompose and send everything that changed since the last call.
+ *
+ * Each dirty layer contributes the union of its old and new area,
+ * overlapping regions are merged so no pixel is sent twice.
+ */
+void DispCompositor::compose( const disp_line_ops_t *ops )
+{
+    disp_area_t regions[DISP_COMP_MAX_LAYERS + 1];
+    uint8_t n = 0, i, j;
+    bool merged;
+
+    m_stats.regions = 0;
+    m_stats.pixels_sent = 0;
+
+    if( !disp_area_is_empty( &m_damage ) ) {
+        regions[n++] = m_damage;
+        m_damage = disp_comp_empty;
+    }
+
+    for( i = 0; i < m_count; i++ )
+    {
+        disp_layer_t *l = &m_layers[i];
+        disp_area_t now = disp_comp_empty;
+
+        if( !l->dirty ) {
+            continue;
+        }
+
+        if( l->visible ) {
+            now.x1 = l->x;
+            now.y1 = l->y;
+            now.x2 = l->x + l->w - 1;
+            now.y2 = l->y + l->h - 1;
+        }
+
+        disp_area_join( &regions[n], &l->shown, &now );
+        l->shown = now;
+        l->dirty = 0;
+
+        if( !disp_area_is_empty( &regions[n] ) ) {
+            n++;
+        }
+    }
+
+    /*
+     * merge until no two regions overlap, starting over after each merge
+     * since the grown region may now reach one that was checked before
+     */
+    do
+    {
+        merged = false;
+
+        for( i = 0; i < n && !merged; i++ )
+        {
+            for( j = i + 1; j < n; j++ )
+            {
+                disp_area_t hit;
+
+                if( disp_area_intersect( &hit, &regions[i], &regions[j] ) ) {
+                    disp_area_join( &regions[i], &regions[i], &regions[j] );
+                    regions[j] = regions[--n];
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    } while( merged );
+
+    for( i = 0; i < n; i++ )
+    {
+        disp_area_t area;
+
+        if( disp_area_intersect( &area, &regions[i], &m_screen ) ) {
+            compose_region( &area, ops );
+        }
+    }
+}
+
+// Private Methods //////////////////////////////////////////////////////////////
+
+/* NULL for ids add_layer() never returned, e.g. its -1 */
+disp_layer_t *DispCompositor::layer( int8_t id )
+{
+    return id >= 0 && id < m_count ? &m_layers[id] : NULL;
+}
+
+void DispCompositor::compose_region( const disp_area_t *area,
+                                     const disp_line_ops_t *ops )
+{
+    disp_coord_t y, n = area->x2 - area->x1 + 1;
+
+    ops->window( ops->ctx, area );
+
+    for( y = area->y1; y <= area->y2; y++ )
+    {
+        compose_row( area->x1, area->x2, y );
+        ops->line( ops->ctx, m_line, n );
+    }
+
+    m_stats.regions++;
+    m_stats.pixels_sent += ( uint32_t )n * ( area->y2 - area->y1 + 1 );
+}
+
+/**
+ * @brief Build screen pixels x1 ~ x2 of row y into m_line[0 ~ x2 - x1].
+ */
+void DispCompositor::compose_row( disp_coord_t x1, disp_coord_t x2, disp_coord_t y )
+{
+    disp_coord_t n = x2 - x1 + 1, x;
+    uint8_t i;
+
+    if( m_bg_func ) {
+        m_bg_func( m_bg_ctx, x1, y, n, m_line );
+    }
+    else {
+        rgb565_fill( m_line, m_background, n );
+    }
+
+    for( i = 0; i < m_count; i++ )
+    {
+        const disp_layer_t *l = &m_layers[i];
+        disp_coord_t from, to;
+        uint16_t *dst;
+
+        if( !l->visible || !l->alpha || y < l->y || y >= l->y + l->h ) {
+            continue;
+        }
+
+        from = disp_max( x1, l->x );
+        to = disp_min( x2, l->x + l->w - 1 );
+
+        if( to < from ) {
+            continue;
+        }
+
+        dst = m_line + ( from - x1 );
+
+        if( !l->pixels ) {
+            rgb565_mix_color( dst, l->color, to - from + 1, l->alpha );
+            continue;
+        }
+
+        const uint16_t *src = l->pixels + ( uint32_t )( y - l->y ) * l->w + ( from - l->x );
+
+        if( !l->use_key ) {
+            rgb565_mix( dst, src, to - from + 1, l->alpha );
+            continue;
+        }
+
+        for( x = from; x <= to; x++, src++, dst++ )
+        {
+            if( *src != l->key ) {
+                *dst = rgb565_mix_px( *src, *dst, l->alpha );
+            }
+        }
+    }
+}
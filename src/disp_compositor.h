@@ -0,0 +1,108 @@
+/**
+ * @file disp_compositor.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Sprite and layer compositor with a single line buffer.
+ *
+ * Moving a sprite only recomposes the union of where it was and where it
+ * is now. Every row of that area is built in a line buffer, background
+ * first and then the layers bottom to top, and streamed out through one
+ * address window, so nothing flickers and nothing is sent twice.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __DISP_COMPOSITOR_H
+#define __DISP_COMPOSITOR_H
+
+#include <inttypes.h>
+
+#include "disp_clip.h"
+
+#ifndef DISP_COMP_MAX_LAYERS
+    #define DISP_COMP_MAX_LAYERS (8)
+#endif
+
+/* widest row the line buffer can hold */
+#ifndef DISP_COMP_LINE_MAX
+    #define DISP_COMP_LINE_MAX (320)
+#endif
+
+typedef struct
+{
+    const uint16_t *pixels;     /* w * h rgb565, NULL for a solid color */
+    uint16_t color;             /* used when pixels is NULL */
+    uint16_t key;               /* transparent color when use_key is set */
+    disp_coord_t x, y, w, h;
+    disp_area_t shown;          /* area on screen after the last compose */
+    uint8_t use_key;
+    uint8_t alpha;              /* 255 is opaque */
+    uint8_t visible;
+    uint8_t dirty;
+} disp_layer_t;
+
+/**
+ * @brief Output of the compositor: window() is called once per region,
+ * followed by one line() per row of it.
+ */
+typedef struct
+{
+    void ( *window )( void *ctx, const disp_area_t *area );
+    void ( *line )( void *ctx, const uint16_t *px, disp_coord_t n );
+    void *ctx;
+} disp_line_ops_t;
+
+/* fills n background pixels of row y starting at x */
+typedef void ( *disp_bg_func_t )( void *ctx, disp_coord_t x, disp_coord_t y,
+                                  disp_coord_t n, uint16_t *px );
+
+typedef struct
+{
+    uint8_t regions;
+    uint32_t pixels_sent;
+} disp_comp_stats_t;
+
+class DispCompositor
+{
+private:
+    disp_layer_t m_layers[DISP_COMP_MAX_LAYERS];
+    uint8_t m_count;
+
+    disp_area_t m_screen;
+    uint16_t m_background;
+    disp_bg_func_t m_bg_func;
+    void *m_bg_ctx;
+
+    /* areas invalidated by the application, joined into one */
+    disp_area_t m_damage;
+
+    uint16_t m_line[DISP_COMP_LINE_MAX];
+    disp_comp_stats_t m_stats;
+
+    disp_layer_t *layer( int8_t id );
+    void compose_row( disp_coord_t x1, disp_coord_t x2, disp_coord_t y );
+    void compose_region( const disp_area_t *area, const disp_line_ops_t *ops );
+
+public:
+    DispCompositor( disp_coord_t width, disp_coord_t height, uint16_t background );
+
+    void set_background( disp_bg_func_t func, void *ctx );
+
+    int8_t add_layer( const uint16_t *pixels, disp_coord_t w, disp_coord_t h );
+    int8_t add_solid( uint16_t color, disp_coord_t w, disp_coord_t h );
+
+    void move( int8_t id, disp_coord_t x, disp_coord_t y );
+    void set_pixels( int8_t id, const uint16_t *pixels );
+    void set_visible( int8_t id, bool visible );
+    void set_alpha( int8_t id, uint8_t alpha );
+    void set_key( int8_t id, bool use_key, uint16_t key );
+    void invalidate( const disp_area_t *area );
+
+    void compose( const disp_line_ops_t *ops );
+
+    const disp_comp_stats_t *stats() const
+    {
+        return &m_stats;
+    }
+};
+
+#endif
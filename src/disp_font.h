@@ -0,0 +1,38 @@
+/**
+ * @file disp_font.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Bitmap font description used by the display drivers.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __DISP_FONT_H
+#define __DISP_FONT_H
+
+#include <Arduino.h>
+
+/* column major glyphs, bit 0 is the top row, at most 8 rows high */
+typedef struct
+{
+    const uint8_t *data;    /* in PROGMEM */
+    uint8_t width;
+    uint8_t height;
+    uint8_t advance;        /* pen step, >= width */
+    uint8_t first;
+    uint8_t last;
+} disp_font_t;
+
+/**
+ * @brief Read one glyph column, characters out of range show as blank.
+ */
+static inline uint8_t disp_font_column( const disp_font_t *font,
+                                        uint8_t c, uint8_t col )
+{
+    if( c < font->first || c > font->last || col >= font->width ) {
+        return 0;
+    }
+
+    return pgm_read_byte( font->data + ( uint16_t )( c - font->first ) * font->width + col );
+}
+
+#endif
@@ -0,0 +1,224 @@
+/**
+ * @file disp_governor.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Refresh governor trading frame rate for bus and panel idle time.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "disp_governor.h"
+
+/* changes per flush the interval aims at, as long as it stays in range */
+#define DISP_GOV_BATCH 2
+
+/* changes within min_interval / DISP_GOV_SAME belong to one update */
+#define DISP_GOV_SAME 4
+
+static const disp_area_t disp_gov_empty = { 0, 0, -1, -1 };
+
+// Constructors ////////////////////////////////////////////////////////////////
+DispGovernor::DispGovernor( const disp_power_ops_t *ops,
+                            const disp_governor_cfg_t *cfg )
+{
+    m_ops = ops;
+    m_cfg = *cfg;
+
+    if( !m_cfg.ramp_step ) {
+        m_cfg.ramp_step = 255;
+    }
+
+    m_state = DISP_GOV_ACTIVE;
+    m_dirty = false;
+    m_damage = disp_gov_empty;
+
+    m_last_change = 0;
+    m_last_flush = 0;
+    m_last_ramp = 0;
+    m_last_activity = 0;
+    m_gap = m_cfg.min_interval;
+    m_interval = m_cfg.min_interval;
+
+    /* unknown until the first ramp, assume the panel is lit */
+    m_level = m_cfg.bright;
+    m_target = m_cfg.bright;
+
+    memset( &m_stats, 0, sizeof( m_stats ) );
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+/**
+ * @brief Content in area changed, it is flushed with the next batch.
+ * Changes closer together than a quarter of min_interval, e.g. the parts
+ * of one redraw, count as one for the rate.
+ * The interval aims at DISP_GOV_BATCH changes per flush, a change after a
+ * quiet spell still goes out at once. While asleep changes only collect,
+ * they go out after the next wake().
+ */
+void DispGovernor::changed( uint32_t now, const disp_area_t *area )
+{
+    uint32_t gap = now - m_last_change;
+
+    m_stats.changes++;
+    disp_area_join( &m_damage, &m_damage, area );
+    m_dirty = true;
+
+    if( gap >= m_cfg.min_interval / DISP_GOV_SAME )
+    {
+        /* speed up quickly when content starts moving, slow down gently */
+        gap = gap > m_cfg.max_interval ? m_cfg.max_interval : gap;
+        m_gap = gap < m_gap ? ( m_gap + gap ) / 2 : ( m_gap * 3 + gap ) / 4;
+        m_last_change = now;
+
+        gap = m_gap * DISP_GOV_BATCH;
+        m_interval = gap < m_cfg.min_interval ? m_cfg.min_interval :
+                     ( gap > m_cfg.max_interval ? m_cfg.max_interval : gap );
+    }
+
+}
+
+/**
+ * @brief User activity, e.g. a key press, lights the panel up again and
+ * restarts the idle timers. Changes alone do not, a dashboard nobody
+ * looks at dims and sleeps while its values keep changing.
+ */
+void DispGovernor::wake( uint32_t now )
+{
+    m_last_activity = now;
+    wake_panel( now );
+}
+
+/**
+ * @brief Do what is due: a brightness ramp step, the batched flush, dimming
+ * or sleeping once idle long enough.
+ *
+ * @return true if the bus was used
+ */
+bool DispGovernor::poll( uint32_t now )
+{
+    uint32_t idle = now - m_last_activity;
+    bool work = false;
+
+    if( m_state == DISP_GOV_SLEEP ) {
+        return false;
+    }
+
+    if( m_level != m_target && now - m_last_ramp >= m_cfg.ramp_ms )
+    {
+        uint8_t step = m_cfg.ramp_step;
+
+        if( m_level < m_target ) {
+            m_level = m_target - m_level > step ? m_level + step : m_target;
+        }
+        else {
+            m_level = m_level - m_target > step ? m_level - step : m_target;
+        }
+
+        if( m_ops->brightness ) {
+            m_ops->brightness( m_ops->ctx, m_level );
+        }
+
+        m_last_ramp = now;
+        m_stats.ramp_steps++;
+        work = true;
+    }
+
+    if( m_dirty && now - m_last_flush >= m_interval )
+    {
+        m_ops->flush( m_ops->ctx, &m_damage );
+        m_damage = disp_gov_empty;
+        m_dirty = false;
+        m_last_flush = now;
+        m_stats.flushes++;
+        work = true;
+    }
+
+    if( m_state == DISP_GOV_ACTIVE && m_cfg.dim_after && idle >= m_cfg.dim_after ) {
+        m_state = DISP_GOV_DIM;
+        m_target = m_cfg.dim;
+    }
+
+    /* only once the dimming ramp is over and nothing waits to be sent */
+    if( may_sleep() && idle >= m_cfg.sleep_after && !m_dirty )
+    {
+        if( m_ops->sleep ) {
+            m_ops->sleep( m_ops->ctx, true );
+        }
+
+        m_state = DISP_GOV_SLEEP;
+        m_stats.sleeps++;
+        work = true;
+    }
+
+    m_stats.wakeups += work;
+
+    return work;
+}
+
+/**
+ * @brief ms until poll() has something to do, 0 if it has now, and
+ * UINT32_MAX while asleep, when only changed() or wake() end the wait.
+ */
+uint32_t DispGovernor::next_poll( uint32_t now ) const
+{
+    uint32_t next = UINT32_MAX, t;
+
+    if( m_state == DISP_GOV_SLEEP ) {
+        return next;
+    }
+
+    if( m_dirty ) {
+        t = now - m_last_flush;
+        next = t >= m_interval ? 0 : m_interval - t;
+    }
+
+    if( m_level != m_target ) {
+        t = now - m_last_ramp;
+        t = t >= m_cfg.ramp_ms ? 0 : m_cfg.ramp_ms - t;
+        next = t < next ? t : next;
+    }
+
+    t = now - m_last_activity;
+
+    if( m_state == DISP_GOV_ACTIVE && m_cfg.dim_after ) {
+        t = t >= m_cfg.dim_after ? 0 : m_cfg.dim_after - t;
+        next = t < next ? t : next;
+    }
+    else if( may_sleep() ) {
+        t = t >= m_cfg.sleep_after ? 0 : m_cfg.sleep_after - t;
+        next = t < next ? t : next;
+    }
+
+    return next;
+}
+
+// Private Methods //////////////////////////////////////////////////////////////
+void DispGovernor::wake_panel( uint32_t now )
+{
+    if( m_state == DISP_GOV_SLEEP )
+    {
+        if( m_ops->sleep ) {
+            m_ops->sleep( m_ops->ctx, false );
+        }
+
+        m_stats.wakeups++;
+    }
+
+    if( m_state != DISP_GOV_ACTIVE ) {
+        m_state = DISP_GOV_ACTIVE;
+        m_target = m_cfg.bright;
+        m_last_ramp = now - m_cfg.ramp_ms;
+    }
+}
+
+/* dimmed, or active with dimming off, and no brightness ramp running */
+bool DispGovernor::may_sleep() const
+{
+    if( !m_cfg.sleep_after || m_level != m_target ) {
+        return false;
+    }
+
+    return m_state == DISP_GOV_DIM || ( m_state == DISP_GOV_ACTIVE && !m_cfg.dim_after );
+}
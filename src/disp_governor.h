@@ -0,0 +1,119 @@
+/**
+ * @file disp_governor.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Refresh governor trading frame rate for bus and panel idle time.
+ *
+ * The application reports changes instead of drawing them out at once.
+ * Changes are joined and flushed in one go, no sooner than an interval
+ * that follows how often content changes: an animation gets the fastest
+ * rate, a clock ticking once a second gets a slow one and its updates
+ * wait a little to be batched. Without user activity, reported by wake(),
+ * the panel is dimmed after a while, then put to sleep, and brightness
+ * moves in command steps, or in one step where the controller ramps it
+ * itself, never by redrawing.
+ *
+ * Time is passed in, so the governor runs the same on a host clock.
+ * next_poll() tells how long the MCU may sleep before poll() has work.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __DISP_GOVERNOR_H
+#define __DISP_GOVERNOR_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "disp_clip.h"
+
+/* what the governor drives, any member but flush may be NULL */
+typedef struct
+{
+    void ( *flush )( void *ctx, const disp_area_t *area );     /* send the batched changes */
+    void ( *sleep )( void *ctx, bool sleep );                  /* panel off and asleep, or back */
+    void ( *brightness )( void *ctx, uint8_t level );
+    void *ctx;
+} disp_power_ops_t;
+
+typedef struct
+{
+    uint16_t min_interval;      /* ms, fastest refresh */
+    uint16_t max_interval;      /* ms, longest a change waits */
+    uint32_t dim_after;         /* ms after the last wake(), 0 never */
+    uint32_t sleep_after;       /* ms after the last wake(), 0 never */
+    uint8_t bright;             /* level while active */
+    uint8_t dim;                /* level while dimmed */
+    uint8_t ramp_step;          /* level change per ramp tick, 255 jumps */
+    uint8_t ramp_ms;            /* between ramp ticks */
+} disp_governor_cfg_t;
+
+typedef struct
+{
+    uint32_t changes;
+    uint32_t flushes;
+    uint32_t wakeups;           /* polls or events that used the bus */
+    uint32_t ramp_steps;
+    uint32_t sleeps;
+} disp_governor_stats_t;
+
+typedef enum
+{
+    DISP_GOV_ACTIVE = 0,
+    DISP_GOV_DIM    = 1,
+    DISP_GOV_SLEEP  = 2,
+} disp_governor_state_t;
+
+/* 30 fps at most, dim after 15 s and sleep after a minute */
+#define DISP_GOVERNOR_DEFAULTS { 33, 500, 15000, 60000, 255, 32, 16, 20 }
+
+class DispGovernor
+{
+private:
+    const disp_power_ops_t *m_ops;
+    disp_governor_cfg_t m_cfg;
+
+    uint8_t m_state;
+    bool m_dirty;
+    disp_area_t m_damage;
+
+    uint32_t m_last_change;
+    uint32_t m_last_flush;
+    uint32_t m_last_ramp;
+    uint32_t m_last_activity;
+    uint32_t m_gap;             /* average ms between changes */
+    uint16_t m_interval;
+
+    uint8_t m_level;
+    uint8_t m_target;
+
+    disp_governor_stats_t m_stats;
+
+    void wake_panel( uint32_t now );
+    bool may_sleep() const;
+
+public:
+    DispGovernor( const disp_power_ops_t *ops, const disp_governor_cfg_t *cfg );
+
+    void changed( uint32_t now, const disp_area_t *area );
+    void wake( uint32_t now );
+
+    bool poll( uint32_t now );
+    uint32_t next_poll( uint32_t now ) const;
+
+    disp_governor_state_t state() const
+    {
+        return ( disp_governor_state_t )m_state;
+    }
+
+    uint16_t interval() const
+    {
+        return m_interval;
+    }
+
+    const disp_governor_stats_t *stats() const
+    {
+        return &m_stats;
+    }
+};
+
+#endif
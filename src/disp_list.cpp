@@ -0,0 +1,447 @@
+/**
+ * @file disp_list.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Retained display list, redraws only the tiles that changed.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "disp_list.h"
+
+/* fnv-1a, folded to DISP_LIST_HASH_BITS when stored */
+#define DISP_HASH_SEED  (0x811C9DC5UL)
+#define DISP_HASH_PRIME (0x01000193UL)
+
+static inline uint32_t disp_hash_byte( uint32_t h, uint8_t b )
+{
+    return ( h ^ b ) * DISP_HASH_PRIME;
+}
+
+static inline uint32_t disp_hash_word( uint32_t h, uint16_t w )
+{
+    h = disp_hash_byte( h, w & 0xFF );
+    return disp_hash_byte( h, w >> 8 );
+}
+
+static inline disp_hash_t disp_hash_fold( uint32_t h )
+{
+#if DISP_LIST_HASH_BITS == 16
+    return ( disp_hash_t )( h ^ ( h >> 16 ) );
+#else
+    return h;
+#endif
+}
+
+static inline uint32_t disp_hash_item( uint32_t h, disp_hash_t item )
+{
+#if DISP_LIST_HASH_BITS == 16
+    return disp_hash_word( h, item );
+#else
+    h = disp_hash_word( h, ( uint16_t )item );
+    return disp_hash_word( h, ( uint16_t )( item >> 16 ) );
+#endif
+}
+
+static inline void disp_tile_plot( const disp_area_t *tile, uint16_t *px,
+                                   disp_coord_t x, disp_coord_t y,
+                                   uint16_t color )
+{
+    if( disp_area_contains( tile, x, y ) ) {
+        px[( y - tile->y1 ) * ( tile->x2 - tile->x1 + 1 ) + ( x - tile->x1 )] = color;
+    }
+}
+
+// Constructors ////////////////////////////////////////////////////////////////
+
+/**
+ * @param tile_hash DISP_LIST_TILES( width, height ) entries, kept by pointer
+ */
+DispList::DispList( disp_coord_t width, disp_coord_t height,
+                    uint16_t background, disp_hash_t *tile_hash )
+{
+    m_width  = width;
+    m_height = height;
+    m_cols   = ( width + DISP_TILE_W - 1 ) / DISP_TILE_W;
+    m_rows   = ( height + DISP_TILE_H - 1 ) / DISP_TILE_H;
+    m_background = background;
+    m_tile_hash = tile_hash;
+
+    m_count = 0;
+    m_valid = false;
+    memset( &m_stats, 0, sizeof( m_stats ) );
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+/**
+ * @brief Start a new frame, the previous items are dropped.
+ */
+void DispList::begin()
+{
+    m_count = 0;
+}
+
+/**
+ * @brief Force every tile out on the next render, e.g. after the panel was
+ * drawn by someone else.
+ */
+void DispList::invalidate()
+{
+    m_valid = false;
+}
+
+bool DispList::add_rect( disp_coord_t x, disp_coord_t y,
+                         disp_coord_t w, disp_coord_t h, uint16_t color )
+{
+    disp_area_t bounds = { x, y, ( disp_coord_t )( x + w - 1 ),
+                           ( disp_coord_t )( y + h - 1 )
+                         };
+
+    return add( DISP_ITEM_RECT, color, &bounds ) != NULL;
+}
+
+bool DispList::add_fill_rect( disp_coord_t x, disp_coord_t y,
+                              disp_coord_t w, disp_coord_t h, uint16_t color )
+{
+    disp_area_t bounds = { x, y, ( disp_coord_t )( x + w - 1 ),
+                           ( disp_coord_t )( y + h - 1 )
+                         };
+
+    return add( DISP_ITEM_FILL_RECT, color, &bounds ) != NULL;
+}
+
+bool DispList::add_line( disp_coord_t x0, disp_coord_t y0,
+                         disp_coord_t x1, disp_coord_t y1, uint16_t color )
+{
+    disp_area_t bounds = { disp_min( x0, x1 ), disp_min( y0, y1 ),
+                           disp_max( x0, x1 ), disp_max( y0, y1 )
+                         };
+    disp_item_t *item = add( DISP_ITEM_LINE, color, &bounds );
+    uint32_t h;
+
+    if( !item ) {
+        return false;
+    }
+
+    /* the bounds alone do not tell the two diagonals apart */
+    item->u.line.x0 = x0;
+    item->u.line.y0 = y0;
+    item->u.line.x1 = x1;
+    item->u.line.y1 = y1;
+
+    h = disp_hash_word( item->hash, x0 );
+    h = disp_hash_word( h, y0 );
+    item->hash = disp_hash_fold( h );
+
+    return true;
+}
+
+bool DispList::add_text( disp_coord_t x, disp_coord_t y, const char *str,
+                         const disp_font_t *font, uint16_t color, uint16_t bg,
+                         bool transparent )
+{
+    size_t len = strlen( str );
+    disp_area_t bounds = { x, y,
+                           ( disp_coord_t )( x + len * font->advance - 1 ),
+                           ( disp_coord_t )( y + font->height - 1 )
+                         };
+    disp_item_t *item;
+    uint32_t h;
+
+    if( !len ) {
+        return true;
+    }
+
+    item = add( DISP_ITEM_TEXT, color, &bounds );
+
+    if( !item ) {
+        return false;
+    }
+
+    item->bg = bg;
+    item->transparent = transparent;
+    item->u.text.str  = str;
+    item->u.text.font = font;
+
+    h = disp_hash_word( item->hash, bg );
+    h = disp_hash_byte( h, transparent );
+    h = disp_hash_word( h, ( uint16_t )( uintptr_t )font );
+
+    while( *str ) {
+        h = disp_hash_byte( h, *str++ );
+    }
+
+    item->hash = disp_hash_fold( h );
+
+    return true;
+}
+
+bool DispList::add_bitmap( disp_coord_t x, disp_coord_t y,
+                           disp_coord_t w, disp_coord_t h, const uint8_t *bits,
+                           uint16_t color, uint16_t bg, bool transparent )
+{
+    disp_area_t bounds = { x, y, ( disp_coord_t )( x + w - 1 ),
+                           ( disp_coord_t )( y + h - 1 )
+                         };
+    disp_item_t *item = add( DISP_ITEM_BITMAP, color, &bounds );
+    uint16_t n = ( ( w + 7 ) / 8 ) * h;
+    uint32_t hash;
+
+    if( !item ) {
+        return false;
+    }
+
+    item->bg = bg;
+    item->transparent = transparent;
+    item->u.bitmap.bits = bits;
+    item->u.bitmap.w = w;
+    item->u.bitmap.h = h;
+
+    hash = disp_hash_word( item->hash, bg );
+    hash = disp_hash_byte( hash, transparent );
+
+    while( n-- ) {
+        hash = disp_hash_byte( hash, *bits++ );
+    }
+
+    item->hash = disp_hash_fold( hash );
+
+    return true;
+}
+
+/**
+ * @brief Hash every tile, render and send the ones that changed since
+ * the previous call.
+ */
+void DispList::render( const disp_tile_ops_t *ops )
+{
+    uint16_t px[DISP_TILE_W * DISP_TILE_H];
+    uint16_t row, col, t = 0;
+    uint8_t i;
+
+    m_stats.tiles_total = m_cols * m_rows;
+    m_stats.tiles_rendered = 0;
+    m_stats.pixels_sent = 0;
+
+    for( row = 0; row < m_rows; row++ )
+    {
+        for( col = 0; col < m_cols; col++, t++ )
+        {
+            disp_area_t tile;
+            uint32_t h = DISP_HASH_SEED;
+            uint16_t n, k;
+            disp_hash_t hash;
+
+            tile.x1 = col * DISP_TILE_W;
+            tile.y1 = row * DISP_TILE_H;
+            tile.x2 = disp_min( tile.x1 + DISP_TILE_W - 1, m_width - 1 );
+            tile.y2 = disp_min( tile.y1 + DISP_TILE_H - 1, m_height - 1 );
+
+            for( i = 0; i < m_count; i++ )
+            {
+                disp_area_t hit;
+
+                if( disp_area_intersect( &hit, &m_items[i].bounds, &tile ) ) {
+                    h = disp_hash_item( h, m_items[i].hash );
+                }
+            }
+
+            hash = disp_hash_fold( h );
+
+            if( m_valid && m_tile_hash[t] == hash ) {
+                continue;
+            }
+
+            m_tile_hash[t] = hash;
+
+            n = ( tile.x2 - tile.x1 + 1 ) * ( tile.y2 - tile.y1 + 1 );
+
+            for( k = 0; k < n; k++ ) {
+                px[k] = m_background;
+            }
+
+            for( i = 0; i < m_count; i++ )
+            {
+                disp_area_t hit;
+
+                if( disp_area_intersect( &hit, &m_items[i].bounds, &tile ) ) {
+                    draw_item( &m_items[i], &tile, px );
+                }
+            }
+
+            ops->flush_tile( ops->ctx, &tile, px );
+
+            m_stats.tiles_rendered++;
+            m_stats.pixels_sent += n;
+        }
+    }
+
+    m_valid = true;
+}
+
+// Private Methods //////////////////////////////////////////////////////////////
+disp_item_t *DispList::add( uint8_t type, uint16_t color,
+                            const disp_area_t *bounds )
+{
+    disp_item_t *item;
+    uint32_t h = DISP_HASH_SEED;
+
+    if( m_count >= DISP_LIST_MAX_ITEMS || disp_area_is_empty( bounds ) ) {
+        return NULL;
+    }
+
+    item = &m_items[m_count++];
+    item->type   = type;
+    item->color  = color;
+    item->bg     = 0;
+    item->transparent = 0;
+    item->bounds = *bounds;
+
+    h = disp_hash_byte( h, type );
+    h = disp_hash_word( h, color );
+    h = disp_hash_word( h, bounds->x1 );
+    h = disp_hash_word( h, bounds->y1 );
+    h = disp_hash_word( h, bounds->x2 );
+    h = disp_hash_word( h, bounds->y2 );
+    item->hash = disp_hash_fold( h );
+
+    return item;
+}
+
+/**
+ * @brief Draw the part of an item that falls inside one tile.
+ */
+void DispList::draw_item( const disp_item_t *item, const disp_area_t *tile,
+                          uint16_t *px )
+{
+    const disp_area_t *b = &item->bounds;
+    disp_coord_t stride = tile->x2 - tile->x1 + 1;
+    disp_area_t hit;
+    disp_coord_t x, y;
+
+    disp_area_intersect( &hit, b, tile );
+
+    switch( item->type )
+    {
+    case DISP_ITEM_FILL_RECT:
+        for( y = hit.y1; y <= hit.y2; y++ )
+        {
+            uint16_t *p = px + ( y - tile->y1 ) * stride + ( hit.x1 - tile->x1 );
+
+            for( x = hit.x1; x <= hit.x2; x++ ) {
+                *p++ = item->color;
+            }
+        }
+        break;
+
+    case DISP_ITEM_RECT:
+        for( x = hit.x1; x <= hit.x2; x++ )
+        {
+            disp_tile_plot( tile, px, x, b->y1, item->color );
+            disp_tile_plot( tile, px, x, b->y2, item->color );
+        }
+
+        for( y = hit.y1; y <= hit.y2; y++ )
+        {
+            disp_tile_plot( tile, px, b->x1, y, item->color );
+            disp_tile_plot( tile, px, b->x2, y, item->color );
+        }
+        break;
+
+    case DISP_ITEM_LINE:
+    {
+        /*
+         * walk the whole line so every tile rasterizes exactly the same
+         * pixels, clipping the end points would move them at tile seams
+         */
+        disp_coord_t x0 = item->u.line.x0, y0 = item->u.line.y0;
+        disp_coord_t x1 = item->u.line.x1, y1 = item->u.line.y1;
+        disp_coord_t dx = x1 > x0 ? x1 - x0 : x0 - x1;
+        disp_coord_t dy = y1 > y0 ? y0 - y1 : y1 - y0;
+        disp_coord_t sx = x0 < x1 ? 1 : -1;
+        disp_coord_t sy = y0 < y1 ? 1 : -1;
+        int32_t err = dx + dy;
+
+        for( ;; )
+        {
+            int32_t e2 = 2 * err;
+
+            disp_tile_plot( tile, px, x0, y0, item->color );
+
+            if( x0 == x1 && y0 == y1 ) {
+                break;
+            }
+
+            if( e2 >= dy ) {
+                err += dy;
+                x0 += sx;
+            }
+
+            if( e2 <= dx ) {
+                err += dx;
+                y0 += sy;
+            }
+        }
+        break;
+    }
+
+    case DISP_ITEM_TEXT:
+    {
+        const disp_font_t *font = item->u.text.font;
+        const char *str = item->u.text.str;
+        disp_coord_t pen = b->x1;
+
+        for( ; *str && pen <= hit.x2; str++, pen += font->advance )
+        {
+            if( pen + font->advance <= hit.x1 ) {
+                continue;
+            }
+
+            for( x = disp_max( pen, hit.x1 );
+                 x <= disp_min( pen + font->advance - 1, hit.x2 ); x++ )
+            {
+                uint8_t bits = disp_font_column( font, *str, x - pen );
+
+                for( y = hit.y1; y <= hit.y2; y++ )
+                {
+                    if( bits & ( 1 << ( y - b->y1 ) ) ) {
+                        px[( y - tile->y1 ) * stride + ( x - tile->x1 )] = item->color;
+                    }
+                    else if( !item->transparent ) {
+                        px[( y - tile->y1 ) * stride + ( x - tile->x1 )] = item->bg;
+                    }
+                }
+            }
+        }
+        break;
+    }
+
+    case DISP_ITEM_BITMAP:
+    {
+        disp_coord_t bpr = ( item->u.bitmap.w + 7 ) / 8;
+
+        for( y = hit.y1; y <= hit.y2; y++ )
+        {
+            const uint8_t *row = item->u.bitmap.bits + ( y - b->y1 ) * bpr;
+
+            for( x = hit.x1; x <= hit.x2; x++ )
+            {
+                disp_coord_t bx = x - b->x1;
+
+                if( row[bx >> 3] & ( 0x80 >> ( bx & 7 ) ) ) {
+                    px[( y - tile->y1 ) * stride + ( x - tile->x1 )] = item->color;
+                }
+                else if( !item->transparent ) {
+                    px[( y - tile->y1 ) * stride + ( x - tile->x1 )] = item->bg;
+                }
+            }
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
@@ -0,0 +1,176 @@
+/**
+ * @file disp_list.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Retained display list, redraws only the tiles that changed.
+ *
+ * Each frame the application rebuilds the list between begin() and
+ * render(). The screen is split into DISP_TILE_W x DISP_TILE_H tiles and
+ * every tile gets a hash of the items touching it; tiles whose hash equals
+ * the previous frame are neither rendered nor sent.
+ *
+ * The tile hashes need DISP_LIST_TILES( width, height ) entries:
+ *
+ *   DispListBuffered<240, 135> list( bg );      table inside the object
+ *   DispList list( 240, 135, bg, my_hashes );   caller's table
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __DISP_LIST_H
+#define __DISP_LIST_H
+
+#include <inttypes.h>
+
+#include "disp_clip.h"
+#include "disp_font.h"
+
+#ifndef DISP_LIST_MAX_ITEMS
+    #define DISP_LIST_MAX_ITEMS (32)
+#endif
+
+/* 16x8 keeps one tile inside a single ssd1306 page */
+#ifndef DISP_TILE_W
+    #define DISP_TILE_W (16)
+#endif
+
+#ifndef DISP_TILE_H
+    #define DISP_TILE_H (8)
+#endif
+
+/* width of the stored item and tile hashes, 16 halves the tile table but
+ * lets an unrelated change keep its old hash more often */
+#ifndef DISP_LIST_HASH_BITS
+    #define DISP_LIST_HASH_BITS (32)
+#endif
+
+#if DISP_LIST_HASH_BITS == 16
+    typedef uint16_t disp_hash_t;
+#else
+    typedef uint32_t disp_hash_t;
+#endif
+
+/* tile hashes a width x height screen needs */
+#define DISP_LIST_TILES( w, h ) ( ( ( ( w ) + DISP_TILE_W - 1 ) / DISP_TILE_W ) * \
+                                  ( ( ( h ) + DISP_TILE_H - 1 ) / DISP_TILE_H ) )
+
+typedef enum
+{
+    DISP_ITEM_RECT        = 0x00,
+    DISP_ITEM_FILL_RECT   = 0x01,
+    DISP_ITEM_LINE        = 0x02,
+    DISP_ITEM_TEXT        = 0x03,
+    DISP_ITEM_BITMAP      = 0x04,
+} disp_item_type_t;
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t transparent;    /* text and bitmap: leave bg pixels alone */
+    uint16_t color;
+    uint16_t bg;
+    disp_area_t bounds;     /* screen area the item may touch */
+    disp_hash_t hash;       /* parameters and content, taken at add time */
+
+    union
+    {
+        struct
+        {
+            disp_coord_t x0, y0, x1, y1;
+        } line;
+
+        struct
+        {
+            const char *str;            /* must live until render() */
+            const disp_font_t *font;
+        } text;
+
+        struct
+        {
+            const uint8_t *bits;        /* 1bpp, row major, msb first */
+            disp_coord_t w, h;
+        } bitmap;
+    } u;
+} disp_item_t;
+
+/**
+ * @brief Receives one rendered tile, px holds (x2-x1+1)*(y2-y1+1)
+ * pixels row by row. Monochrome sinks treat any non zero pixel as on.
+ */
+typedef struct
+{
+    void ( *flush_tile )( void *ctx, const disp_area_t *area, const uint16_t *px );
+    void *ctx;
+} disp_tile_ops_t;
+
+typedef struct
+{
+    uint16_t tiles_total;
+    uint16_t tiles_rendered;
+    uint32_t pixels_sent;
+} disp_list_stats_t;
+
+class DispList
+{
+private:
+    disp_item_t m_items[DISP_LIST_MAX_ITEMS];
+    uint8_t m_count;
+
+    disp_coord_t m_width;
+    disp_coord_t m_height;
+    uint16_t m_cols;
+    uint16_t m_rows;
+    uint16_t m_background;
+
+    disp_hash_t *m_tile_hash;   /* DISP_LIST_TILES( m_width, m_height ) */
+    bool m_valid;   /* false until the first render, or after invalidate() */
+
+    disp_list_stats_t m_stats;
+
+    disp_item_t *add( uint8_t type, uint16_t color, const disp_area_t *bounds );
+    void draw_item( const disp_item_t *item, const disp_area_t *tile,
+                    uint16_t *px );
+
+public:
+    DispList( disp_coord_t width, disp_coord_t height, uint16_t background,
+              disp_hash_t *tile_hash );
+
+    void begin();
+    void invalidate();
+
+    bool add_rect( disp_coord_t x, disp_coord_t y,
+                   disp_coord_t w, disp_coord_t h, uint16_t color );
+    bool add_fill_rect( disp_coord_t x, disp_coord_t y,
+                        disp_coord_t w, disp_coord_t h, uint16_t color );
+    bool add_line( disp_coord_t x0, disp_coord_t y0,
+                   disp_coord_t x1, disp_coord_t y1, uint16_t color );
+    bool add_text( disp_coord_t x, disp_coord_t y, const char *str,
+                   const disp_font_t *font, uint16_t color, uint16_t bg,
+                   bool transparent = false );
+    bool add_bitmap( disp_coord_t x, disp_coord_t y,
+                     disp_coord_t w, disp_coord_t h, const uint8_t *bits,
+                     uint16_t color, uint16_t bg, bool transparent = false );
+
+    void render( const disp_tile_ops_t *ops );
+
+    const disp_list_stats_t *stats() const
+    {
+        return &m_stats;
+    }
+};
+
+template <disp_coord_t W, disp_coord_t H>
+class DispListBuffered : public DispList
+{
+    static_assert( W > 0 && H > 0, "empty screen" );
+
+private:
+    disp_hash_t m_hash[DISP_LIST_TILES( W, H )];
+
+public:
+    DispListBuffered( uint16_t background )
+        : DispList( W, H, background, m_hash )
+    {
+    }
+};
+
+#endif
@@ -0,0 +1,612 @@
+/**
+ * @file disp_raster.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Span based rasterizer for lines, circles, rounded rectangles and
+ * polygons.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "disp_raster.h"
+
+static const disp_area_t disp_no_clip = { -32768, -32768, 32767, 32767 };
+
+static inline const disp_area_t *raster_area( const disp_raster_t *r )
+{
+    return r->clip ? &disp_clip_current( r->clip )->area : &disp_no_clip;
+}
+
+static inline void raster_origin( const disp_raster_t *r,
+                                  disp_coord_t *x, disp_coord_t *y )
+{
+    if( r->clip ) {
+        *x += disp_clip_current( r->clip )->ox;
+        *y += disp_clip_current( r->clip )->oy;
+    }
+}
+
+/* span in screen coordinates, x1 and x2 inclusive */
+static void raster_span( disp_raster_t *r, int32_t x1, int32_t x2,
+                         int32_t y, uint16_t color )
+{
+    const disp_area_t *a = raster_area( r );
+
+    if( y < a->y1 || y > a->y2 ) {
+        return;
+    }
+
+    if( x1 < a->x1 ) {
+        x1 = a->x1;
+    }
+
+    if( x2 > a->x2 ) {
+        x2 = a->x2;
+    }
+
+    if( x2 < x1 ) {
+        return;
+    }
+
+    r->span( r->ctx, x1, y, x2 - x1 + 1, color );
+    r->spans++;
+    r->pixels += x2 - x1 + 1;
+}
+
+/* solid block in screen coordinates */
+static void raster_fill( disp_raster_t *r, int32_t x1, int32_t y1,
+                         int32_t x2, int32_t y2, uint16_t color )
+{
+    const disp_area_t *a = raster_area( r );
+    int32_t y;
+
+    x1 = x1 < a->x1 ? a->x1 : x1;
+    y1 = y1 < a->y1 ? a->y1 : y1;
+    x2 = x2 > a->x2 ? a->x2 : x2;
+    y2 = y2 > a->y2 ? a->y2 : y2;
+
+    if( x2 < x1 || y2 < y1 ) {
+        return;
+    }
+
+    if( r->fill ) {
+        r->fill( r->ctx, x1, y1, x2 - x1 + 1, y2 - y1 + 1, color );
+        r->spans++;
+        r->pixels += ( uint32_t )( x2 - x1 + 1 ) * ( y2 - y1 + 1 );
+        return;
+    }
+
+    for( y = y1; y <= y2; y++ ) {
+        raster_span( r, x1, x2, y, color );
+    }
+}
+
+static void raster_blend( disp_raster_t *r, int32_t x, int32_t y,
+                          uint16_t color, uint8_t alpha )
+{
+    const disp_area_t *a = raster_area( r );
+
+    if( !alpha || x < a->x1 || x > a->x2 || y < a->y1 || y > a->y2 ) {
+        return;
+    }
+
+    if( r->blend ) {
+        r->blend( r->ctx, x, y, color, alpha );
+        r->spans++;
+        r->pixels++;
+    }
+    else if( alpha >= 128 ) {
+        raster_span( r, x, x, y, color );
+    }
+}
+
+/* true if the screen box misses the clip area entirely */
+static inline bool raster_reject( const disp_raster_t *r,
+                                  int32_t x1, int32_t y1,
+                                  int32_t x2, int32_t y2 )
+{
+    const disp_area_t *a = raster_area( r );
+
+    return x2 < a->x1 || x1 > a->x2 || y2 < a->y1 || y1 > a->y2 ||
+           disp_area_is_empty( a );
+}
+
+/* half width of circle row dy, -1 past the radius */
+static inline int32_t circle_width( int32_t radius, int32_t dy, int32_t prev )
+{
+    int32_t limit = radius * radius + radius;
+
+    if( dy > radius ) {
+        return -1;
+    }
+
+    while( prev > 0 && prev * prev + dy * dy > limit ) {
+        prev--;
+    }
+
+    return prev;
+}
+
+/*
+ * Shared by the arc functions, centers may differ per quadrant so rounded
+ * rectangles can reuse it: (lx, ty) is the top left center and (rx, by)
+ * the bottom right one.
+ */
+static void raster_arcs( disp_raster_t *r, int32_t lx, int32_t ty,
+                         int32_t rx, int32_t by, int32_t radius,
+                         uint8_t quadrants, bool filled, uint16_t color )
+{
+    int32_t dy, w, next;
+    bool left_top = quadrants & DISP_QUAD_TOP_LEFT;
+    bool right_top = quadrants & DISP_QUAD_TOP_RIGHT;
+    bool left_bottom = quadrants & DISP_QUAD_BOTTOM_LEFT;
+    bool right_bottom = quadrants & DISP_QUAD_BOTTOM_RIGHT;
+
+    if( radius < 0 || raster_reject( r, lx - radius, ty - radius,
+                                     rx + radius, by + radius ) ) {
+        return;
+    }
+
+    w = circle_width( radius, 0, radius );
+
+    for( dy = 0; dy <= radius; dy++ )
+    {
+        int32_t inner;
+
+        next = circle_width( radius, dy + 1, w );
+
+        if( filled ) {
+            inner = 0;
+        }
+        else {
+            inner = next < w ? next + 1 : w;
+        }
+
+        for( uint8_t half = 0; half < 2; half++ )
+        {
+            bool l = half ? left_bottom : left_top;
+            bool rt = half ? right_bottom : right_top;
+            int32_t y = half ? by + dy : ty - dy;
+
+            /* with a single center the middle row is shared by both halves */
+            if( dy == 0 && ty == by ) {
+                if( half ) {
+                    break;
+                }
+
+                l = left_top || left_bottom;
+                rt = right_top || right_bottom;
+            }
+
+            /* both sides reach the center, send the row as one span */
+            if( l && rt && inner == 0 ) {
+                raster_span( r, lx - w, rx + w, y, color );
+                continue;
+            }
+
+            if( l ) {
+                raster_span( r, lx - w, lx - inner, y, color );
+            }
+
+            if( rt ) {
+                raster_span( r, rx + inner, rx + w, y, color );
+            }
+        }
+
+        w = next;
+    }
+}
+
+/*
+ * First and last step of a line from a to a + s * n, s = +-1, that fall in
+ * [lo, hi] on that axis. Empty when *first > *last.
+ */
+static inline void raster_steps( int32_t a, int32_t s, int32_t n,
+                                 int32_t lo, int32_t hi,
+                                 int32_t *first, int32_t *last )
+{
+    *first = s > 0 ? lo - a : a - hi;
+    *last = s > 0 ? hi - a : a - lo;
+    *first = *first < 0 ? 0 : *first;
+    *last = *last > n ? n : *last;
+}
+
+/*
+ * Bresenham line in screen coordinates. After i steps along the major axis
+ * the minor one has moved floor((2 * i * minor + major) / (2 * major)),
+ * the same pixels as the textbook loop, so the walk can start where the
+ * line enters the clip area and stops where it leaves. The end points are
+ * never moved, a clipped line keeps every pixel it has unclipped.
+ */
+static void raster_line( disp_raster_t *r, int32_t x0, int32_t y0,
+                         int32_t x1, int32_t y1, uint16_t color )
+{
+    const disp_area_t *a = raster_area( r );
+    int32_t dx, dy, sx, sy, major, minor, first, last, i;
+    int32_t x, y, rem, run_x, run_y;
+    bool steep;
+
+    if( x0 == x1 || y0 == y1 ) {
+        raster_fill( r, x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1,
+                     x0 < x1 ? x1 : x0, y0 < y1 ? y1 : y0, color );
+        return;
+    }
+
+    if( raster_reject( r, x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1,
+                       x0 < x1 ? x1 : x0, y0 < y1 ? y1 : y0 ) ) {
+        return;
+    }
+
+    dx = x1 > x0 ? x1 - x0 : x0 - x1;
+    dy = y1 > y0 ? y1 - y0 : y0 - y1;
+    sx = x0 < x1 ? 1 : -1;
+    sy = y0 < y1 ? 1 : -1;
+    steep = dy > dx;
+    major = steep ? dy : dx;
+    minor = steep ? dx : dy;
+
+    if( steep ) {
+        raster_steps( y0, sy, major, a->y1, a->y2, &first, &last );
+    }
+    else {
+        raster_steps( x0, sx, major, a->x1, a->x2, &first, &last );
+    }
+
+    if( first > last ) {
+        return;
+    }
+
+    /* position and remainder after `first` steps, 64 bit only here */
+    {
+        int64_t num = 2 * ( int64_t )first * minor + major;
+        int32_t m = ( int32_t )( num / ( 2 * major ) );
+
+        rem = ( int32_t )( num - ( int64_t )m * 2 * major );
+        x = steep ? x0 + sx * m : x0 + sx * first;
+        y = steep ? y0 + sy * first : y0 + sy * m;
+    }
+
+    run_x = x;
+    run_y = y;
+
+    for( i = first; i < last; i++ )
+    {
+        int32_t px = x;
+
+        rem += 2 * minor;
+
+        if( rem >= 2 * major ) {
+            rem -= 2 * major;
+
+            if( steep ) {
+                x += sx;
+            }
+            else {
+                y += sy;
+            }
+        }
+
+        if( steep ) {
+            y += sy;
+        }
+        else {
+            x += sx;
+        }
+
+        /* pixels on one row make one span */
+        if( y != run_y ) {
+            raster_span( r, run_x < px ? run_x : px, run_x < px ? px : run_x, run_y, color );
+            run_x = x;
+            run_y = y;
+        }
+    }
+
+    raster_span( r, run_x < x ? run_x : x, run_x < x ? x : run_x, run_y, color );
+}
+
+// Public Functions /////////////////////////////////////////////////////////////
+
+/**
+ * @brief One clipped span, coordinates relative to the current viewport.
+ */
+void disp_raster_hspan( disp_raster_t *r, disp_coord_t x, disp_coord_t y,
+                        disp_coord_t len, uint16_t color )
+{
+    if( len <= 0 ) {
+        return;
+    }
+
+    raster_origin( r, &x, &y );
+    raster_span( r, x, ( int32_t )x + len - 1, y, color );
+}
+
+/**
+ * @brief Bresenham line, consecutive pixels on a row are merged into one
+ * span and straight lines are sent as a single block. Clipping drops
+ * pixels, it never moves the end points.
+ */
+void disp_draw_line( disp_raster_t *r, disp_coord_t x0, disp_coord_t y0,
+                     disp_coord_t x1, disp_coord_t y1, uint16_t color )
+{
+    disp_coord_t ox = 0, oy = 0;
+
+    raster_origin( r, &ox, &oy );
+    raster_line( r, ( int32_t )x0 + ox, ( int32_t )y0 + oy,
+                 ( int32_t )x1 + ox, ( int32_t )y1 + oy, color );
+}
+
+/**
+ * @brief Xiaolin Wu anti-aliased line. Each pixel goes through the blend
+ * callback with its coverage; without one, pixels over half covered are
+ * drawn solid. Like disp_draw_line(), only the steps inside the clip area
+ * are walked and the end points stay where they are.
+ */
+void disp_draw_line_aa( disp_raster_t *r, disp_coord_t x0, disp_coord_t y0,
+                        disp_coord_t x1, disp_coord_t y1, uint16_t color )
+{
+    const disp_area_t *a = raster_area( r );
+    disp_coord_t ox = 0, oy = 0;
+    int32_t ax, ay, bx, by, dx, dy, first, last, i, y, grad_int;
+    uint32_t frac, grad_frac;
+    bool steep;
+
+    raster_origin( r, &ox, &oy );
+    ax = ( int32_t )x0 + ox;
+    ay = ( int32_t )y0 + oy;
+    bx = ( int32_t )x1 + ox;
+    by = ( int32_t )y1 + oy;
+    dx = bx - ax;
+    dy = by - ay;
+
+    /* axis aligned and 45 degree lines have nothing to smooth */
+    if( dx == 0 || dy == 0 || dx == dy || dx == -dy ) {
+        raster_line( r, ax, ay, bx, by, color );
+        return;
+    }
+
+    steep = ( dy < 0 ? -dy : dy ) > ( dx < 0 ? -dx : dx );
+
+    if( steep ) {
+        int32_t t;
+
+        t = ax;
+        ax = ay;
+        ay = t;
+        t = bx;
+        bx = by;
+        by = t;
+    }
+
+    if( ax > bx ) {
+        int32_t t;
+
+        t = ax;
+        ax = bx;
+        bx = t;
+        t = ay;
+        ay = by;
+        by = t;
+    }
+
+    raster_steps( ax, 1, bx - ax, steep ? a->y1 : a->x1, steep ? a->y2 : a->x2,
+                  &first, &last );
+
+    if( first > last ) {
+        return;
+    }
+
+    /*
+     * 16.16 fixed point, y at step i is y0 + i * grad; the start is worked
+     * out in 64 bit, the walk carries the fraction by hand
+     */
+    {
+        int64_t grad = ( ( int64_t )( by - ay ) << 16 ) / ( bx - ax );
+        int64_t inter = ( ( int64_t )ay << 16 ) + grad * first;
+
+        y = ( int32_t )( inter >> 16 );
+        frac = ( uint32_t )inter & 0xFFFF;
+        grad_int = ( int32_t )( grad >> 16 );
+        grad_frac = ( uint32_t )grad & 0xFFFF;
+    }
+
+    for( i = ax + first; i <= ax + last; i++ )
+    {
+        uint8_t cover = frac >> 8;
+
+        if( steep ) {
+            raster_blend( r, y, i, color, 255 - cover );
+            raster_blend( r, y + 1, i, color, cover );
+        }
+        else {
+            raster_blend( r, i, y, color, 255 - cover );
+            raster_blend( r, i, y + 1, color, cover );
+        }
+
+        frac += grad_frac;
+        y += grad_int + ( int32_t )( frac >> 16 );
+        frac &= 0xFFFF;
+    }
+}
+
+void disp_draw_arc( disp_raster_t *r, disp_coord_t cx, disp_coord_t cy,
+                    disp_coord_t radius, uint8_t quadrants, uint16_t color )
+{
+    raster_origin( r, &cx, &cy );
+    raster_arcs( r, cx, cy, cx, cy, radius, quadrants, false, color );
+}
+
+void disp_fill_arc( disp_raster_t *r, disp_coord_t cx, disp_coord_t cy,
+                    disp_coord_t radius, uint8_t quadrants, uint16_t color )
+{
+    raster_origin( r, &cx, &cy );
+    raster_arcs( r, cx, cy, cx, cy, radius, quadrants, true, color );
+}
+
+void disp_draw_circle( disp_raster_t *r, disp_coord_t cx, disp_coord_t cy,
+                       disp_coord_t radius, uint16_t color )
+{
+    disp_draw_arc( r, cx, cy, radius, DISP_QUAD_ALL, color );
+}
+
+void disp_fill_circle( disp_raster_t *r, disp_coord_t cx, disp_coord_t cy,
+                       disp_coord_t radius, uint16_t color )
+{
+    disp_fill_arc( r, cx, cy, radius, DISP_QUAD_ALL, color );
+}
+
+void disp_draw_round_rect( disp_raster_t *r, disp_coord_t x, disp_coord_t y,
+                           disp_coord_t w, disp_coord_t h,
+                           disp_coord_t radius, uint16_t color )
+{
+    int32_t x2, y2;
+
+    if( w <= 0 || h <= 0 ) {
+        return;
+    }
+
+    raster_origin( r, &x, &y );
+    x2 = ( int32_t )x + w - 1;
+    y2 = ( int32_t )y + h - 1;
+
+    if( raster_reject( r, x, y, x2, y2 ) ) {
+        return;
+    }
+
+    radius = disp_max( 0, disp_min( radius, disp_min( w, h ) / 2 - 1 ) );
+
+    raster_arcs( r, x + radius, y + radius, x2 - radius, y2 - radius,
+                 radius, DISP_QUAD_ALL, false, color );
+
+    /* the arcs close the top and bottom edges, only the sides are left */
+    raster_fill( r, x, y + radius + 1, x, y2 - radius - 1, color );
+    raster_fill( r, x2, y + radius + 1, x2, y2 - radius - 1, color );
+}
+
+void disp_fill_round_rect( disp_raster_t *r, disp_coord_t x, disp_coord_t y,
+                           disp_coord_t w, disp_coord_t h,
+                           disp_coord_t radius, uint16_t color )
+{
+    int32_t x2, y2;
+
+    if( w <= 0 || h <= 0 ) {
+        return;
+    }
+
+    raster_origin( r, &x, &y );
+    x2 = ( int32_t )x + w - 1;
+    y2 = ( int32_t )y + h - 1;
+
+    if( raster_reject( r, x, y, x2, y2 ) ) {
+        return;
+    }
+
+    radius = disp_max( 0, disp_min( radius, disp_min( w, h ) / 2 - 1 ) );
+
+    /* caps are one span per row, the body is a single block */
+    raster_arcs( r, x + radius, y + radius, x2 - radius, y2 - radius,
+                 radius, DISP_QUAD_ALL, true, color );
+    raster_fill( r, x, y + radius + 1, x2, y2 - radius - 1, color );
+}
+
+/* floor division for a positive divisor */
+static inline int32_t floor_div( int32_t a, int32_t b )
+{
+    return a >= 0 ? a / b : -( ( -a + b - 1 ) / b );
+}
+
+/**
+ * @brief Fill a polygon with the even-odd rule, sampling pixel centers.
+ *
+ * @param xy     count x, y pairs
+ * @return false if count is out of range
+ */
+bool disp_fill_polygon( disp_raster_t *r, const disp_coord_t *xy,
+                        uint8_t count, uint16_t color )
+{
+    const disp_area_t *a = raster_area( r );
+    disp_coord_t ox = 0, oy = 0;
+    int32_t ymin = 32767, ymax = -32768, xmin = 32767, xmax = -32768;
+    int32_t cross[DISP_POLY_MAX_VERTS];
+    int32_t y;
+    uint8_t i;
+
+    if( count < 3 || count > DISP_POLY_MAX_VERTS ) {
+        return false;
+    }
+
+    raster_origin( r, &ox, &oy );
+
+    for( i = 0; i < count; i++ )
+    {
+        int32_t vx = xy[2 * i] + ox, vy = xy[2 * i + 1] + oy;
+
+        xmin = vx < xmin ? vx : xmin;
+        xmax = vx > xmax ? vx : xmax;
+        ymin = vy < ymin ? vy : ymin;
+        ymax = vy > ymax ? vy : ymax;
+    }
+
+    if( raster_reject( r, xmin, ymin, xmax, ymax ) ) {
+        return true;
+    }
+
+    ymin = ymin < a->y1 ? a->y1 : ymin;
+    ymax = ymax > a->y2 ? a->y2 : ymax;
+
+    for( y = ymin; y <= ymax; y++ )
+    {
+        uint8_t n = 0;
+
+        for( i = 0; i < count; i++ )
+        {
+            uint8_t j = ( i + 1 == count ) ? 0 : i + 1;
+            int32_t xa = xy[2 * i] + ox, ya = xy[2 * i + 1] + oy;
+            int32_t xb = xy[2 * j] + ox, yb = xy[2 * j + 1] + oy;
+            int32_t den, num;
+
+            if( ya == yb ) {
+                continue;
+            }
+
+            if( ya > yb ) {
+                int32_t t;
+
+                t = xa;
+                xa = xb;
+                xb = t;
+                t = ya;
+                ya = yb;
+                yb = t;
+            }
+
+            /* does the row center y + 0.5 fall in [ya, yb) */
+            if( 2 * y + 1 < 2 * ya || 2 * y + 1 >= 2 * yb ) {
+                continue;
+            }
+
+            /* crossing x = num / den, keep the first pixel center right of it */
+            den = 2 * ( yb - ya );
+            num = xa * den + ( 2 * y + 1 - 2 * ya ) * ( xb - xa );
+            cross[n++] = -floor_div( -( 2 * num - den ), 2 * den );
+        }
+
+        /* insertion sort, n is tiny */
+        for( i = 1; i < n; i++ )
+        {
+            int32_t v = cross[i];
+            uint8_t k = i;
+
+            while( k && cross[k - 1] > v ) {
+                cross[k] = cross[k - 1];
+                k--;
+            }
+
+            cross[k] = v;
+        }
+
+        for( i = 0; i + 1 < n; i += 2 ) {
+            raster_span( r, cross[i], cross[i + 1] - 1, y, color );
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file disp_raster.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Span based rasterizer for lines, circles, rounded rectangles and
+ * polygons.
+ *
+ * Every shape is broken into horizontal spans which are clipped once and
+ * handed to the driver, so a span becomes one address window plus a color
+ * run on the st7789v, or one masked byte run in the ssd1306 page buffer.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __DISP_RASTER_H
+#define __DISP_RASTER_H
+
+#include <inttypes.h>
+
+#include "disp_clip.h"
+
+/* max vertices of disp_fill_polygon() */
+#ifndef DISP_POLY_MAX_VERTS
+    #define DISP_POLY_MAX_VERTS (16)
+#endif
+
+/* quadrant mask for arcs, in screen orientation */
+#define DISP_QUAD_TOP_RIGHT    (0x01)
+#define DISP_QUAD_BOTTOM_RIGHT (0x02)
+#define DISP_QUAD_BOTTOM_LEFT  (0x04)
+#define DISP_QUAD_TOP_LEFT     (0x08)
+#define DISP_QUAD_ALL          (0x0F)
+
+typedef struct
+{
+    /* x and y are screen coordinates, already clipped, len > 0 */
+    void ( *span )( void *ctx, disp_coord_t x, disp_coord_t y,
+                    disp_coord_t len, uint16_t color );
+    /* solid rectangle, may be NULL, then it is sent as spans */
+    void ( *fill )( void *ctx, disp_coord_t x, disp_coord_t y,
+                    disp_coord_t w, disp_coord_t h, uint16_t color );
+    /* one pixel with coverage alpha 0 ~ 255, may be NULL */
+    void ( *blend )( void *ctx, disp_coord_t x, disp_coord_t y,
+                     uint16_t color, uint8_t alpha );
+    void *ctx;
+
+    const disp_clip_t *clip;
+
+    /* statistics, reset by the caller */
+    uint32_t spans;
+    uint32_t pixels;
+} disp_raster_t;
+
+/**
+ * @brief Mix two rgb565 colors, alpha 255 gives fg.
+ */
+static inline uint16_t disp_rgb565_mix( uint16_t fg, uint16_t bg, uint8_t alpha )
+{
+    uint16_t ia = 255 - alpha;
+    uint16_t r = ( ( fg >> 11 ) * alpha + ( bg >> 11 ) * ia + 127 ) / 255;
+    uint16_t g = ( ( ( fg >> 5 ) & 0x3F ) * alpha + ( ( bg >> 5 ) & 0x3F ) * ia + 127 ) / 255;
+    uint16_t b = ( ( fg & 0x1F ) * alpha + ( bg & 0x1F ) * ia + 127 ) / 255;
+
+    return ( r << 11 ) | ( g << 5 ) | b;
+}
+
+void disp_raster_hspan( disp_raster_t *r, disp_coord_t x, disp_coord_t y,
+                        disp_coord_t len, uint16_t color );
+
+void disp_draw_line( disp_raster_t *r, disp_coord_t x0, disp_coord_t y0,
+                     disp_coord_t x1, disp_coord_t y1, uint16_t color );
+void disp_draw_line_aa( disp_raster_t *r, disp_coord_t x0, disp_coord_t y0,
+                        disp_coord_t x1, disp_coord_t y1, uint16_t color );
+
+void disp_draw_arc( disp_raster_t *r, disp_coord_t cx, disp_coord_t cy,
+                    disp_coord_t radius, uint8_t quadrants, uint16_t color );
+void disp_fill_arc( disp_raster_t *r, disp_coord_t cx, disp_coord_t cy,
+                    disp_coord_t radius, uint8_t quadrants, uint16_t color );
+void disp_draw_circle( disp_raster_t *r, disp_coord_t cx, disp_coord_t cy,
+                       disp_coord_t radius, uint16_t color );
+void disp_fill_circle( disp_raster_t *r, disp_coord_t cx, disp_coord_t cy,
+                       disp_coord_t radius, uint16_t color );
+
+void disp_draw_round_rect( disp_raster_t *r, disp_coord_t x, disp_coord_t y,
+                           disp_coord_t w, disp_coord_t h,
+                           disp_coord_t radius, uint16_t color );
+void disp_fill_round_rect( disp_raster_t *r, disp_coord_t x, disp_coord_t y,
+                           disp_coord_t w, disp_coord_t h,
+                           disp_coord_t radius, uint16_t color );
+
+bool disp_fill_polygon( disp_raster_t *r, const disp_coord_t *xy,
+                        uint8_t count, uint16_t color );
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * @file font5x7.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Classic 5x7 ascii font, shared by both display drivers.
+ *
+ * Glyphs are stored column by column, bit 0 is the top row, which is the
+ * same layout as one ssd1306 page byte.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __FONT5X7_H
+#define __FONT5X7_H
+
+#include "disp_font.h"
+
+extern const disp_font_t font5x7;
+
+#endif
@@ -0,0 +1,350 @@
+/**
+ * @file frame_stream.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Receiver for delta encoded frames sent over a serial link.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "frame_stream.h"
+
+enum
+{
+    FS_SYNC0,
+    FS_SYNC1,
+    FS_SEQ,
+    FS_OP,
+    FS_HEAD,
+    FS_RAW,
+    FS_IDX,
+    FS_PAL,
+};
+
+/* header bytes after each op */
+static uint8_t frame_stream_head( uint8_t op )
+{
+    switch( op )
+    {
+    case FRAME_STREAM_END:
+    case FRAME_STREAM_RAW:
+    case FRAME_STREAM_IDX:
+        return 1;
+
+    case FRAME_STREAM_IRUN:
+    case FRAME_STREAM_PAL:
+        return 2;
+
+    case FRAME_STREAM_RUN:
+        return 3;
+
+    case FRAME_STREAM_RECT:
+        return 8;
+
+    default:
+        return 0;
+    }
+}
+
+// Constructors ////////////////////////////////////////////////////////////////
+FrameStreamRx::FrameStreamRx( const disp_line_ops_t *ops,
+                              disp_coord_t width, disp_coord_t height )
+{
+    m_ops = ops;
+    m_width = width;
+    m_height = height;
+
+    memset( m_palette, 0, sizeof( m_palette ) );
+    memset( &m_stats, 0, sizeof( m_stats ) );
+    m_seq = 0;
+    reset();
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+/**
+ * @brief Drop the frame in progress and wait for the next sync. The
+ * palette is kept, a host starting over sends it again anyway.
+ */
+void FrameStreamRx::reset()
+{
+    m_state = FS_SYNC0;
+    m_left = 0;
+    m_count = 0;
+    m_half = false;
+    m_buf_len = 0;
+}
+
+/**
+ * @brief Screen size rectangles are checked against, e.g. after the panel
+ * was rotated. The frame in progress is dropped.
+ */
+void FrameStreamRx::set_size( disp_coord_t width, disp_coord_t height )
+{
+    m_width = width;
+    m_height = height;
+    reset();
+}
+
+frame_stream_event_t FrameStreamRx::feed( uint8_t b )
+{
+    m_stats.bytes++;
+
+    switch( m_state )
+    {
+    case FS_SYNC0:
+        if( b == FRAME_STREAM_SYNC0 ) {
+            m_state = FS_SYNC1;
+        }
+        break;
+
+    case FS_SYNC1:
+        if( b != FRAME_STREAM_SYNC0 ) {
+            m_state = b == FRAME_STREAM_SYNC1 ? FS_SEQ : FS_SYNC0;
+        }
+        break;
+
+    case FS_SEQ:
+        m_seq = b;
+        m_sum = b;
+        m_left = 0;
+        m_state = FS_OP;
+        break;
+
+    case FS_OP:
+        m_sum += b;
+        m_op = b;
+        m_head_len = 0;
+        m_head_need = frame_stream_head( b );
+
+        if( !m_head_need ) {
+            return fail();
+        }
+
+        m_state = FS_HEAD;
+        break;
+
+    case FS_HEAD:
+        m_head[m_head_len++] = b;
+
+        if( m_op != FRAME_STREAM_END ) {
+            m_sum += b;
+        }
+
+        if( m_head_len < m_head_need ) {
+            break;
+        }
+
+        if( m_op == FRAME_STREAM_END )
+        {
+            flush();
+            m_state = FS_SYNC0;
+
+            if( b != m_sum || m_left ) {
+                return fail();
+            }
+
+            m_stats.frames++;
+
+            return FRAME_STREAM_DONE;
+        }
+
+        begin_op();
+
+        if( m_state == FS_SYNC0 ) {
+            return fail();
+        }
+        break;
+
+    case FS_RAW:
+    case FS_PAL:
+        m_sum += b;
+
+        if( !m_half ) {
+            m_hi = b;
+            m_half = true;
+            break;
+        }
+
+        m_half = false;
+
+        if( m_state == FS_RAW ) {
+            push( ( uint16_t )( ( m_hi << 8 ) | b ) );
+        }
+        else {
+            m_palette[m_pal_index++] = ( uint16_t )( ( m_hi << 8 ) | b );
+        }
+
+        if( !--m_count ) {
+            m_state = FS_OP;
+        }
+        break;
+
+    case FS_IDX:
+        m_sum += b;
+
+        if( b >= FRAME_STREAM_PALETTE_SIZE ) {
+            return fail();
+        }
+
+        push( m_palette[b] );
+
+        if( !--m_count ) {
+            m_state = FS_OP;
+        }
+        break;
+
+    default:
+        m_state = FS_SYNC0;
+        break;
+    }
+
+    return FRAME_STREAM_BUSY;
+}
+
+/**
+ * @brief Feed whatever has arrived, stopping at the end of a frame so the
+ * caller can acknowledge it.
+ */
+frame_stream_event_t FrameStreamRx::poll( Stream &in )
+{
+    while( in.available() > 0 )
+    {
+        frame_stream_event_t ev = feed( ( uint8_t )in.read() );
+
+        if( ev != FRAME_STREAM_BUSY ) {
+            return ev;
+        }
+    }
+
+    return FRAME_STREAM_BUSY;
+}
+
+// Private Methods //////////////////////////////////////////////////////////////
+
+/**
+ * @brief Act on a complete op header, leaves m_state at FS_SYNC0 if the
+ * op does not fit the rectangle or the palette.
+ */
+void FrameStreamRx::begin_op()
+{
+    uint16_t n = m_head[0] + 1;
+
+    m_state = FS_OP;
+
+    switch( m_op )
+    {
+    case FRAME_STREAM_RECT:
+    {
+        disp_area_t area;
+        uint16_t x = m_head[0] | ( m_head[1] << 8 );
+        uint16_t y = m_head[2] | ( m_head[3] << 8 );
+        uint16_t w = m_head[4] | ( m_head[5] << 8 );
+        uint16_t h = m_head[6] | ( m_head[7] << 8 );
+
+        if( m_left || !w || !h || ( uint32_t )x + w > ( uint32_t )m_width ||
+            ( uint32_t )y + h > ( uint32_t )m_height ) {
+            m_state = FS_SYNC0;
+            return;
+        }
+
+        flush();
+
+        area.x1 = x;
+        area.y1 = y;
+        area.x2 = x + w - 1;
+        area.y2 = y + h - 1;
+        m_ops->window( m_ops->ctx, &area );
+
+        m_left = ( uint32_t )w * h;
+        m_stats.rects++;
+        return;
+    }
+
+    case FRAME_STREAM_RAW:
+    case FRAME_STREAM_IDX:
+        if( n > m_left ) {
+            m_state = FS_SYNC0;
+            return;
+        }
+
+        m_count = n;
+        m_half = false;
+        m_state = m_op == FRAME_STREAM_RAW ? FS_RAW : FS_IDX;
+        return;
+
+    case FRAME_STREAM_RUN:
+    case FRAME_STREAM_IRUN:
+    {
+        uint16_t color;
+
+        if( n > m_left ) {
+            m_state = FS_SYNC0;
+            return;
+        }
+
+        if( m_op == FRAME_STREAM_RUN ) {
+            color = ( m_head[1] << 8 ) | m_head[2];
+        }
+        else if( m_head[1] < FRAME_STREAM_PALETTE_SIZE ) {
+            color = m_palette[m_head[1]];
+        }
+        else {
+            m_state = FS_SYNC0;
+            return;
+        }
+
+        while( n-- ) {
+            push( color );
+        }
+        return;
+    }
+
+    case FRAME_STREAM_PAL:
+        n = m_head[1] + 1;
+
+        if( m_head[0] + n > FRAME_STREAM_PALETTE_SIZE ) {
+            m_state = FS_SYNC0;
+            return;
+        }
+
+        m_pal_index = m_head[0];
+        m_count = n;
+        m_half = false;
+        m_state = FS_PAL;
+        return;
+
+    default:
+        m_state = FS_SYNC0;
+        return;
+    }
+}
+
+void FrameStreamRx::push( uint16_t color )
+{
+    m_buf[m_buf_len++] = color;
+    m_left--;
+    m_stats.pixels++;
+
+    if( m_buf_len == FRAME_STREAM_BUF ) {
+        flush();
+    }
+}
+
+void FrameStreamRx::flush()
+{
+    if( m_buf_len ) {
+        m_ops->line( m_ops->ctx, m_buf, m_buf_len );
+        m_buf_len = 0;
+    }
+}
+
+frame_stream_event_t FrameStreamRx::fail()
+{
+    flush();
+    reset();
+    m_stats.errors++;
+
+    return FRAME_STREAM_ERROR;
+}
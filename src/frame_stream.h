@@ -0,0 +1,130 @@
+/**
+ * @file frame_stream.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Receiver for delta encoded frames sent over a serial link.
+ *
+ * A host sends only what changed since the previous frame, as rectangles
+ * whose pixels follow in row order, raw, as runs of one color, or as
+ * indexes into a small palette kept by the receiver. Every rectangle is
+ * opened as one address window and its pixels go straight out through a
+ * line sink, e.g. ST7789V::line_ops(), so no framebuffer is needed.
+ *
+ *   A5 5A seq             start of a frame
+ *   01 x y w h            rectangle, 16 bit little endian each
+ *   02 n-1 c...           n raw colors
+ *   03 n-1 c              run of n times color c
+ *   04 n-1 i...           n palette indexes
+ *   05 n-1 i              run of n times palette entry i
+ *   06 first n-1 c...     set n palette entries from first on
+ *   00 sum                end of frame
+ *
+ * Colors are RGB565, high byte first as the panel takes them. sum is the
+ * 8 bit sum of every byte from seq up to and including the 00. Pixels
+ * already sent can not be taken back, so on an error the host should
+ * follow with a key frame that repaints the whole screen.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __FRAME_STREAM_H
+#define __FRAME_STREAM_H
+
+#include <Arduino.h>
+#include <inttypes.h>
+
+#include "disp_clip.h"
+#include "disp_compositor.h"
+
+#define FRAME_STREAM_SYNC0 0xA5
+#define FRAME_STREAM_SYNC1 0x5A
+
+#define FRAME_STREAM_END  0x00
+#define FRAME_STREAM_RECT 0x01
+#define FRAME_STREAM_RAW  0x02
+#define FRAME_STREAM_RUN  0x03
+#define FRAME_STREAM_IDX  0x04
+#define FRAME_STREAM_IRUN 0x05
+#define FRAME_STREAM_PAL  0x06
+
+/* longest run or literal one op carries */
+#define FRAME_STREAM_OP_MAX (256)
+
+/* palette entries, the host encoder must use the same number */
+#ifndef FRAME_STREAM_PALETTE_SIZE
+    #define FRAME_STREAM_PALETTE_SIZE (64)
+#endif
+
+/* pixels collected before they are handed to the sink */
+#ifndef FRAME_STREAM_BUF
+    #define FRAME_STREAM_BUF (32)
+#endif
+
+typedef enum
+{
+    FRAME_STREAM_BUSY  = 0,     /* frame in progress, or waiting for one */
+    FRAME_STREAM_DONE  = 1,     /* a frame ended with a good sum */
+    FRAME_STREAM_ERROR = -1,    /* bad op, rectangle or sum, resyncing */
+} frame_stream_event_t;
+
+typedef struct
+{
+    uint32_t bytes;
+    uint32_t frames;
+    uint32_t errors;
+    uint32_t rects;
+    uint32_t pixels;
+} frame_stream_stats_t;
+
+class FrameStreamRx
+{
+private:
+    const disp_line_ops_t *m_ops;
+    disp_coord_t m_width, m_height;
+
+    uint8_t m_state;
+    uint8_t m_op;
+    uint8_t m_head[8];
+    uint8_t m_head_len, m_head_need;
+
+    uint8_t m_seq;
+    uint8_t m_sum;
+
+    uint32_t m_left;            /* pixels still owed to the rectangle */
+    uint16_t m_count;           /* items left in the current op */
+    uint8_t m_hi;
+    bool m_half;
+    uint8_t m_pal_index;
+
+    uint16_t m_buf[FRAME_STREAM_BUF];
+    uint8_t m_buf_len;
+
+    uint16_t m_palette[FRAME_STREAM_PALETTE_SIZE];
+    frame_stream_stats_t m_stats;
+
+    void begin_op();
+    void push( uint16_t color );
+    void flush();
+    frame_stream_event_t fail();
+
+public:
+    FrameStreamRx( const disp_line_ops_t *ops, disp_coord_t width, disp_coord_t height );
+
+    void reset();
+    void set_size( disp_coord_t width, disp_coord_t height );
+
+    frame_stream_event_t feed( uint8_t b );
+    frame_stream_event_t poll( Stream &in );
+
+    /* of the frame last finished */
+    uint8_t seq() const
+    {
+        return m_seq;
+    }
+
+    const frame_stream_stats_t *stats() const
+    {
+        return &m_stats;
+    }
+};
+
+#endif
@@ -0,0 +1,186 @@
+/**
+ * @file glyph_cache.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief LRU cache of glyphs expanded to RGB565.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "glyph_cache.h"
+
+void glyph_expand( const disp_font_t *font, uint8_t c,
+                   uint16_t fg, uint16_t bg, uint16_t *px )
+{
+    const uint16_t lut[2] = { bg, fg };
+    uint8_t col, row;
+
+    for( col = 0; col < font->advance; col++ )
+    {
+        uint8_t bits = disp_font_column( font, c, col );
+
+        for( row = 0; row < font->height; row++, bits >>= 1 ) {
+            px[row * font->advance + col] = lut[bits & 1];
+        }
+    }
+}
+
+// Constructors ////////////////////////////////////////////////////////////////
+GlyphCache::GlyphCache( void *pool, size_t bytes, uint16_t slot_px )
+{
+    size_t per = sizeof( glyph_cache_entry_t ) + sizeof( uint16_t ) * ( slot_px + 1 );
+    size_t n = bytes / per;
+    uint16_t buckets = 1;
+
+    if( n > GLYPH_CACHE_NONE - 1 ) {
+        n = GLYPH_CACHE_NONE - 1;
+    }
+
+    while( buckets * 2 <= n ) {
+        buckets *= 2;
+    }
+
+    m_slots = n;
+    m_slot_px = slot_px;
+    m_mask = buckets - 1;
+    m_entries = ( glyph_cache_entry_t * )pool;
+    m_pixels = ( uint16_t * )( m_entries + n );
+    m_buckets = m_pixels + n * slot_px;
+
+    clear();
+    reset_stats();
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+const uint16_t *GlyphCache::get( const disp_font_t *font, uint8_t c, uint16_t fg, uint16_t bg )
+{
+    uint16_t b, i;
+
+    if( ( uint16_t )font->advance * font->height > m_slot_px || !m_slots ) {
+        m_stats.too_large++;
+        return NULL;
+    }
+
+    b = bucket( font, c, fg, bg );
+
+    for( i = m_buckets[b]; i != GLYPH_CACHE_NONE; i = m_entries[i].chain )
+    {
+        glyph_cache_entry_t *e = &m_entries[i];
+
+        if( e->c == c && e->font == font && e->fg == fg && e->bg == bg )
+        {
+            if( i != m_head ) {
+                unlink( i );
+                push_front( i );
+            }
+
+            m_stats.hits++;
+
+            return m_pixels + ( uint32_t )i * m_slot_px;
+        }
+    }
+
+    m_stats.misses++;
+
+    /* a free slot while there is one, else the least recently drawn */
+    if( m_used < m_slots ) {
+        i = m_used++;
+    }
+    else
+    {
+        glyph_cache_entry_t *old;
+        uint16_t *link;
+
+        i = m_tail;
+        old = &m_entries[i];
+        unlink( i );
+
+        link = &m_buckets[bucket( old->font, old->c, old->fg, old->bg )];
+
+        while( *link != i ) {
+            link = &m_entries[*link].chain;
+        }
+
+        *link = old->chain;
+        m_stats.evictions++;
+    }
+
+    m_entries[i].font = font;
+    m_entries[i].c = c;
+    m_entries[i].fg = fg;
+    m_entries[i].bg = bg;
+    m_entries[i].chain = m_buckets[b];
+    m_buckets[b] = i;
+    push_front( i );
+
+    glyph_expand( font, c, fg, bg, m_pixels + ( uint32_t )i * m_slot_px );
+
+    return m_pixels + ( uint32_t )i * m_slot_px;
+}
+
+void GlyphCache::clear()
+{
+    uint16_t i;
+
+    for( i = 0; m_slots && i <= m_mask; i++ ) {
+        m_buckets[i] = GLYPH_CACHE_NONE;
+    }
+
+    m_used = 0;
+    m_head = GLYPH_CACHE_NONE;
+    m_tail = GLYPH_CACHE_NONE;
+}
+
+void GlyphCache::reset_stats()
+{
+    memset( &m_stats, 0, sizeof( m_stats ) );
+}
+
+// Private Methods //////////////////////////////////////////////////////////////
+uint16_t GlyphCache::bucket( const disp_font_t *font, uint8_t c, uint16_t fg, uint16_t bg ) const
+{
+    uint16_t h = ( uint16_t )( ( uintptr_t )font >> 2 );
+
+    h = h * 31 + c;
+    h = h * 31 + fg;
+    h = h * 31 + bg;
+
+    return ( h ^ ( h >> 7 ) ) & m_mask;
+}
+
+void GlyphCache::unlink( uint16_t i )
+{
+    glyph_cache_entry_t *e = &m_entries[i];
+
+    if( e->prev != GLYPH_CACHE_NONE ) {
+        m_entries[e->prev].next = e->next;
+    }
+    else {
+        m_head = e->next;
+    }
+
+    if( e->next != GLYPH_CACHE_NONE ) {
+        m_entries[e->next].prev = e->prev;
+    }
+    else {
+        m_tail = e->prev;
+    }
+}
+
+void GlyphCache::push_front( uint16_t i )
+{
+    glyph_cache_entry_t *e = &m_entries[i];
+
+    e->prev = GLYPH_CACHE_NONE;
+    e->next = m_head;
+
+    if( m_head != GLYPH_CACHE_NONE ) {
+        m_entries[m_head].prev = i;
+    }
+    else {
+        m_tail = i;
+    }
+
+    m_head = i;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file glyph_cache.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief LRU cache of glyphs expanded to RGB565.
+ *
+ * Drawing a glyph means turning every font bit into a foreground or
+ * background pixel. The cache keeps the result of that per glyph, font and
+ * color pair, so text drawn again goes straight from RAM to the bus. The
+ * memory is handed in once and cut into equal slots of slot_px pixels,
+ * glyphs larger than a slot are not cached. When all slots are taken the
+ * least recently drawn glyph makes room.
+ *
+ *   GlyphCacheBuffered<2048> cache;     pool inside the object
+ *   GlyphCache cache( pool, sizeof( pool ) );
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __GLYPH_CACHE_H
+#define __GLYPH_CACHE_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "disp_font.h"
+
+/* pixels per slot, font5x7 needs advance 6 x height 7 */
+#ifndef GLYPH_CACHE_SLOT_PX
+    #define GLYPH_CACHE_SLOT_PX (42)
+#endif
+
+#define GLYPH_CACHE_NONE (0xFFFF)
+
+typedef struct
+{
+    const disp_font_t *font;
+    uint16_t fg, bg;
+    uint8_t c;
+    uint16_t prev, next;        /* LRU order, m_head drawn last */
+    uint16_t chain;             /* next entry in the same bucket */
+} glyph_cache_entry_t;
+
+typedef struct
+{
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t too_large;         /* glyphs that do not fit a slot */
+} glyph_cache_stats_t;
+
+/**
+ * @brief Expand glyph c of font into advance x height pixels, row by row.
+ */
+void glyph_expand( const disp_font_t *font, uint8_t c,
+                   uint16_t fg, uint16_t bg, uint16_t *px );
+
+class GlyphCache
+{
+private:
+    glyph_cache_entry_t *m_entries;
+    uint16_t *m_buckets;
+    uint16_t *m_pixels;
+    uint16_t m_slots;
+    uint16_t m_mask;            /* bucket count - 1 */
+    uint16_t m_slot_px;
+    uint16_t m_used;
+    uint16_t m_head, m_tail;
+
+    glyph_cache_stats_t m_stats;
+
+    uint16_t bucket( const disp_font_t *font, uint8_t c, uint16_t fg, uint16_t bg ) const;
+    void unlink( uint16_t i );
+    void push_front( uint16_t i );
+
+public:
+    GlyphCache( void *pool, size_t bytes, uint16_t slot_px = GLYPH_CACHE_SLOT_PX );
+
+    /**
+     * @brief Pixels of glyph c, expanded on a miss.
+     *
+     * @return advance x height pixels, valid until the next get(), NULL if
+     * the glyph is larger than a slot or the pool holds no slot at all
+     */
+    const uint16_t *get( const disp_font_t *font, uint8_t c, uint16_t fg, uint16_t bg );
+
+    /* forget every glyph, e.g. after the font data changed */
+    void clear();
+
+    uint16_t slots() const
+    {
+        return m_slots;
+    }
+
+    const glyph_cache_stats_t *stats() const
+    {
+        return &m_stats;
+    }
+
+    void reset_stats();
+};
+
+/**
+ * @brief GlyphCache carrying a pool of BYTES of its own.
+ */
+template <size_t BYTES, uint16_t SLOT_PX = GLYPH_CACHE_SLOT_PX>
+class GlyphCacheBuffered : public GlyphCache
+{
+private:
+    void *m_pool[( BYTES + sizeof( void * ) - 1 ) / sizeof( void * )];
+
+public:
+    GlyphCacheBuffered()
+        : GlyphCache( m_pool, sizeof( m_pool ), SLOT_PX )
+    {
+    }
+};
+
+#endif
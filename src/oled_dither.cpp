@@ -0,0 +1,275 @@
+/**
+ * @file oled_dither.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Grayscale to 1bpp conversion for the ssd1306.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <Arduino.h>
+#include <string.h>
+
+#include "oled_dither.h"
+
+/* 8x8 Bayer matrix, 0 ~ 63 */
+static const uint8_t bayer8[8][8] PROGMEM = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 },
+};
+
+/* true if the image area lies inside the frame buffer */
+static bool dither_fits( const OledFrameBuffer *fb, disp_coord_t x, disp_coord_t y,
+                         disp_coord_t w, disp_coord_t h )
+{
+    return w > 0 && h > 0 && x >= 0 && y >= 0 &&
+           x + w <= fb->width() && y + h <= fb->height();
+}
+
+// Constructors ////////////////////////////////////////////////////////////////
+OledDither::OledDither( OledFrameBuffer *fb, oled_dither_t method )
+{
+    m_fb = fb;
+    m_method = method;
+    m_w = 0;
+    m_h = 0;
+    m_row = 0;
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+/**
+ * @brief Start an image of w x h pixels at (x, y) of the frame buffer.
+ *
+ * @return false if it does not fit the buffer or OLED_DITHER_MAX_W
+ */
+bool OledDither::begin( disp_coord_t x, disp_coord_t y,
+                        disp_coord_t w, disp_coord_t h )
+{
+    if( w > OLED_DITHER_MAX_W || !dither_fits( m_fb, x, y, w, h ) ) {
+        m_h = 0;
+        return false;
+    }
+
+    m_x = x;
+    m_y = y;
+    m_w = w;
+    m_h = h;
+    m_row = 0;
+    memset( m_err, 0, sizeof( m_err ) );
+
+    return true;
+}
+
+/**
+ * @brief Dither the next row of 8 bit gray pixels into the frame buffer.
+ *
+ * @return false once all rows were pushed
+ */
+bool OledDither::push_gray( const uint8_t *row )
+{
+    disp_coord_t y, x;
+
+    if( m_row >= m_h ) {
+        return false;
+    }
+
+    y = m_y + m_row++;
+
+    switch( m_method )
+    {
+    case OLED_DITHER_BAYER:
+    {
+        const uint8_t *t = bayer8[y & 7];
+
+        for( x = 0; x < m_w; x++ ) {
+            m_fb->set_pixel( m_x + x, y, row[x] > ( pgm_read_byte( &t[( m_x + x ) & 7] ) << 2 ) + 1 );
+        }
+        break;
+    }
+
+    case OLED_DITHER_FLOYD:
+    {
+        /*
+         * m_err[] holds the errors for this row on entry and the ones for
+         * the next row on exit. hold is the next row value of x - 1 still
+         * waiting for its 3/16 share, below is the 1/16 share of x.
+         */
+        int16_t right = 0, hold = 0, below = 0;
+
+        for( x = 0; x < m_w; x++ )
+        {
+            int16_t v = row[x] + m_err[x] + right;
+            bool on = v >= 128;
+            int16_t e = v - ( on ? 255 : 0 );
+
+            m_fb->set_pixel( m_x + x, y, on );
+
+            right = ( e * 7 ) / 16;
+
+            if( x ) {
+                m_err[x - 1] = hold + ( e * 3 ) / 16;
+            }
+
+            hold = below + ( e * 5 ) / 16;
+            below = e / 16;
+        }
+
+        m_err[m_w - 1] = hold;
+        break;
+    }
+
+    default:
+        for( x = 0; x < m_w; x++ ) {
+            m_fb->set_pixel( m_x + x, y, row[x] >= 128 );
+        }
+        break;
+    }
+
+    return true;
+}
+
+bool OledDither::push_rgb565( const uint16_t *row )
+{
+    disp_coord_t x;
+
+    for( x = 0; x < m_w; x++ ) {
+        m_gray[x] = oled_rgb565_to_gray( row[x] );
+    }
+
+    return push_gray( m_gray );
+}
+
+// Constructors ////////////////////////////////////////////////////////////////
+
+/**
+ * @param levels OLED_GRAY_BUF_SIZE(w, h) bytes, owned by the caller
+ */
+OledGrayDither::OledGrayDither( OledFrameBuffer *fb, uint8_t *levels )
+{
+    m_fb = fb;
+    m_levels = levels;
+    m_w = 0;
+    m_h = 0;
+    m_row = 0;
+    m_frame = 0;
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+bool OledGrayDither::begin( disp_coord_t x, disp_coord_t y,
+                            disp_coord_t w, disp_coord_t h )
+{
+    if( !dither_fits( m_fb, x, y, w, h ) ) {
+        m_h = 0;
+        return false;
+    }
+
+    m_x = x;
+    m_y = y;
+    m_w = w;
+    m_h = h;
+    m_row = 0;
+
+    return true;
+}
+
+/**
+ * @brief Quantize the next row to OLED_GRAY_FRAMES + 1 levels, with the
+ * Bayer matrix breaking up the bands between them.
+ */
+bool OledGrayDither::push_gray( const uint8_t *row )
+{
+    disp_coord_t x;
+    uint16_t i;
+
+    if( m_row >= m_h ) {
+        return false;
+    }
+
+    i = ( uint16_t )m_row * m_w;
+
+    for( x = 0; x < m_w; x++, i++ )
+    {
+        uint8_t t = pgm_read_byte( &bayer8[m_row & 7][x & 7] );
+        uint16_t level = ( row[x] * OLED_GRAY_FRAMES * 64 + t * 255 ) / ( 255 * 64 );
+        uint8_t shift = ( i & 3 ) << 1;
+
+        if( level > OLED_GRAY_FRAMES ) {
+            level = OLED_GRAY_FRAMES;
+        }
+
+        m_levels[i >> 2] = ( m_levels[i >> 2] & ~( 3 << shift ) ) | ( level << shift );
+    }
+
+    m_row++;
+
+    return true;
+}
+
+/**
+ * @brief Draw the next plane of the cycle and flush only the columns of
+ * each page that changed. Call it at a steady rate, 3 planes at 60 Hz or
+ * more look steady on most panels.
+ */
+void OledGrayDither::next_frame( oled_flush_func_t flush, void *ctx )
+{
+    disp_coord_t page, first_page = m_y >> 3, last_page = ( m_y + m_h - 1 ) >> 3;
+
+    if( !m_h ) {
+        return;
+    }
+
+    for( page = first_page; page <= last_page; page++ )
+    {
+        disp_area_t dirty = { 32767, ( disp_coord_t )( page << 3 ), -1,
+                              ( disp_coord_t )( ( page << 3 ) + 7 )
+                            };
+        disp_coord_t x;
+
+        for( x = 0; x < m_w; x++ )
+        {
+            uint8_t *p = m_fb->at( m_x + x, page << 3 );
+            uint8_t b = *p;
+            uint8_t bit;
+
+            for( bit = 0; bit < 8; bit++ )
+            {
+                disp_coord_t y = ( page << 3 ) + bit - m_y;
+                uint16_t i;
+                uint8_t level;
+
+                if( y < 0 || y >= m_h ) {
+                    continue;
+                }
+
+                i = ( uint16_t )y * m_w + x;
+                level = ( m_levels[i >> 2] >> ( ( i & 3 ) << 1 ) ) & 3;
+
+                /* spread the on frames so neighbours do not blink together */
+                if( ( m_frame + x + y ) % OLED_GRAY_FRAMES < level ) {
+                    b |= 1 << bit;
+                }
+                else {
+                    b &= ~( 1 << bit );
+                }
+            }
+
+            if( b != *p ) {
+                *p = b;
+                dirty.x1 = disp_min( dirty.x1, m_x + x );
+                dirty.x2 = disp_max( dirty.x2, m_x + x );
+            }
+        }
+
+        if( !disp_area_is_empty( &dirty ) ) {
+            flush( ctx, &dirty );
+        }
+    }
+
+    m_frame = ( m_frame + 1 ) % OLED_GRAY_FRAMES;
+}
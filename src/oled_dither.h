@@ -0,0 +1,95 @@
+/**
+ * @file oled_dither.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Grayscale to 1bpp conversion for the ssd1306.
+ *
+ * Images are streamed in one row at a time, so the working memory is one
+ * row of errors for Floyd-Steinberg and nothing at all for the ordered
+ * (Bayer) method. OledGrayDither adds pseudo grayscale by cycling a few
+ * 1bpp planes and flushing only the bytes that changed.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __OLED_DITHER_H
+#define __OLED_DITHER_H
+
+#include <inttypes.h>
+
+#include "oled_fb.h"
+
+/* widest image OledDither accepts, sets the size of the error row */
+#ifndef OLED_DITHER_MAX_W
+    #define OLED_DITHER_MAX_W (128)
+#endif
+
+/* frames per cycle of OledGrayDither, 2 bit levels allow up to 3 */
+#define OLED_GRAY_FRAMES (3)
+
+/* bytes of level storage OledGrayDither needs for a w x h image */
+#define OLED_GRAY_BUF_SIZE(w, h) ((((uint16_t)(w) * (h)) + 3) / 4)
+
+typedef enum
+{
+    OLED_DITHER_THRESHOLD = 0x00,
+    OLED_DITHER_BAYER     = 0x01,
+    OLED_DITHER_FLOYD     = 0x02,
+} oled_dither_t;
+
+/* sends one area of the frame buffer to the panel */
+typedef void ( *oled_flush_func_t )( void *ctx, const disp_area_t *area );
+
+static inline uint8_t oled_rgb565_to_gray( uint16_t c )
+{
+    /* 0.30 r + 0.59 g + 0.11 b, channels scaled to 8 bits */
+    uint16_t r = ( c >> 11 ) << 3, g = ( ( c >> 5 ) & 0x3F ) << 2, b = ( c & 0x1F ) << 3;
+
+    return ( r * 77 + g * 151 + b * 28 ) >> 8;
+}
+
+class OledDither
+{
+private:
+    OledFrameBuffer *m_fb;
+    oled_dither_t m_method;
+
+    disp_coord_t m_x, m_y, m_w, m_h;
+    disp_coord_t m_row;
+
+    int16_t m_err[OLED_DITHER_MAX_W];   /* errors carried into the next row */
+    uint8_t m_gray[OLED_DITHER_MAX_W];  /* rgb565 rows are converted here */
+
+public:
+    OledDither( OledFrameBuffer *fb, oled_dither_t method );
+
+    bool begin( disp_coord_t x, disp_coord_t y, disp_coord_t w, disp_coord_t h );
+    bool push_gray( const uint8_t *row );
+    bool push_rgb565( const uint16_t *row );
+
+    /* bytes of working memory, for sizing on small targets */
+    static uint16_t working_memory()
+    {
+        return sizeof( int16_t ) * OLED_DITHER_MAX_W + OLED_DITHER_MAX_W;
+    }
+};
+
+class OledGrayDither
+{
+private:
+    OledFrameBuffer *m_fb;
+    uint8_t *m_levels;      /* 2 bits per pixel, row major */
+
+    disp_coord_t m_x, m_y, m_w, m_h;
+    disp_coord_t m_row;
+    uint8_t m_frame;
+
+public:
+    OledGrayDither( OledFrameBuffer *fb, uint8_t *levels );
+
+    bool begin( disp_coord_t x, disp_coord_t y, disp_coord_t w, disp_coord_t h );
+    bool push_gray( const uint8_t *row );
+
+    void next_frame( oled_flush_func_t flush, void *ctx );
+};
+
+#endif
@@ -0,0 +1,173 @@
+/**
+ * @file oled_fb.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief 1bpp frame buffer in ssd1306 page layout.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include "oled_fb.h"
+
+#if OLED_FB_WORD_OPS
+    /* the buffer is a byte array, tell the compiler word access may alias it */
+    typedef uint32_t __attribute__( ( __may_alias__ ) ) oled_word_t;
+#endif
+
+/* rows a..b of one page, a <= b, both 0 ~ 7 */
+static inline uint8_t page_mask( uint8_t a, uint8_t b )
+{
+    return ( uint8_t )( ( 0xFF << a ) & ( 0xFF >> ( 7 - b ) ) );
+}
+
+// Constructors ////////////////////////////////////////////////////////////////
+OledFrameBuffer::OledFrameBuffer( uint8_t *buf, disp_coord_t width,
+                                  disp_coord_t height )
+{
+    m_buf = buf;
+    m_width = width;
+    m_height = height;
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+void OledFrameBuffer::clear( bool on )
+{
+    memset( m_buf, on ? 0xFF : 0x00, size() );
+}
+
+/**
+ * @brief Set or clear an area, given in buffer coordinates and already
+ * clipped. Full pages become memset runs, partial pages a masked run.
+ */
+void OledFrameBuffer::fill_area( const disp_area_t *area, bool on )
+{
+    uint8_t first = area->y1 >> 3, last = area->y2 >> 3;
+    disp_coord_t n = area->x2 - area->x1 + 1;
+    uint8_t page;
+
+    for( page = first; page <= last; page++ )
+    {
+        uint8_t mask = page_mask( page == first ? ( area->y1 & 7 ) : 0,
+                                  page == last ? ( area->y2 & 7 ) : 7 );
+        uint8_t *p = &m_buf[page * m_width + area->x1];
+
+        if( mask == 0xFF ) {
+            memset( p, on ? 0xFF : 0x00, n );
+        }
+        else {
+            span_mask( p, n, mask, on );
+        }
+    }
+}
+
+/**
+ * @brief Draw a 1bpp image in page layout, w columns by ceil(h / 8) pages.
+ *
+ * When y is not a multiple of 8 every source byte is split over two
+ * destination pages with one shift, there is no per pixel work.
+ */
+void OledFrameBuffer::blit( disp_coord_t x, disp_coord_t y, const uint8_t *src,
+                            disp_coord_t w, disp_coord_t h,
+                            oled_blit_mode_t mode )
+{
+    disp_coord_t x1 = disp_max( x, 0 ), x2 = disp_min( x + w - 1, m_width - 1 );
+    disp_coord_t pages = ( h + 7 ) >> 3;
+    disp_coord_t dst_pages = m_height >> 3;
+    disp_coord_t sp, c;
+    uint8_t shift = y & 7;
+    disp_coord_t base = y >> 3;     /* floor, also for negative y */
+
+    if( x2 < x1 || h <= 0 ) {
+        return;
+    }
+
+    for( sp = 0; sp < pages; sp++ )
+    {
+        /* rows of this source page that belong to the image */
+        uint8_t rows = ( sp == pages - 1 && ( h & 7 ) ) ? page_mask( 0, ( h & 7 ) - 1 ) : 0xFF;
+        const uint8_t *s = src + sp * w + ( x1 - x );
+
+        for( uint8_t half = 0; half < 2; half++ )
+        {
+            disp_coord_t dp = base + sp + half;
+            uint8_t m;
+            uint8_t *d;
+
+            if( half && !shift ) {
+                break;
+            }
+
+            if( dp < 0 || dp >= dst_pages ) {
+                continue;
+            }
+
+            m = half ? ( rows >> ( 8 - shift ) ) : ( uint8_t )( rows << shift );
+
+            if( !m ) {
+                continue;
+            }
+
+            d = &m_buf[dp * m_width + x1];
+
+            for( c = 0; c <= x2 - x1; c++ )
+            {
+                uint8_t b = half ? ( s[c] >> ( 8 - shift ) ) : ( uint8_t )( s[c] << shift );
+
+                b &= m;
+
+                switch( mode )
+                {
+                case OLED_BLIT_COPY:
+                    d[c] = ( d[c] & ~m ) | b;
+                    break;
+
+                case OLED_BLIT_OR:
+                    d[c] |= b;
+                    break;
+
+                case OLED_BLIT_CLR:
+                    d[c] &= ~b;
+                    break;
+
+                default:
+                    d[c] ^= b;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Private Methods //////////////////////////////////////////////////////////////
+
+/**
+ * @brief OR or AND-NOT one mask into n bytes, four at a time where the
+ * buffer is word aligned.
+ */
+void OledFrameBuffer::span_mask( uint8_t *p, disp_coord_t n, uint8_t mask, bool set )
+{
+#if OLED_FB_WORD_OPS
+    uint32_t wmask = mask * 0x01010101UL;
+
+    while( n && ( ( uintptr_t )p & 3 ) )
+    {
+        *p = set ? ( *p | mask ) : ( *p & ~mask );
+        p++;
+        n--;
+    }
+
+    for( ; n >= 4; n -= 4, p += 4 )
+    {
+        oled_word_t *w = ( oled_word_t * )p;
+
+        *w = set ? ( *w | wmask ) : ( *w & ~wmask );
+    }
+#endif
+
+    while( n-- )
+    {
+        *p = set ? ( *p | mask ) : ( *p & ~mask );
+        p++;
+    }
+}
@@ -0,0 +1,96 @@
+/**
+ * @file oled_fb.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief 1bpp frame buffer in ssd1306 page layout.
+ *
+ * Byte (page * width + x) holds rows page * 8 ~ page * 8 + 7 of column x,
+ * bit 0 on top, which is what the controller expects in page addressing
+ * mode, so a flush is a plain copy.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __OLED_FB_H
+#define __OLED_FB_H
+
+#include <inttypes.h>
+
+#include "disp_clip.h"
+
+/* word wide kernels only pay off on 32 bit cores */
+#ifndef OLED_FB_WORD_OPS
+    #if defined(__AVR__)
+        #define OLED_FB_WORD_OPS 0
+    #else
+        #define OLED_FB_WORD_OPS 1
+    #endif
+#endif
+
+typedef enum
+{
+    OLED_BLIT_COPY = 0x00,  /* dst = src */
+    OLED_BLIT_OR   = 0x01,  /* set where src is set */
+    OLED_BLIT_CLR  = 0x02,  /* clear where src is set */
+    OLED_BLIT_XOR  = 0x03,  /* invert where src is set */
+} oled_blit_mode_t;
+
+class OledFrameBuffer
+{
+private:
+    uint8_t *m_buf;
+    disp_coord_t m_width;
+    disp_coord_t m_height;
+
+    void span_mask( uint8_t *p, disp_coord_t n, uint8_t mask, bool set );
+
+public:
+    OledFrameBuffer( uint8_t *buf, disp_coord_t width, disp_coord_t height );
+
+    uint8_t *buffer() const
+    {
+        return m_buf;
+    }
+
+    disp_coord_t width() const
+    {
+        return m_width;
+    }
+
+    disp_coord_t height() const
+    {
+        return m_height;
+    }
+
+    uint16_t size() const
+    {
+        return ( uint16_t )m_width * ( m_height >> 3 );
+    }
+
+    /* no bounds check, callers clip first */
+    inline uint8_t *at( disp_coord_t x, disp_coord_t y ) const
+    {
+        return &m_buf[( y >> 3 ) * m_width + x];
+    }
+
+    inline bool get_pixel( disp_coord_t x, disp_coord_t y ) const
+    {
+        return ( *at( x, y ) >> ( y & 7 ) ) & 1;
+    }
+
+    inline void set_pixel( disp_coord_t x, disp_coord_t y, bool on )
+    {
+        if( on ) {
+            *at( x, y ) |= 1 << ( y & 7 );
+        }
+        else {
+            *at( x, y ) &= ~( 1 << ( y & 7 ) );
+        }
+    }
+
+    void clear( bool on );
+    void fill_area( const disp_area_t *area, bool on );
+    void blit( disp_coord_t x, disp_coord_t y, const uint8_t *src,
+               disp_coord_t w, disp_coord_t h, oled_blit_mode_t mode );
+};
+
+#endif
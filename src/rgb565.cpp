@@ -0,0 +1,328 @@
+/**
+ * @file rgb565.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Fixed point RGB565 span kernels.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "rgb565.h"
+
+/* pixel buffers are accessed as words, tell the compiler they may alias */
+typedef uint32_t __attribute__( ( __may_alias__ ) ) rgb565_word_t;
+
+static inline uint32_t rev16( uint32_t w )
+{
+#if RGB565_HAVE_REV16
+    uint32_t r;
+
+    __asm__( "rev16 %0, %1" : "=r"( r ) : "r"( w ) );
+    return r;
+#else
+    return ( ( w & 0x00FF00FFUL ) << 8 ) | ( ( w >> 8 ) & 0x00FF00FFUL );
+#endif
+}
+
+/* two pixels in memory order, whatever the cpu endianness */
+static inline uint32_t pair( uint16_t first, uint16_t second )
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    return ( ( uint32_t )first << 16 ) | second;
+#else
+    return ( ( uint32_t )second << 16 ) | first;
+#endif
+}
+
+typedef struct
+{
+    int32_t r, g, b;
+} rgb565_acc_t;
+
+static inline void gradient_setup( rgb565_acc_t *v, rgb565_acc_t *d,
+                                   uint16_t c0, uint16_t c1, size_t n )
+{
+    int32_t steps = n > 1 ? ( int32_t )n - 1 : 1;
+
+    /* 16.16 per channel, starting half a step up to round */
+    v->r = ( ( int32_t )( c0 >> 11 ) << 16 ) + 0x8000;
+    v->g = ( ( int32_t )( ( c0 >> 5 ) & 0x3F ) << 16 ) + 0x8000;
+    v->b = ( ( int32_t )( c0 & 0x1F ) << 16 ) + 0x8000;
+    d->r = ( ( ( int32_t )( c1 >> 11 ) << 16 ) - ( ( int32_t )( c0 >> 11 ) << 16 ) ) / steps;
+    d->g = ( ( ( int32_t )( ( c1 >> 5 ) & 0x3F ) << 16 ) -
+             ( ( int32_t )( ( c0 >> 5 ) & 0x3F ) << 16 ) ) / steps;
+    d->b = ( ( ( int32_t )( c1 & 0x1F ) << 16 ) - ( ( int32_t )( c0 & 0x1F ) << 16 ) ) / steps;
+}
+
+static inline uint16_t gradient_next( rgb565_acc_t *v, const rgb565_acc_t *d )
+{
+    uint16_t c = ( uint16_t )( ( ( v->r >> 16 ) << 11 ) | ( ( v->g >> 16 ) << 5 ) | ( v->b >> 16 ) );
+
+    v->r += d->r;
+    v->g += d->g;
+    v->b += d->b;
+
+    return c;
+}
+
+// Kernels //////////////////////////////////////////////////////////////////////
+
+void rgb565_fill( uint16_t *dst, uint16_t color, size_t n )
+{
+    uint32_t w = pair( color, color );
+
+    if( n && ( ( uintptr_t )dst & 2 ) ) {
+        *dst++ = color;
+        n--;
+    }
+
+    for( ; n >= 8; n -= 8, dst += 8 )
+    {
+        rgb565_word_t *p = ( rgb565_word_t * )dst;
+
+        p[0] = w;
+        p[1] = w;
+        p[2] = w;
+        p[3] = w;
+    }
+
+    for( ; n >= 2; n -= 2, dst += 2 ) {
+        *( rgb565_word_t * )dst = w;
+    }
+
+    if( n ) {
+        *dst = color;
+    }
+}
+
+/**
+ * @brief Horizontal gradient from c0 to c1 over n pixels, also the row
+ * kernel for diagonal ones.
+ */
+void rgb565_gradient( uint16_t *dst, uint16_t c0, uint16_t c1, size_t n )
+{
+    rgb565_gradient_part( dst, c0, c1, n, 0, n );
+}
+
+/**
+ * @brief Pixels first ~ first + count - 1 of an n pixel gradient, so a
+ * long one can be built piece by piece in a short buffer.
+ */
+void rgb565_gradient_part( uint16_t *dst, uint16_t c0, uint16_t c1, size_t n,
+                           size_t first, size_t count )
+{
+    rgb565_acc_t v, d;
+
+    gradient_setup( &v, &d, c0, c1, n );
+
+    v.r += d.r * ( int32_t )first;
+    v.g += d.g * ( int32_t )first;
+    v.b += d.b * ( int32_t )first;
+    n = count;
+
+    if( n && ( ( uintptr_t )dst & 2 ) ) {
+        *dst++ = gradient_next( &v, &d );
+        n--;
+    }
+
+    for( ; n >= 2; n -= 2, dst += 2 )
+    {
+        uint16_t a = gradient_next( &v, &d );
+        uint16_t b = gradient_next( &v, &d );
+
+        *( rgb565_word_t * )dst = pair( a, b );
+    }
+
+    if( n ) {
+        *dst = gradient_next( &v, &d );
+    }
+}
+
+/**
+ * @brief dst = src over dst, alpha rounded to 5 bits by rgb565_alpha5().
+ */
+void rgb565_blend( uint16_t *dst, const uint16_t *src, size_t n, uint8_t alpha )
+{
+    uint8_t a5 = rgb565_alpha5( alpha );
+
+    if( a5 == 0 ) {
+        return;
+    }
+
+    if( a5 == 32 )
+    {
+        while( n-- ) {
+            *dst++ = *src++;
+        }
+
+        return;
+    }
+
+    while( n-- )
+    {
+        uint32_t f = rgb565_spread( *src++ ), b = rgb565_spread( *dst );
+
+        *dst++ = rgb565_pack( ( ( ( f - b ) * a5 ) >> 5 ) + b );
+    }
+}
+
+/**
+ * @brief dst = color over dst, alpha rounded to 5 bits like
+ * rgb565_blend(). The color is spread once for the whole span.
+ */
+void rgb565_blend_color( uint16_t *dst, uint16_t color, size_t n, uint8_t alpha )
+{
+    uint8_t a5 = rgb565_alpha5( alpha );
+    uint32_t f = rgb565_spread( color );
+
+    if( a5 == 0 ) {
+        return;
+    }
+
+    if( a5 == 32 ) {
+        rgb565_fill( dst, color, n );
+        return;
+    }
+
+    while( n-- )
+    {
+        uint32_t b = rgb565_spread( *dst );
+
+        *dst++ = rgb565_pack( ( ( ( f - b ) * a5 ) >> 5 ) + b );
+    }
+}
+
+/**
+ * @brief dst = src over dst with all 8 bits of alpha, see rgb565_mix_px().
+ */
+void rgb565_mix( uint16_t *dst, const uint16_t *src, size_t n, uint8_t alpha )
+{
+    if( alpha == 0 ) {
+        return;
+    }
+
+    if( alpha == 255 )
+    {
+        while( n-- ) {
+            *dst++ = *src++;
+        }
+
+        return;
+    }
+
+    for( ; n; n--, dst++ ) {
+        *dst = rgb565_mix_px( *src++, *dst, alpha );
+    }
+}
+
+/**
+ * @brief dst = color over dst with all 8 bits of alpha, the color is
+ * scaled once for the whole span.
+ */
+void rgb565_mix_color( uint16_t *dst, uint16_t color, size_t n, uint8_t alpha )
+{
+    uint32_t ia = 255 - alpha;
+    uint32_t rb = rgb565_spread_rb( color ) * alpha + 0x00800080UL;
+    uint32_t g = ( ( color >> 5 ) & 0x3F ) * alpha + 0x80;
+
+    if( alpha == 0 ) {
+        return;
+    }
+
+    if( alpha == 255 ) {
+        rgb565_fill( dst, color, n );
+        return;
+    }
+
+    for( ; n; n--, dst++ ) {
+        *dst = rgb565_mix_pack( rb + rgb565_spread_rb( *dst ) * ia,
+                                g + ( ( *dst >> 5 ) & 0x3F ) * ia );
+    }
+}
+
+/**
+ * @brief Byte swap n pixels into the msb first order the st7789v expects,
+ * dst may equal src.
+ */
+void rgb565_swap( uint16_t *dst, const uint16_t *src, size_t n )
+{
+    if( n && ( ( ( uintptr_t )dst | ( uintptr_t )src ) & 2 ) )
+    {
+        /* only worth aligning if both pointers agree */
+        if( ( ( uintptr_t )dst ^ ( uintptr_t )src ) & 2 ) {
+            rgb565_swap_ref( dst, src, n );
+            return;
+        }
+
+        *dst++ = rgb565_swap_px( *src++ );
+        n--;
+    }
+
+    for( ; n >= 2; n -= 2, dst += 2, src += 2 ) {
+        *( rgb565_word_t * )dst = rev16( *( const rgb565_word_t * )src );
+    }
+
+    if( n ) {
+        *dst = rgb565_swap_px( *src );
+    }
+}
+
+// References ///////////////////////////////////////////////////////////////////
+
+void rgb565_fill_ref( uint16_t *dst, uint16_t color, size_t n )
+{
+    while( n-- ) {
+        *dst++ = color;
+    }
+}
+
+void rgb565_gradient_ref( uint16_t *dst, uint16_t c0, uint16_t c1, size_t n )
+{
+    rgb565_acc_t v, d;
+
+    gradient_setup( &v, &d, c0, c1, n );
+
+    while( n-- ) {
+        *dst++ = gradient_next( &v, &d );
+    }
+}
+
+/* per channel b + (f - b) * a / 32, rounded down */
+void rgb565_blend_ref( uint16_t *dst, const uint16_t *src, size_t n, uint8_t alpha )
+{
+    int32_t a5 = rgb565_alpha5( alpha );
+
+    while( n-- )
+    {
+        int32_t fr = *src >> 11, fg = ( *src >> 5 ) & 0x3F, fb = *src & 0x1F;
+        int32_t br = *dst >> 11, bg = ( *dst >> 5 ) & 0x3F, bb = *dst & 0x1F;
+        int32_t r = br + ( ( ( fr - br ) * a5 ) >> 5 );
+        int32_t g = bg + ( ( ( fg - bg ) * a5 ) >> 5 );
+        int32_t b = bb + ( ( ( fb - bb ) * a5 ) >> 5 );
+
+        *dst++ = ( uint16_t )( ( r << 11 ) | ( g << 5 ) | b );
+        src++;
+    }
+}
+
+/* per channel ( f * a + b * ( 255 - a ) + 127 ) / 255 */
+void rgb565_mix_ref( uint16_t *dst, const uint16_t *src, size_t n, uint8_t alpha )
+{
+    int32_t ia = 255 - alpha;
+
+    while( n-- )
+    {
+        int32_t r = ( ( *src >> 11 ) * alpha + ( *dst >> 11 ) * ia + 127 ) / 255;
+        int32_t g = ( ( ( *src >> 5 ) & 0x3F ) * alpha + ( ( *dst >> 5 ) & 0x3F ) * ia + 127 ) / 255;
+        int32_t b = ( ( *src & 0x1F ) * alpha + ( *dst & 0x1F ) * ia + 127 ) / 255;
+
+        *dst++ = ( uint16_t )( ( r << 11 ) | ( g << 5 ) | b );
+        src++;
+    }
+}
+
+void rgb565_swap_ref( uint16_t *dst, const uint16_t *src, size_t n )
+{
+    while( n-- ) {
+        *dst++ = rgb565_swap_px( *src++ );
+    }
+}
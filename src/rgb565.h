@@ -0,0 +1,129 @@
+/**
+ * @file rgb565.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Fixed point RGB565 span kernels: fills, gradients, blending and
+ * byte swapping.
+ *
+ * The kernels work on 32 bit words, two pixels per word for fills and
+ * swaps, and all three channels of a pixel at once for blending. On ARMv6
+ * and later the swap uses REV16. Every kernel has a scalar reference,
+ * rgb565_*_ref(), which is what the fast paths must match.
+ *
+ * rgb565_blend*() round alpha to 5 bits, so 1 ~ 3 leave dst alone and
+ * 252 ~ 255 are opaque. rgb565_mix*() keep all 8 bits at the cost of a
+ * second multiply per pixel.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __RGB565_H
+#define __RGB565_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#if defined(__ARM_ARCH) && (__ARM_ARCH >= 6) && \
+    (!defined(__thumb__) || defined(__thumb2__))
+    #define RGB565_HAVE_REV16 1
+#else
+    #define RGB565_HAVE_REV16 0
+#endif
+
+/* spread r, g and b of one pixel so they can be scaled in parallel */
+#define RGB565_SPREAD_MASK (0x07E0F81FUL)
+
+static inline uint32_t rgb565_spread( uint16_t c )
+{
+    return ( ( ( uint32_t )c << 16 ) | c ) & RGB565_SPREAD_MASK;
+}
+
+static inline uint16_t rgb565_pack( uint32_t s )
+{
+    s &= RGB565_SPREAD_MASK;
+    return ( uint16_t )( s | ( s >> 16 ) );
+}
+
+/**
+ * @brief fg over bg with a 5 bit alpha, 0 ~ 32.
+ */
+static inline uint16_t rgb565_blend_px( uint16_t fg, uint16_t bg, uint8_t a5 )
+{
+    uint32_t f = rgb565_spread( fg ), b = rgb565_spread( bg );
+
+    return rgb565_pack( ( ( ( f - b ) * a5 ) >> 5 ) + b );
+}
+
+/* 8 bit alpha to the 5 bit alpha used by the kernels */
+static inline uint8_t rgb565_alpha5( uint8_t alpha )
+{
+    return ( alpha + 4 ) >> 3;
+}
+
+/* red and blue 16 bits apart, room for an 8 bit multiply each */
+static inline uint32_t rgb565_spread_rb( uint16_t c )
+{
+    return ( ( ( uint32_t )c & 0xF800 ) << 5 ) | ( c & 0x1F );
+}
+
+/**
+ * @brief Pack the sums of rgb565_mix_px(), x / 255 rounded per channel,
+ * exact while x + 128 < 65536.
+ */
+static inline uint16_t rgb565_mix_pack( uint32_t rb, uint32_t g )
+{
+    rb = ( ( rb + ( ( rb >> 8 ) & 0x00FF00FFUL ) ) >> 8 ) & 0x001F001FUL;
+    g = ( g + ( g >> 8 ) ) >> 8;
+
+    return ( uint16_t )( ( rb >> 5 ) | ( g << 5 ) | ( rb & 0x1F ) );
+}
+
+/**
+ * @brief fg over bg with an 8 bit alpha, per channel
+ * ( f * a + b * ( 255 - a ) + 127 ) / 255 like disp_rgb565_mix().
+ */
+static inline uint16_t rgb565_mix_px( uint16_t fg, uint16_t bg, uint8_t alpha )
+{
+    uint32_t ia = 255 - alpha;
+
+    return rgb565_mix_pack( rgb565_spread_rb( fg ) * alpha + rgb565_spread_rb( bg ) * ia + 0x00800080UL,
+                            ( ( fg >> 5 ) & 0x3F ) * alpha + ( ( bg >> 5 ) & 0x3F ) * ia + 0x80 );
+}
+
+static inline uint16_t rgb565_swap_px( uint16_t c )
+{
+    return ( uint16_t )( ( c << 8 ) | ( c >> 8 ) );
+}
+
+void rgb565_fill( uint16_t *dst, uint16_t color, size_t n );
+void rgb565_gradient( uint16_t *dst, uint16_t c0, uint16_t c1, size_t n );
+void rgb565_gradient_part( uint16_t *dst, uint16_t c0, uint16_t c1, size_t n,
+                           size_t first, size_t count );
+void rgb565_blend( uint16_t *dst, const uint16_t *src, size_t n, uint8_t alpha );
+void rgb565_blend_color( uint16_t *dst, uint16_t color, size_t n, uint8_t alpha );
+void rgb565_mix( uint16_t *dst, const uint16_t *src, size_t n, uint8_t alpha );
+void rgb565_mix_color( uint16_t *dst, uint16_t color, size_t n, uint8_t alpha );
+void rgb565_swap( uint16_t *dst, const uint16_t *src, size_t n );
+
+/* scalar references */
+void rgb565_fill_ref( uint16_t *dst, uint16_t color, size_t n );
+void rgb565_gradient_ref( uint16_t *dst, uint16_t c0, uint16_t c1, size_t n );
+void rgb565_blend_ref( uint16_t *dst, const uint16_t *src, size_t n, uint8_t alpha );
+void rgb565_mix_ref( uint16_t *dst, const uint16_t *src, size_t n, uint8_t alpha );
+void rgb565_swap_ref( uint16_t *dst, const uint16_t *src, size_t n );
+
+/**
+ * @brief Color of row y in a vertical gradient of h rows, fill the row
+ * with rgb565_fill(). Pixel y of a horizontal gradient of h pixels is the
+ * same color.
+ */
+static inline uint16_t rgb565_gradient_at( uint16_t c0, uint16_t c1,
+        uint16_t y, uint16_t h )
+{
+    uint16_t c;
+
+    rgb565_gradient_part( &c, c0, c1, h, y, 1 );
+
+    return c;
+}
+
+#endif
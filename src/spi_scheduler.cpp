@@ -0,0 +1,148 @@
+/**
+ * @file spi_scheduler.cpp
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Cooperative scheduler for devices sharing one SPI bus.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <Arduino.h>
+#include <string.h>
+
+#include "spi_scheduler.h"
+
+// Constructors ////////////////////////////////////////////////////////////////
+SpiScheduler::SpiScheduler()
+{
+    m_head = NULL;
+    m_last = NULL;
+    memset( &m_stats, 0, sizeof( m_stats ) );
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+/**
+ * @brief Queue a job, it is kept by pointer until done or cancelled.
+ */
+void SpiScheduler::submit( spi_job_t *job )
+{
+    spi_job_t **p = &m_head;
+
+    /* keep the list sorted, equal priorities stay first come first served */
+    while( *p && ( *p )->priority >= job->priority ) {
+        p = &( *p )->next;
+    }
+
+    job->next = *p;
+    *p = job;
+}
+
+void SpiScheduler::cancel( spi_job_t *job )
+{
+    remove( job );
+}
+
+/**
+ * @brief Run one step of the most urgent job.
+ *
+ * @return false if nothing was pending
+ */
+bool SpiScheduler::poll()
+{
+    spi_job_t *job = m_head;
+    spi_device_t *dev;
+    uint32_t start, took;
+    bool done;
+
+    if( !job ) {
+        return false;
+    }
+
+    if( m_last && m_last != job ) {
+        spi_job_t *p;
+
+        /* the previous job is still queued, so this one cut in */
+        for( p = m_head; p; p = p->next ) {
+            if( p == m_last ) {
+                m_stats.preemptions++;
+                break;
+            }
+        }
+    }
+
+    dev = job->device;
+    start = micros();
+
+    if( dev->begin ) {
+        dev->begin( dev->ctx );
+    }
+    else {
+        SPI.beginTransaction( dev->settings );
+    }
+
+    done = job->step( job->ctx, job->chunk );
+
+    if( dev->end ) {
+        dev->end( dev->ctx );
+    }
+    else {
+        SPI.endTransaction();
+    }
+
+    took = micros() - start;
+
+    if( took > m_stats.max_step_us ) {
+        m_stats.max_step_us = took;
+    }
+
+    m_stats.steps++;
+    m_last = job;
+
+    if( done )
+    {
+        remove( job );
+
+        if( job->done ) {
+            job->done( job->ctx );
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Step jobs until the queue is empty or budget_us has passed,
+ * meant to be called from loop() between other work.
+ */
+void SpiScheduler::run( uint32_t budget_us )
+{
+    uint32_t start = micros();
+
+    while( poll() && micros() - start < budget_us );
+}
+
+/**
+ * @brief Block until every queued job is finished.
+ */
+void SpiScheduler::flush()
+{
+    while( poll() );
+}
+
+// Private Methods //////////////////////////////////////////////////////////////
+void SpiScheduler::remove( spi_job_t *job )
+{
+    spi_job_t **p = &m_head;
+
+    while( *p && *p != job ) {
+        p = &( *p )->next;
+    }
+
+    if( *p ) {
+        *p = job->next;
+    }
+
+    if( m_last == job ) {
+        m_last = NULL;
+    }
+}
@@ -0,0 +1,96 @@
+/**
+ * @file spi_scheduler.h
+ * @author Zheng Hua (writeforever@foxmail.com)
+ * @brief Cooperative scheduler for devices sharing one SPI bus.
+ *
+ * Long transfers are queued as jobs that move at most `chunk` bytes per
+ * step. Every step is bracketed by its own transaction, and the highest
+ * priority pending job is picked again before each step, so an SD card or
+ * ADC waits for at most one display chunk instead of a whole frame.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef __SPI_SCHEDULER_H
+#define __SPI_SCHEDULER_H
+
+#include <inttypes.h>
+#include <SPI.h>
+
+/* one shared bus per device, begin/end may be NULL to use settings */
+typedef struct
+{
+    SPISettings settings;
+    void ( *begin )( void *ctx );
+    void ( *end )( void *ctx );
+    void *ctx;
+} spi_device_t;
+
+/**
+ * @brief Move at most budget bytes.
+ *
+ * @return true when the job is finished
+ */
+typedef bool ( *spi_job_step_t )( void *ctx, uint16_t budget );
+
+typedef struct spi_job
+{
+    spi_device_t *device;
+    spi_job_step_t step;
+    void ( *done )( void *ctx );    /* may be NULL */
+    void *ctx;
+
+    uint8_t priority;               /* higher runs first */
+    uint16_t chunk;                 /* bytes per step */
+
+    struct spi_job *next;
+} spi_job_t;
+
+typedef struct
+{
+    uint32_t steps;
+    uint32_t preemptions;           /* a job ran while another was unfinished */
+    uint32_t max_step_us;
+} spi_sched_stats_t;
+
+/**
+ * @brief Bytes that fit in latency_us at clock hz, for sizing job chunks.
+ */
+static inline uint16_t spi_chunk_for_latency( uint32_t hz, uint32_t latency_us )
+{
+    uint32_t n = ( hz / 8 / 1000 ) * latency_us / 1000;
+
+    return n < 2 ? 2 : ( n > 0xFFFF ? 0xFFFF : ( uint16_t )n );
+}
+
+class SpiScheduler
+{
+private:
+    spi_job_t *m_head;
+    spi_job_t *m_last;          /* job of the previous step */
+    spi_sched_stats_t m_stats;
+
+    void remove( spi_job_t *job );
+
+public:
+    SpiScheduler();
+
+    void submit( spi_job_t *job );
+    void cancel( spi_job_t *job );
+
+    bool poll();
+    void run( uint32_t budget_us );
+    void flush();
+
+    bool busy() const
+    {
+        return m_head != NULL;
+    }
+
+    const spi_sched_stats_t *stats() const
+    {
+        return &m_stats;
+    }
+};
+
+#endif
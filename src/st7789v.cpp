@@ -31,6 +31,12 @@
 
 #include "st7789v.h"
 
+#ifdef ST7789V_CALIB_EEPROM_ADDR
+    #include <EEPROM.h>
+#endif
+
+typedef st7789v_view<st7789v_default_panel_t, ST7789V_DEFAULT_ROTATION> default_view_t;
+
 st7789v_handle_t ST7789V::m_st7789v_handle = {
     .scl = 0,
     .sda = 0,
@@ -39,7 +45,25 @@ st7789v_handle_t ST7789V::m_st7789v_handle = {
     .dc  = 0,
     .spi_mode = 0,
     .spi_bit_order = 0,
-    .spi_speed = 0
+    .spi_speed = 0,
+    .width    = default_view_t::width,
+    .height   = default_view_t::height,
+    .x_offset = default_view_t::x_offset,
+    .y_offset = default_view_t::y_offset,
+    .rotation = default_view_t::rotation,
+    .framebuffer = NULL,
+    .st7789v_ops = { NULL, NULL, NULL }
+};
+
+disp_clip_t ST7789V::m_clip;
+u8 ST7789V::m_bus_depth = 0;
+GlyphCache *ST7789V::m_glyph_cache = NULL;
+const st7789v_stream_job_t *ST7789V::m_window_job = NULL;
+spi_device_t ST7789V::m_bus_device = {
+    SPISettings(),
+    ST7789V::bus_begin_cb,
+    ST7789V::bus_end_cb,
+    NULL
 };
 
 
@@ -94,21 +118,21 @@ enum st7789v_command {
     RDID3     = 0xDC,   // Read ID3
 };
 
-struct st7789v_cmd_param st7789v_init_cmds[] = {
-    // command  len data  ms  us
-    SWRESET, 0, NULL, 120, 0,   // software reset
-    SLPOUT,  0, NULL, 10, 0,     // sleep out
+/* command, parameter count, parameters, delay in ms; see init_display_P() */
+static const u8 st7789v_init_seq[] PROGMEM = {
+    SWRESET, 0, 120,                        // software reset
+    SLPOUT,  0, 10,                         // sleep out
     
-    COLMOD,  1, ( u8[] ){0x55}, 10, 0, // interface pixel format, 16-bit/pixel for RGB 565 format
-    CASET,   4, ( u8[] ){0x00, 0x00, 0x00, 0xEF}, 0, 0, // column address set - from 0 to 239
-    RASET,   4, ( u8[] ){0x00, 0x00, 0x00, 0x86}, 0, 0, // row address set - from 0 to 134
-    MADCTL,  1, ( u8[] ){0x00}, 0, 0, // memory data access control
+    COLMOD,  1, 0x55, 10,                   // interface pixel format, 16-bit/pixel for RGB 565 format
+    CASET,   4, 0x00, 0x00, 0x00, 0xEF, 0,  // column address set - from 0 to 239
+    RASET,   4, 0x00, 0x00, 0x00, 0x86, 0,  // row address set - from 0 to 134
+    MADCTL,  1, 0x00, 0,                    // memory data access control
     
-    NORON,   0, NULL, 10, 0,     // normal display mode on, means partial mode off
+    NORON,   0, 10,                         // normal display mode on, means partial mode off
     
-    //WRDISBV, 1, ( u8[] ){0xFF}, 0, 0, // write display brightness
-    //INVOFF,  0, NULL, 10, 0,     // display inversion off
-    //DISPON,  0, NULL, 10, 0,    // display on, recover from display off mode, output from the frame memory is enabled.
+    //WRDISBV, 1, 0xFF, 0,                  // write display brightness
+    //INVOFF,  0, 10,                       // display inversion off
+    //DISPON,  0, 10,                       // display on, recover from display off mode, output from the frame memory is enabled.
 };
 
 
@@ -121,11 +145,18 @@ ST7789V::ST7789V( int scl, int sda, int cs, int dc, int rst )
     handle.cs  = cs;
     handle.dc  = dc;
     handle.res = rst;
-    handle.spi_speed = 14000000;
+    handle.spi_speed = ST7789V_SPI_SPEED;
     handle.spi_mode  = SPI_MODE0;
     handle.spi_bit_order = MSBFIRST;
     
+    handle.rotation = default_view_t::rotation;
+    handle.width    = default_view_t::width;
+    handle.height   = default_view_t::height;
+    handle.x_offset = default_view_t::x_offset;
+    handle.y_offset = default_view_t::y_offset;
+    
     m_st7789v_handle = handle;
+    disp_clip_init( &m_clip, handle.width, handle.height );
 }
 
 
@@ -138,11 +169,18 @@ ST7789V::ST7789V( int cs, int dc, int rst )
     handle.cs  = cs;
     handle.dc  = dc;
     handle.res = rst;
-    handle.spi_speed = 14000000;
+    handle.spi_speed = ST7789V_SPI_SPEED;
     handle.spi_mode  = SPI_MODE0;
     handle.spi_bit_order = MSBFIRST;
     
+    handle.rotation = default_view_t::rotation;
+    handle.width    = default_view_t::width;
+    handle.height   = default_view_t::height;
+    handle.x_offset = default_view_t::x_offset;
+    handle.y_offset = default_view_t::y_offset;
+    
     m_st7789v_handle = handle;
+    disp_clip_init( &m_clip, handle.width, handle.height );
 }
 
 inline static  void st7789_set_init_pinMode()
@@ -183,12 +221,283 @@ void ST7789V::init( u16 width, u16 height )
     st7789_set_init_pinState();
     st7789_hardware_reset();
 
-#if ST7789V_USE_HARDWARE_SPI
-    SPI.beginTransaction(SPISettings(14000000, MSBFIRST, SPI_MODE0));
+#if !ST7789V_USE_SOFTWARE_SPI
+    SPI.begin();
+#endif
+
+#ifdef ST7789V_CALIB_EEPROM_ADDR
+    load_spi_clock();
 #endif
     
-    init_display( st7789v_init_cmds,
-                  sizeof( st7789v_init_cmds ) / sizeof( st7789v_init_cmds[0] ) );
+    /* every command takes and releases the bus, delays do not hold it */
+    init_display_P( st7789v_init_seq, sizeof( st7789v_init_seq ) );
+                  
+    set_rotation( ST7789V_DEFAULT_ROTATION );
 }
 
 
+
+// Calibration ///////////////////////////////////////////////////////////////////
+
+#define ST7789V_CALIB_PATTERNS (5)
+#define ST7789V_CALIB_MAGIC    (0x7789)
+
+/* pixel i of test pattern p: full toggling, alternate bits, stuck bits, noise */
+static u16 st7789v_calib_pattern( u8 p, u16 i )
+{
+    u16 s;
+    
+    switch( p )
+    {
+    case 0:
+        return ( i & 1 ) ? 0xFFFF : 0x0000;
+        
+    case 1:
+        return ( i & 1 ) ? 0x5555 : 0xAAAA;
+        
+    case 2:
+        return ( u16 )( 1u << ( i & 15 ) );
+        
+    case 3:
+        return ( u16 )~( 1u << ( i & 15 ) );
+        
+    default:
+        s = ( u16 )( i * 0x9E37u + 0x7789u );
+        s ^= s << 7;
+        s ^= s >> 9;
+        s ^= s << 8;
+        return s;
+    }
+}
+
+static inline void st7789v_bus_write( u8 data )
+{
+#if ST7789V_USE_SOFTWARE_SPI
+    ST7789V::writebyte( data );
+#else
+    SPI.transfer( data );
+#endif
+}
+
+static inline u8 st7789v_bus_read()
+{
+#if ST7789V_USE_SOFTWARE_SPI
+    return ST7789V::readbyte();
+#else
+    return SPI.transfer( 0x00 );
+#endif
+}
+
+#ifdef ST7789V_CALIB_EEPROM_ADDR
+typedef struct
+{
+    u16 magic;
+    u32 hz;
+    u16 check;
+} st7789v_calib_record_t;
+
+static inline u16 st7789v_calib_check( u32 hz )
+{
+    return ( u16 )( hz ^ ( hz >> 16 ) ^ ST7789V_CALIB_MAGIC );
+}
+
+static void st7789v_calib_save( u32 hz )
+{
+    st7789v_calib_record_t rec = { ST7789V_CALIB_MAGIC, hz, st7789v_calib_check( hz ) };
+    
+#if defined(ESP8266) || defined(ESP32)
+    EEPROM.begin( ST7789V_CALIB_EEPROM_ADDR + sizeof( rec ) );
+#endif
+    EEPROM.put( ST7789V_CALIB_EEPROM_ADDR, rec );
+#if defined(ESP8266) || defined(ESP32)
+    EEPROM.commit();
+#endif
+}
+#endif
+
+/**
+ * @brief Read a w x h window of GRAM back as RGB565, in the coordinates of
+ * the current rotation. Clocked at ST7789V_READ_SPEED at most.
+ *
+ * The controller answers RAMRD with a dummy byte, then 18 bit pixels even
+ * in 16 bit COLMOD, one byte per channel with the value in the upper bits.
+ * On hardware SPI this needs MISO wired to the panel.
+ *
+ * @return false if called inside an open transaction
+ */
+bool ST7789V::read_gram( u16 x, u16 y, u16 w, u16 h, u16 *buf )
+{
+    st7789v_handle_t *handle = &m_st7789v_handle;
+    u32 speed = handle->spi_speed, n = ( u32 )w * h;
+    
+    /* the read clock is only applied by an outermost bus_begin() */
+    if( m_bus_depth ) {
+        return false;
+    }
+    
+    set_addr( x, y, x + w - 1, y + h - 1 );
+    
+    if( handle->spi_speed > ST7789V_READ_SPEED ) {
+        handle->spi_speed = ST7789V_READ_SPEED;
+    }
+    
+    bus_begin();
+    set_cs( LOW );
+    set_dc( LOW );
+    st7789v_bus_write( 0x2E );
+    set_dc( HIGH );
+    st7789v_bus_read();
+    
+    while( n-- )
+    {
+        u8 r = st7789v_bus_read();
+        u8 g = st7789v_bus_read();
+        u8 b = st7789v_bus_read();
+        
+        *buf++ = ( u16 )( ( ( r & 0xF8 ) << 8 ) | ( ( g & 0xFC ) << 3 ) | ( b >> 3 ) );
+    }
+    
+    set_cs( HIGH );
+    bus_end();
+    
+    handle->spi_speed = speed;
+    
+    return true;
+}
+
+/**
+ * @brief Write every test pattern into the ST7789V_CALIB_SIZE square at
+ * (0, 0) with a write clock of hz, and compare what reads back.
+ *
+ * @return true if all ST7789V_CALIB_PASSES runs came back intact
+ */
+bool ST7789V::self_test( u32 hz )
+{
+    st7789v_handle_t *handle = &m_st7789v_handle;
+    const u16 n = ST7789V_CALIB_SIZE * ST7789V_CALIB_SIZE;
+    u16 px[ST7789V_CALIB_SIZE * ST7789V_CALIB_SIZE];
+    u32 speed = handle->spi_speed;
+    u8 p, pass;
+    u16 i;
+    
+    for( p = 0; p < ST7789V_CALIB_PATTERNS; p++ )
+    {
+        for( pass = 0; pass < ST7789V_CALIB_PASSES; pass++ )
+        {
+            /* shift the pattern each pass so stale GRAM cannot pass */
+            for( i = 0; i < n; i++ ) {
+                px[i] = st7789v_calib_pattern( p, i + pass );
+            }
+            
+            handle->spi_speed = hz;
+            set_addr( 0, 0, ST7789V_CALIB_SIZE - 1, ST7789V_CALIB_SIZE - 1 );
+            write_pixels( px, n );
+            handle->spi_speed = speed;
+            
+            if( !read_gram( 0, 0, ST7789V_CALIB_SIZE, ST7789V_CALIB_SIZE, px ) ) {
+                return false;
+            }
+            
+            for( i = 0; i < n; i++ )
+            {
+                if( px[i] != st7789v_calib_pattern( p, i + pass ) ) {
+                    return false;
+                }
+            }
+        }
+    }
+    
+    return true;
+}
+
+/**
+ * @brief Step the write clock up from min_hz by step_hz until the self-test
+ * fails or max_hz is reached, then settle on the fastest passing clock less
+ * ST7789V_CALIB_MARGIN percent. The result goes to the handle, and to
+ * EEPROM when ST7789V_CALIB_EEPROM_ADDR is defined.
+ *
+ * Call it after init() and before drawing, the top left corner is
+ * overwritten. The SPI peripheral rounds every clock down to one of its
+ * dividers, so neighbouring steps may test the same real clock.
+ *
+ * @return the new clock, 0 if min_hz already failed and nothing changed
+ */
+u32 ST7789V::calibrate_spi_clock( u32 min_hz, u32 max_hz, u32 step_hz )
+{
+    st7789v_handle_t *handle = &m_st7789v_handle;
+    
+#if ST7789V_USE_SOFTWARE_SPI
+    /* bit banged, the clock is whatever digitalWrite() manages */
+    ( void )min_hz;
+    ( void )max_hz;
+    ( void )step_hz;
+    
+    return self_test( handle->spi_speed ) ? handle->spi_speed : 0;
+#else
+    u32 hz, good = 0;
+    
+    if( !min_hz || !step_hz ) {
+        return 0;
+    }
+    
+    for( hz = min_hz; hz <= max_hz; hz += step_hz )
+    {
+        if( !self_test( hz ) ) {
+            break;
+        }
+        
+        good = hz;
+        
+        if( max_hz - hz < step_hz ) {
+            break;
+        }
+    }
+    
+    if( !good ) {
+        return 0;
+    }
+    
+    hz = good / 100 * ( 100 - ST7789V_CALIB_MARGIN );
+    
+    if( hz < min_hz ) {
+        hz = min_hz;
+    }
+    
+    handle->spi_speed = hz;
+    
+#ifdef ST7789V_CALIB_EEPROM_ADDR
+    st7789v_calib_save( hz );
+#endif
+    
+    return hz;
+#endif
+}
+
+/**
+ * @brief Restore the clock of the last calibration, init() calls this
+ * when ST7789V_CALIB_EEPROM_ADDR is defined.
+ *
+ * @return false if nothing valid was stored
+ */
+bool ST7789V::load_spi_clock()
+{
+#ifdef ST7789V_CALIB_EEPROM_ADDR
+    st7789v_calib_record_t rec;
+    
+#if defined(ESP8266) || defined(ESP32)
+    EEPROM.begin( ST7789V_CALIB_EEPROM_ADDR + sizeof( rec ) );
+#endif
+    EEPROM.get( ST7789V_CALIB_EEPROM_ADDR, rec );
+    
+    if( rec.magic != ST7789V_CALIB_MAGIC || !rec.hz ||
+        rec.check != st7789v_calib_check( rec.hz ) ) {
+        return false;
+    }
+    
+    m_st7789v_handle.spi_speed = rec.hz;
+    
+    return true;
+#else
+    return false;
+#endif
+}
@@ -32,9 +32,18 @@
 #ifndef __ST7789V_H
 #define __ST7789V_H
 
+#include <assert.h>
 #include <inttypes.h>
 #include <SPI.h>
 
+#include "disp_clip.h"
+#include "disp_raster.h"
+#include "disp_compositor.h"
+#include "disp_governor.h"
+#include "glyph_cache.h"
+#include "rgb565.h"
+#include "spi_scheduler.h"
+
 #define NUMARGS(...)  (sizeof((int[]){__VA_ARGS__}) / sizeof(int))
 
 #define write_reg(handle, ...)                                            \
@@ -49,6 +58,154 @@
     #define ST7789V_USE_SOFTWARE_SPI 1
 #endif
 
+/* controller frame memory size, fixed by the st7789v itself */
+#define ST7789V_GRAM_WIDTH  (240)
+#define ST7789V_GRAM_HEIGHT (320)
+
+/* panel geometry, override these before including this header */
+#ifndef ST7789V_PANEL_WIDTH
+    #define ST7789V_PANEL_WIDTH (135)
+#endif
+
+#ifndef ST7789V_PANEL_HEIGHT
+    #define ST7789V_PANEL_HEIGHT (240)
+#endif
+
+/* where the visible panel starts inside GRAM, in rotation 0 */
+#ifndef ST7789V_PANEL_COL_OFFSET
+    #define ST7789V_PANEL_COL_OFFSET (52)
+#endif
+
+#ifndef ST7789V_PANEL_ROW_OFFSET
+    #define ST7789V_PANEL_ROW_OFFSET (40)
+#endif
+
+/* rotation applied by init(), 1 means landscape 240x135 */
+#ifndef ST7789V_DEFAULT_ROTATION
+    #define ST7789V_DEFAULT_ROTATION (1)
+#endif
+
+/* write clock until calibrate_spi_clock() finds a better one */
+#ifndef ST7789V_SPI_SPEED
+    #define ST7789V_SPI_SPEED (14000000UL)
+#endif
+
+/* the read cycle is far slower than the write cycle, GRAM is read back at this */
+#ifndef ST7789V_READ_SPEED
+    #define ST7789V_READ_SPEED (4000000UL)
+#endif
+
+/* percent taken off the fastest passing clock */
+#ifndef ST7789V_CALIB_MARGIN
+    #define ST7789V_CALIB_MARGIN (20)
+#endif
+
+/* 1 echoes commands and register reads to Serial, which then can not be a data link */
+#ifndef ST7789V_DEBUG
+    #define ST7789V_DEBUG (0)
+#endif
+
+/* 1 turns on the driver's assert()s, they halt on a misused API */
+#ifndef ST7789V_ASSERT
+    #define ST7789V_ASSERT ST7789V_DEBUG
+#endif
+
+/* clean runs of every pattern needed before a clock counts as passing */
+#ifndef ST7789V_CALIB_PASSES
+    #define ST7789V_CALIB_PASSES (3)
+#endif
+
+/* side of the square GRAM window at (0, 0) the self-test overwrites */
+#ifndef ST7789V_CALIB_SIZE
+    #define ST7789V_CALIB_SIZE (8)
+#endif
+
+/* define ST7789V_CALIB_EEPROM_ADDR to keep the calibrated clock over resets */
+
+/* pixels of a horizontal gradient built on the stack at a time */
+#ifndef ST7789V_GRADIENT_CHUNK
+    #define ST7789V_GRADIENT_CHUNK (32)
+#endif
+
+/* MADCTL bits */
+#define ST7789V_MADCTL_MY  (0x80)   /* row address order */
+#define ST7789V_MADCTL_MX  (0x40)   /* column address order */
+#define ST7789V_MADCTL_MV  (0x20)   /* row/column exchange */
+#define ST7789V_MADCTL_ML  (0x10)   /* line address order */
+#define ST7789V_MADCTL_BGR (0x08)   /* RGB/BGR order */
+
+#ifndef ST7789V_MADCTL_COLOR_ORDER
+    #define ST7789V_MADCTL_COLOR_ORDER (0x00)
+#endif
+
+/* WRCTRLD bits */
+#define ST7789V_CTRLD_BCTRL (0x20)  /* brightness control on */
+#define ST7789V_CTRLD_DD    (0x08)  /* controller ramps brightness changes */
+#define ST7789V_CTRLD_BL    (0x04)  /* backlight on */
+
+/**
+ * @brief Physical panel geometry, all members are compile time constants.
+ *
+ * @tparam W        panel width in rotation 0
+ * @tparam H        panel height in rotation 0
+ * @tparam COL_OFS  first visible GRAM column in rotation 0
+ * @tparam ROW_OFS  first visible GRAM row in rotation 0
+ */
+template <u16 W, u16 H, u16 COL_OFS, u16 ROW_OFS>
+struct st7789v_panel {
+    static constexpr u16 width      = W;
+    static constexpr u16 height     = H;
+    static constexpr u16 col_offset = COL_OFS;
+    static constexpr u16 row_offset = ROW_OFS;
+    
+    static_assert( W + COL_OFS <= ST7789V_GRAM_WIDTH, "panel exceeds GRAM width" );
+    static_assert( H + ROW_OFS <= ST7789V_GRAM_HEIGHT, "panel exceeds GRAM height" );
+};
+
+/**
+ * @brief A panel seen through one of the four MADCTL rotations.
+ *
+ * Everything here folds to constants, so a draw call templated on a view
+ * costs no more than one with literal coordinates.
+ */
+template <class PANEL, u8 ROTATION>
+struct st7789v_view {
+    typedef PANEL panel;
+    
+    static constexpr u8 rotation = ROTATION % 4;
+    static constexpr bool swap_xy = ( rotation & 1 );
+    
+    static constexpr u16 width  = swap_xy ? PANEL::height : PANEL::width;
+    static constexpr u16 height = swap_xy ? PANEL::width : PANEL::height;
+    
+    static constexpr u8 madctl = ST7789V_MADCTL_COLOR_ORDER |
+                                 ( rotation == 0 ? 0x00 :
+                                   rotation == 1 ? ( ST7789V_MADCTL_MX | ST7789V_MADCTL_MV ) :
+                                   rotation == 2 ? ( ST7789V_MADCTL_MX | ST7789V_MADCTL_MY ) :
+                                   ( ST7789V_MADCTL_MY | ST7789V_MADCTL_MV ) );
+                                   
+    /* mirrored axes count from the far end of GRAM */
+    static constexpr u16 x_offset =
+        rotation == 0 ? PANEL::col_offset :
+        rotation == 1 ? PANEL::row_offset :
+        rotation == 2 ? ST7789V_GRAM_WIDTH - PANEL::width - PANEL::col_offset :
+        ST7789V_GRAM_HEIGHT - PANEL::height - PANEL::row_offset;
+        
+    static constexpr u16 y_offset =
+        rotation == 0 ? PANEL::row_offset :
+        rotation == 1 ? ST7789V_GRAM_WIDTH - PANEL::width - PANEL::col_offset :
+        rotation == 2 ? ST7789V_GRAM_HEIGHT - PANEL::height - PANEL::row_offset :
+        PANEL::col_offset;
+        
+    static constexpr bool contains( int32_t x, int32_t y )
+    {
+        return x >= 0 && y >= 0 && x < width && y < height;
+    }
+};
+
+typedef st7789v_panel<ST7789V_PANEL_WIDTH, ST7789V_PANEL_HEIGHT,
+        ST7789V_PANEL_COL_OFFSET, ST7789V_PANEL_ROW_OFFSET> st7789v_default_panel_t;
+
 union WDATA {
     uint16_t w;
     struct {
@@ -96,8 +253,12 @@ typedef struct
     uint8_t spi_bit_order;
     uint32_t spi_speed;
     
+    /* geometry of the current rotation, see set_rotation() */
     uint16_t width;
     uint16_t height;
+    uint16_t x_offset;
+    uint16_t y_offset;
+    uint8_t rotation;
     
     uint32_t *framebuffer;
     
@@ -113,18 +274,40 @@ struct st7789v_cmd_param {
     u16 delay_us;   // delay us
 };
 
-class ST7789V: SPIClass
+/* a window streamed in chunks through SpiScheduler */
+typedef struct
+{
+    spi_job_t job;
+    disp_area_t area;
+    const u16 *pixels;
+    u16 color;
+    u32 left;
+    u32 open;       /* pixels the window set by this job still takes */
+} st7789v_stream_job_t;
+
+class ST7789V
 {
 private:
 
 public:
     static st7789v_handle_t m_st7789v_handle;
+    static disp_clip_t m_clip;
+    static u8 m_bus_depth;
+    static spi_device_t m_bus_device;
+    static GlyphCache *m_glyph_cache;
+    static const st7789v_stream_job_t *m_window_job;   /* NULL after any other command */
     
     ST7789V( int scl, int sda, int cs, int dc, int rst );
     ST7789V( int cs, int dc, int rst );
     
     void init( u16 width, u16 height );
-    
+
+    // CALIBRATION API **********************************************
+    static bool read_gram( u16 x, u16 y, u16 w, u16 h, u16 *buf );
+    static bool self_test( u32 hz );
+    static u32 calibrate_spi_clock( u32 min_hz, u32 max_hz, u32 step_hz );
+    static bool load_spi_clock();
+
     /**
      * @brief Set the cs object
      *
@@ -239,8 +422,37 @@ public:
         
     }
     
+    /**
+     * @brief Bracket bus access with an SPI transaction. Calls nest, only
+     * the outermost pair touches the bus, so a whole draw call shares one
+     * transaction and never keeps the bus past its end.
+     */
+    inline static void bus_begin()
+    {
+#if !ST7789V_USE_SOFTWARE_SPI
+        st7789v_handle_t *handle = &m_st7789v_handle;
+        
+        if( !m_bus_depth++ ) {
+            SPI.beginTransaction( SPISettings( handle->spi_speed,
+                                               handle->spi_bit_order,
+                                               handle->spi_mode ) );
+        }
+#endif
+    }
+    
+    inline static void bus_end()
+    {
+#if !ST7789V_USE_SOFTWARE_SPI
+        if( m_bus_depth && !--m_bus_depth ) {
+            SPI.endTransaction();
+        }
+#endif
+    }
+    
     inline static void write_cmd( u8 cmd )
     {
+        m_window_job = NULL;
+        bus_begin();
         set_cs( LOW );
         set_dc( LOW );
         
@@ -250,10 +462,12 @@ public:
         SPI.transfer( cmd );
 #endif
         set_cs( HIGH );
+        bus_end();
     }
     
     inline static void write_data( u8 data )
     {
+        bus_begin();
         set_cs( LOW );
         set_dc( HIGH );
         
@@ -263,10 +477,12 @@ public:
         SPI.transfer( data );
 #endif
         set_cs( HIGH );
+        bus_end();
     }
     
     inline static void write_wdata( u16 dat )
     {
+        bus_begin();
         set_cs( LOW );
         set_dc( HIGH );
 #if ST7789V_USE_SOFTWARE_SPI
@@ -276,7 +492,57 @@ public:
         SPI.transfer( dat >> 8 );
         SPI.transfer( dat );
 #endif
-        set_cs( HIGH );  
+        set_cs( HIGH );
+        bus_end();
+    }
+    
+    /**
+     * @brief Stream one color n times, CS stays low for the whole run.
+     */
+    inline static void write_color( u16 color, u32 n )
+    {
+        bus_begin();
+        set_cs( LOW );
+        set_dc( HIGH );
+        
+        while( n-- )
+        {
+#if ST7789V_USE_SOFTWARE_SPI
+            writebyte( color >> 8 );
+            writebyte( color );
+#else
+            SPI.transfer( color >> 8 );
+            SPI.transfer( color );
+#endif
+        }
+        
+        set_cs( HIGH );
+        bus_end();
+    }
+    
+    /**
+     * @brief Stream n RGB565 pixels, CS stays low for the whole run.
+     */
+    inline static void write_pixels( const u16 *buf, u32 n )
+    {
+        bus_begin();
+        set_cs( LOW );
+        set_dc( HIGH );
+        
+        while( n-- )
+        {
+            u16 color = *buf++;
+#if ST7789V_USE_SOFTWARE_SPI
+            writebyte( color >> 8 );
+            writebyte( color );
+#else
+            SPI.transfer( color >> 8 );
+            SPI.transfer( color );
+#endif
+        }
+        
+        set_cs( HIGH );
+        bus_end();
     }
     
     inline static void send_command( u8 cmd, const u8 *buf, u8 lens )
@@ -304,18 +570,24 @@ public:
         set_cs( HIGH );
         */
 
-               Serial.print( "cmd: " );
+#if ST7789V_DEBUG
+        Serial.print( "cmd: " );
         Serial.print( cmd, HEX );
         Serial.print( " " );
+#endif
         write_cmd( cmd );
         
         for( u8 i = 0; i < lens; i++ )
         {
+#if ST7789V_DEBUG
             Serial.print( " " );
             Serial.print( *buf, HEX );
+#endif
             write_data( *buf++ );
         }
+#if ST7789V_DEBUG
         Serial.println();
+#endif
     }
     
     inline static void read_command8( u8 cmd, u8 index )
@@ -330,12 +602,18 @@ public:
         do
         {
             result = readbyte();
+#if ST7789V_DEBUG
             Serial.print( "read_command8: " );
             Serial.print( result );
+#endif
         }
         while( index-- );
         
+#if ST7789V_DEBUG
         Serial.println();
+#else
+        ( void )result;
+#endif
         set_cs( HIGH );
     }
     
@@ -396,7 +674,9 @@ public:
         for( int i = 0; i < lens; i++ )
         {
             buf[i] = readbyte();
+#if ST7789V_DEBUG
             Serial.println( buf[i], HEX );
+#endif
         }
         
         digitalWrite( handle->cs, HIGH );
@@ -438,10 +718,31 @@ public:
     }
     
     inline static void set_addr( u16 x1, u16 y1, u16 x2, u16 y2 )
+    {
+        set_gram_addr( x1 + m_st7789v_handle.x_offset,
+                       y1 + m_st7789v_handle.y_offset,
+                       x2 + m_st7789v_handle.x_offset,
+                       y2 + m_st7789v_handle.y_offset );
+    }
+    
+    /**
+     * @brief Same as set_addr(), but with the offsets of a fixed view
+     * folded in at compile time.
+     */
+    template <class VIEW>
+    inline static void set_addr( u16 x1, u16 y1, u16 x2, u16 y2 )
+    {
+        set_gram_addr( x1 + VIEW::x_offset, y1 + VIEW::y_offset,
+                       x2 + VIEW::x_offset, y2 + VIEW::y_offset );
+    }
+    
+    /* raw GRAM window, no rotation offsets applied */
+    inline static void set_gram_addr( u16 x1, u16 y1, u16 x2, u16 y2 )
     {
         // set_col_addr( x1, x2 );
         // set_row_addr( y1, y2 );
         // write_cmd( 0x2C );
+        bus_begin();
         write_cmd( 0x2A );
         write_wdata( x1 );
         write_wdata( x2 );
@@ -449,6 +750,7 @@ public:
         write_wdata( y1 );
         write_wdata( y2 );
         write_cmd( 0x2C );
+        bus_end();
     }
     
     inline static void set_display_power( bool on )
@@ -461,66 +763,647 @@ public:
         }
     }
     
+    /**
+     * @brief Enter or leave sleep, SLPIN/SLPOUT. Wait 120 ms after either
+     * before sending the other, and 5 ms after SLPOUT before drawing.
+     */
+    inline static void set_sleep( bool sleep )
+    {
+        write_cmd( sleep ? 0x10 : 0x11 );
+        delay( 5 );
+    }
+    
+    /**
+     * @brief Display brightness, WRDISBV. It only reaches the backlight on
+     * panels that drive it from the controller's LEDPWM pin and only with
+     * ST7789V_CTRLD_BCTRL set, a GPIO backlight ignores it.
+     */
+    inline static void set_brightness( u8 level )
+    {
+        bus_begin();
+        write_cmd( 0x51 );
+        write_data( level );
+        bus_end();
+    }
+    
+    /* WRCTRLD, ST7789V_CTRLD_* bits */
+    inline static void set_display_control( u8 ctrl )
+    {
+        bus_begin();
+        write_cmd( 0x53 );
+        write_data( ctrl );
+        bus_end();
+    }
+    
+    // POWER API ****************************************************
+    static void sleep_cb( void *ctx, bool sleep )
+    {
+        ( void )ctx;
+        
+        if( sleep ) {
+            write_cmd( 0x28 );
+            set_sleep( true );
+        }
+        else {
+            set_sleep( false );
+            write_cmd( 0x29 );
+        }
+    }
+    
+    static void brightness_cb( void *ctx, uint8_t level )
+    {
+        ( void )ctx;
+        
+        set_brightness( level );
+    }
+    
+    /**
+     * @brief This panel as a DispGovernor target. The controller keeps no
+     * frame of ours, so flush comes from the caller, e.g. the compositor.
+     * With ST7789V_CTRLD_DD set the controller ramps brightness itself,
+     * give the governor a ramp_step of 255 then.
+     */
+    inline static disp_power_ops_t power_ops( void ( *flush )( void *ctx, const disp_area_t *area ),
+                                              void *ctx )
+    {
+        disp_power_ops_t ops = { flush, sleep_cb, brightness_cb, ctx };
+        
+        return ops;
+    }
+    
     // DRAW API ***************************************************
     inline static void clear_screen_directly( u16 color )
     {
-        // set_addr( 0, 0, 240, 320 );
-        set_addr(0,0,240, 135);
-        u16 i, j;
+        st7789v_stream_job_t job;
         
-        for( i = 0; i < 320; i++ )
-        {
-            for( j = 0; j < 240; j++ )
-            {
-                write_wdata( color );
-            }
-        }
+        clear_job( &job, color, 0xFFFF );
+        run_job( &job );
+    }
+    
+    /**
+     * @brief Apply a rotation whose geometry is known at compile time.
+     */
+    template <class VIEW>
+    inline static void apply_view()
+    {
+        st7789v_handle_t *handle = &m_st7789v_handle;
+        u8 madctl = VIEW::madctl;
         
-        // for( int k = 0; k < 200; k++ ) {
-        //     write_data( color >> 8 );
-        //     write_data( color );
-        // }
+        handle->rotation = VIEW::rotation;
+        handle->width    = VIEW::width;
+        handle->height   = VIEW::height;
+        handle->x_offset = VIEW::x_offset;
+        handle->y_offset = VIEW::y_offset;
+        
+        disp_clip_init( &m_clip, VIEW::width, VIEW::height );
+        
+        send_command( 0x36, &madctl, 1 );
     }
-
+    
+    template <u8 ROTATION>
+    inline static void set_rotation()
+    {
+        apply_view< st7789v_view<st7789v_default_panel_t, ROTATION> >();
+    }
+    
+    /**
+     * @brief Set the rotation of the default panel through MADCTL.
+     *
+     * @param rotation 0 ~ 3, in 90 degree steps clockwise
+     */
     inline static void set_rotation( u8 rotation )
     {
-        u8 r = rotation % 4;
-        u8 param_rotation;
-
-        switch (r)
+        switch( rotation % 4 )
         {
         case 0:
-            param_rotation = (3 << 6);
+            set_rotation<0>();
             break;
-        
-        case  1:
-            param_rotation = (2 << 6);
+            
+        case 1:
+            set_rotation<1>();
             break;
-
+            
+        case 2:
+            set_rotation<2>();
+            break;
+            
         default:
+            set_rotation<3>();
             break;
         }
+    }
+    
+    inline static void put_pixel( disp_coord_t x, disp_coord_t y,
+                                  u16 color )
+    {
+        if( !disp_clip_point( &m_clip, &x, &y ) ) {
+            return;
+        }
         
+        set_addr( x, y, x, y );
+        write_wdata( color );
+    }
+    
+    // CLIP API ***************************************************
+    /**
+     * @brief Draw relative to (x, y) and clip to w x h until the
+     * matching pop_clip(). Nests up to DISP_CLIP_STACK_DEPTH deep.
+     */
+    inline static bool push_viewport( disp_coord_t x, disp_coord_t y,
+                                      disp_coord_t w, disp_coord_t h )
+    {
+        return disp_clip_push_viewport( &m_clip, x, y, w, h );
+    }
+    
+    inline static bool push_clip( disp_coord_t x1, disp_coord_t y1,
+                                  disp_coord_t x2, disp_coord_t y2 )
+    {
+        disp_area_t area = { x1, y1, x2, y2 };
         
-        //send_command( 0x36, param_rotation, sizeof( param ) / sizeof( param[0] ) );
+        return disp_clip_push( &m_clip, &area );
     }
     
-    inline static void put_pixel( u16 x, u16 y,
-                                  u16 color )
+    inline static void pop_clip()
     {
-        /*
-        if( x >= handle->width || y >= handle->height ) {
+        disp_clip_pop( &m_clip );
+    }
+    
+    /**
+     * @brief Fill a rectangle, clipped once, sent as a single window.
+     */
+    inline static void fill_rect( disp_coord_t x, disp_coord_t y,
+                                  disp_coord_t w, disp_coord_t h, u16 color )
+    {
+        st7789v_stream_job_t job;
+        
+        fill_job( &job, x, y, w, h, color, 0xFFFF );
+        run_job( &job );
+    }
+    
+    inline static void draw_hline( disp_coord_t x, disp_coord_t y,
+                                   disp_coord_t w, u16 color )
+    {
+        fill_rect( x, y, w, 1, color );
+    }
+    
+    inline static void draw_vline( disp_coord_t x, disp_coord_t y,
+                                   disp_coord_t h, u16 color )
+    {
+        fill_rect( x, y, 1, h, color );
+    }
+    
+    /**
+     * @brief Blit a w x h RGB565 image, clipped rows are skipped
+     * instead of sent.
+     */
+    inline static void draw_bitmap( disp_coord_t x, disp_coord_t y,
+                                    disp_coord_t w, disp_coord_t h,
+                                    const u16 *bitmap )
+    {
+        disp_area_t area = { x, y, ( disp_coord_t )( x + w - 1 ),
+                             ( disp_coord_t )( y + h - 1 )
+                           };
+        const disp_viewport_t *vp = disp_clip_current( &m_clip );
+        disp_coord_t row, cols;
+        
+        if( w <= 0 || h <= 0 || !disp_clip_area( &m_clip, &area ) ) {
             return;
         }
         
-        u16 *p = ( u16 * )handle->framebuffer + x + y * handle->width;
-        *p = color;
-        */
-        set_addr( x, y, x + 1, y + 1 );
+        /* back to bitmap coordinates */
+        x += vp->ox;
+        y += vp->oy;
+        cols = area.x2 - area.x1 + 1;
+        
+        set_addr( area.x1, area.y1, area.x2, area.y2 );
+        
+        /* unclipped columns, the rows follow each other in memory */
+        if( cols == w ) {
+            write_pixels( bitmap + ( u32 )( area.y1 - y ) * w,
+                          ( u32 )w * ( area.y2 - area.y1 + 1 ) );
+            return;
+        }
+        
+        for( row = area.y1; row <= area.y2; row++ ) {
+            write_pixels( bitmap + ( u32 )( row - y ) * w + ( area.x1 - x ), cols );
+        }
+    }
+    
+    // TEXT API ***************************************************
+    /**
+     * @brief Draw glyphs through cache, NULL expands every glyph again.
+     */
+    inline static void set_glyph_cache( GlyphCache *cache )
+    {
+        m_glyph_cache = cache;
+    }
+    
+    /**
+     * @brief Draw character c with its top left corner at (x, y), one
+     * advance wide, background pixels in bg.
+     */
+    inline static void draw_char( disp_coord_t x, disp_coord_t y, uint8_t c,
+                                  const disp_font_t *font, u16 fg, u16 bg )
+    {
+        const u16 *px = m_glyph_cache ? m_glyph_cache->get( font, c, fg, bg ) : NULL;
+        
+        if( px ) {
+            draw_bitmap( x, y, font->advance, font->height, px );
+        }
+        else if( ( u16 )font->advance * font->height <= GLYPH_CACHE_SLOT_PX )
+        {
+            u16 buf[GLYPH_CACHE_SLOT_PX];
+            
+            glyph_expand( font, c, fg, bg, buf );
+            draw_bitmap( x, y, font->advance, font->height, buf );
+        }
+        else
+        {
+            /* too large for the stack buffer, a column at a time */
+            u16 col[8];
+            u8 i, row;
+            
+            for( i = 0; i < font->advance; i++ )
+            {
+                u8 bits = disp_font_column( font, c, i );
+                
+                for( row = 0; row < font->height; row++, bits >>= 1 ) {
+                    col[row] = bits & 1 ? fg : bg;
+                }
+                
+                draw_bitmap( x + i, y, 1, font->height, col );
+            }
+        }
+    }
+    
+    /**
+     * @brief Draw str in one bus transaction.
+     *
+     * @return x after the last character
+     */
+    inline static disp_coord_t draw_string( disp_coord_t x, disp_coord_t y, const char *str,
+                                            const disp_font_t *font, u16 fg, u16 bg )
+    {
+        bus_begin();
+        
+        for( ; *str; str++, x += font->advance ) {
+            draw_char( x, y, *str, font, fg, bg );
+        }
+        
+        bus_end();
+        
+        return x;
+    }
+    
+    /**
+     * @brief put_pixel() for a fixed view, the bounds check and the
+     * window offsets compile down to constants.
+     *
+     * (x, y) are screen coordinates of VIEW. The clip and viewport stack
+     * is bypassed, push_viewport() and push_clip() do not apply. VIEW
+     * must be the rotation set_rotation() last set, otherwise the pixel
+     * lands elsewhere; with ST7789V_ASSERT that is checked.
+     */
+    template <class VIEW>
+    inline static void put_pixel( u16 x, u16 y, u16 color )
+    {
+#if ST7789V_ASSERT
+        assert( VIEW::rotation == m_st7789v_handle.rotation );
+#endif
+        
+        if( !VIEW::contains( x, y ) ) {
+            return;
+        }
+        
+        set_addr<VIEW>( x, y, x, y );
         write_wdata( color );
     }
     
+    /**
+     * @brief Tile sink for DispList, see disp_tile_ops_t.
+     */
+    static void flush_tile( void *ctx, const disp_area_t *area, const uint16_t *px )
+    {
+        ( void )ctx;
+        
+        set_addr( area->x1, area->y1, area->x2, area->y2 );
+        write_pixels( px, ( u32 )( area->x2 - area->x1 + 1 ) *
+                      ( area->y2 - area->y1 + 1 ) );
+    }
+    
+    /**
+     * @brief Gradient from c0 to c1, top to bottom when vertical, else
+     * left to right. A vertical gradient is one window for the whole
+     * rectangle; a horizontal one is one window per ST7789V_GRADIENT_CHUNK
+     * columns, each built once and sent for every row.
+     */
+    inline static void fill_gradient( disp_coord_t x, disp_coord_t y,
+                                      disp_coord_t w, disp_coord_t h,
+                                      u16 c0, u16 c1, bool vertical )
+    {
+        disp_area_t area = { x, y, ( disp_coord_t )( x + w - 1 ),
+                             ( disp_coord_t )( y + h - 1 )
+                           };
+        const disp_viewport_t *vp = disp_clip_current( &m_clip );
+        u16 line[ST7789V_GRADIENT_CHUNK];
+        disp_coord_t row, col;
+        
+        if( w <= 0 || h <= 0 || !disp_clip_area( &m_clip, &area ) ) {
+            return;
+        }
+        
+        x += vp->ox;
+        y += vp->oy;
+        
+        if( vertical )
+        {
+            set_addr( area.x1, area.y1, area.x2, area.y2 );
+            
+            for( row = area.y1; row <= area.y2; row++ ) {
+                write_color( rgb565_gradient_at( c0, c1, row - y, h ),
+                             area.x2 - area.x1 + 1 );
+            }
+            
+            return;
+        }
+        
+        for( col = area.x1; col <= area.x2; col += ST7789V_GRADIENT_CHUNK )
+        {
+            disp_coord_t n = disp_min( ST7789V_GRADIENT_CHUNK, area.x2 - col + 1 );
+            
+            rgb565_gradient_part( line, c0, c1, w, col - x, n );
+            set_addr( col, area.y1, col + n - 1, area.y2 );
+            
+            for( row = area.y1; row <= area.y2; row++ ) {
+                write_pixels( line, n );
+            }
+        }
+    }
+    
+    // RASTER API ***************************************************
+    /**
+     * @brief Span sinks for disp_raster.h, each span is one window and one
+     * color run. ctx of blend points to the u16 background, or NULL for
+     * black, since GRAM is not read back.
+     */
+    static void raster_span( void *ctx, disp_coord_t x, disp_coord_t y,
+                             disp_coord_t len, uint16_t color )
+    {
+        ( void )ctx;
+        
+        set_addr( x, y, x + len - 1, y );
+        write_color( color, len );
+    }
+    
+    static void raster_fill( void *ctx, disp_coord_t x, disp_coord_t y,
+                             disp_coord_t w, disp_coord_t h, uint16_t color )
+    {
+        ( void )ctx;
+        
+        set_addr( x, y, x + w - 1, y + h - 1 );
+        write_color( color, ( u32 )w * h );
+    }
+    
+    static void raster_blend( void *ctx, disp_coord_t x, disp_coord_t y,
+                              uint16_t color, uint8_t alpha )
+    {
+        u16 bg = ctx ? *( const u16 * )ctx : 0x0000;
+        
+        set_addr( x, y, x, y );
+        write_wdata( disp_rgb565_mix( color, bg, alpha ) );
+    }
+    
+    /**
+     * @brief A rasterizer bound to this panel and its clip stack.
+     *
+     * @param background anti-aliasing target color, NULL for black
+     */
+    inline static disp_raster_t raster( const u16 *background = NULL )
+    {
+        disp_raster_t r = { raster_span, raster_fill, raster_blend,
+                            ( void * )background, &m_clip, 0, 0
+                          };
+                          
+        return r;
+    }
+    
+    // COMPOSITOR API ***********************************************
+    static void line_window( void *ctx, const disp_area_t *area )
+    {
+        ( void )ctx;
+        
+        set_addr( area->x1, area->y1, area->x2, area->y2 );
+    }
+    
+    static void line_write( void *ctx, const uint16_t *px, disp_coord_t n )
+    {
+        ( void )ctx;
+        
+        write_pixels( px, n );
+    }
+    
+    /**
+     * @brief Line sink for DispCompositor, rows continue the RAMWR
+     * started by line_window().
+     */
+    inline static disp_line_ops_t line_ops()
+    {
+        disp_line_ops_t ops = { line_window, line_write, NULL };
+        
+        return ops;
+    }
+    
+    // SCHEDULER API ************************************************
+    /**
+     * @brief This panel as a SpiScheduler device, its steps reuse the
+     * nesting transaction of bus_begin()/bus_end().
+     */
+    inline static spi_device_t *bus_device()
+    {
+        return &m_bus_device;
+    }
+    
+    /**
+     * @brief Prepare a job streaming a window, from pixels or, when pixels
+     * is NULL, a single color. Submit &job->job to a SpiScheduler.
+     *
+     * @param chunk bytes per step, see spi_chunk_for_latency()
+     */
+    inline static void stream_job( st7789v_stream_job_t *job,
+                                   const disp_area_t *area,
+                                   const u16 *pixels, u16 color,
+                                   uint8_t priority, uint16_t chunk )
+    {
+        job->job.device   = &m_bus_device;
+        job->job.step     = stream_step;
+        job->job.done     = NULL;
+        job->job.ctx      = job;
+        job->job.priority = priority;
+        job->job.chunk    = chunk < 2 ? 2 : chunk;
+        job->job.next     = NULL;
+        
+        job->area   = *area;
+        job->pixels = pixels;
+        job->color  = color;
+        job->left   = ( u32 )( area->x2 - area->x1 + 1 ) * ( area->y2 - area->y1 + 1 );
+        job->open   = 0;
+    }
+    
+    static bool stream_step( void *ctx, uint16_t budget )
+    {
+        st7789v_stream_job_t *job = ( st7789v_stream_job_t * )ctx;
+        u32 n = budget / 2;
+        
+        if( !job->left ) {
+            return true;
+        }
+        
+        /*
+         * later chunks continue the same RAMWR while other devices use the
+         * bus; once anything else sent a command to this panel, the window
+         * is set again for what is left
+         */
+        if( m_window_job != job || !job->open ) {
+            stream_window( job );
+        }
+        
+        if( n > job->open ) {
+            n = job->open;
+        }
+        
+        if( job->pixels ) {
+            write_pixels( job->pixels, n );
+            job->pixels += n;
+        }
+        else {
+            write_color( job->color, n );
+        }
+        
+        job->left -= n;
+        job->open -= n;
+        
+        return job->left == 0;
+    }
+    
+    /* window of the pixels left, the rest of a started row comes first */
+    static void stream_window( st7789v_stream_job_t *job )
+    {
+        const disp_area_t *a = &job->area;
+        u16 w = a->x2 - a->x1 + 1;
+        u32 done = ( u32 )w * ( a->y2 - a->y1 + 1 ) - job->left;
+        u16 x = a->x1 + done % w;
+        u16 y = a->y1 + done / w;
+        
+        if( x != a->x1 ) {
+            set_addr( x, y, a->x2, y );
+            job->open = a->x2 - x + 1;
+        }
+        else {
+            set_addr( x, y, a->x2, a->y2 );
+            job->open = job->left;
+        }
+        
+        m_window_job = job;
+    }
+    
+    // JOB API ******************************************************
+    /**
+     * @brief fill_rect() as a resumable job, clipped now, sent in steps of
+     * at most chunk bytes by job_step(). Other jobs and draw calls may run
+     * in between, the job then sets its window again before the next step.
+     */
+    inline static void fill_job( st7789v_stream_job_t *job,
+                                 disp_coord_t x, disp_coord_t y,
+                                 disp_coord_t w, disp_coord_t h,
+                                 u16 color, uint16_t chunk )
+    {
+        disp_area_t area = { x, y, ( disp_coord_t )( x + w - 1 ),
+                             ( disp_coord_t )( y + h - 1 )
+                           };
+                           
+        stream_job( job, &area, NULL, color, 0, chunk );
+        
+        if( w <= 0 || h <= 0 || !disp_clip_area( &m_clip, &area ) ) {
+            job->left = 0;
+            return;
+        }
+        
+        job->area = area;
+        job->left = ( u32 )( area.x2 - area.x1 + 1 ) * ( area.y2 - area.y1 + 1 );
+    }
+    
+    /**
+     * @brief clear_screen_directly() as a resumable job, ignores the clip.
+     */
+    inline static void clear_job( st7789v_stream_job_t *job, u16 color, uint16_t chunk )
+    {
+        disp_area_t area = { 0, 0, ( disp_coord_t )( m_st7789v_handle.width - 1 ),
+                             ( disp_coord_t )( m_st7789v_handle.height - 1 )
+                           };
+                           
+        stream_job( job, &area, NULL, color, 0, chunk );
+    }
+    
+    /**
+     * @brief Do one chunk of a job, e.g. once per pass of loop().
+     *
+     * @return true when the job is finished
+     */
+    inline static bool job_step( st7789v_stream_job_t *job )
+    {
+        return stream_step( job, job->job.chunk );
+    }
+    
+    /**
+     * @brief Finish a job in one transaction, what the blocking calls do.
+     */
+    inline static void run_job( st7789v_stream_job_t *job )
+    {
+        bus_begin();
+        
+        while( !job_step( job ) );
+        
+        bus_end();
+    }
+    
 protected:
+    static void bus_begin_cb( void *ctx )
+    {
+        ( void )ctx;
+        bus_begin();
+    }
+    
+    static void bus_end_cb( void *ctx )
+    {
+        ( void )ctx;
+        bus_end();
+    }
+    
+    /**
+     * @brief Run an init sequence kept in flash. Each entry is the
+     * command, its parameter count, the parameters and a delay in ms.
+     */
+    inline static void init_display_P( const u8 *seq, size_t len )
+    {
+        const u8 *end = seq + len;
+        
+        while( seq < end )
+        {
+            u8 n;
+            
+            write_cmd( pgm_read_byte( seq++ ) );
+            n = pgm_read_byte( seq++ );
+            
+            while( n-- ) {
+                write_data( pgm_read_byte( seq++ ) );
+            }
+            
+            delay( pgm_read_byte( seq++ ) );
+        }
+        
+        set_display_power( true );
+    }
+    
     inline static void init_display( const void *cmdList, size_t cmdLen )
     {
         struct st7789v_cmd_param *disp_cmd = ( struct st7789v_cmd_param * )cmdList;